@@ -9,26 +9,54 @@
 
 #include <limits>
 #include <memory>
+#include <thread>
 #include <fstream>
+#include <numeric>
 #include <algorithm>
+#include <unordered_map>
 
 #include "file.h"
+#include "numa.h"
+#include "simd.h"
 #include "timer.h"
 #include "query.h"
 #include "decode_d0.h"
 #include "run_export.h"
 #include "commandline.h"
+#include "parser_query.h"
 #include "channel_file.h"
+#include "result_cache.h"
+#include "postings_cache.h"
+#include "allocator_pool.h"
 #include "compress_integer.h"
+#include "query_term_list.h"
+#include "JASS_anytime_cost.h"
+#include "JASS_anytime_load.h"
 #include "JASS_anytime_stats.h"
 #include "JASS_anytime_query.h"
 #include "deserialised_jass_v1.h"
 
+/*
+	If the line below is enabled then the global operator new and operator delete methods are overwridden
+	to check whether any memory is allocated during the processing of a query.  If the line is commented
+	out then the checks are disabled and the global operators are not overridden.  The checks are only
+	valid with one thread (-t 1) because the check is turned on and off for the whole process.
+*/
+//#define ENSURE_NO_ALLOCATIONS false				// uncomment this line to check for spurious memory allocations
+
+#ifdef ENSURE_NO_ALLOCATIONS
+	#include "global_new_delete.h"
+#endif
+
 constexpr size_t MAX_QUANTUM = 0x0FFF;
 constexpr size_t MAX_TERMS_PER_QUERY = 1024;
 
 constexpr size_t MAX_DOCUMENTS = 50'000'000;
 constexpr size_t MAX_TOP_K = 1'000;
+constexpr size_t MAX_BATCH = 64;							///< The largest batch (each query in a batch has its own accumulators)
+
+constexpr size_t PREFETCH_SEGMENTS = 4;					///< While processing a segment, prefetch the start of the segment this many ahead (0 = don't prefetch)
+constexpr size_t PREFETCH_BYTES = 256;					///< The number of bytes at the start of a segment's postings to prefetch
 
 /*
 	PARAMETERS
@@ -37,22 +65,134 @@ constexpr size_t MAX_TOP_K = 1'000;
 std::string parameter_queryfilename;				///< Name of file containing the queries
 size_t parameter_threads = 1;							///< Number of concurrent queries
 size_t parameter_top_k = 10;							///< Number of results to return
+std::string parameter_accumulators = "2d";			///< The accumulator management policy
+bool parameter_histogram = false;					///< Track the top-k with a histogram rather than a heap
+size_t parameter_accumulator_width = 0;			///< The number of bits in an accumulator (0 = choose from the index)
+bool parameter_pin = false;							///< Pin each thread to a CPU (spreading them across the NUMA nodes)
+bool parameter_replicate = false;					///< Copy the postings to each NUMA node (implies parameter_pin)
+size_t parameter_rate = 0;								///< Open-loop arrival rate in queries per second (0 = closed-loop)
+std::string parameter_arrivals;						///< Name of file containing the arrival time (in microseconds) of each query
+size_t parameter_sla = 0;								///< 99th percentile latency SLA in microseconds (0 = no sweep)
+size_t parameter_cache_mb = 0;						///< Size of the result cache in megabytes (0 = no cache)
+size_t parameter_decoded_mb = 0;						///< Size of the decoded postings cache in megabytes (0 = no cache)
+std::string parameter_warmup;							///< Name of file containing the queries used to choose the segments to decode in advance
+size_t parameter_batch = 1;							///< Number of queries each thread processes together (sharing the decoding of common segments)
+size_t parameter_target = 0;							///< Target time to process a query in microseconds (0 = no adaptive budget)
 
 std::string parameters_errors;						///< Any errors as a result of command line parsing
 auto parameters = std::make_tuple					///< The  command line parameter block
 	(
 	JASS::commandline::parameter("-q", "--queryfile", "Name of file containing a list of queries (1 per line, each line prefixed with query-id)", parameter_queryfilename),
 	JASS::commandline::parameter("-t", "--threads",   "Number of threads to use (one query per thread) [default = 1]", parameter_threads),
-	JASS::commandline::parameter("-k", "--top-k",     "Number of results to return to the user (top-k value) [default = 10]", parameter_top_k)
+	JASS::commandline::parameter("-k", "--top-k",     "Number of results to return to the user (top-k value) [default = 10]", parameter_top_k),
+	JASS::commandline::parameter("-a", "--accumulators", "Accumulator policy: 2d, bitmap (cache line pages), bitmap-page (4KB pages), simple (memset), epoch (epoch tagged, O(1) rewind), or hash (sized from the query, for short queries) [default = 2d]", parameter_accumulators),
+	JASS::commandline::parameter("-H", "--histogram",    "Track the top-k with a histogram of accumulator values rather than a heap", parameter_histogram),
+	JASS::commandline::parameter("-w", "--width",        "Accumulator width in bits: 8, 16, or 32 [default = the smallest that can hold the largest query score]", parameter_accumulator_width),
+	JASS::commandline::parameter("-P", "--pin",          "Pin each thread to a CPU, dealing the threads across the NUMA nodes", parameter_pin),
+	JASS::commandline::parameter("-R", "--replicate",    "Copy the postings to each NUMA node so that each thread reads a local copy (implies -P)", parameter_replicate),
+	JASS::commandline::parameter("-r", "--rate",         "Open-loop replay: queries arrive as a Poisson process at this many queries per second (or rescale the -A trace to this rate)", parameter_rate),
+	JASS::commandline::parameter("-A", "--arrivals",     "Open-loop replay: name of file containing the arrival time of each query (in microseconds, one per line)", parameter_arrivals),
+	JASS::commandline::parameter("-S", "--sla",          "Open-loop replay: raise the rate by 25% each run until the 99th percentile latency exceeds this many microseconds", parameter_sla),
+	JASS::commandline::parameter("-C", "--cache",        "Size (in MB) of a result cache shared by all threads, keyed on the sorted query terms, top-k, and postings budget (answers cut short by -T are not cached) [default = 0 (off)]", parameter_cache_mb),
+	JASS::commandline::parameter("-D", "--decoded",      "Size (in MB) of a cache of decoded impact segments shared by all threads, filled with the segments most used by the -W queries [default = 0 (off)]", parameter_decoded_mb),
+	JASS::commandline::parameter("-W", "--warmup",       "Name of file containing the queries used to fill the -D cache (1 per line, each line prefixed with query-id) [default = the -q queries]", parameter_warmup),
+	JASS::commandline::parameter("-b", "--batch",        "Number of queries each thread processes together, decoding each segment they share once (answers are ready when the batch is done).  Each query in a batch has its own accumulators (documents x width/8 bytes, or sized from the query with -a hash), so they take threads x batch times that [default = 1, maximum = 64]", parameter_batch),
+	JASS::commandline::parameter("-T", "--target",       "Give each query a postings budget predicted (by a cost model fitted as queries are processed) to keep its processing time under this many microseconds [default = 0 (off)]", parameter_target)
 	);
 
+/*
+	CACHE_KEY()
+	-----------
+*/
+/*!
+	@brief Build the result cache key for a query.
+	@details The key is the top-k and the postings budget followed by the query terms (not including the TREC topic ID) in sorted order, so that
+	queries that differ only in the order of their terms share an answer.  Repeated terms are kept as they change the scores.
+	@param key [out] The key is written here.
+	@param maximum_length [in] The size of key.
+	@param terms [in] The parsed query.
+	@param sorted [in] Space for MAX_TERMS_PER_QUERY pointers (used to sort the terms).
+	@param top_k [in] The number of results to return for each query.
+	@param postings_to_process [in] The anytime stopping criteria.
+	@return The length of the key, or 0 if the query cannot be cached (the key is too long).
+*/
+size_t cache_key(char *key, size_t maximum_length, const JASS::query_term_list &terms, const JASS::query_term **sorted, size_t top_k, size_t postings_to_process)
+	{
+	size_t length = sizeof(top_k) + sizeof(postings_to_process);
+	if (length > maximum_length)
+		return 0;
+	::memcpy(key, &top_k, sizeof(top_k));
+	::memcpy(key + sizeof(top_k), &postings_to_process, sizeof(postings_to_process));
+
+	size_t term_count = 0;
+	bool topic_id = true;
+	for (const auto &term : terms)
+		{
+		if (topic_id)
+			topic_id = false;
+		else if (term_count < MAX_TERMS_PER_QUERY)
+			sorted[term_count++] = &term;
+		else
+			return 0;
+		}
+
+	std::sort(sorted, sorted + term_count, [](const JASS::query_term *first, const JASS::query_term *second){ return JASS::slice::strict_weak_order_less_than(first->token(), second->token()); });
+
+	for (size_t which = 0; which < term_count; which++)
+		{
+		JASS::slice token = sorted[which]->token();
+		if (length + token.size() + 1 > maximum_length)
+			return 0;
+		::memcpy(key + length, token.address(), token.size());
+		length += token.size();
+		key[length++] = ' ';
+		}
+
+	return length;
+	}
+
+/*
+	CLASS SEGMENT_USE
+	-----------------
+*/
+/*!
+	@brief A segment that one of the queries in a batch needs to process.
+*/
+class segment_use
+	{
+	public:
+		uint64_t segment;					///< Offset (within the postings) of the segment header
+		size_t query;						///< The query in the batch that needs it
+	};
+
 /*
 	ANYTIME()
 	---------
 */
-template <typename DECODER>
-void anytime(std::ostream &output, const JASS::deserialised_jass_v1 &index, std::vector<JASS_anytime_query> &query_list, size_t postings_to_process, size_t top_k)
+/*!
+	@brief Process queries from query_list until there are none left.
+	@details The postings are read from postings, which is either the index's copy or a copy of it (see numa::replicate()).  The query objects and the
+	accumulators are allocated by the calling thread, so if it has been pinned they are on its NUMA node.  Queries are taken batch at a time and the
+	segments of all the queries in a batch are processed together, in impact order, so that a segment needed by several of them is decoded once and
+	added to each of their accumulators (see decoder_d1::decode_and_process()).  Each query still stops at its own postings budget.  The answers to
+	a batch are ready when the whole batch is done, so a batch larger than 1 trades latency for throughput.  Each query in a batch has its own query
+	object, so the accumulators take batch times the memory (unless they are sized from the query, see accumulator_hash).
+	@param output [out] The results are written here.
+	@param index [in] The index.
+	@param postings [in] The postings to use (index.postings() or a copy of it).
+	@param cache [in] The result cache (or nullptr if there isn't one).
+	@param decoded [in] The decoded postings cache (or nullptr if there isn't one).
+	@param cost [in] The cost model that sets each query's postings budget (or nullptr to use postings_to_process for every query).
+	@param query_list [in] The queries.
+	@param postings_to_process [in] The anytime stopping criteria (the largest postings budget any query can have).
+	@param top_k [in] The number of results to return for each query.
+	@param batch [in] The number of queries to process together.
+*/
+template <typename DECODER, typename ACCUMULATOR_TYPE, typename ACCUMULATORS, JASS::query_top_k TOP_K_METHOD>
+void anytime(std::ostream &output, const JASS::deserialised_jass_v1 &index, const uint8_t *postings, JASS::result_cache *cache, const JASS::postings_cache *decoded, anytime_cost *cost, std::vector<JASS_anytime_query> &query_list, size_t postings_to_process, size_t top_k, size_t batch)
 	{
+	typedef JASS::query<ACCUMULATOR_TYPE, MAX_DOCUMENTS, MAX_TOP_K, ACCUMULATORS, TOP_K_METHOD> query_type;
+
 	/*
 		Extract the compression scheme from the index
 	*/
@@ -61,76 +201,185 @@ void anytime(std::ostream &output, const JASS::deserialised_jass_v1 &index, std:
 	auto decoder = new DECODER(index.document_count() + 4096);				// Some decoders write past the end of the output buffer (e.g. GroupVarInt) so we allocate enough space for the overflow
 
 	/*
-		Allocate the Score-at-a-Time table
+		Allocate the Score-at-a-Time table (for all the queries in the batch).  It starts with room for one term of MAX_QUANTUM segments for each query
+		in the batch and grows when a batch has more segments than that (the most it can need, MAX_TERMS_PER_QUERY * MAX_QUANTUM per query, is 64MB each)
+	*/
+	std::vector<segment_use> segment_table(batch * MAX_QUANTUM);
+	segment_use *segment_order = segment_table.data();
+	segment_use *current_segment;
+
+	/*
+		Allocate, for each query in the batch, the result cache key and its length, the query it is, its postings budget, how many segments and postings it
+		has (then has processed), and whether it has stopped
+	*/
+	std::vector<std::vector<char>> key(batch, std::vector<char>(cache == nullptr ? 1 : cache->key_length_limit()));
+	std::vector<size_t> key_length(batch);
+	std::vector<JASS_anytime_query *> member(batch);
+	std::vector<size_t> budget(batch);
+	std::vector<size_t> segments_processed(batch);
+	std::vector<size_t> postings_processed(batch);
+	std::vector<uint8_t> finished(batch);
+	std::vector<query_type *> users(batch * MAX_TERMS_PER_QUERY);				// the queries that need the segment being processed (once for each time a query has the term)
+
+	/*
+		Allocate the space to sort the terms into, and the cached answer
 	*/
-	uint64_t *segment_order = new uint64_t [MAX_TERMS_PER_QUERY * MAX_QUANTUM];
-	uint64_t *current_segment;
+	std::vector<const JASS::query_term *> sorted_terms(MAX_TERMS_PER_QUERY);
+	JASS::result_cache::answer cached(index.primary_keys(), top_k);
+
+	/*
+		Writing the results to the output stream is I/O rather than search, and the stream grows as it does so, so it is not checked.
+	*/
+	auto write_results = [&output](const JASS::query_term &query_id, auto &results)
+		{
+		#ifdef ENSURE_NO_ALLOCATIONS
+			global_new_delete_return();				// disable checking
+			JASS::run_export(JASS::run_export::TREC, output, (char *)query_id.token().address(), results, "COMPILED", true);
+			global_new_delete_replace();				// enable checking
+		#else
+			JASS::run_export(JASS::run_export::TREC, output, (char *)query_id.token().address(), results, "COMPILED", true);
+		#endif
+		};
 
 	/*
 		Now start searching
 	*/
 	size_t next_query = 0;
-	std::string query = JASS_anytime_query::get_next_query(query_list, next_query);
+	const std::string *query = JASS_anytime_query::get_next_query(query_list, next_query);
 	/*
-		Allocate a JASS query object
+		Allocate a JASS query object for each query in the batch
 	*/
-	JASS::query<uint16_t, MAX_DOCUMENTS, MAX_TOP_K> *jass_query;
+	std::vector<query_type *> jass_query(batch);
 	try
 		{
-		jass_query = new JASS::query<uint16_t, MAX_DOCUMENTS, MAX_TOP_K>(index.primary_keys(), index.document_count(), top_k);
+		for (auto &current : jass_query)
+			current = new query_type(index.primary_keys(), index.document_count(), top_k);
 		}
 	catch (std::bad_array_new_length &error)
 		{
 		exit(printf("Can't load index as the number of documents is too large - change MAX_DOCUMENTS in %s\n", __FILE__));
 		}
 
-	while (query.size() != 0)
-		{
-		jass_query->parse(query);
-		auto &terms = jass_query->terms();
-		auto query_id = terms[0];
+	#ifdef ENSURE_NO_ALLOCATIONS
+		global_new_delete_replace();				// enable checking
+	#endif
 
+	while (query != nullptr)
+		{
 		/*
-			Parse the query and extract the list of impact segments
+			Take queries until the batch is full (or there are none left), gathering the impact segments of those that aren't in the result cache
 		*/
+		size_t members = 0;
 		current_segment = segment_order;
-		size_t term_id = 0;
-		for (const auto &term : terms)
+		while (query != nullptr && members < batch)
 			{
 			/*
-				Count which term we're on (and ignore the first as its the TREC topic ID)
+				In an open-loop replay wait until the query arrives, otherwise it arrives now.  get_next_query() leaves next_query at the query it returned.
 			*/
-			term_id++;
-			if (term_id == 1)
-				continue;
+			JASS_anytime_query &current_query = query_list[next_query];
+			if (current_query.scheduled)
+				while (JASS::timer::start() < current_query.arrival)
+					std::this_thread::yield();
+			else
+				current_query.arrival = JASS::timer::start();
 
-//	std::cout << "TERM:" << term << "\n";
+			jass_query[members]->parse(*query);
+			auto &terms = jass_query[members]->terms();
 
 			/*
-				Get the metadata for this term (and if this term isn't in the vocab them move on to the next term)
+				If the answer is in the result cache then there's nothing to do
 			*/
-			JASS::deserialised_jass_v1::metadata metadata;
-			if (!index.postings_details(metadata, term))
-				continue;
+			key_length[members] = cache == nullptr ? 0 : cache_key(&key[members][0], key[members].size(), terms, &sorted_terms[0], top_k, postings_to_process);
+			if (key_length[members] != 0 && cache->find(&key[members][0], key_length[members], cached))
+				{
+				current_query.latency_in_ns = JASS::timer::stop(current_query.arrival).nanoseconds();
+				write_results(terms[0], cached);
+				}
+			else
+				{
+				/*
+					Parse the query and extract the list of impact segments
+				*/
+				size_t term_id = 0;
+				for (const auto &term : terms)
+					{
+					/*
+						Count which term we're on (and ignore the first as its the TREC topic ID)
+					*/
+					term_id++;
+					if (term_id == 1)
+						continue;
 
-			/*
-				Add to the list of imact segments that need to be processed
-			*/
-			std::copy((uint64_t *)(metadata.offset), (uint64_t *)(metadata.offset) + metadata.impacts, current_segment);
-			current_segment += metadata.impacts;
+//	std::cout << "TERM:" << term << "\n";
+
+					/*
+						Get the metadata for this term (and if this term isn't in the vocab them move on to the next term)
+					*/
+					JASS::deserialised_jass_v1::metadata metadata;
+					if (!index.postings_details(metadata, term))
+						continue;
+
+					/*
+						Make sure the Score-at-a-Time table has room for this term's segments
+					*/
+					size_t used = current_segment - segment_order;
+					if (used + metadata.impacts > segment_table.size())
+						{
+						#ifdef ENSURE_NO_ALLOCATIONS
+							global_new_delete_return();				// the table only grows when a batch has more segments than any before it
+							segment_table.resize((std::max)(2 * segment_table.size(), used + metadata.impacts));
+							global_new_delete_replace();
+						#else
+							segment_table.resize((std::max)(2 * segment_table.size(), used + metadata.impacts));
+						#endif
+						segment_order = segment_table.data();
+						current_segment = segment_order + used;
+						}
+
+					/*
+						Add to the list of imact segments that need to be processed
+					*/
+					const uint64_t *segments = reinterpret_cast<const uint64_t *>(postings + (metadata.offset - index.postings()));
+					for (const uint64_t *segment = segments; segment < segments + metadata.impacts; segment++)
+						{
+						current_segment->segment = *segment;
+						current_segment->query = members;
+						current_segment++;
+
+						/*
+							The sort reads every segment header, so start loading them now (they are all over the postings)
+						*/
+						JASS::simd::prefetch(postings + *segment, sizeof(JASS::deserialised_jass_v1::segment_header));
+						}
+					}
+
+				member[members] = &current_query;
+				budget[members] = postings_to_process;
+				segments_processed[members] = 0;
+				postings_processed[members] = 0;
+				finished[members] = false;
+				members++;
+				}
+
+			query = JASS_anytime_query::get_next_query(query_list, next_query);
 			}
 
+		if (members == 0)
+			continue;
+
+		auto processing_time = JASS::timer::start();
+
 		/*
-			Sort the segments from highest impact to lowest impact
+			Sort the segments from highest impact to lowest impact, keeping the uses of the same segment together
 		*/
 		std::sort
 			(
 			segment_order,
 			current_segment,
-			[postings = index.postings()](uint64_t first, uint64_t second)
+			[postings](const segment_use &first, const segment_use &second)
 				{
-				JASS::deserialised_jass_v1::segment_header *lhs = (JASS::deserialised_jass_v1::segment_header *)(postings + first);
-				JASS::deserialised_jass_v1::segment_header *rhs = (JASS::deserialised_jass_v1::segment_header *)(postings + second);
+				JASS::deserialised_jass_v1::segment_header *lhs = (JASS::deserialised_jass_v1::segment_header *)(postings + first.segment);
+				JASS::deserialised_jass_v1::segment_header *rhs = (JASS::deserialised_jass_v1::segment_header *)(postings + second.segment);
 
 				/*
 					sort from highest to lowest impact, but break ties by placing the lowest quantum-frequency first and the highest quantum-drequency last
@@ -139,52 +388,478 @@ void anytime(std::ostream &output, const JASS::deserialised_jass_v1 &index, std:
 					return false;
 				else if (lhs->impact > rhs->impact)
 					return true;
-				else			// impact scores are the same, so tie break on the length of the segment
+				else if (lhs->segment_frequency != rhs->segment_frequency)			// impact scores are the same, so tie break on the length of the segment
 					return lhs->segment_frequency < rhs->segment_frequency;
+				else
+					return first.segment < second.segment || (first.segment == second.segment && first.query < second.query);
 				}
 			);
 
 		/*
-			0 terminate the list of segments
+			Each segment's postings are somewhere else in memory so prefetch the start of the segment PREFETCH_SEGMENTS ahead while processing this one.
+			In a batch the uses of a segment by different queries are next to each other, so prefetch_next() prefetches a segment and skips all its uses.
+			prefetched is the next segment to prefetch.
 		*/
-		*current_segment = 0;
+		segment_use *prefetched = segment_order;
+		auto prefetch_next = [postings, current_segment, &prefetched](void)
+			{
+			uint64_t segment = prefetched->segment;
+			const JASS::deserialised_jass_v1::segment_header &header = *reinterpret_cast<const JASS::deserialised_jass_v1::segment_header *>(postings + segment);
+			JASS::simd::prefetch(postings + header.offset, (std::min)(static_cast<size_t>(header.end - header.offset), PREFETCH_BYTES));
+			do
+				prefetched++;
+			while (prefetched < current_segment && prefetched->segment == segment);
+			};
+		for (size_t ahead = 0; ahead < PREFETCH_SEGMENTS && prefetched < current_segment; ahead++)
+			prefetch_next();
 
 		/*
-			Process the segments
+			Count how many segments and postings each query has (the sort has read all the headers so this is cheap), and ask the cost model for its budget.
+			The budget is always at least the query's highest impact segment so that every query has an answer.  The result cache key has postings_to_process
+			in it, not the budget, so the answer to a query the model truncated must not go into the result cache (it would be served as the full answer).
+			Then rewind the query, telling it the most postings it will process (accumulator_hash is sized from this).
 		*/
-		jass_query->rewind();
+		if (cost != nullptr)
+			std::fill(budget.begin(), budget.begin() + members, 0);
+		for (segment_use *current = segment_order; current < current_segment; current++)
+			{
+			const JASS::deserialised_jass_v1::segment_header &header = *reinterpret_cast<const JASS::deserialised_jass_v1::segment_header *>(postings + current->segment);
+			if (segments_processed[current->query]++ == 0 && cost != nullptr)
+				budget[current->query] = header.segment_frequency;
+			postings_processed[current->query] += header.segment_frequency;
+			}
+		for (size_t which = 0; which < members; which++)
+			{
+			if (cost != nullptr)
+				{
+				budget[which] = (std::min)(postings_to_process, (std::max)(budget[which], cost->budget(segments_processed[which], postings_processed[which])));
+				if (budget[which] < (std::min)(postings_to_process, postings_processed[which]))
+					key_length[which] = 0;
+				}
+			#ifdef ENSURE_NO_ALLOCATIONS
+				global_new_delete_return();				// accumulator_hash grows (between searches) when a query has more postings than any before it
+				jass_query[which]->rewind((std::min)(budget[which], postings_processed[which]));
+				global_new_delete_replace();
+			#else
+				jass_query[which]->rewind((std::min)(budget[which], postings_processed[which]));
+			#endif
+			segments_processed[which] = 0;
+			postings_processed[which] = 0;
+			}
 
-		size_t postings_processed = 0;
-		for (uint64_t *current = segment_order; current < current_segment; current++)
+		/*
+			Process the segments
+		*/
+		size_t unfinished = members;
+		for (segment_use *current = segment_order; current < current_segment && unfinished != 0;)
 			{
-//	std::cout << "Process Segment->(" << ((JASS::deserialised_jass_v1::segment_header *)(index.postings() + *current))->impact << ":" << ((JASS::deserialised_jass_v1::segment_header *)(index.postings() + *current))->segment_frequency << ")\n";
-			const JASS::deserialised_jass_v1::segment_header &header = *reinterpret_cast<const JASS::deserialised_jass_v1::segment_header *>(index.postings() + *current);
+			if (PREFETCH_SEGMENTS != 0 && prefetched < current_segment)
+				prefetch_next();
+
+//	std::cout << "Process Segment->(" << ((JASS::deserialised_jass_v1::segment_header *)(postings + current->segment))->impact << ":" << ((JASS::deserialised_jass_v1::segment_header *)(postings + current->segment))->segment_frequency << ")\n";
+			uint64_t segment = current->segment;
+			const JASS::deserialised_jass_v1::segment_header &header = *reinterpret_cast<const JASS::deserialised_jass_v1::segment_header *>(postings + segment);
 
 			/*
-				The anytime algorithms basically boils down to this... have we processed enough postings yet?  If so then stop
+				Find the queries that need this segment.  The anytime algorithms basically boils down to this... has the query processed enough postings yet?  If so then it stops
 			*/
-			if (postings_processed + header.segment_frequency > postings_to_process)
-				break;
-			postings_processed += header.segment_frequency;
+			size_t user_count = 0;
+			do
+				{
+				size_t which = current->query;
+				if (!finished[which])
+					{
+					if (postings_processed[which] + header.segment_frequency > budget[which])
+						{
+						finished[which] = true;
+						unfinished--;
+						}
+					else
+						{
+						postings_processed[which] += header.segment_frequency;
+						segments_processed[which]++;
+						users[user_count++] = jass_query[which];
+						}
+					}
+				current++;
+				}
+			while (current < current_segment && current->segment == segment);
+
+			if (user_count == 0)
+				continue;
 
 			/*
-				Process the postings
+				Process the postings (those in the decoded postings cache are already decoded)
 			*/
 			uint16_t impact = header.impact;
-			decoder->decode(decompressor, header.segment_frequency, index.postings() + header.offset, header.end - header.offset);
-			decoder->process(impact, *jass_query);
+			const uint32_t *document_ids = decoded == nullptr ? nullptr : decoded->find(segment);
+			if (document_ids != nullptr)
+				for (size_t which = 0; which < user_count; which++)
+					users[which]->add_rsv_block(document_ids, header.segment_frequency, impact);
+			else
+				decoder->decode_and_process(impact, &users[0], user_count, decompressor, header.segment_frequency, postings + header.offset, header.end - header.offset);
+			}
+
+		/*
+			Sort the answers (the queries are done)
+		*/
+		for (size_t which = 0; which < members; which++)
+			{
+			JASS_anytime_query &current_query = *member[which];
+			jass_query[which]->sort();
+			current_query.latency_in_ns = JASS::timer::stop(current_query.arrival).nanoseconds();
 			}
 
-		jass_query->sort();
-		JASS::run_export(JASS::run_export::TREC, output, (char *)query_id.token().address(), *jass_query, "COMPILED", true);
-		query = JASS_anytime_query::get_next_query(query_list, next_query);
+		/*
+			Tell the cost model how long the batch took to process
+		*/
+		if (cost != nullptr)
+			{
+			uint64_t took = JASS::timer::stop(processing_time).nanoseconds();
+			size_t segments = std::accumulate(segments_processed.begin(), segments_processed.begin() + members, static_cast<size_t>(0));
+			size_t postings_done = std::accumulate(postings_processed.begin(), postings_processed.begin() + members, static_cast<size_t>(0));
+			cost->observe(members, segments, postings_done, took);
+			}
+
+		/*
+			Put the answers in the result cache and write them out
+		*/
+		for (size_t which = 0; which < members; which++)
+			{
+			if (key_length[which] != 0)
+				{
+				cached.size = 0;
+				for (const auto &document : *jass_query[which])
+					cached.push_back(document.document_id, document.rsv);
+				cache->insert(&key[which][0], key_length[which], cached);
+				}
+
+			write_results(jass_query[which]->terms()[0], *jass_query[which]);
+			}
 		}
 
-	delete jass_query;
-	delete [] segment_order;
+	#ifdef ENSURE_NO_ALLOCATIONS
+		global_new_delete_return();				// disable checking
+	#endif
+
+	for (auto &current : jass_query)
+		delete current;
 	delete decoder;
 	}
 
+/*
+	ANYTIME_METHOD
+	--------------
+*/
+/*!
+	@brief The type of an instance of anytime() (one per decoder, accumulator type, and accumulator policy).
+*/
+typedef void (*anytime_method)(std::ostream &output, const JASS::deserialised_jass_v1 &index, const uint8_t *postings, JASS::result_cache *cache, const JASS::postings_cache *decoded, anytime_cost *cost, std::vector<JASS_anytime_query> &query_list, size_t postings_to_process, size_t top_k, size_t batch);
+
+/*
+	SELECT_ANYTIME()
+	----------------
+*/
+/*!
+	@brief Choose the instance of anytime() that uses the given accumulator policy and way of tracking the top-k.
+	@param accumulators [in] The name of the accumulator policy.
+	@return The instance of anytime(), or nullptr if the policy is not known.
+*/
+template <typename DECODER, typename ACCUMULATOR_TYPE, JASS::query_top_k TOP_K_METHOD>
+anytime_method select_anytime(const std::string &accumulators)
+	{
+	if (accumulators == "2d")
+		return anytime<DECODER, ACCUMULATOR_TYPE, JASS::accumulator_2d<ACCUMULATOR_TYPE, MAX_DOCUMENTS>, TOP_K_METHOD>;
+	else if (accumulators == "bitmap")
+		return anytime<DECODER, ACCUMULATOR_TYPE, JASS::accumulator_bitmap<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 64>, TOP_K_METHOD>;
+	else if (accumulators == "bitmap-page")
+		return anytime<DECODER, ACCUMULATOR_TYPE, JASS::accumulator_bitmap<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 4096>, TOP_K_METHOD>;
+	else if (accumulators == "simple")
+		return anytime<DECODER, ACCUMULATOR_TYPE, JASS::accumulator_simple<ACCUMULATOR_TYPE, MAX_DOCUMENTS>, TOP_K_METHOD>;
+	else if (accumulators == "epoch")
+		return anytime<DECODER, ACCUMULATOR_TYPE, JASS::accumulator_epoch<ACCUMULATOR_TYPE, MAX_DOCUMENTS>, TOP_K_METHOD>;
+	else if (accumulators == "hash")
+		return anytime<DECODER, ACCUMULATOR_TYPE, JASS::accumulator_hash<ACCUMULATOR_TYPE, MAX_DOCUMENTS>, TOP_K_METHOD>;
+	else
+		return nullptr;
+	}
+
+/*
+	SELECT_ANYTIME()
+	----------------
+*/
+/*!
+	@brief Choose the instance of anytime() that uses the given accumulator width, accumulator policy, and way of tracking the top-k.
+	@details The histogram has one counter per accumulator value so it cannot be used with 32-bit accumulators.
+	@param accumulators [in] The name of the accumulator policy.
+	@param histogram [in] true to track the top-k with a histogram, false to use a heap.
+	@param bits [in] The width of an accumulator (8, 16, or 32).
+	@return The instance of anytime(), or nullptr if the policy is not known or the combination is not possible.
+*/
+template <typename DECODER>
+anytime_method select_anytime(const std::string &accumulators, bool histogram, size_t bits)
+	{
+	switch (bits)
+		{
+		case 8:
+			return histogram ? select_anytime<DECODER, uint8_t, JASS::TOP_K_HISTOGRAM>(accumulators) : select_anytime<DECODER, uint8_t, JASS::TOP_K_HEAP>(accumulators);
+		case 16:
+			return histogram ? select_anytime<DECODER, uint16_t, JASS::TOP_K_HISTOGRAM>(accumulators) : select_anytime<DECODER, uint16_t, JASS::TOP_K_HEAP>(accumulators);
+		case 32:
+			return histogram ? nullptr : select_anytime<DECODER, uint32_t, JASS::TOP_K_HEAP>(accumulators);
+		default:
+			return nullptr;
+		}
+	}
+
+/*
+	WORKER()
+	--------
+*/
+/*!
+	@brief Run an instance of anytime() as the given worker thread, optionally pinned to a CPU and reading a copy of the postings on its NUMA node.
+	@param method [in] The instance of anytime() to run.
+	@param thread [in] The worker thread number (from 0).
+	@param output [out] The results are written here.
+	@param index [in] The index.
+	@param replicas [in] A copy of the postings for each NUMA node (or empty, or nullptr for a node, to use the index's copy).
+	@param cache [in] The result cache (or nullptr if there isn't one).
+	@param decoded [in] The decoded postings cache (or nullptr if there isn't one).
+	@param cost [in] The cost model that sets each query's postings budget (or nullptr to use postings_to_process for every query).
+	@param query_list [in] The queries.
+	@param postings_to_process [in] The anytime stopping criteria.
+	@param top_k [in] The number of results to return for each query.
+*/
+void worker(anytime_method method, size_t thread, std::ostream &output, const JASS::deserialised_jass_v1 &index, const std::vector<std::unique_ptr<uint8_t[]>> &replicas, JASS::result_cache *cache, const JASS::postings_cache *decoded, anytime_cost *cost, std::vector<JASS_anytime_query> &query_list, size_t postings_to_process, size_t top_k)
+	{
+	if (parameter_pin && !JASS::numa::pin(JASS::numa::cpu_for_thread(thread)))
+		std::cout << "Thread " + std::to_string(thread) + " could not be pinned to CPU " + std::to_string(JASS::numa::cpu_for_thread(thread)) + "\n";
+
+	const uint8_t *postings = replicas.size() == 0 ? nullptr : replicas[JASS::numa::node_for_thread(thread)].get();
+	if (postings == nullptr)
+		postings = index.postings();
+	method(output, index, postings, cache, decoded, cost, query_list, postings_to_process, top_k, parameter_batch);
+	}
+
+/*
+	SEARCH()
+	--------
+*/
+/*!
+	@brief Process all the queries in query_list using parameter_threads threads.
+	@param method [in] The instance of anytime() to run.
+	@param output [out] The results from each thread are written to its own stream.
+	@param index [in] The index.
+	@param replicas [in] A copy of the postings for each NUMA node (or empty, or nullptr for a node, to use the index's copy).
+	@param cache [in] The result cache (or nullptr if there isn't one).
+	@param decoded [in] The decoded postings cache (or nullptr if there isn't one).
+	@param cost [in] The cost model that sets each query's postings budget (or nullptr to use postings_to_process for every query).
+	@param query_list [in] The queries.
+	@param postings_to_process [in] The anytime stopping criteria.
+	@param top_k [in] The number of results to return for each query.
+	@return The time taken (in nanoseconds).
+*/
+uint64_t search(anytime_method method, std::vector<std::ostringstream> &output, const JASS::deserialised_jass_v1 &index, const std::vector<std::unique_ptr<uint8_t[]>> &replicas, JASS::result_cache *cache, const JASS::postings_cache *decoded, anytime_cost *cost, std::vector<JASS_anytime_query> &query_list, size_t postings_to_process, size_t top_k)
+	{
+	auto total_search_time = JASS::timer::start();
+	if (parameter_threads == 1)
+		{
+		/*
+			We have only 1 thread so don't bother to start a thread to do the work
+		*/
+		worker(method, 0, output[0], index, replicas, cache, decoded, cost, query_list, postings_to_process, top_k);
+		}
+	else
+		{
+		/*
+			Multiple threads, so start each worker
+		*/
+		std::vector<std::thread> thread_pool;
+		for (size_t which = 0; which < parameter_threads ; which++)
+			thread_pool.push_back(std::thread(worker, method, which, std::ref(output[which]), std::ref(index), std::cref(replicas), cache, decoded, cost, std::ref(query_list), postings_to_process, top_k));
+
+		/*
+			Wait until they're all done (blocking on the completion of each thread in turn)
+		*/
+		for (auto &thread : thread_pool)
+			thread.join();
+		}
+
+	return JASS::timer::stop(total_search_time).nanoseconds();
+	}
+
+/*
+	REPLAY()
+	--------
+*/
+/*!
+	@brief Replay the queries open-loop, with the arrival times in load, and fill in load's latency statistics.
+	@details Threads take the queries in order, so this is a single first-come first-served queue in front of parameter_threads servers.  The
+	replay starts 10ms after the call so that the threads are running before the first query arrives.
+	@param load [in/out] The arrival times (in), and the latencies and achieved rate (out).
+	@param method [in] The instance of anytime() to run.
+	@param output [out] The results from each thread are written to its own stream.
+	@param index [in] The index.
+	@param replicas [in] A copy of the postings for each NUMA node (or empty, or nullptr for a node, to use the index's copy).
+	@param cache [in] The result cache (or nullptr if there isn't one).
+	@param decoded [in] The decoded postings cache (or nullptr if there isn't one).
+	@param cost [in] The cost model that sets each query's postings budget (or nullptr to use postings_to_process for every query).
+	@param query_list [in] The queries (only the first load.arrival_in_ns.size() are replayed).
+	@param postings_to_process [in] The anytime stopping criteria.
+	@param top_k [in] The number of results to return for each query.
+	@return The time taken to process the queries (in nanoseconds).
+*/
+uint64_t replay(anytime_load &load, anytime_method method, std::vector<std::ostringstream> &output, const JASS::deserialised_jass_v1 &index, const std::vector<std::unique_ptr<uint8_t[]>> &replicas, JASS::result_cache *cache, const JASS::postings_cache *decoded, anytime_cost *cost, std::vector<JASS_anytime_query> &query_list, size_t postings_to_process, size_t top_k)
+	{
+	size_t queries = load.arrival_in_ns.size();
+	auto start = JASS::timer::start() + std::chrono::milliseconds(10);
+	for (size_t which = 0; which < query_list.size(); which++)
+		{
+		query_list[which].taken = which >= queries;				// queries without an arrival time are not replayed
+		query_list[which].scheduled = true;
+		if (which < queries)
+			query_list[which].arrival = start + std::chrono::nanoseconds(load.arrival_in_ns[which]);
+		}
+	for (auto &stream : output)
+		stream.str("");
+
+	uint64_t search_time = search(method, output, index, replicas, cache, decoded, cost, query_list, postings_to_process, top_k);
+	uint64_t took = JASS::timer::stop(start).nanoseconds();
+
+	load.achieved_rate = took == 0 ? 0 : queries * 1'000'000'000.0 / took;
+	load.latency_in_ns.clear();
+	for (size_t which = 0; which < queries; which++)
+		load.latency_in_ns.push_back(query_list[which].latency_in_ns);
+	std::sort(load.latency_in_ns.begin(), load.latency_in_ns.end());
+
+	return search_time;
+	}
+
+/*
+	MAXIMUM_QUERY_SCORE()
+	---------------------
+*/
+/*!
+	@brief Return the largest score any document could get for any of the queries.
+	@details A document's score is the sum of the impacts of the query terms it contains, so the largest possible score for a query is the
+	sum of the largest impact of each of its terms (counting repeated terms each time, as the search does).
+	@param index [in] The index.
+	@param query_list [in] The queries.
+	@return The largest possible score.
+*/
+uint64_t maximum_query_score(const JASS::deserialised_jass_v1 &index, std::vector<JASS_anytime_query> &query_list)
+	{
+	JASS::allocator_pool memory;
+	JASS::parser_query parser(memory);
+	uint64_t largest = 0;
+
+	for (const auto &query : query_list)
+		{
+		memory.recycle();
+		JASS::query_term_list *terms = new (memory.malloc(sizeof(JASS::query_term_list))) JASS::query_term_list(memory);
+		parser.parse(*terms, query.query);
+
+		uint64_t score = 0;
+		size_t term_id = 0;
+		for (const auto &term : *terms)
+			{
+			/*
+				Ignore the first term as its the TREC topic ID
+			*/
+			if (++term_id == 1)
+				continue;
+
+			JASS::deserialised_jass_v1::metadata metadata;
+			if (index.postings_details(metadata, term))
+				score += index.maximum_impact(metadata);
+			}
+
+		largest = (std::max)(largest, score);
+		}
+
+	return largest;
+	}
+
+/*
+	FILL_POSTINGS_CACHE()
+	---------------------
+*/
+/*!
+	@brief Decode the segments most used by the warm-up queries into the decoded postings cache.
+	@details Each segment is counted once for each warm-up query that has the segment's term, and the most used are decoded first (on a tie the
+	highest impact first, as those are processed first).  Segments that do not fit are skipped so that smaller, less used, segments can fill the space.
+	@param decoded [out] The cache to fill.
+	@param index [in] The index.
+	@param warmup [in] The warm-up queries.
+	@param d1 [in] true if the postings are D1 encoded, false if they are D0.
+*/
+void fill_postings_cache(JASS::postings_cache &decoded, const JASS::deserialised_jass_v1 &index, std::vector<JASS_anytime_query> &warmup, bool d1)
+	{
+	JASS::allocator_pool memory;
+	JASS::parser_query parser(memory);
+	std::unordered_map<uint64_t, size_t> uses;
+
+	for (const auto &query : warmup)
+		{
+		memory.recycle();
+		JASS::query_term_list *terms = new (memory.malloc(sizeof(JASS::query_term_list))) JASS::query_term_list(memory);
+		parser.parse(*terms, query.query);
+
+		size_t term_id = 0;
+		for (const auto &term : *terms)
+			{
+			/*
+				Ignore the first term as its the TREC topic ID
+			*/
+			if (++term_id == 1)
+				continue;
+
+			JASS::deserialised_jass_v1::metadata metadata;
+			if (index.postings_details(metadata, term))
+				{
+				const uint64_t *segments = reinterpret_cast<const uint64_t *>(metadata.offset);
+				for (size_t which = 0; which < metadata.impacts; which++)
+					uses[segments[which]]++;
+				}
+			}
+		}
+
+	/*
+		Order the segments from most to least used
+	*/
+	const uint8_t *postings = index.postings();
+	std::vector<std::pair<uint64_t, size_t>> order(uses.begin(), uses.end());
+	std::sort
+		(
+		order.begin(),
+		order.end(),
+		[postings](const std::pair<uint64_t, size_t> &first, const std::pair<uint64_t, size_t> &second)
+			{
+			if (first.second != second.second)
+				return first.second > second.second;
+			uint16_t first_impact = reinterpret_cast<const JASS::deserialised_jass_v1::segment_header *>(postings + first.first)->impact;
+			uint16_t second_impact = reinterpret_cast<const JASS::deserialised_jass_v1::segment_header *>(postings + second.first)->impact;
+			return first_impact != second_impact ? first_impact > second_impact : first.first < second.first;
+			}
+		);
+
+	/*
+		Decode them into the cache
+	*/
+	std::string codex_name;
+	JASS::compress_integer &decompressor = index.codex(codex_name);
+	std::vector<uint32_t> document_ids(index.document_count() + 4096);				// Some decoders write past the end of the output buffer (e.g. GroupVarInt)
+	for (const auto &segment : order)
+		{
+		const JASS::deserialised_jass_v1::segment_header &header = *reinterpret_cast<const JASS::deserialised_jass_v1::segment_header *>(postings + segment.first);
+		if (d1)
+			decompressor.decode_d1(document_ids.data(), header.segment_frequency, postings + header.offset, header.end - header.offset);
+		else
+			decompressor.decode(document_ids.data(), header.segment_frequency, postings + header.offset, header.end - header.offset);
+		decoded.insert(segment.first, document_ids.data(), header.segment_frequency);
+		}
+	}
+
 /*
 	MAIN()
 	------
@@ -201,6 +876,32 @@ int main(int argc, const char *argv[])
 		exit(1);
 		}
 
+	#ifdef ENSURE_NO_ALLOCATIONS
+		if (parameter_threads != 1)
+			{
+			std::cout << "ENSURE_NO_ALLOCATIONS is defined in " << __FILE__ << " so only one thread can be used.\n";
+			exit(1);
+			}
+	#endif
+
+	if (parameter_batch == 0)
+		{
+		std::cout << "The batch size must be at least 1\n";
+		exit(1);
+		}
+
+	if (parameter_batch > MAX_BATCH)
+		{
+		std::cout << "batch size specified (" << parameter_batch << ") is larger than maximum batch size (" << MAX_BATCH << "), change MAX_BATCH in " << __FILE__  << " and recompile.\n";
+		exit(1);
+		}
+
+	if (parameter_top_k == 0)
+		{
+		std::cout << "The top-k must be at least 1\n";
+		exit(1);
+		}
+
 	if (parameter_top_k > MAX_TOP_K)
 		{
 		std::cout << "top-k specified (" << parameter_top_k << ") is larger than maximum TOP-K (" << MAX_TOP_K << "), change MAX_TOP_K in " << __FILE__  << " and recompile.\n";
@@ -250,60 +951,152 @@ int main(int argc, const char *argv[])
 		}
 
 	/*
-		Allocate a thread pool and the place to put the answers
+		Allocate the place to put the answers
 	*/
-	std::vector<std::thread> thread_pool;
 	std::vector<std::ostringstream> output;
 	output.resize(parameter_threads);
 
 	/*
-		Start the work
+		Choose the accumulator width.  The narrowest that can hold the largest possible score is used (8-bit accumulators saturate so
+		they are safe, but fit twice as many accumulators in cache as 16-bit accumulators).
+	*/
+	size_t bits = parameter_accumulator_width;
+	if (bits == 0)
+		{
+		uint64_t largest_score = maximum_query_score(index, query_list);
+		bits = largest_score <= (std::numeric_limits<uint8_t>::max)() ? 8 : largest_score <= (std::numeric_limits<uint16_t>::max)() ? 16 : 32;
+		}
+	if (bits != 8 && bits != 16 && bits != 32)
+		{
+		std::cout << "Accumulator width must be 8, 16, or 32 bits (not " << bits << ")\n";
+		exit(1);
+		}
+	if (bits == 32 && parameter_histogram)
+		{
+		std::cout << "The histogram top-k cannot be used with 32-bit accumulators\n";
+		exit(1);
+		}
+
+	stats.accumulator_width = bits;
+
+	/*
+		Choose the decoder (from the index) and the accumulator width and policy
 	*/
 	std::string codex_name;
 	index.codex(codex_name);
-	uint32_t d_ness = codex_name == "None" ? 0 : 1;
+	anytime_method method = codex_name == "None" ? select_anytime<JASS::decoder_d0>(parameter_accumulators, parameter_histogram, bits) : select_anytime<JASS::decoder_d1>(parameter_accumulators, parameter_histogram, bits);
+	if (method == nullptr)
+		{
+		std::cout << "Unknown accumulator policy: " << parameter_accumulators << "\n";
+		exit(1);
+		}
 
 	/*
-		Start the work
+		If asked, put a copy of the postings on each NUMA node (before the clock starts as this is part of loading the index)
 	*/
-	auto total_search_time = JASS::timer::start();
-	if (parameter_threads == 1)
+	std::vector<std::unique_ptr<uint8_t[]>> replicas;
+	if (parameter_replicate)
 		{
-		/*
-			We have only 1 thread so don't bother to start a thread to do the work
-		*/
-		switch (d_ness)
+		parameter_pin = true;
+		if (JASS::numa::nodes() > 1)
+			for (size_t node = 0; node < JASS::numa::nodes(); node++)
+				{
+				replicas.push_back(JASS::numa::replicate(index.postings(), index.postings_size(), node));
+				if (replicas.back() == nullptr)
+					std::cout << "Could not replicate the postings on NUMA node " << node << ", its threads will use the shared copy\n";
+				}
+		}
+
+	/*
+		If asked, allocate the result cache (all the memory it will use is allocated now)
+	*/
+	std::unique_ptr<JASS::result_cache> cache;
+	if (parameter_cache_mb != 0)
+		cache.reset(new JASS::result_cache(parameter_cache_mb * 1024 * 1024, parameter_top_k));
+
+	/*
+		If asked, decode the hottest segments of the warm-up queries in advance (before the clock starts, as this is part of loading the index)
+	*/
+	std::unique_ptr<JASS::postings_cache> decoded;
+	std::unique_ptr<anytime_cost> cost;
+	if (parameter_target != 0)
+		cost.reset(new anytime_cost(parameter_target * 1000));
+	if (parameter_decoded_mb != 0)
+		{
+		std::vector<JASS_anytime_query> warmup;
+		if (parameter_warmup.size() != 0)
 			{
-			case 0:
-					anytime<JASS::decoder_d0>(output[0], index, query_list, postings_to_process, parameter_top_k);
-				break;
-			default:
-					anytime<JASS::decoder_d1>(output[0], index, query_list, postings_to_process, parameter_top_k);
-				break;
+			JASS::channel_file warmup_input(parameter_warmup);
+			warmup_input.gets(query);
+			while (query.size() != 0)
+				{
+				warmup.push_back(query);
+				warmup_input.gets(query);
+				}
 			}
+
+		decoded.reset(new JASS::postings_cache(parameter_decoded_mb * 1024 * 1024));
+		fill_postings_cache(*decoded, index, parameter_warmup.size() == 0 ? query_list : warmup, codex_name != "None");
+		stats.decoded_segments = decoded->size();
+		stats.decoded_bytes = decoded->bytes();
 		}
+
+	/*
+		Start the work
+	*/
+	if (parameter_rate == 0 && parameter_arrivals.size() == 0)
+		stats.total_search_time_in_ns = search(method, output, index, replicas, cache.get(), decoded.get(), cost.get(), query_list, postings_to_process, parameter_top_k);
 	else
 		{
 		/*
-			Multiple threads, so start each worker
+			Open-loop replay, either at the given rate, or from a trace (optionally rescaled to the given rate)
 		*/
-		for (size_t which = 0; which < parameter_threads ; which++)
-			switch (d_ness)
+		anytime_load load;
+		if (parameter_arrivals.size() != 0)
+			{
+			if (load.trace(parameter_arrivals, query_list.size(), static_cast<double>(parameter_rate)) == 0)
 				{
-				case 0:
-						thread_pool.push_back(std::thread(anytime<JASS::decoder_d0>, std::ref(output[which]), std::ref(index), std::ref(query_list), postings_to_process, parameter_top_k));
-					break;
-				default:
-						thread_pool.push_back(std::thread(anytime<JASS::decoder_d1>, std::ref(output[which]), std::ref(index), std::ref(query_list), postings_to_process, parameter_top_k));
-					break;
+				std::cout << "Cannot read any arrival times from " << parameter_arrivals << " (there must be one per line, in non-decreasing order)\n";
+				exit(1);
 				}
+			}
+		else
+			load.poisson(query_list.size(), static_cast<double>(parameter_rate));
+
 		/*
-			Wait until they're all done (blocking on the completion of each thread in turn)
+			Replay once, or (given an SLA) keep raising the rate until the 99th percentile latency breaks the SLA
 		*/
-		for (auto &thread : thread_pool)
-			thread.join();
+		std::cout << "   offered/s  achieved/s     p50(us)     p95(us)     p99(us)   p99.9(us)     max(us)\n";
+		do
+			{
+			/*
+				Each run starts with an empty cache, otherwise every query after the first run would be a hit
+			*/
+			if (parameter_cache_mb != 0)
+				cache.reset(new JASS::result_cache(parameter_cache_mb * 1024 * 1024, parameter_top_k));
+
+			stats.total_search_time_in_ns = replay(load, method, output, index, replicas, cache.get(), decoded.get(), cost.get(), query_list, postings_to_process, parameter_top_k);
+			std::cout << load;
+			load.scale(load.offered_rate * 1.25);
+			}
+		while (parameter_sla != 0 && load.percentile(99) <= parameter_sla * 1000 && load.trace_rate() != 0);			// if every query arrives at once the rate can't be raised
+
+		stats.number_of_queries = load.arrival_in_ns.size();
+		}
+
+	if (cost != nullptr)
+		{
+		stats.target_in_ns = parameter_target * 1000;
+		stats.budgeted_queries = cost->query_count();
+		stats.truncated_queries = cost->truncated_count();
+		cost->coefficients(stats.cost_per_query, stats.cost_per_segment, stats.cost_per_posting);
+		}
+
+	if (cache != nullptr)
+		{
+		stats.cache_hits = cache->hit_count();
+		stats.cache_misses = cache->miss_count();
 		}
-	stats.total_search_time_in_ns = JASS::timer::stop(total_search_time).nanoseconds();
 
 	/*
 		Dump the answer
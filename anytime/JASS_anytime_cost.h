@@ -0,0 +1,277 @@
+/*
+	JASS_ANYTIME_COST.H
+	-------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Query cost prediction and adaptive postings budgets for the anytime search engine
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <cmath>
+#include <mutex>
+#include <limits>
+#include <algorithm>
+
+#include "asserts.h"
+
+/*
+	CLASS ANYTIME_COST
+	------------------
+*/
+/*!
+	@brief A model of how long a query takes to process, used to give each query a postings budget that keeps it within a target time.
+	@details The time to process a query is modelled as ns = per_query + per_segment * segments + per_posting * postings, where segments and postings
+	are the number of impact segments and postings processed.  Both are known from the vocabulary and the segment headers before the query is processed,
+	so the cost of processing a query exhaustively can be predicted.  The model is fitted (least squares) to the measured times of the queries
+	that have been processed so far, and is shared by all the threads.  A query predicted to finish within the target is processed exhaustively,
+	otherwise it is given the number of postings that can be processed in the time left after the per-query and per-segment costs.  Until the model
+	has seen enough queries every query is processed exhaustively.
+*/
+class anytime_cost
+	{
+	private:
+		static constexpr size_t FEATURES = 3;						///< queries, segments, postings
+		static constexpr size_t MINIMUM_OBSERVATIONS = 16;		///< The model is not used until it has seen this many queries (or batches)
+
+	private:
+		std::mutex lock;													///< The model is shared by the threads
+		uint64_t target_in_ns;											///< The target time to process a query
+		size_t observations;												///< The number of times observe() has been called
+		double xtx[FEATURES][FEATURES];								///< The sum of the outer products of the features (X^T X)
+		double xty[FEATURES];											///< The sum of the features times the time taken (X^T y)
+		double coefficient[FEATURES];									///< The fitted cost of a query, a segment, and a posting (in nanoseconds)
+		size_t queries;													///< The number of queries budget() has been asked about
+		size_t truncated;													///< The number of those that were given a budget smaller than their postings
+
+	private:
+		/*
+			ANYTIME_COST::FIT()
+			-------------------
+		*/
+		/*!
+			@brief Solve the normal equations (by Gaussian elimination with partial pivoting) to get the coefficients.
+			@details If the equations are singular (for example, every query so far has had the same number of segments) then the coefficients are not changed.
+		*/
+		void fit(void)
+			{
+			double matrix[FEATURES][FEATURES + 1];
+			for (size_t row = 0; row < FEATURES; row++)
+				{
+				for (size_t column = 0; column < FEATURES; column++)
+					matrix[row][column] = xtx[row][column];
+				matrix[row][FEATURES] = xty[row];
+				}
+
+			for (size_t column = 0; column < FEATURES; column++)
+				{
+				size_t pivot = column;
+				for (size_t row = column + 1; row < FEATURES; row++)
+					if (std::fabs(matrix[row][column]) > std::fabs(matrix[pivot][column]))
+						pivot = row;
+				if (std::fabs(matrix[pivot][column]) < 1e-9 * (1 + std::fabs(xtx[column][column])))
+					return;
+				for (size_t which = 0; which <= FEATURES; which++)
+					std::swap(matrix[column][which], matrix[pivot][which]);
+
+				for (size_t row = 0; row < FEATURES; row++)
+					if (row != column)
+						{
+						double scale = matrix[row][column] / matrix[column][column];
+						for (size_t which = column; which <= FEATURES; which++)
+							matrix[row][which] -= scale * matrix[column][which];
+						}
+				}
+
+			for (size_t row = 0; row < FEATURES; row++)
+				coefficient[row] = matrix[row][FEATURES] / matrix[row][row];
+			}
+
+	public:
+		/*
+			ANYTIME_COST::ANYTIME_COST()
+			----------------------------
+		*/
+		/*!
+			@brief Constructor
+			@param target_in_ns [in] The target time to process a query (in nanoseconds).
+		*/
+		explicit anytime_cost(uint64_t target_in_ns) :
+			target_in_ns(target_in_ns),
+			observations(0),
+			xtx(),
+			xty(),
+			coefficient(),
+			queries(0),
+			truncated(0)
+			{
+			/* Nothing */
+			}
+
+		/*
+			ANYTIME_COST::OBSERVE()
+			-----------------------
+		*/
+		/*!
+			@brief Add a measurement to the model.
+			@details The costs are additive so a batch of queries processed together is observed as the sum of their segments and postings.
+			@param batch [in] The number of queries processed.
+			@param segments [in] The number of segments they processed.
+			@param postings [in] The number of postings they processed.
+			@param time_in_ns [in] How long it took (in nanoseconds).
+		*/
+		void observe(size_t batch, size_t segments, size_t postings, uint64_t time_in_ns)
+			{
+			double feature[FEATURES] = {static_cast<double>(batch), static_cast<double>(segments), static_cast<double>(postings)};
+
+			std::lock_guard<std::mutex> guard(lock);
+			for (size_t row = 0; row < FEATURES; row++)
+				{
+				for (size_t column = 0; column < FEATURES; column++)
+					xtx[row][column] += feature[row] * feature[column];
+				xty[row] += feature[row] * time_in_ns;
+				}
+			observations++;
+			fit();
+			}
+
+		/*
+			ANYTIME_COST::BUDGET()
+			----------------------
+		*/
+		/*!
+			@brief Return the number of postings a query can process and still (as predicted) finish within the target time.
+			@param segments [in] The number of segments the query has.
+			@param postings [in] The number of postings the query has.
+			@return The postings budget, which is (std::numeric_limits<size_t>::max)() if the query can be processed exhaustively.
+		*/
+		size_t budget(size_t segments, size_t postings)
+			{
+			const size_t exhaustive = (std::numeric_limits<size_t>::max)();
+			std::lock_guard<std::mutex> guard(lock);
+
+			queries++;
+			if (observations < MINIMUM_OBSERVATIONS || coefficient[2] <= 0)
+				return exhaustive;
+
+			double fixed = coefficient[0] + coefficient[1] * segments;
+			if (fixed + coefficient[2] * postings <= target_in_ns)
+				return exhaustive;
+
+			truncated++;
+			return fixed >= target_in_ns ? 0 : static_cast<size_t>((target_in_ns - fixed) / coefficient[2]);
+			}
+
+		/*
+			ANYTIME_COST::TRUNCATED_COUNT()
+			-------------------------------
+		*/
+		/*!
+			@brief Return the number of queries that were given a budget smaller than their number of postings.
+			@return The number of queries.
+		*/
+		size_t truncated_count(void)
+			{
+			std::lock_guard<std::mutex> guard(lock);
+			return truncated;
+			}
+
+		/*
+			ANYTIME_COST::QUERY_COUNT()
+			---------------------------
+		*/
+		/*!
+			@brief Return the number of queries that have been given a budget.
+			@return The number of queries.
+		*/
+		size_t query_count(void)
+			{
+			std::lock_guard<std::mutex> guard(lock);
+			return queries;
+			}
+
+		/*
+			ANYTIME_COST::COEFFICIENTS()
+			----------------------------
+		*/
+		/*!
+			@brief Return the fitted model.
+			@param per_query [out] The cost of a query (in nanoseconds).
+			@param per_segment [out] The cost of an impact segment (in nanoseconds).
+			@param per_posting [out] The cost of a posting (in nanoseconds).
+		*/
+		void coefficients(double &per_query, double &per_segment, double &per_posting)
+			{
+			std::lock_guard<std::mutex> guard(lock);
+			per_query = coefficient[0];
+			per_segment = coefficient[1];
+			per_posting = coefficient[2];
+			}
+
+		/*
+			ANYTIME_COST::UNITTEST()
+			------------------------
+		*/
+		/*!
+			@brief Unit test this class
+		*/
+		static void unittest(void)
+			{
+			const double per_query = 1000;
+			const double per_segment = 50;
+			const double per_posting = 2;
+			anytime_cost model(100000);
+			double got_query, got_segment, got_posting;
+
+			/*
+				Until the model has seen MINIMUM_OBSERVATIONS queries every query is processed exhaustively.  If every query has the same number of segments
+				the equations are singular and the coefficients are left alone.
+			*/
+			for (size_t which = 0; which < MINIMUM_OBSERVATIONS - 1; which++)
+				{
+				size_t postings = 1000 * (which + 1);
+				model.observe(1, 10, postings, static_cast<uint64_t>(per_query + per_segment * 10 + per_posting * postings));
+				JASS_assert(model.budget(10, 1000000) == (std::numeric_limits<size_t>::max)());
+				}
+			model.coefficients(got_query, got_segment, got_posting);
+			JASS_assert(got_query == 0 && got_segment == 0 && got_posting == 0);
+
+			/*
+				Observations of single queries and of batches (whose costs add) that vary all the features, so the fit recovers the coefficients.
+			*/
+			for (size_t which = 0; which < 2 * MINIMUM_OBSERVATIONS; which++)
+				{
+				size_t batch = which % 3 + 1;
+				size_t segments = batch * (5 + (which * 7) % 23);
+				size_t postings = batch * (100 + (which * 997) % 10007);
+				model.observe(batch, segments, postings, static_cast<uint64_t>(per_query * batch + per_segment * segments + per_posting * postings));
+				}
+			model.coefficients(got_query, got_segment, got_posting);
+			JASS_assert(std::fabs(got_query - per_query) < 1);
+			JASS_assert(std::fabs(got_segment - per_segment) < 0.1);
+			JASS_assert(std::fabs(got_posting - per_posting) < 0.001);
+
+			/*
+				A query predicted to finish in time is exhaustive, a longer one gets the postings that fit in the time left after the fixed costs
+				(1000 + 50 * 10 = 1500ns, leaving 98500ns for 49250 postings), and one whose fixed costs are over the target gets none.
+			*/
+			size_t queries_before = model.query_count();
+			JASS_assert(model.budget(10, 1000) == (std::numeric_limits<size_t>::max)());
+			JASS_assert(model.truncated_count() == 0);
+
+			size_t budget = model.budget(10, 1000000);
+			JASS_assert(budget >= 49240 && budget <= 49260);
+			JASS_assert(model.budget(10000, 1) == 0);
+			JASS_assert(model.truncated_count() == 2);
+			JASS_assert(model.query_count() == queries_before + 3);
+
+			puts("anytime_cost::PASSED");
+			}
+	};
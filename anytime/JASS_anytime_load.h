@@ -0,0 +1,203 @@
+/*
+	JASS_ANYTIME_LOAD.H
+	-------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Open-loop load generation (query arrival times) and latency statistics for the anytime search engine
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <stdint.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+/*
+	CLASS ANYTIME_LOAD
+	------------------
+*/
+/*!
+	@brief The arrival times of the queries in an open-loop replay, and the latencies that were seen.
+	@details In a closed-loop test each thread takes the next query as soon as it has finished the last, which measures throughput but
+	not latency at a given load.  In an open-loop replay each query arrives at a set time (whether or not the engine is keeping up) and
+	its latency is the time from arrival until its results are ready, which includes the time it spent waiting for a free thread.
+	Arrival times are either generated (a Poisson process at a given rate) or taken from a trace, and are offsets (in nanoseconds) from the
+	start of the replay.
+*/
+class anytime_load
+	{
+	public:
+		std::vector<uint64_t> arrival_in_ns;			///< When each query arrives (nanoseconds from the start of the replay), in increasing order
+		double offered_rate;									///< The arrival rate (queries per second)
+		double achieved_rate;								///< The rate at which queries were answered (queries per second)
+		std::vector<uint64_t> latency_in_ns;			///< The latency of each query (sorted once the replay is done)
+
+	public:
+		/*
+			ANYTIME_LOAD::ANYTIME_LOAD()
+			----------------------------
+		*/
+		/*!
+			@brief Constructor
+		*/
+		anytime_load() :
+			offered_rate(0),
+			achieved_rate(0)
+			{
+			/* Nothing */
+			}
+
+		/*
+			ANYTIME_LOAD::POISSON()
+			-----------------------
+		*/
+		/*!
+			@brief Generate arrivals from a Poisson process (exponentially distributed gaps between queries).
+			@details The same seed always gives the same arrivals so that runs can be compared.  The gaps are then scaled so that the mean rate of
+			the sample (not just of the process) is rate.
+			@param queries [in] The number of queries.
+			@param rate [in] The mean number of queries per second.
+			@param seed [in] The seed for the random number generator.
+		*/
+		void poisson(size_t queries, double rate, uint32_t seed = 1)
+			{
+			std::mt19937_64 random(seed);
+			std::exponential_distribution<double> gap(rate);
+			double now = 0;
+
+			arrival_in_ns.resize(queries);
+			for (auto &arrival : arrival_in_ns)
+				{
+				arrival = static_cast<uint64_t>(now * 1'000'000'000.0);
+				now += gap(random);
+				}
+
+			/*
+				Make the mean rate of this sample exactly rate so that it is the rate that is reported
+			*/
+			scale(rate);
+			}
+
+		/*
+			ANYTIME_LOAD::TRACE()
+			---------------------
+		*/
+		/*!
+			@brief Read arrivals from a trace.
+			@details The file has one timestamp (in microseconds) per line, one for each query in the same order as the queries.  The first query
+			arrives at the start of the replay.  If rate is not 0 then the gaps are scaled so that the mean rate is rate (keeping the shape of the trace).
+			The timestamps must not decrease; they can't be sorted as that would give the arrival times to the wrong queries.
+			@param filename [in] The name of the trace file.
+			@param queries [in] The number of queries (if the trace is shorter then the remaining queries are not replayed).
+			@param rate [in] The mean number of queries per second (or 0 to replay at the rate in the trace).
+			@return The number of arrivals read from the trace, or 0 if there are none or they are not in order.
+		*/
+		size_t trace(const std::string &filename, size_t queries, double rate = 0)
+			{
+			std::ifstream file(filename);
+			std::vector<double> timestamp;
+			double when;
+			while (timestamp.size() < queries && file >> when)
+				{
+				if (timestamp.size() != 0 && when < timestamp.back())
+					{
+					arrival_in_ns.clear();
+					return 0;
+					}
+				timestamp.push_back(when);
+				}
+
+			arrival_in_ns.resize(timestamp.size());
+			for (size_t which = 0; which < timestamp.size(); which++)
+				arrival_in_ns[which] = static_cast<uint64_t>((timestamp[which] - timestamp[0]) * 1'000.0);
+
+			offered_rate = trace_rate();
+			if (rate != 0)
+				scale(rate);
+
+			return timestamp.size();
+			}
+
+		/*
+			ANYTIME_LOAD::TRACE_RATE()
+			--------------------------
+		*/
+		/*!
+			@brief Return the mean arrival rate of the current arrivals.
+			@return The rate in queries per second (or 0 if there are fewer than 2 arrivals, or they all arrive at once).
+		*/
+		double trace_rate(void) const
+			{
+			if (arrival_in_ns.size() < 2 || arrival_in_ns.back() == 0)
+				return 0;
+			return (arrival_in_ns.size() - 1) * 1'000'000'000.0 / arrival_in_ns.back();
+			}
+
+		/*
+			ANYTIME_LOAD::SCALE()
+			---------------------
+		*/
+		/*!
+			@brief Squash (or stretch) the arrivals so that their mean rate is rate.
+			@param rate [in] The new rate (queries per second).
+		*/
+		void scale(double rate)
+			{
+			double current = trace_rate();
+			if (current != 0)
+				for (auto &arrival : arrival_in_ns)
+					arrival = static_cast<uint64_t>(arrival * (current / rate));
+			offered_rate = rate;
+			}
+
+		/*
+			ANYTIME_LOAD::PERCENTILE()
+			--------------------------
+		*/
+		/*!
+			@brief Return the given percentile of the latencies (which must have been sorted).
+			@details This is the nearest-rank percentile.
+			@param percent [in] The percentile (for example, 99.9).
+			@return The latency in nanoseconds (or 0 if there are none).
+		*/
+		uint64_t percentile(double percent) const
+			{
+			if (latency_in_ns.size() == 0)
+				return 0;
+
+			size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * latency_in_ns.size()));
+			return latency_in_ns[rank == 0 ? 0 : rank - 1];
+			}
+	};
+
+/*
+	OPERATOR<<()
+	------------
+*/
+/*!
+	@brief Dump a human readable version of the latency statistics (one line of a table) down an output stream.
+	@param stream [in] The stream to write to.
+	@param data [in] The data to write.
+	@return The stream once the data has been written.
+*/
+inline std::ostream &operator<<(std::ostream &output, const anytime_load &data)
+	{
+	output << std::fixed << std::setprecision(1);
+	output << std::setw(12) << data.offered_rate << std::setw(12) << data.achieved_rate;
+	for (double percent : {50.0, 95.0, 99.0, 99.9})
+		output << std::setw(12) << data.percentile(percent) / 1000.0;
+	output << std::setw(12) << (data.latency_in_ns.size() == 0 ? 0 : data.latency_in_ns.back()) / 1000.0 << '\n';
+	output.unsetf(std::ios_base::floatfield);
+	output << std::setprecision(6);
+
+	return output;
+	}
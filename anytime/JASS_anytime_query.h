@@ -16,6 +16,8 @@
 
 #include <atomic>
 
+#include "timer.h"
+
 /*
 	CLASS JASS_ANYTIME_QUERY
 	------------------------
@@ -28,6 +30,9 @@ class JASS_anytime_query
 	public:
 		std::atomic<uint8_t> taken;				///< Has this query been "taken" by a thread and processed
 		std::string query;							///< The query.
+		JASS::timer::stop_watch arrival;		///< When the query arrived (set by the load generator if scheduled, else when the query is taken)
+		bool scheduled;								///< Is this an open-loop replay (the query must not be started before arrival)
+		uint64_t latency_in_ns;					///< The time from arrival until the results were ready (queueing plus service time)
 
 	public:
 		/*
@@ -49,7 +54,10 @@ class JASS_anytime_query
 		*/
 		JASS_anytime_query(const std::string &query) :
 			taken(false),
-			query(query)
+			query(query),
+			arrival(),
+			scheduled(false),
+			latency_in_ns(0)
 				{
 				/* Nothing */
 				}
@@ -64,7 +72,10 @@ class JASS_anytime_query
 		*/
 		JASS_anytime_query(JASS_anytime_query &&original) :
 			taken(original.taken.load()),
-			query(original.query)
+			query(original.query),
+			arrival(original.arrival),
+			scheduled(original.scheduled),
+			latency_in_ns(original.latency_in_ns)
 				{
 				/*
 					Invalidate the original object.
@@ -81,9 +92,9 @@ class JASS_anytime_query
 			@brief Given a list of queries, return the next un-taken query
 			@param list [in] The list to search in
 			@param starging_from [in/out] Where to start searching (should initially be 0, updated to the current node)
-			@return A copy of the string representing the query
+			@return A pointer to the string representing the query (which is not copied so that there is no allocation), or nullptr if there are no more queries
 		*/
-		static std::string get_next_query(std::vector<JASS_anytime_query>&list, size_t &starting_from)
+		static const std::string *get_next_query(std::vector<JASS_anytime_query>&list, size_t &starting_from)
 			{
 			auto total_queries = list.size();
 			while (starting_from < total_queries)
@@ -92,11 +103,11 @@ class JASS_anytime_query
 					{
 					uint8_t expected = false;
 					if (list[starting_from].taken.compare_exchange_strong(expected, true))
-						return list[starting_from].query;
+						return &list[starting_from].query;
 					}
 				starting_from++;
 				}
 
-			return std::string();
+			return nullptr;
 			}
 	};
@@ -25,6 +25,17 @@ class anytime_stats
 		size_t threads;								///< The number of threads (mean queries per thread = number_of_queries/threads)
 		size_t number_of_queries;					///< The number of queries that have been processed
 		size_t total_search_time_in_ns;			///< Total time to search (in nanoseconds)
+		size_t accumulator_width;					///< The number of bits in each accumulator
+		size_t cache_hits;							///< The number of queries answered from the result cache
+		size_t cache_misses;							///< The number of queries looked for in the result cache but not found
+		size_t decoded_segments;					///< The number of segments in the decoded postings cache
+		size_t decoded_bytes;						///< The size of the decoded postings cache (in bytes)
+		size_t target_in_ns;							///< The target time to process a query (or 0 if there are no adaptive budgets)
+		size_t budgeted_queries;					///< The number of queries given a budget by the cost model
+		size_t truncated_queries;					///< The number of those given a budget smaller than their postings
+		double cost_per_query;						///< The fitted cost model: nanoseconds per query
+		double cost_per_segment;					///< The fitted cost model: nanoseconds per impact segment
+		double cost_per_posting;					///< The fitted cost model: nanoseconds per posting
 
 	public:
 		/*
@@ -37,7 +48,18 @@ class anytime_stats
 		anytime_stats() :
 			threads(0),
 			number_of_queries(0),
-			total_search_time_in_ns(0)
+			total_search_time_in_ns(0),
+			accumulator_width(0),
+			cache_hits(0),
+			cache_misses(0),
+			decoded_segments(0),
+			decoded_bytes(0),
+			target_in_ns(0),
+			budgeted_queries(0),
+			truncated_queries(0),
+			cost_per_query(0),
+			cost_per_segment(0),
+			cost_per_posting(0)
 			{
 			/* Nothing */
 			}
@@ -58,8 +80,18 @@ std::ostream &operator<<(std::ostream &output, anytime_stats &data)
 	output << "-------------------\n";
 	output << "Threads                                : " << data.threads << '\n';
 	output << "Queries                                : " << data.number_of_queries << '\n';
+	output << "Accumulator width                      : " << data.accumulator_width << " bits\n";
 	output << "Total search time                      : " << data.total_search_time_in_ns << " ns\n";
 	output << "Total time excluding I/O   (per query) : " << data.total_search_time_in_ns / ((data.number_of_queries == 0) ? 1 : data.number_of_queries) << " ns\n";
+	if (data.cache_hits + data.cache_misses != 0)
+		output << "Result cache hit rate                  : " << 100.0 * data.cache_hits / (data.cache_hits + data.cache_misses) << "% (" << data.cache_hits << " of " << data.cache_hits + data.cache_misses << ")\n";
+	if (data.decoded_segments != 0)
+		output << "Decoded postings cache                 : " << data.decoded_segments << " segments (" << data.decoded_bytes << " bytes)\n";
+	if (data.target_in_ns != 0)
+		{
+		output << "Adaptive budget target                 : " << data.target_in_ns << " ns (" << data.truncated_queries << " of " << data.budgeted_queries << " queries not processed exhaustively)\n";
+		output << "Cost model                             : " << data.cost_per_query << " ns + " << data.cost_per_segment << " ns/segment + " << data.cost_per_posting << " ns/posting\n";
+		}
 	output << "-------------------\n";
 	return output;
 	}
@@ -11,6 +11,7 @@
 
 #include "query.h"
 #include "strings.h"
+#include "commandline.h"
 #include "channel_file.h"
 #include "parser_query.h"
 #include "allocator_pool.h"
@@ -33,12 +34,40 @@
 */
 extern std::vector<std::string> primary_key;
 
+/*
+	PARAMETERS
+	----------
+*/
+size_t parameter_top_k = 10;							///< Number of results to return
+
+std::string parameters_errors;						///< Any errors as a result of command line parsing
+auto parameters = std::make_tuple					///< The  command line parameter block
+	(
+	JASS::commandline::parameter("-k", "--top-k", "Number of results to return to the user (top-k value) [default = 10]", parameter_top_k)
+	);
+
 /*
 	MAIN()
 	------
 */
-int main(int argc, char *argv[])
+int main(int argc, const char *argv[])
 	{
+	/*
+		Parse the commane line parameters
+	*/
+	auto success = JASS::commandline::parse(argc, argv, parameters, parameters_errors);
+	if (!success)
+		{
+		std::cout << parameters_errors;
+		exit(1);
+		}
+
+	if (parameter_top_k > JASS_ci_max_top_k)
+		{
+		std::cout << "top-k specified (" << parameter_top_k << ") is larger than maximum TOP-K (" << JASS_ci_max_top_k << ") of this compiled index, re-generate the index with a larger top-k.\n";
+		exit(1);
+		}
+
 	try
 		{
 		/*
@@ -53,6 +82,11 @@ int main(int argc, char *argv[])
 		JASS::channel_file input;							// read from here
 		JASS::channel_file output;							// write to here.
 
+		/*
+			Allocate a JASS query object, its accumulators are sized for this collection by the index generator (see JASS_query.h)
+		*/
+		auto jass_query = new JASS_ci_query(primary_key, primary_key.size(), parameter_top_k);
+
 		while (1)
 			{
 			/*
@@ -68,7 +102,6 @@ int main(int argc, char *argv[])
 			#endif
 			
 			JASS::string query(memory);					// allocate a string to read into
-			JASS::query<uint16_t, 10'000'000, 10> jass_query(primary_key, 1024, 10);	// allocate a JASS query object
 
 			/*
 				Read a query from a user
@@ -90,26 +123,38 @@ int main(int argc, char *argv[])
 			/*
 				Parse the query then iterate over the terms
 			*/
-			jass_query.parse(query);
-			for (const auto &term : jass_query.terms())
+			jass_query->parse(query);
+			for (const auto &term : jass_query->terms())
 				{
 				/*
 					Search the vocabulary for the query term and if we find it all the attached method to process the postings.
 				*/
 				auto low = std::lower_bound (&dictionary[0], &dictionary[dictionary_length], JASS_ci_vocab(term.token()));
 				if ((low != &dictionary[dictionary_length] && !(JASS_ci_vocab(term.token()) < *low)))
-					low->method(jass_query);
+					low->method(*jass_query);
 				}
 
 			/*
 				Dump the top-k to the output channel
 			*/
-			for (const auto &element : jass_query)
+			for (const auto &element : *jass_query)
 				{
 				std::cout << element.document_id << ":" <<element.document_id << "::" << element.rsv << "\n";
 				//output << element.document_id << ":" << element.rsv << "\n";
 				}
+
+			/*
+				Get ready for the next query
+			*/
+			#ifdef ENSURE_NO_ALLOCATIONS
+				global_new_delete_return();					// disable checking
+				jass_query->rewind();
+				global_new_delete_replace();				// enable checking
+			#else
+				jass_query->rewind();
+			#endif
 			}
+		delete jass_query;
 		}
 	catch (std::exception &error)
 		{
@@ -0,0 +1,263 @@
+/*
+	JASS_COMPILED_INDEX_LOADER.CPP
+	------------------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Search a Compiled Index that has been built as a shared object (see JASS_plugin.h)
+	@details The index is loaded with dlopen() so it can be rebuilt without relinking this program, and a new index can be
+	swapped in (with the .load command) without restarting.  As the new index is loaded before the old one is released,
+	a rebuilt index must be given a new filename, otherwise dlopen() returns the one that is already loaded.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <exception>
+
+#include <dlfcn.h>
+#include <stdint.h>
+
+#include "commandline.h"
+#include "JASS_plugin.h"
+
+/*
+	PARAMETERS
+	----------
+*/
+std::string parameter_plugin;							///< Name of the shared object holding the compiled index
+size_t parameter_top_k = 10;							///< Number of results to return
+
+std::string parameters_errors;						///< Any errors as a result of command line parsing
+auto parameters = std::make_tuple					///< The  command line parameter block
+	(
+	JASS::commandline::parameter("-p", "--plugin", "Name of the shared object holding the compiled index", parameter_plugin),
+	JASS::commandline::parameter("-k", "--top-k",  "Number of results to return to the user (top-k value) [default = 10]", parameter_top_k)
+	);
+
+/*
+	CLASS COMPILED_INDEX
+	--------------------
+*/
+/*!
+	@brief A compiled index loaded from a shared object, and a query object to search it with.
+*/
+class compiled_index
+	{
+	public:
+		void *handle;								///< The handle returned by dlopen().
+		const JASS_ci_plugin *plugin;			///< The description of the index.
+		void *query;								///< The query object, allocated by the plugin.
+		std::vector<JASS_ci_result> results;	///< The top-k of the most recent search.
+
+	public:
+		/*
+			COMPILED_INDEX::COMPILED_INDEX()
+			--------------------------------
+		*/
+		/*!
+			@brief Constructor
+		*/
+		compiled_index() :
+			handle(nullptr),
+			plugin(nullptr),
+			query(nullptr)
+			{
+			/* Nothing */
+			}
+
+		/*
+			COMPILED_INDEX::~COMPILED_INDEX()
+			---------------------------------
+		*/
+		/*!
+			@brief Destructor
+		*/
+		~compiled_index()
+			{
+			unload();
+			}
+
+		/*
+			COMPILED_INDEX::LOAD()
+			----------------------
+		*/
+		/*!
+			@brief Load a compiled index from a shared object.
+			@param filename [in] The name of the shared object.
+			@param top_k [in] The number of results to return from each search.
+			@param error [out] Why the load failed (if it did).
+			@return true on success, false on failure (in which case this object is unchanged).
+		*/
+		bool load(const std::string &filename, size_t top_k, std::string &error)
+			{
+			void *new_handle = dlopen(filename.c_str(), RTLD_NOW | RTLD_LOCAL);
+			if (new_handle == nullptr)
+				{
+				error = dlerror();
+				return false;
+				}
+
+			auto get = reinterpret_cast<const JASS_ci_plugin *(*)(void)>(dlsym(new_handle, "JASS_ci_plugin_get"));
+			if (get == nullptr)
+				{
+				error = filename + " is not a JASS compiled index";
+				dlclose(new_handle);
+				return false;
+				}
+
+			const JASS_ci_plugin *new_plugin = get();
+			if (new_plugin->abi != JASS_ci_plugin_abi)
+				{
+				error = filename + " has plugin ABI " + std::to_string(new_plugin->abi) + " but this program expects ABI " + std::to_string(JASS_ci_plugin_abi);
+				dlclose(new_handle);
+				return false;
+				}
+
+			if (top_k > new_plugin->max_top_k)
+				{
+				error = "top-k specified (" + std::to_string(top_k) + ") is larger than maximum TOP-K (" + std::to_string(new_plugin->max_top_k) + ") of " + filename + ", re-generate the index with a larger top-k.";
+				dlclose(new_handle);
+				return false;
+				}
+
+			void *new_query = new_plugin->query_new(top_k);
+			if (new_query == nullptr)
+				{
+				error = "Can't allocate a query object for " + filename;
+				dlclose(new_handle);
+				return false;
+				}
+
+			/*
+				The new index is good so swap it in
+			*/
+			unload();
+			handle = new_handle;
+			plugin = new_plugin;
+			query = new_query;
+			results.resize(top_k);
+
+			return true;
+			}
+
+		/*
+			COMPILED_INDEX::UNLOAD()
+			------------------------
+		*/
+		/*!
+			@brief Release the query object and the shared object.
+		*/
+		void unload(void)
+			{
+			if (handle == nullptr)
+				return;
+
+			plugin->query_delete(query);
+			dlclose(handle);
+			handle = nullptr;
+			plugin = nullptr;
+			query = nullptr;
+			}
+
+		/*
+			COMPILED_INDEX::SEARCH()
+			------------------------
+		*/
+		/*!
+			@brief Search the index.
+			@param text [in] The query.
+			@return The number of results (which are in results).
+		*/
+		size_t search(const std::string &text)
+			{
+			return plugin->search(query, text.c_str(), text.size(), results.data());
+			}
+	};
+
+/*
+	MAIN()
+	------
+*/
+int main(int argc, const char *argv[])
+	{
+	/*
+		Parse the commane line parameters
+	*/
+	auto success = JASS::commandline::parse(argc, argv, parameters, parameters_errors);
+	if (!success)
+		{
+		std::cout << parameters_errors;
+		exit(1);
+		}
+
+	if (parameter_plugin == "")
+		{
+		std::cout << JASS::commandline::usage(argv[0], parameters);
+		exit(1);
+		}
+
+	if (parameter_top_k == 0)
+		{
+		std::cout << "The top-k must be at least 1\n";
+		exit(1);
+		}
+
+	try
+		{
+		compiled_index index;
+		std::string error;
+
+		if (!index.load(parameter_plugin, parameter_top_k, error))
+			{
+			std::cout << error << "\n";
+			exit(1);
+			}
+		std::cout << "Loaded " << parameter_plugin << " (" << index.plugin->build << ", " << index.plugin->documents << " documents, " << index.plugin->terms << " terms)\n";
+
+		std::string query;
+		while (1)
+			{
+			/*
+				Read a query from a user
+			*/
+			std::cout << "]";
+			if (!std::getline(std::cin, query) || query.compare(0, 5, ".quit") == 0)
+				break;
+
+			/*
+				Hot-swap the index, keeping the current one if the new one can't be loaded
+			*/
+			if (query.compare(0, 6, ".load ") == 0)
+				{
+				std::string filename = query.substr(6);
+				if (index.load(filename, parameter_top_k, error))
+					std::cout << "Loaded " << filename << " (" << index.plugin->build << ", " << index.plugin->documents << " documents, " << index.plugin->terms << " terms)\n";
+				else
+					std::cout << error << "\n";
+				continue;
+				}
+
+			/*
+				Search and dump the top-k
+			*/
+			std::cout << query << "\n";
+			size_t found = index.search(query);
+			for (size_t result = 0; result < found; result++)
+				std::cout << index.results[result].document_id << ":" << index.results[result].primary_key << "::" << index.results[result].rsv << "\n";
+			}
+		}
+	catch (std::exception &error)
+		{
+		printf("CAUGHT AN EXCEPTION OF TYPE std::exception (%s)\n", error.what());
+		}
+	catch (...)
+		{
+		printf("CAUGHT AN EXCEPTION OF UNKNOEN TYPE)\n");
+		}
+
+	return 0;
+	}
@@ -0,0 +1,107 @@
+/*
+	JASS_PLUGIN.CPP
+	---------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief The search methods of a Compiled Index built as a shared object (see JASS_plugin.h)
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <stdint.h>
+
+#include "JASS_plugin.h"
+#include "JASS_query.h"
+#include "JASS_vocabulary.h"
+
+/*
+	Table that converts internal document IDs to external primary keys.
+*/
+extern std::vector<std::string> primary_key;
+
+/*
+	QUERY_NEW()
+	-----------
+*/
+/*!
+	@brief Allocate a query object (see JASS_ci_plugin::query_new).
+*/
+static void *query_new(size_t top_k)
+	{
+	if (top_k == 0 || top_k > JASS_ci_max_top_k)
+		return nullptr;
+
+	return new JASS_ci_query(primary_key, primary_key.size(), top_k);
+	}
+
+/*
+	QUERY_DELETE()
+	--------------
+*/
+/*!
+	@brief Deallocate a query object (see JASS_ci_plugin::query_delete).
+*/
+static void query_delete(void *query)
+	{
+	delete static_cast<JASS_ci_query *>(query);
+	}
+
+/*
+	SEARCH()
+	--------
+*/
+/*!
+	@brief Search and get the top-k results (see JASS_ci_plugin::search).
+*/
+static size_t search(void *query, const char *text, size_t length, JASS_ci_result *results)
+	{
+	JASS_ci_query &jass_query = *static_cast<JASS_ci_query *>(query);
+
+	/*
+		Parse the query then iterate over the terms
+	*/
+	jass_query.parse(text, length);
+	for (const auto &term : jass_query.terms())
+		{
+		/*
+			Search the vocabulary for the query term and if we find it all the attached method to process the postings.
+		*/
+		auto low = std::lower_bound(&dictionary[0], &dictionary[dictionary_length], JASS_ci_vocab(term.token()));
+		if ((low != &dictionary[dictionary_length] && !(JASS_ci_vocab(term.token()) < *low)))
+			low->method(jass_query);
+		}
+
+	/*
+		Copy out the top-k then get ready for the next query
+	*/
+	size_t found = 0;
+	for (const auto &element : jass_query)
+		results[found++] = {element.primary_key.c_str(), element.document_id, element.rsv};
+
+	jass_query.rewind();
+
+	return found;
+	}
+
+/*
+	JASS_CI_PLUGIN_GET()
+	--------------------
+*/
+extern "C" const JASS_ci_plugin *JASS_ci_plugin_get(void)
+	{
+	static const JASS_ci_plugin description = {JASS_ci_plugin_abi, JASS_ci_build, JASS_ci_documents, JASS_ci_max_top_k, dictionary_length, query_new, query_delete, search};
+
+	/*
+		Sort the dictionary - because it was probably generated in the order of the hash-table which isn't alphabetical.
+	*/
+	static bool sorted = (std::sort(&dictionary[0], &dictionary[dictionary_length]), true);
+	(void)sorted;
+
+	return &description;
+	}
@@ -0,0 +1,94 @@
+/*
+	JASS_PLUGIN.H
+	-------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+ */
+/*!
+	@file
+	@brief The interface between a Compiled Index built as a shared object and the program that loads it
+	@details A compiled index is specialised for its collection (the accumulators are sized by JASS_query.h) so the loader
+	cannot know the type of the query object.  Instead, the shared object exports a single function, JASS_ci_plugin_get(),
+	that returns a description of the index and the methods to search it.  Nothing templated crosses the boundary.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+	JASS_CI_PLUGIN_ABI
+	------------------
+*/
+/*!
+	@brief The version of this interface.  Change this whenever JASS_ci_plugin or JASS_ci_result change.
+*/
+constexpr uint32_t JASS_ci_plugin_abi = 1;
+
+/*
+	CLASS JASS_CI_RESULT
+	--------------------
+*/
+/*!
+	@brief One of the top-k results of a search.
+*/
+class JASS_ci_result
+	{
+	public:
+		const char *primary_key;			///< The external identifier of the document (owned by the plugin).
+		uint64_t document_id;				///< The internal document identifier.
+		uint64_t rsv;							///< The rsv (Retrieval Status Value) relevance score.
+	};
+
+/*
+	CLASS JASS_CI_PLUGIN
+	--------------------
+*/
+/*!
+	@brief The self-description of a Compiled Index shared object, and the methods used to search it.
+*/
+class JASS_ci_plugin
+	{
+	public:
+		uint32_t abi;							///< The value of JASS_ci_plugin_abi when the plugin was compiled.
+		const char *build;					///< The version::build() string of the program that generated the index.
+		uint64_t documents;					///< The number of documents in the collection (including document 0).
+		uint64_t max_top_k;					///< The largest top-k the index can be asked for.
+		uint64_t terms;						///< The number of terms in the vocabulary.
+
+		/*!
+			@brief Allocate a query object.
+			@param top_k [in] The number of results to return from each search (at most max_top_k).
+			@return A handle to the query object, or nullptr on error.
+		*/
+		void *(*query_new)(size_t top_k);
+
+		/*!
+			@brief Deallocate a query object allocated with query_new().
+			@param query [in] The query object.
+		*/
+		void (*query_delete)(void *query);
+
+		/*!
+			@brief Search and get the top-k results.
+			@param query [in] The query object (which is rewound before returning).
+			@param text [in] The query.
+			@param length [in] The length of the query (in bytes).
+			@param results [out] The results, from highest to lowest rsv.  There must be space for top_k results.
+			@return The number of results.
+		*/
+		size_t (*search)(void *query, const char *text, size_t length, JASS_ci_result *results);
+	};
+
+/*
+	JASS_CI_PLUGIN_GET()
+	--------------------
+*/
+/*!
+	@brief Return the description of the Compiled Index in this shared object.
+	@details This is the only symbol the loader looks up (with dlsym()).
+	@return The description of the index.
+*/
+extern "C" const JASS_ci_plugin *JASS_ci_plugin_get(void);
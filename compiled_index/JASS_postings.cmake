@@ -0,0 +1,3 @@
+# Generated by JASS Version 0.1 64-bit DEBUGGING-build Copyright (c) 2016-2017 Andrew Trotman, University of Otago
+set(COMPILED_INDEX_POSTINGS_FILES
+	JASS_postings.cpp)
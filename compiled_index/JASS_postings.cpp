@@ -1,57 +1,57 @@
 /* Generated by JASS Version 0.1 64-bit DEBUGGING-build Copyright (c) 2016-2017 Andrew Trotman, University of Otago */
 #include <stddef.h>
 #include <stdint.h>
-#include"query.h"
+#include"JASS_query.h"
 
 using namespace JASS;
-void T_6(query<uint16_t, 10'000'000, 10> &q)
+void T_6(JASS_ci_query &q)
 {
 q.add_rsv(6,1);
 }
-void T_1(query<uint16_t, 10'000'000, 10> &q)
+void T_1(JASS_ci_query &q)
 {
 q.add_rsv(1,1);
 }
-void T_4(query<uint16_t, 10'000'000, 10> &q)
+void T_4(JASS_ci_query &q)
 {
 q.add_rsv(4,1);
 }
-void T_5(query<uint16_t, 10'000'000, 10> &q)
+void T_5(JASS_ci_query &q)
 {
 q.add_rsv(5,1);
 }
-void T_3(query<uint16_t, 10'000'000, 10> &q)
+void T_3(JASS_ci_query &q)
 {
 q.add_rsv(3,1);
 }
-void T_8(query<uint16_t, 10'000'000, 10> &q)
+void T_8(JASS_ci_query &q)
 {
 q.add_rsv(8,1);
 }
-void T_7(query<uint16_t, 10'000'000, 10> &q)
+void T_7(JASS_ci_query &q)
 {
 q.add_rsv(7,1);
 }
-void T_2(query<uint16_t, 10'000'000, 10> &q)
+void T_2(JASS_ci_query &q)
 {
 q.add_rsv(2,1);
 }
-void T_9(query<uint16_t, 10'000'000, 10> &q)
+void T_9(JASS_ci_query &q)
 {
 q.add_rsv(9,1);
 }
-void T_10(query<uint16_t, 10'000'000, 10> &q)
+void T_10(JASS_ci_query &q)
 {
 q.add_rsv(10,1);
 }
-void T_four(query<uint16_t, 10'000'000, 10> &q)
+void T_four(JASS_ci_query &q)
 {
 q.add_rsv(7,1);
 q.add_rsv(8,1);
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_eight(query<uint16_t, 10'000'000, 10> &q)
+void T_eight(JASS_ci_query &q)
 {
 q.add_rsv(3,1);
 q.add_rsv(4,1);
@@ -62,7 +62,7 @@ q.add_rsv(8,1);
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_five(query<uint16_t, 10'000'000, 10> &q)
+void T_five(JASS_ci_query &q)
 {
 q.add_rsv(6,1);
 q.add_rsv(7,1);
@@ -70,7 +70,7 @@ q.add_rsv(8,1);
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_seven(query<uint16_t, 10'000'000, 10> &q)
+void T_seven(JASS_ci_query &q)
 {
 q.add_rsv(4,1);
 q.add_rsv(5,1);
@@ -80,12 +80,12 @@ q.add_rsv(8,1);
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_two(query<uint16_t, 10'000'000, 10> &q)
+void T_two(JASS_ci_query &q)
 {
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_six(query<uint16_t, 10'000'000, 10> &q)
+void T_six(JASS_ci_query &q)
 {
 q.add_rsv(5,1);
 q.add_rsv(6,1);
@@ -94,17 +94,17 @@ q.add_rsv(8,1);
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_three(query<uint16_t, 10'000'000, 10> &q)
+void T_three(JASS_ci_query &q)
 {
 q.add_rsv(8,1);
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_one(query<uint16_t, 10'000'000, 10> &q)
+void T_one(JASS_ci_query &q)
 {
 q.add_rsv(10,1);
 }
-void T_nine(query<uint16_t, 10'000'000, 10> &q)
+void T_nine(JASS_ci_query &q)
 {
 q.add_rsv(2,1);
 q.add_rsv(3,1);
@@ -116,7 +116,7 @@ q.add_rsv(8,1);
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_ten(query<uint16_t, 10'000'000, 10> &q)
+void T_ten(JASS_ci_query &q)
 {
 q.add_rsv(1,1);
 q.add_rsv(2,1);
@@ -0,0 +1,10 @@
+/* Generated by JASS Version 0.1 64-bit DEBUGGING-build Copyright (c) 2016-2017 Andrew Trotman, University of Otago */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include"query.h"
+
+constexpr size_t JASS_ci_documents = 11;
+constexpr size_t JASS_ci_max_top_k = 10;
+typedef JASS::query<uint16_t, JASS_ci_documents, JASS_ci_max_top_k> JASS_ci_query;
+constexpr const char *JASS_ci_build = "JASS Version 0.1 64-bit DEBUGGING-build Copyright (c) 2016-2017 Andrew Trotman, University of Otago";
@@ -0,0 +1,52 @@
+/*
+	JASS_SEGMENT.H
+	--------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+ */
+/*!
+	@file
+	@brief Describes the Compiled Indexes packed postings segments and the loop that processes them
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "forceinline.h"
+
+/*
+	CLASS JASS_CI_SEGMENT
+	---------------------
+*/
+/*!
+	@brief A range of a term's document ids array (generated by serialise_ci) that all have the same impact score.
+*/
+class JASS_ci_segment
+	{
+	public:
+		uint16_t impact;				///< The impact score of each document in the segment.
+		uint32_t start;				///< The index (in the document ids array) of the first document in the segment.
+		uint32_t end;					///< The index (in the document ids array) of one past the last document in the segment.
+	};
+
+/*
+	JASS_CI_ADD_SEGMENTS()
+	----------------------
+*/
+/*!
+	@brief Add the impact of each document in each segment to the accumulators.
+	@details This is the only loop in a packed compiled index, every term's method calls it with that term's arrays so the
+	instruction cache holds one tight loop rather than one add_rsv() per posting.
+	@param q [in, out] The query object (that holds the accumulators).
+	@param segment [in] The first segment to process.
+	@param end [in] One past the last segment to process.
+	@param documents [in] The term's document ids array.
+*/
+template <typename QUERY>
+forceinline void JASS_ci_add_segments(QUERY &q, const JASS_ci_segment *segment, const JASS_ci_segment *end, const uint32_t *documents)
+	{
+	for (; segment < end; segment++)
+		q.add_rsv_block(documents + segment->start, segment->end - segment->start, segment->impact);
+	}
@@ -0,0 +1,22 @@
+# Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+# file Copyright.txt or https://cmake.org/licensing for details.
+
+cmake_minimum_required(VERSION 3.5)
+
+file(MAKE_DIRECTORY
+  "/root/repo/external/zlib/src/zlib"
+  "/root/repo/external/zlib"
+  "/root/repo/external/zlib"
+  "/root/repo/external/zlib/tmp"
+  "/root/repo/external/zlib/src/zlib-stamp"
+  "/root/repo/external/zlib/src"
+  "/root/repo/external/zlib/src/zlib-stamp"
+)
+
+set(configSubDirs Debug)
+foreach(subDir IN LISTS configSubDirs)
+    file(MAKE_DIRECTORY "/root/repo/external/zlib/src/zlib-stamp/${subDir}")
+endforeach()
+if(cfgdir)
+  file(MAKE_DIRECTORY "/root/repo/external/zlib/src/zlib-stamp${cfgdir}") # cfgdir has leading slash
+endif()
@@ -0,0 +1,22 @@
+# Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+# file Copyright.txt or https://cmake.org/licensing for details.
+
+cmake_minimum_required(VERSION 3.5)
+
+file(MAKE_DIRECTORY
+  "/root/repo/external/zstd/src/zstd"
+  "/root/repo/external/zstd"
+  "/root/repo/external/zstd"
+  "/root/repo/external/zstd/tmp"
+  "/root/repo/external/zstd/src/zstd-stamp"
+  "/root/repo/external/zstd/src"
+  "/root/repo/external/zstd/src/zstd-stamp"
+)
+
+set(configSubDirs Debug)
+foreach(subDir IN LISTS configSubDirs)
+    file(MAKE_DIRECTORY "/root/repo/external/zstd/src/zstd-stamp/${subDir}")
+endforeach()
+if(cfgdir)
+  file(MAKE_DIRECTORY "/root/repo/external/zstd/src/zstd-stamp${cfgdir}") # cfgdir has leading slash
+endif()
@@ -14,7 +14,9 @@
 
 #include <new>
 #include <vector>
+#include <limits>
 #include <numeric>
+#include <algorithm>
 
 #include <math.h>
 #include <stdint.h>
@@ -139,6 +141,55 @@ namespace JASS
 				return accumulator[which];
 				}
 			
+			/*
+				ACCUMULATOR_2D::GET_INDEX()
+				---------------------------
+			*/
+			/*!
+				@brief Given a pointer to an accumulator, return the accumulator's index (i.e. the document id).
+				@param pointer [in] A pointer returned by operator[]().
+				@return The index of the accumulator.
+			*/
+			forceinline size_t get_index(const ELEMENT *pointer) const
+				{
+				return pointer - accumulator;
+				}
+
+			/*
+				ACCUMULATOR_2D::ORDER()
+				-----------------------
+			*/
+			/*!
+				@brief Return the key that accumulators with the same value are ordered on (their address, which is in document order).
+				@param pointer [in] A pointer returned by operator[]().
+				@return The address of the accumulator.
+			*/
+			static forceinline uintptr_t order(const ELEMENT *pointer)
+				{
+				return reinterpret_cast<uintptr_t>(pointer);
+				}
+
+			/*
+				ACCUMULATOR_2D::FOR_EACH_TOUCHED()
+				----------------------------------
+			*/
+			/*!
+				@brief Call functor on each accumulator that has been initialised since the last rewind(), in document order.
+				@details This walks each row that has its clean flag set, so untouched rows are skipped but some of the accumulators passed may be zero.
+				@param functor [in] Called as functor(ELEMENT &accumulator).
+			*/
+			template <typename FUNCTOR>
+			void for_each_touched(FUNCTOR &&functor)
+				{
+				for (size_t flag = 0; flag < number_of_clean_flags; flag++)
+					if (clean_flag[flag])
+						{
+						size_t end = (std::min)(flag * width + width, number_of_accumulators);
+						for (size_t which = flag * width; which < end; which++)
+							functor(accumulator[which]);
+						}
+				}
+
 			/*
 				ACCUMULATOR_2D::SIZE()
 				----------------------
@@ -160,8 +211,9 @@ namespace JASS
 			/*!
 				@brief Clear the accumulators ready for use
 				@details This clears the clean flags so that the next time an accumulator is requested it ix initialised to zero before being returned.
+				@param postings [in] Not used (the accumulators are for the whole collection, not sized for each search).
 			*/
-			void rewind(void)
+			void rewind(size_t postings = (std::numeric_limits<size_t>::max)())
 				{
 				std::fill(clean_flag, clean_flag + number_of_clean_flags, false);
 				}
@@ -198,6 +250,19 @@ namespace JASS
 				*/
 				for (size_t element = 0; element < instance.size(); element++)
 					JASS_assert(instance[element] == element);
+
+				/*
+					Make sure the document id can be found from the address of the accumulator
+				*/
+				for (const auto &position : sequence)
+					JASS_assert(instance.get_index(&instance[position]) == position);
+
+				/*
+					Make sure all the accumulators are walked
+				*/
+				size_t total = 0;
+				instance.for_each_touched([&total](const auto &value){ total += value; });
+				JASS_assert(total == instance.size() * (instance.size() - 1) / 2);
 				}
 
 			/*
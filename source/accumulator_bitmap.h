@@ -0,0 +1,322 @@
+/*
+	ACCUMULATOR_BITMAP.H
+	--------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Manage an accumulator array as fixed-size pages with a bitmap of dirty flags.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <new>
+#include <vector>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+	#include <malloc.h>
+#endif
+
+#include "forceinline.h"
+
+namespace JASS
+	{
+	/*
+		CLASS ACCUMULATOR_BITMAP
+		------------------------
+	*/
+	/*!
+		@brief Store the accumulators as pages of a fixed number of bytes, keeping one dirty bit per page.
+		@details This is a variant of accumulator_2d.  Rather than the rows being the square root of the number of accumulators,
+		each page is PAGE_BYTES long so that it matches a unit the hardware cares about (a cache line or a virtual memory page).
+		Initialising a page then costs exactly one cache line (or one memory page), and the dirty flags are kept as bits so that the
+		flags for a large collection fit in cache and rewind() clears 64 pages per word.  The accumulators are allocated aligned to PAGE_BYTES
+		(the query objects are allocated with new, which is not required to honour over-alignment before C++17, so they can't be a member
+		array) so that a page never straddles two cache lines (or memory pages).
+		@tparam ELEMENT The type of accumulator being used (default is uint16_t)
+		@tparam NUMBER_OF_ACCUMULATORS The maximum number of accumulators this object can hold.
+		@tparam PAGE_BYTES The size of a page in bytes (a whole power of 2 that is at least sizeof(ELEMENT), default is a 64-byte cache line).
+	*/
+	template <typename ELEMENT, size_t NUMBER_OF_ACCUMULATORS, size_t PAGE_BYTES = 64, typename = typename std::enable_if<std::is_arithmetic<ELEMENT>::value, ELEMENT>::type>
+	class accumulator_bitmap
+		{
+		/*
+			So that unittest() can see the private members of another instance of the class.
+		*/
+		template<typename A, size_t B, size_t C, typename D> friend class accumulator_bitmap;
+
+		static_assert((PAGE_BYTES & (PAGE_BYTES - 1)) == 0, "PAGE_BYTES must be a whole power of 2");
+		static_assert(PAGE_BYTES >= sizeof(ELEMENT) && PAGE_BYTES % sizeof(ELEMENT) == 0, "PAGE_BYTES must hold a whole number of accumulators");
+
+		private:
+			static constexpr size_t width = PAGE_BYTES / sizeof(ELEMENT);																///< The number of accumulators in a page
+			static constexpr size_t maximum_number_of_pages = (NUMBER_OF_ACCUMULATORS + width - 1) / width;						///< The number of pages (i.e. dirty bits)
+			static constexpr size_t maximum_number_of_dirty_words = (maximum_number_of_pages + 63) / 64;							///< The number of words of dirty bits
+			ELEMENT *accumulator;																															///< The accumulators are kept in a PAGE_BYTES aligned array
+			uint64_t dirty[maximum_number_of_dirty_words];																					///< One bit per page, set once the page has been zeroed
+
+			size_t number_of_accumulators;							///< The number of accumulators that the user asked for
+			size_t number_of_dirty_words;								///< The number of words of dirty bits that are in use
+
+		public:
+			/*
+				ACCUMULATOR_BITMAP::ACCUMULATOR_BITMAP()
+				----------------------------------------
+			*/
+			/*!
+				@brief Constructor.
+				@param number_of_accumulators [in] The numnber of elements in the array being managed.
+			*/
+			accumulator_bitmap(size_t number_of_accumulators) :
+				accumulator(nullptr),
+				number_of_accumulators(number_of_accumulators),
+				number_of_dirty_words(((number_of_accumulators + width - 1) / width + 63) / 64)
+				{
+				if (number_of_accumulators > NUMBER_OF_ACCUMULATORS)
+					throw std::bad_array_new_length();
+
+				/*
+					Allocate whole pages (at least one), aligned on a page boundary.
+				*/
+				size_t bytes = (std::max)((number_of_accumulators + width - 1) / width, static_cast<size_t>(1)) * PAGE_BYTES;
+				#ifdef _MSC_VER
+					accumulator = static_cast<ELEMENT *>(::_aligned_malloc(bytes, PAGE_BYTES));
+				#else
+					accumulator = static_cast<ELEMENT *>(::aligned_alloc(PAGE_BYTES, bytes));
+				#endif
+				if (accumulator == nullptr)
+					throw std::bad_alloc();				// LCOV_EXCL_LINE
+
+				rewind();
+				}
+
+			/*
+				ACCUMULATOR_BITMAP::ACCUMULATOR_BITMAP()
+				----------------------------------------
+			*/
+			/*!
+				@brief Copy constructor (deleted as the object owns the accumulators).
+			*/
+			accumulator_bitmap(const accumulator_bitmap &) = delete;
+
+			/*
+				ACCUMULATOR_BITMAP::OPERATOR=()
+				-------------------------------
+			*/
+			/*!
+				@brief Assignment operator (deleted as the object owns the accumulators).
+			*/
+			accumulator_bitmap &operator=(const accumulator_bitmap &) = delete;
+
+			/*
+				ACCUMULATOR_BITMAP::~ACCUMULATOR_BITMAP()
+				-----------------------------------------
+			*/
+			/*!
+				@brief Destructor.
+			*/
+			~accumulator_bitmap()
+				{
+				#ifdef _MSC_VER
+					::_aligned_free(accumulator);
+				#else
+					::free(accumulator);
+				#endif
+				}
+
+			/*
+				ACCUMULATOR_BITMAP::OPERATOR[]()
+				--------------------------------
+			*/
+			/*!
+				@brief Return a reference to the given accumulator
+				@details The only valid way to access the accumulators is through this interface.  It ensures the page holding the accumulator
+				has been zeroed before the first time it is returned to the caller.
+				@param which [in] The accumulator to return.
+			*/
+			forceinline ELEMENT &operator[](size_t which)
+				{
+				size_t page = which / width;
+				uint64_t bit = (uint64_t)1 << (page & 63);
+				uint64_t &word = dirty[page >> 6];
+				if ((word & bit) == 0)
+					{
+					::memset(&accumulator[page * width], 0, PAGE_BYTES);
+					word |= bit;
+					}
+
+				return accumulator[which];
+				}
+
+			/*
+				ACCUMULATOR_BITMAP::GET_INDEX()
+				-------------------------------
+			*/
+			/*!
+				@brief Given a pointer to an accumulator, return the accumulator's index (i.e. the document id).
+				@param pointer [in] A pointer returned by operator[]().
+				@return The index of the accumulator.
+			*/
+			forceinline size_t get_index(const ELEMENT *pointer) const
+				{
+				return pointer - accumulator;
+				}
+
+			/*
+				ACCUMULATOR_BITMAP::ORDER()
+				---------------------------
+			*/
+			/*!
+				@brief Return the key that accumulators with the same value are ordered on (their address, which is in document order).
+				@param pointer [in] A pointer returned by operator[]().
+				@return The address of the accumulator.
+			*/
+			static forceinline uintptr_t order(const ELEMENT *pointer)
+				{
+				return reinterpret_cast<uintptr_t>(pointer);
+				}
+
+			/*
+				ACCUMULATOR_BITMAP::FOR_EACH_TOUCHED()
+				--------------------------------------
+			*/
+			/*!
+				@brief Call functor on each accumulator that has been initialised since the last rewind(), in document order.
+				@details This walks each page that has its dirty bit set, so untouched pages are skipped but some of the accumulators passed may be zero.
+				@param functor [in] Called as functor(ELEMENT &accumulator).
+			*/
+			template <typename FUNCTOR>
+			void for_each_touched(FUNCTOR &&functor)
+				{
+				for (size_t word = 0; word < number_of_dirty_words; word++)
+					if (dirty[word] != 0)
+						for (size_t bit = 0; bit < 64; bit++)
+							if (dirty[word] & ((uint64_t)1 << bit))
+								{
+								size_t page = word * 64 + bit;
+								size_t end = (std::min)(page * width + width, number_of_accumulators);
+								for (size_t which = page * width; which < end; which++)
+									functor(accumulator[which]);
+								}
+				}
+
+			/*
+				ACCUMULATOR_BITMAP::SIZE()
+				--------------------------
+			*/
+			/*!
+				@brief Return the number of accumulators in the array.
+				@return Size of the accumulator array.
+			*/
+			size_t size(void) const
+				{
+				return number_of_accumulators;
+				}
+
+			/*
+				ACCUMULATOR_BITMAP::REWIND()
+				----------------------------
+			*/
+			/*!
+				@brief Clear the dirty bits so that each page is zeroed the next time it is touched
+				@param postings [in] Not used (the accumulators are for the whole collection, not sized for each search).
+			*/
+			void rewind(size_t postings = (std::numeric_limits<size_t>::max)())
+				{
+				std::fill(dirty, dirty + number_of_dirty_words, 0);
+				}
+
+			/*
+				ACCUMULATOR_BITMAP::UNITTEST_EXAMPLE()
+				--------------------------------------
+			*/
+			/*!
+				@brief Unit test a single instance making sure its correct
+			*/
+			template <typename ACCUMULATOR_BITMAP>
+			static void unittest_example(ACCUMULATOR_BITMAP &instance)
+				{
+				/*
+					Populate an array with the shuffled sequence 0..instance.size()
+				*/
+				std::vector<size_t> sequence(instance.size());
+				std::iota(sequence.begin(), sequence.end(), 0);
+				std::random_shuffle(sequence.begin(), sequence.end());
+
+				/*
+					Do it twice to make sure rewind() works
+				*/
+				for (size_t pass = 0; pass < 2; pass++)
+					{
+					for (const auto &position : sequence)
+						{
+						JASS_assert(instance[position] == 0);
+						instance[position] = position + 1;
+						JASS_assert(instance.get_index(&instance[position]) == position);
+						}
+
+					for (size_t element = 0; element < instance.size(); element++)
+						JASS_assert(instance[element] == element + 1);
+
+					size_t total = 0;
+					instance.for_each_touched([&total](const auto &value){ total += value; });
+					JASS_assert(total == instance.size() * (instance.size() + 1) / 2);
+
+					instance.rewind();
+					}
+				}
+
+			/*
+				ACCUMULATOR_BITMAP::UNITTEST()
+				------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				/*
+					Cache line sized pages with more than 64 pages (so more than one dirty word) and a partial last page
+				*/
+				accumulator_bitmap<uint32_t, 5000> cache_line(4999);
+				JASS_assert(cache_line.width == 16);
+				JASS_assert(cache_line.number_of_dirty_words == 5);
+				JASS_assert(reinterpret_cast<uintptr_t>(cache_line.accumulator) % 64 == 0);
+				unittest_example(cache_line);
+
+				/*
+					Memory page sized pages with a single accumulator
+				*/
+				accumulator_bitmap<uint16_t, 1, 4096> memory_page(1);
+				JASS_assert(memory_page.width == 2048);
+				JASS_assert(reinterpret_cast<uintptr_t>(memory_page.accumulator) % 4096 == 0);
+				unittest_example(memory_page);
+
+				/*
+					Make sure we can't allocate more than the maximum
+				*/
+				bool thrown = false;
+				try
+					{
+					accumulator_bitmap<size_t, 64> too_large(65);
+					}
+				catch (std::bad_array_new_length &)
+					{
+					thrown = true;
+					}
+				JASS_assert(thrown);
+
+				puts("accumulator_bitmap::PASSED");
+				}
+		};
+	}
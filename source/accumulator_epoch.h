@@ -0,0 +1,270 @@
+/*
+	ACCUMULATOR_EPOCH.H
+	-------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Manage an accumulator array where each accumulator is tagged with the search that last touched it (an epoch-reset array).
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <new>
+#include <vector>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "forceinline.h"
+
+namespace JASS
+	{
+	/*
+		CLASS ACCUMULATOR_EPOCH
+		-----------------------
+	*/
+	/*!
+		@brief An accumulator array where each accumulator is tagged with an epoch (search number) so that rewind() is O(1).
+		@details This is a dense array of NUMBER_OF_ACCUMULATORS slots, not a sparse structure: its size depends on the collection, and
+		as each accumulator is interleaved with a 16-bit epoch it takes about twice the memory of accumulator_2d (for 16-bit accumulators).
+		An accumulator is valid only if its epoch matches the current epoch, otherwise it is zeroed on first access.  So rewind() is just an
+		increment and nothing is initialised that the search doesn't touch.  The epoch sits next to the accumulator so the check and the
+		update hit the same cache line.  When the epoch wraps the tags are all cleared (once every 65535 searches).  for_each_touched() has
+		to look at every epoch so it is proportional to the size of the collection.  The accumulators stay in document order in memory so
+		the top-k (which holds pointers and breaks ties on address) is unaffected.
+		@tparam ELEMENT The type of accumulator being used (default is uint16_t)
+		@tparam NUMBER_OF_ACCUMULATORS The maximum number of accumulators this object can hold.
+	*/
+	template <typename ELEMENT, size_t NUMBER_OF_ACCUMULATORS, typename = typename std::enable_if<std::is_arithmetic<ELEMENT>::value, ELEMENT>::type>
+	class accumulator_epoch
+		{
+		/*
+			So that unittest() can see the private members of another instance of the class.
+		*/
+		template<typename A, size_t B, typename C> friend class accumulator_epoch;
+
+		private:
+			/*
+				CLASS ACCUMULATOR_EPOCH::SLOT
+				-----------------------------
+			*/
+			/*!
+				@brief An accumulator and the epoch it was last touched.
+			*/
+			class slot
+				{
+				public:
+					uint16_t epoch;				///< The epoch of the search that last zeroed this accumulator
+					ELEMENT accumulator;			///< The accumulator
+				};
+
+		private:
+			slot accumulator[NUMBER_OF_ACCUMULATORS];			///< The accumulators and their epochs
+			size_t number_of_accumulators;						///< The number of accumulators that the user asked for
+			uint16_t epoch;											///< The current epoch (0 is never used so that a cleared slot is never valid)
+
+		public:
+			/*
+				ACCUMULATOR_EPOCH::ACCUMULATOR_EPOCH()
+				--------------------------------------
+			*/
+			/*!
+				@brief Constructor.
+				@param number_of_accumulators [in] The numnber of elements in the array being managed.
+			*/
+			accumulator_epoch(size_t number_of_accumulators) :
+				number_of_accumulators(number_of_accumulators),
+				epoch(std::numeric_limits<uint16_t>::max())
+				{
+				if (number_of_accumulators > NUMBER_OF_ACCUMULATORS)
+					throw std::bad_array_new_length();
+
+				/*
+					Starting at the last epoch forces rewind() to wrap, which clears the tags
+				*/
+				rewind();
+				}
+
+			/*
+				ACCUMULATOR_EPOCH::OPERATOR[]()
+				-------------------------------
+			*/
+			/*!
+				@brief Return a reference to the given accumulator
+				@details The only valid way to access the accumulators is through this interface.  It ensures the accumulator has been zeroed
+				in this epoch before it is returned to the caller.
+				@param which [in] The accumulator to return.
+			*/
+			forceinline ELEMENT &operator[](size_t which)
+				{
+				slot &current = accumulator[which];
+				if (current.epoch != epoch)
+					{
+					current.epoch = epoch;
+					current.accumulator = 0;
+					}
+
+				return current.accumulator;
+				}
+
+			/*
+				ACCUMULATOR_EPOCH::GET_INDEX()
+				------------------------------
+			*/
+			/*!
+				@brief Given a pointer to an accumulator, return the accumulator's index (i.e. the document id).
+				@details As the accumulators are interleaved with the epochs this is computed from the byte offset of the pointer.
+				@param pointer [in] A pointer returned by operator[]().
+				@return The index of the accumulator.
+			*/
+			forceinline size_t get_index(const ELEMENT *pointer) const
+				{
+				return (reinterpret_cast<const uint8_t *>(pointer) - reinterpret_cast<const uint8_t *>(&accumulator[0].accumulator)) / sizeof(slot);
+				}
+
+			/*
+				ACCUMULATOR_EPOCH::ORDER()
+				--------------------------
+			*/
+			/*!
+				@brief Return the key that accumulators with the same value are ordered on (their address, which is in document order).
+				@param pointer [in] A pointer returned by operator[]().
+				@return The address of the accumulator.
+			*/
+			static forceinline uintptr_t order(const ELEMENT *pointer)
+				{
+				return reinterpret_cast<uintptr_t>(pointer);
+				}
+
+			/*
+				ACCUMULATOR_EPOCH::FOR_EACH_TOUCHED()
+				-------------------------------------
+			*/
+			/*!
+				@brief Call functor on each accumulator that has been initialised since the last rewind(), in document order.
+				@details This must look at every epoch so it is proportional to the size of the collection, not the number of accumulators touched.
+				@param functor [in] Called as functor(ELEMENT &accumulator).
+			*/
+			template <typename FUNCTOR>
+			void for_each_touched(FUNCTOR &&functor)
+				{
+				for (size_t which = 0; which < number_of_accumulators; which++)
+					if (accumulator[which].epoch == epoch)
+						functor(accumulator[which].accumulator);
+				}
+
+			/*
+				ACCUMULATOR_EPOCH::SIZE()
+				-------------------------
+			*/
+			/*!
+				@brief Return the number of accumulators in the array.
+				@return Size of the accumulator array.
+			*/
+			size_t size(void) const
+				{
+				return number_of_accumulators;
+				}
+
+			/*
+				ACCUMULATOR_EPOCH::REWIND()
+				---------------------------
+			*/
+			/*!
+				@brief Invalidate all the accumulators ready for use
+				@details This moves to the next epoch.  Only if the epoch wraps are the tags cleared.
+				@param postings [in] Not used (the accumulators are for the whole collection, not sized for each search).
+			*/
+			void rewind(size_t postings = (std::numeric_limits<size_t>::max)())
+				{
+				epoch++;
+				if (epoch == 0)
+					{
+					for (size_t which = 0; which < number_of_accumulators; which++)
+						accumulator[which].epoch = 0;
+					epoch = 1;
+					}
+				}
+
+			/*
+				ACCUMULATOR_EPOCH::UNITTEST()
+				-----------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				accumulator_epoch<uint32_t, 1000> instance(999);
+				JASS_assert(instance.size() == 999);
+
+				/*
+					Populate an array with the shuffled sequence 0..instance.size()
+				*/
+				std::vector<size_t> sequence(instance.size());
+				std::iota(sequence.begin(), sequence.end(), 0);
+				std::random_shuffle(sequence.begin(), sequence.end());
+
+				for (const auto &position : sequence)
+					{
+					JASS_assert(instance[position] == 0);
+					instance[position] = position + 1;
+					JASS_assert(instance.get_index(&instance[position]) == position);
+					}
+
+				for (size_t element = 0; element < instance.size(); element++)
+					JASS_assert(instance[element] == element + 1);
+
+				/*
+					Make sure the accumulators are in document order in memory (the top-k relies on this)
+				*/
+				JASS_assert(&instance[0] < &instance[1]);
+
+				/*
+					Make sure an accumulator not touched for a whole cycle of epochs is still zero when the epoch wraps.
+				*/
+				instance[0] = 5;
+				for (size_t search = 0; search < std::numeric_limits<uint16_t>::max(); search++)
+					{
+					instance.rewind();
+					instance[1] = 1;
+					}
+				JASS_assert(instance.epoch != 0);
+				JASS_assert(instance[0] == 0);
+				JASS_assert(instance[1] == 1);
+
+				/*
+					Only the accumulators touched in this epoch are walked
+				*/
+				size_t touched = 0;
+				instance.for_each_touched([&touched](const uint32_t &){ touched++; });
+				JASS_assert(touched == 2);
+
+				instance.rewind();
+				for (size_t element = 0; element < instance.size(); element++)
+					JASS_assert(instance[element] == 0);
+
+				/*
+					Make sure we can't allocate more than the maximum
+				*/
+				bool thrown = false;
+				try
+					{
+					accumulator_epoch<size_t, 64> too_large(65);
+					}
+				catch (std::bad_array_new_length &)
+					{
+					thrown = true;
+					}
+				JASS_assert(thrown);
+
+				puts("accumulator_epoch::PASSED");
+				}
+		};
+	}
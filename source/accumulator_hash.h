@@ -0,0 +1,333 @@
+/*
+	ACCUMULATOR_HASH.H
+	------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Manage the accumulators as an open-addressed hash table from document id to accumulator (for short queries over large collections).
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <new>
+#include <vector>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "asserts.h"
+#include "forceinline.h"
+
+namespace JASS
+	{
+	/*
+		CLASS ACCUMULATOR_HASH
+		----------------------
+	*/
+	/*!
+		@brief A sparse set of accumulators held in a fixed-capacity open-addressed (linear probing) hash table keyed on document id.
+		@details The memory used depends on the number of postings in the query, not the size of the collection.  rewind(postings) sizes
+		the table to twice the number of postings in the next search (rounded up to a power of 2), so it is never more than half full, and
+		this is capped at twice the number of documents (a search can't touch more than that).  The table only grows, and only in rewind(),
+		it is never re-hashed during a search so a pointer to an accumulator stays valid until the next rewind() (the top-k relies on this).
+		rewind() and for_each_touched() are proportional to the number of accumulators touched, not the size of the collection.  Each slot
+		holds the document id next to the accumulator, so get_index() and order() read it from there.  The slots are not in document order,
+		so order() (which the top-k breaks ties on) returns the document id rather than the address.
+		@tparam ELEMENT The type of accumulator being used (default is uint16_t)
+		@tparam NUMBER_OF_ACCUMULATORS The maximum number of accumulators this object can hold.
+	*/
+	template <typename ELEMENT, size_t NUMBER_OF_ACCUMULATORS, typename = typename std::enable_if<std::is_arithmetic<ELEMENT>::value, ELEMENT>::type>
+	class accumulator_hash
+		{
+		/*
+			So that unittest() can see the private members of another instance of the class.
+		*/
+		template<typename A, size_t B, typename C> friend class accumulator_hash;
+
+		private:
+			/*
+				CLASS ACCUMULATOR_HASH::SLOT
+				----------------------------
+			*/
+			/*!
+				@brief An accumulator and the document it belongs to (the accumulator must come first, see order()).
+			*/
+			class slot
+				{
+				public:
+					ELEMENT accumulator;			///< The accumulator
+					uint32_t document;			///< The document id (or EMPTY)
+				};
+
+			static constexpr uint32_t EMPTY = (std::numeric_limits<uint32_t>::max)();			///< Marker for an unused slot
+			static constexpr size_t minimum_capacity = 64;											///< The smallest table (in slots)
+
+		private:
+			std::vector<slot> table;						///< The hash table
+			std::vector<uint32_t> touched;				///< The slots in use in this search (so that rewind() and for_each_touched() don't walk the table)
+			size_t table_shift;								///< The hash is the top (64 - table_shift) bits of the product of the document id and a constant
+			size_t table_mask;								///< table.size() - 1
+			size_t maximum_capacity;						///< The largest the table can need to be (twice the number of documents, rounded up to a power of 2)
+			size_t number_of_accumulators;				///< The number of accumulators that the user asked for
+
+		private:
+			/*
+				ACCUMULATOR_HASH::HASH()
+				------------------------
+			*/
+			/*!
+				@brief Return the slot to start looking for a document.
+				@param which [in] The document id.
+				@return The slot.
+			*/
+			forceinline size_t hash(size_t which) const
+				{
+				return (static_cast<uint64_t>(which) * 0x9E3779B97F4A7C15ULL) >> table_shift;
+				}
+
+		public:
+			/*
+				ACCUMULATOR_HASH::ACCUMULATOR_HASH()
+				------------------------------------
+			*/
+			/*!
+				@brief Constructor.
+				@details The table starts small, rewind(postings) sets its size before each search.
+				@param number_of_accumulators [in] The numnber of elements in the array being managed.
+			*/
+			accumulator_hash(size_t number_of_accumulators) :
+				table_shift(64),
+				table_mask(0),
+				maximum_capacity(minimum_capacity),
+				number_of_accumulators(number_of_accumulators)
+				{
+				if (number_of_accumulators > NUMBER_OF_ACCUMULATORS)
+					throw std::bad_array_new_length();
+
+				while (maximum_capacity < 2 * number_of_accumulators)
+					maximum_capacity *= 2;
+
+				rewind(0);
+				}
+
+			/*
+				ACCUMULATOR_HASH::OPERATOR[]()
+				------------------------------
+			*/
+			/*!
+				@brief Return a reference to the given accumulator
+				@details The only valid way to access the accumulators is through this interface.  If the document is not in the table
+				then it is added with an accumulator of zero.  The table must have room, so no more postings can be added than rewind() was told.
+				@param which [in] The accumulator to return.
+			*/
+			forceinline ELEMENT &operator[](size_t which)
+				{
+				size_t where = hash(which);
+				while (table[where].document != which)
+					{
+					if (table[where].document == EMPTY)
+						{
+						JASS_assert(touched.size() < touched.capacity());
+						touched.push_back(static_cast<uint32_t>(where));
+						table[where].document = static_cast<uint32_t>(which);
+						table[where].accumulator = 0;
+						break;
+						}
+					where = (where + 1) & table_mask;
+					}
+
+				return table[where].accumulator;
+				}
+
+			/*
+				ACCUMULATOR_HASH::GET_INDEX()
+				-----------------------------
+			*/
+			/*!
+				@brief Given a pointer to an accumulator, return the accumulator's index (i.e. the document id).
+				@param pointer [in] A pointer returned by operator[]().
+				@return The index of the accumulator.
+			*/
+			forceinline size_t get_index(const ELEMENT *pointer) const
+				{
+				return order(pointer);
+				}
+
+			/*
+				ACCUMULATOR_HASH::ORDER()
+				-------------------------
+			*/
+			/*!
+				@brief Return the key that accumulators with the same value are ordered on (the document id, read from the slot).
+				@param pointer [in] A pointer returned by operator[]().
+				@return The document id.
+			*/
+			static forceinline uintptr_t order(const ELEMENT *pointer)
+				{
+				return reinterpret_cast<const slot *>(pointer)->document;
+				}
+
+			/*
+				ACCUMULATOR_HASH::FOR_EACH_TOUCHED()
+				------------------------------------
+			*/
+			/*!
+				@brief Call functor on each accumulator that has been initialised since the last rewind(), in document order.
+				@details The slots used in this search are sorted on document id first, so this is O(t log t) for t accumulators touched.
+				@param functor [in] Called as functor(ELEMENT &accumulator).
+			*/
+			template <typename FUNCTOR>
+			void for_each_touched(FUNCTOR &&functor)
+				{
+				std::sort(touched.begin(), touched.end(), [this](uint32_t first, uint32_t second){ return table[first].document < table[second].document; });
+				for (const auto where : touched)
+					functor(table[where].accumulator);
+				}
+
+			/*
+				ACCUMULATOR_HASH::SIZE()
+				------------------------
+			*/
+			/*!
+				@brief Return the number of accumulators in the array.
+				@return Size of the accumulator array.
+			*/
+			size_t size(void) const
+				{
+				return number_of_accumulators;
+				}
+
+			/*
+				ACCUMULATOR_HASH::CAPACITY()
+				----------------------------
+			*/
+			/*!
+				@brief Return the number of slots in the hash table.
+				@return The number of slots.
+			*/
+			size_t capacity(void) const
+				{
+				return table.size();
+				}
+
+			/*
+				ACCUMULATOR_HASH::REWIND()
+				--------------------------
+			*/
+			/*!
+				@brief Empty the table ready for the next search and make sure it is large enough for it.
+				@details Only the slots used in the last search are cleared.  The table is re-allocated only if it needs to grow (which
+				happens between searches, so no pointer into the table is held).
+				@param postings [in] The largest number of postings the next search will add (default is as many as there can be).
+			*/
+			void rewind(size_t postings = (std::numeric_limits<size_t>::max)())
+				{
+				for (const auto where : touched)
+					table[where].document = EMPTY;
+				touched.clear();
+
+				size_t wanted = minimum_capacity;
+				while (wanted < maximum_capacity && wanted / 2 < postings)
+					wanted *= 2;
+
+				if (wanted > table.size())
+					{
+					table.assign(wanted, slot{0, EMPTY});
+					touched.reserve(wanted / 2 + 1);
+					table_mask = wanted - 1;
+					table_shift = 64;
+					while ((static_cast<size_t>(1) << (64 - table_shift)) < wanted)
+						table_shift--;
+					}
+				}
+
+			/*
+				ACCUMULATOR_HASH::UNITTEST()
+				----------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				accumulator_hash<uint32_t, 100000> instance(99999);
+				JASS_assert(instance.size() == 99999);
+				JASS_assert(instance.capacity() == minimum_capacity);
+
+				/*
+					Populate with a shuffled sequence spread over the collection, sizing the table for it
+				*/
+				std::vector<size_t> sequence(1000);
+				std::iota(sequence.begin(), sequence.end(), 0);
+				for (auto &position : sequence)
+					position = position * 97 + 3;
+				std::random_shuffle(sequence.begin(), sequence.end());
+
+				instance.rewind(sequence.size());
+				JASS_assert(instance.capacity() == 2048);
+				const uint32_t *first_slot = &instance[sequence[0]];
+				for (const auto &position : sequence)
+					{
+					JASS_assert(instance[position] == 0);
+					instance[position] = static_cast<uint32_t>(position + 1);
+					JASS_assert(instance.get_index(&instance[position]) == position);
+					}
+
+				/*
+					The accumulators don't move as the table fills
+				*/
+				JASS_assert(&instance[sequence[0]] == first_slot);
+				for (const auto &position : sequence)
+					JASS_assert(instance[position] == position + 1);
+
+				/*
+					Only the accumulators touched are walked, and in document order
+				*/
+				size_t previous = 0;
+				size_t touched_count = 0;
+				instance.for_each_touched([&previous, &touched_count](const uint32_t &value){ JASS_assert(value > previous); previous = value; touched_count++; });
+				JASS_assert(touched_count == sequence.size());
+
+				/*
+					After a rewind() they are all zero again, and a smaller search doesn't shrink the table
+				*/
+				instance.rewind(10);
+				JASS_assert(instance.capacity() == 2048);
+				for (const auto &position : sequence)
+					JASS_assert(instance[position] == 0);
+
+				/*
+					The table is capped at twice the number of documents
+				*/
+				accumulator_hash<uint16_t, 1000> small(1000);
+				small.rewind();
+				JASS_assert(small.capacity() == 2048);
+				for (size_t element = 0; element < small.size(); element++)
+					small[element] = static_cast<uint16_t>(element);
+				for (size_t element = 0; element < small.size(); element++)
+					JASS_assert(small[element] == element);
+
+				/*
+					Make sure we can't allocate more than the maximum
+				*/
+				bool thrown = false;
+				try
+					{
+					accumulator_hash<size_t, 64> too_large(65);
+					}
+				catch (std::bad_array_new_length &)
+					{
+					thrown = true;
+					}
+				JASS_assert(thrown);
+
+				puts("accumulator_hash::PASSED");
+				}
+		};
+	}
@@ -0,0 +1,206 @@
+/*
+	ACCUMULATOR_SIMPLE.H
+	--------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Manage an accumulator array as a single array that is zeroed on each search.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <new>
+#include <vector>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "forceinline.h"
+
+namespace JASS
+	{
+	/*
+		CLASS ACCUMULATOR_SIMPLE
+		------------------------
+	*/
+	/*!
+		@brief Store the accumulators in a flat array that is zeroed between searches.
+		@details This is the obvious way to manage the accumulators.  There is no check on access, instead the entire array is zeroed
+		with memset() when rewind() is called.  For small collections (or queries that touch a large proportion of the collection) this
+		is faster than accumulator_2d because memset() runs at memory bandwidth and operator[] has no branch.  For large collections
+		and short queries the cost of the memset() dominates.
+		@tparam ELEMENT The type of accumulator being used (default is uint16_t)
+		@tparam NUMBER_OF_ACCUMULATORS The maximum number of accumulators this object can hold.
+	*/
+	template <typename ELEMENT, size_t NUMBER_OF_ACCUMULATORS, typename = typename std::enable_if<std::is_arithmetic<ELEMENT>::value, ELEMENT>::type>
+	class accumulator_simple
+		{
+		private:
+			ELEMENT accumulator[NUMBER_OF_ACCUMULATORS];			///< The accumulators are kept in an array
+			size_t number_of_accumulators;							///< The number of accumulators that the user asked for
+
+		public:
+			/*
+				ACCUMULATOR_SIMPLE::ACCUMULATOR_SIMPLE()
+				----------------------------------------
+			*/
+			/*!
+				@brief Constructor.
+				@param number_of_accumulators [in] The numnber of elements in the array being managed.
+			*/
+			accumulator_simple(size_t number_of_accumulators) :
+				number_of_accumulators(number_of_accumulators)
+				{
+				if (number_of_accumulators > NUMBER_OF_ACCUMULATORS)
+					throw std::bad_array_new_length();
+
+				rewind();
+				}
+
+			/*
+				ACCUMULATOR_SIMPLE::OPERATOR[]()
+				--------------------------------
+			*/
+			/*!
+				@brief Return a reference to the given accumulator
+				@param which [in] The accumulator to return.
+			*/
+			forceinline ELEMENT &operator[](size_t which)
+				{
+				return accumulator[which];
+				}
+
+			/*
+				ACCUMULATOR_SIMPLE::GET_INDEX()
+				-------------------------------
+			*/
+			/*!
+				@brief Given a pointer to an accumulator, return the accumulator's index (i.e. the document id).
+				@param pointer [in] A pointer returned by operator[]().
+				@return The index of the accumulator.
+			*/
+			forceinline size_t get_index(const ELEMENT *pointer) const
+				{
+				return pointer - accumulator;
+				}
+
+			/*
+				ACCUMULATOR_SIMPLE::ORDER()
+				---------------------------
+			*/
+			/*!
+				@brief Return the key that accumulators with the same value are ordered on (their address, which is in document order).
+				@param pointer [in] A pointer returned by operator[]().
+				@return The address of the accumulator.
+			*/
+			static forceinline uintptr_t order(const ELEMENT *pointer)
+				{
+				return reinterpret_cast<uintptr_t>(pointer);
+				}
+
+			/*
+				ACCUMULATOR_SIMPLE::FOR_EACH_TOUCHED()
+				--------------------------------------
+			*/
+			/*!
+				@brief Call functor on each accumulator that has been initialised since the last rewind(), in document order.
+				@details There is no record of which accumulators have been touched so this walks them all.
+				@param functor [in] Called as functor(ELEMENT &accumulator).
+			*/
+			template <typename FUNCTOR>
+			void for_each_touched(FUNCTOR &&functor)
+				{
+				for (size_t which = 0; which < number_of_accumulators; which++)
+					functor(accumulator[which]);
+				}
+
+			/*
+				ACCUMULATOR_SIMPLE::SIZE()
+				--------------------------
+			*/
+			/*!
+				@brief Return the number of accumulators in the array.
+				@return Size of the accumulator array.
+			*/
+			size_t size(void) const
+				{
+				return number_of_accumulators;
+				}
+
+			/*
+				ACCUMULATOR_SIMPLE::REWIND()
+				----------------------------
+			*/
+			/*!
+				@brief Zero the accumulators ready for use
+				@param postings [in] Not used (the accumulators are for the whole collection, not sized for each search).
+			*/
+			void rewind(size_t postings = (std::numeric_limits<size_t>::max)())
+				{
+				::memset(accumulator, 0, sizeof(*accumulator) * number_of_accumulators);
+				}
+
+			/*
+				ACCUMULATOR_SIMPLE::UNITTEST()
+				------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				accumulator_simple<size_t, 64> instance(63);
+				JASS_assert(instance.size() == 63);
+
+				/*
+					Populate an array with the shuffled sequence 0..instance.size()
+				*/
+				std::vector<size_t> sequence(instance.size());
+				std::iota(sequence.begin(), sequence.end(), 0);
+				std::random_shuffle(sequence.begin(), sequence.end());
+
+				/*
+					Set elemenets and make sure they're correct
+				*/
+				for (const auto &position : sequence)
+					{
+					JASS_assert(instance[position] == 0);
+					instance[position] = position;
+					JASS_assert(instance.get_index(&instance[position]) == position);
+					}
+
+				for (size_t element = 0; element < instance.size(); element++)
+					JASS_assert(instance[element] == element);
+
+				/*
+					Make sure rewind() clears them all
+				*/
+				instance.rewind();
+				for (size_t element = 0; element < instance.size(); element++)
+					JASS_assert(instance[element] == 0);
+
+				/*
+					Make sure we can't allocate more than the maximum
+				*/
+				bool thrown = false;
+				try
+					{
+					accumulator_simple<size_t, 64> too_large(65);
+					}
+				catch (std::bad_array_new_length &)
+					{
+					thrown = true;
+					}
+				JASS_assert(thrown);
+
+				puts("accumulator_simple::PASSED");
+				}
+		};
+	}
@@ -192,6 +192,37 @@ namespace JASS
 #endif
 		}
 
+	/*
+		ALLOCATOR_POOL::RECYCLE()
+		-------------------------
+	*/
+	void allocator_pool::recycle(void)
+		{
+#ifdef USE_CRT_MALLOC
+		rewind();
+#else
+		chunk *chain = current_chunk;
+
+		/*
+			If there's only one chunk then re-use it
+		*/
+		if (chain == nullptr || chain->next_chunk == nullptr)
+			{
+			if (chain != nullptr)
+				chain->chunk_at = chain->data;
+			used = 0;
+			return;
+			}
+
+		/*
+			Otherwise replace all the chunks with one chunk large enough to hold everything they did
+		*/
+		size_t needed = allocated;
+		rewind();
+		add_chunk(needed);
+#endif
+		}
+
 	/*
 		ALLOCATOR_POOL::UNITTEST_THREAD()
 		---------------------------------
@@ -259,6 +290,32 @@ namespace JASS
 		JASS_assert(memory.size() == 0);
 		JASS_assert(memory.capacity() == 0);
 
+		/*
+			Recycle the memory, a single chunk is kept and re-used, more than one is replaced by one large enough for them all
+		*/
+		{
+		allocator_pool small(1024);
+		uint8_t *first = (uint8_t *)small.malloc(100);
+		auto capacity = small.capacity();
+		small.recycle();
+		JASS_assert(small.size() == 0);
+		JASS_assert(small.capacity() == capacity);
+		JASS_assert(small.malloc(100) == first);
+
+		small.malloc(2000);
+		small.malloc(2000);
+		auto needed = small.capacity();
+		small.recycle();
+		JASS_assert(small.size() == 0);
+		JASS_assert(small.capacity() >= needed);
+		first = (uint8_t *)small.malloc(3000);
+		small.malloc(1000);
+		capacity = small.capacity();
+		small.recycle();
+		JASS_assert(small.capacity() == capacity);
+		JASS_assert(small.malloc(3000) == first);
+		}
+
 
 		/*
 			Thread test this class.  This calls a seperate routine 255 times, each allocates n bytes of memory
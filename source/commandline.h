@@ -547,6 +547,25 @@ namespace JASS
 				results2 << parameter_boolean << parameter_string << parameter_integer << parameter_unsigned;
 				JASS_assert(results2.str() == "1four56");
 
+				/*
+					Check that a long name that starts with another long name is still matched (the longer names must not be captured by the shorter)
+				*/
+				bool zipfian_generate = false;
+				size_t zipfian_lists = 0;
+				std::string zipfian_skew;
+				auto prefix_commands = std::make_tuple
+					(
+					commandline::parameter("-Z", "--Zipfian_generate", "Extract a boolean", zipfian_generate),
+					commandline::parameter("-L", "--Zipfian_lists", "Extract an integer", zipfian_lists),
+					commandline::parameter("-S", "--Zipfian_skew", "Extract a string", zipfian_skew)
+					);
+				const char *argv4[] = {"program", "--Zipfian_lists", "3", "--Zipfian_skew", "1.5", "--Zipfian_generate"};
+				success = commandline::parse(6, argv4, prefix_commands, error);
+				JASS_assert(success);
+				JASS_assert(zipfian_generate);
+				JASS_assert(zipfian_lists == 3);
+				JASS_assert(zipfian_skew == "1.5");
+
 				/*
 					check for errors
 				*/
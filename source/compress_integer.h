@@ -15,6 +15,10 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include <vector>
+
+#include "simd.h"
+
 namespace JASS
 	{
 	/*
@@ -33,6 +37,28 @@ namespace JASS
 			typedef uint32_t integer;									///< This class and descendants will work on integers of this size.  Do not change without also changing JASS_COMPRESS_INTEGER_BITS_PER_INTEGER
 			#define JASS_COMPRESS_INTEGER_BITS_PER_INTEGER 32	///< The number of bits in compress_integer::integer (either 32 or 64). This must remain in sync with compress_integer::integer (and a hard coded value to be used in \#if statements)
 
+		public:
+			static constexpr size_t block_size = 256;				///< The number of integers decode_block() is usually asked to decode at a time (small enough to remain in L1 cache).
+
+			/*
+				CLASS COMPRESS_INTEGER::CURSOR
+				------------------------------
+			*/
+			/*!
+				@brief The state of a block at a time decode (see decode_block()).
+				@details The cursor is held by the caller so that the codex itself remains stateless (and so shareable between threads).
+			*/
+			class cursor
+				{
+				public:
+					const uint8_t *selectors;			///< Codex specific control information (such as the Stream VByte keys), or nullptr.
+					const uint8_t *data;					///< The next byte of the encoded sequence to decode.
+					const uint8_t *end;					///< The end of the encoded sequence.
+					size_t decoded;						///< The number of integers that have been decoded so far.
+					size_t integers;						///< The number of integers in the encoded sequence.
+					const compress_integer *codex;	///< The codex that decode_block() hands off to (for codexes that choose another per sequence), or nullptr.
+				};
+
 		public:
 			/*
 				COMPRESS_INTEGER::COMPRESS_INTEGER()
@@ -83,5 +109,109 @@ namespace JASS
 				@param source_length [in] The length (in bytes) of the source buffer.
 			*/
 			virtual void decode(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length) = 0;
+
+			/*
+				COMPRESS_INTEGER::DECODE_D1()
+				-----------------------------
+			*/
+			/*!
+				@brief Decode a sequence of D1 encoded integers (d-gaps) and reconstruct the original sequence (the cumulative sum).
+				@details The default is to decode() then compute the cumulative sum in place using SIMD instructions.  A codex
+				that can do the cumulative sum as it decodes (while the integers are still in registers) should override this.
+				@param decoded [out] The sequence of decoded integers.
+				@param integers_to_decode [in] The minimum number of integers to decode (it may decode more, but only this many are summed).
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			virtual void decode_d1(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length)
+				{
+				decode(decoded, integers_to_decode, source, source_length);
+				simd::cumulative_sum(decoded, integers_to_decode);
+				}
+
+			/*
+				COMPRESS_INTEGER::SUPPORTS_BLOCKS()
+				-----------------------------------
+			*/
+			/*!
+				@brief Does this codex support decoding a block of integers at a time (using decode_start() and decode_block())?
+				@details Codexes that do not must be decoded in one call to decode().
+				@return true if decode_block() can be used, else false.
+			*/
+			virtual bool supports_blocks(void) const
+				{
+				return false;
+				}
+
+			/*
+				COMPRESS_INTEGER::DECODE_START()
+				--------------------------------
+			*/
+			/*!
+				@brief Set up a cursor ready to decode the encoded sequence a block at a time.
+				@param at [out] The cursor.
+				@param integers [in] The number of integers in the encoded sequence.
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			virtual void decode_start(cursor &at, size_t integers, const void *source, size_t source_length) const
+				{
+				at.selectors = nullptr;
+				at.data = static_cast<const uint8_t *>(source);
+				at.end = at.data + source_length;
+				at.decoded = 0;
+				at.integers = integers;
+				at.codex = nullptr;
+				}
+
+			/*
+				COMPRESS_INTEGER::DECODE_BLOCK()
+				--------------------------------
+			*/
+			/*!
+				@brief Decode the next (up to) integers_to_decode integers from the sequence and advance the cursor.
+				@details Unlike decode(), exactly the number of integers returned are written to decoded (never more).  For the
+				codexes that decode a group of integers at a time integers_to_decode should be a multiple of 4 (as block_size is).
+				@param at [in, out] The cursor (from decode_start()).
+				@param decoded [out] The decoded integers.
+				@param integers_to_decode [in] The maximum number of integers to decode.
+				@return The number of integers decoded, 0 at the end of the sequence.
+			*/
+			virtual size_t decode_block(cursor &at, integer *decoded, size_t integers_to_decode) const
+				{
+				return 0;
+				}
+
+			/*
+				COMPRESS_INTEGER::UNITTEST_DECODE_BLOCKS()
+				------------------------------------------
+			*/
+			/*!
+				@brief Check that decoding a block at a time gives the same answer as decoding all at once.
+				@details This is for use by the unit tests of codexes that support decode_block().
+				@param codex [in] The codex to test.
+				@param sequence [in] The sequence of integers to encode then decode.
+				@return true if decode_block() correctly decodes the sequence, else false.
+			*/
+			static bool unittest_decode_blocks(compress_integer &codex, const std::vector<integer> &sequence)
+				{
+				std::vector<uint8_t> encoded(sequence.size() * sizeof(integer) * 2 + 1024);
+				std::vector<integer> decoded;
+				integer block[block_size + 1];
+
+				size_t size = codex.encode(encoded.data(), encoded.size(), sequence.data(), sequence.size());
+
+				/*
+					Decode into a block one larger than asked for so that we can check decode_block() doesn't write past the end.
+				*/
+				cursor at;
+				size_t got;
+				codex.decode_start(at, sequence.size(), encoded.data(), size);
+				block[block_size] = 0xDEADBEEF;
+				while ((got = codex.decode_block(at, block, block_size)) != 0)
+					decoded.insert(decoded.end(), block, block + got);
+
+				return codex.supports_blocks() && decoded == sequence && block[block_size] == 0xDEADBEEF;
+				}
 		} ;
 	}
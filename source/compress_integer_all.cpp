@@ -8,6 +8,7 @@
 
 #include "compress_integer_all.h"
 #include "compress_integer_none.h"
+#include "compress_integer_pfor.h"
 #include "compress_integer_carry_8b.h"
 #include "compress_integer_simple_9.h"
 #include "compress_integer_simple_8b.h"
@@ -17,11 +18,15 @@
 #include "compress_integer_carryover_12.h"
 #include "compress_integer_variable_byte.h"
 #include "compress_integer_qmx_improved.h"
+#include "compress_integer_bitpack_128.h"
+#include "compress_integer_elias_fano.h"
 #include "compress_integer_qmx_original.h"
 #include "compress_integer_stream_vbyte.h"
 #include "compress_integer_simple_9_packed.h"
 #include "compress_integer_simple_16_packed.h"
 #include "compress_integer_simple_8b_packed.h"
+#include "compress_integer_per_segment.h"
+#include "compress_integer_elias_fano_partitioned.h"
 
 namespace JASS
 	{
@@ -38,11 +43,19 @@ namespace JASS
 	static compress_integer_carryover_12 carryover_12;				///< Carryover-12 compressor
 	static compress_integer_qmx_original qmx_original;				///< QMX compressor
 	static compress_integer_qmx_improved qmx_improved;				///< Improved QMX compressor
-	static compress_integer_stream_vbyte stream_vbyte;				///< Stream VByte compressor
+	static compress_integer_stream_vbyte stream_vbyte(cpu::SSE4_2);			///< Stream VByte compressor
+	static compress_integer_stream_vbyte stream_vbyte_avx2(cpu::AVX2);		///< Stream VByte compressor (AVX2 decoder)
+	static compress_integer_stream_vbyte stream_vbyte_avx512(cpu::AVX512);	///< Stream VByte compressor (AVX-512 decoder)
 	static compress_integer_variable_byte variable_byte;			///< Variable Byte compressor
 	static compress_integer_simple_9_packed simple_9_packed;		///< Packed Simple-9 compressor
 	static compress_integer_simple_16_packed simple_16_packed;	///< Packed Simple-16 compressor
 	static compress_integer_simple_8b_packed simple_8b_packed;	///< Packed Simple-8b compressor
+	static compress_integer_elias_fano elias_fano;					///< Elias-Fano compressor
+	static compress_integer_elias_fano_partitioned elias_fano_partitioned;	///< Partitioned Elias-Fano compressor
+	static compress_integer_bitpack_128 bitpack_128;				///< SIMD-BP128 compressor
+	static compress_integer_pfor pfor_delta(false);					///< PForDelta compressor
+	static compress_integer_pfor opt_pfor(true);						///< OptPFor compressor
+	static compress_integer_per_segment per_segment;				///< The best of several compressors for each sequence
 
 	/*!
 		@brief Table of known compressors and their command line parameter names and actual names
@@ -50,21 +63,27 @@ namespace JASS
 	std::array<compress_integer_all::details, compress_integer_all::compressors_size> compress_integer_all::compressors
 		{
 			{
-			{"-cn", "--compress_none", "None", &none},
-			{"-cv", "--compress_vbyte", "Variable Byte", &variable_byte},
-			{"-cV", "--compress_stream_vbyte", "Stream VByte", &stream_vbyte},
-			{"-cr", "--compress_relative_10", "Relative-10", &relative_10},
-			{"-cc", "--compress_carryover_12", "Carryover-12", &carryover_12},
-			{"-cC", "--compress_carry_8b", "Carry-8b", &carry_8b},
-			{"-cs", "--compress_simple_9", "Simple-9", &simple_9},
-			{"-cp", "--compress_simple_9_packed", "Optimal Packed Simple-9", &simple_9_packed},
-			{"-ct", "--compress_simple_16", "Simple-16", &simple_16},
-			{"-cq", "--compress_simple_16_packed", "Optimal Packed Simple-16", &simple_16_packed},
-			{"-cT", "--compress_simple_8b", "Simple-8b", &simple_8b},
-			{"-cQ", "--compress_simple_8b_packed", "Optimal Packed Simple-8b", &simple_8b_packed},
-			{"-cX", "--compress_qmx_improved", "QMX Improved", &qmx_improved},
-			{"-cx", "--compress_qmx_original", "QMX Original", &qmx_original},
-			{"-cxX", "--compress_qmx_jass_v1", "QMX JASS v1", &qmx_jass_v1},
+			{"-cn", "--compress_none", "None", {&none}},
+			{"-cv", "--compress_vbyte", "Variable Byte", {&variable_byte}},
+			{"-cV", "--compress_stream_vbyte", "Stream VByte", {&stream_vbyte, &stream_vbyte_avx2, &stream_vbyte_avx512}},
+			{"-cr", "--compress_relative_10", "Relative-10", {&relative_10}},
+			{"-cc", "--compress_carryover_12", "Carryover-12", {&carryover_12}},
+			{"-cC", "--compress_carry_8b", "Carry-8b", {&carry_8b}},
+			{"-cs", "--compress_simple_9", "Simple-9", {&simple_9}},
+			{"-cp", "--compress_simple_9_packed", "Optimal Packed Simple-9", {&simple_9_packed}},
+			{"-ct", "--compress_simple_16", "Simple-16", {&simple_16}},
+			{"-cq", "--compress_simple_16_packed", "Optimal Packed Simple-16", {&simple_16_packed}},
+			{"-cT", "--compress_simple_8b", "Simple-8b", {&simple_8b}},
+			{"-cQ", "--compress_simple_8b_packed", "Optimal Packed Simple-8b", {&simple_8b_packed}},
+			{"-cX", "--compress_qmx_improved", "QMX Improved", {&qmx_improved}},
+			{"-cx", "--compress_qmx_original", "QMX Original", {&qmx_original}},
+			{"-cxX", "--compress_qmx_jass_v1", "QMX JASS v1", {&qmx_jass_v1}},
+			{"-ce", "--compress_elias_fano", "Elias-Fano", {&elias_fano}},
+			{"-cE", "--compress_elias_fano_partitioned", "Partitioned Elias-Fano", {&elias_fano_partitioned}},
+			{"-cb", "--compress_simd_bp128", "SIMD-BP128", {&bitpack_128}},
+			{"-cf", "--compress_pfor_delta", "PForDelta", {&pfor_delta}},
+			{"-cF", "--compress_opt_pfor", "OptPFor", {&opt_pfor}},
+			{"-cA", "--compress_per_segment", "Per-Segment Best", {&per_segment}},
 			}
 		};
 
@@ -110,7 +129,7 @@ namespace JASS
 		*/
 		JASS_assert(parameters[1] == true);
 		JASS_assert(name(parameters) == compressors[1].description);
-		JASS_assert(&compressor(parameters) == compressors[1].codex);
+		JASS_assert(&compressor(parameters) == compressors[1].codex[cpu::SSE4_2]);
 
 		/*
 			Check what happens if we don't have any parameters.
@@ -125,7 +144,28 @@ namespace JASS
 				parameters_selected++;					// LCOV_EXCL_LINE		// if the unit test is successful then this should not be called.
 		JASS_assert(parameters_selected == 0);
 		JASS_assert(name(parameters) == "None");
-		JASS_assert(&compressor(parameters) == compressors[default_compressor].codex);
+		JASS_assert(&compressor(parameters) == compressors[default_compressor].codex[cpu::SSE4_2]);
+
+		/*
+			Check access by index.
+		*/
+		for (size_t which = 0; which < compressors_size; which++)
+			{
+			JASS_assert(&get_by_index(which) == &variant(compressors[which]));
+			JASS_assert(&get_by_name(get_name(which)) == &variant(compressors[which]));
+			}
+
+		/*
+			Check that the variant matches the instruction set.
+		*/
+		cpu::isa original = cpu::best();
+		for (cpu::isa instruction_set = cpu::SSE4_2; instruction_set <= original; instruction_set = static_cast<cpu::isa>(instruction_set + 1))
+			{
+			cpu::limit(instruction_set);
+			JASS_assert(&get_by_name("Stream VByte") == compressors[2].codex[instruction_set]);
+			JASS_assert(&get_by_name("None") == compressors[0].codex[cpu::SSE4_2]);
+			}
+		cpu::limit(original);
 
 		puts("compress_integer_all::PASSED");
 		}
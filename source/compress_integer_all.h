@@ -16,6 +16,7 @@
 #include <tuple>
 #include <string>
 
+#include "cpu.h"
 #include "commandline.h"
 #include "compress_integer.h"
 
@@ -28,12 +29,13 @@ namespace JASS
 	/*!
 		@brief A container holding all the integer compression schemes known by JASS
 		@details Add a new compressor by creating an instance of it in compress_integer_all.cpp, then creating
-		an new row in the table compressors, then incr
+		an new row in the table compressors, then incr.  A compressor can have a different instance (variant) for each
+		instruction set (see JASS::cpu), the variant for the best instruction set the CPU supports is the one that is used.
 	*/
 	class compress_integer_all
 		{
 		public:
-			static constexpr size_t compressors_size = 15;					///< There are currently this many compressors known to JASS
+			static constexpr size_t compressors_size = 21;					///< There are currently this many compressors known to JASS
 			static constexpr size_t default_compressor = 0;					///< The default one to use is at this position in the compressors array
 
 		private:
@@ -42,7 +44,7 @@ namespace JASS
 				-----------------------------------
 			*/
 			/*!
-				Each compressor is represented by the command line details and an instance of that compressor
+				Each compressor is represented by the command line details and an instance of that compressor for each instruction set.
 			*/
 			class details
 				{
@@ -50,13 +52,31 @@ namespace JASS
 					const char *shortname;					///< The short command line parameter.
 					const char *longname;					///< The long command line parameter.
 					const char *description;				///< The name of the scheme, in command line use other stuff is wrapped around this.
-					compress_integer *codex;				///< An instance of the compressor.
+					compress_integer *codex[cpu::ISA_COUNT];	///< An instance of the compressor for each instruction set (nullptr if there isn't one, but there must be one for cpu::SSE4_2).
 				};
 
 		private:
 			static std::array<details, compressors_size> compressors;			///< The array of known compressor schemes
 			
 		private:
+			/*
+				COMPRESS_INTEGER_ALL::VARIANT()
+				-------------------------------
+			*/
+			/*!
+				@brief Return the variant of the compressor for the best instruction set the CPU supports.
+				@param scheme [in] The compressor.
+				@return A reference to the compressor.
+			*/
+			static compress_integer &variant(const details &scheme)
+				{
+				for (size_t instruction_set = cpu::best(); instruction_set > cpu::SSE4_2; instruction_set--)
+					if (scheme.codex[instruction_set] != nullptr)
+						return *scheme.codex[instruction_set];
+
+				return *scheme.codex[cpu::SSE4_2];
+				}
+
 			/*
 				COMPRESS_INTEGER_ALL::MAKE_COMMANDLINE()
 				----------------------------------------
@@ -115,9 +135,9 @@ namespace JASS
 				{
 				for (size_t which = 0; which < compressors_size; which++)
 					if (option[which])
-						return *compressors[which].codex;
+						return variant(compressors[which]);
 					
-				return *compressors[default_compressor].codex;
+				return variant(compressors[default_compressor]);
 				}
 			
 			/*
@@ -151,9 +171,38 @@ namespace JASS
 				{
 				for (size_t which = 0; which < compressors_size; which++)
 					if (compressors[which].description == name)
-						return *compressors[which].codex;
+						return variant(compressors[which]);
+
+				return variant(compressors[0]);
+				}
 
-				return *compressors[0].codex;
+			/*
+				COMPRESS_INTEGER_ALL::GET_BY_INDEX()
+				------------------------------------
+			*/
+			/*!
+				@brief Return a reference to the compressor at the given position in the table of known compressors.
+				@details This, along with get_name(), is used to iterate over all the known compressors (0 to compressors_size - 1).
+				@param which [in] The index of the compressor (which must be less than compressors_size).
+				@return A reference to the compressor.
+			*/
+			static compress_integer &get_by_index(size_t which)
+				{
+				return variant(compressors[which]);
+				}
+
+			/*
+				COMPRESS_INTEGER_ALL::GET_NAME()
+				--------------------------------
+			*/
+			/*!
+				@brief Return the name of the compressor at the given position in the table of known compressors.
+				@param which [in] The index of the compressor (which must be less than compressors_size).
+				@return The name of the compressor.
+			*/
+			static const char *get_name(size_t which)
+				{
+				return compressors[which].description;
 				}
 
 			/*
@@ -0,0 +1,340 @@
+/*
+	COMPRESS_INTEGER_BITPACK_128.CPP
+	--------------------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <stdio.h>
+#include <immintrin.h>
+
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include "asserts.h"
+#include "compress_integer_bitpack_128.h"
+
+namespace JASS
+	{
+	/*
+		COMPRESS_INTEGER_BITPACK_128::INTEGERS_PER_BLOCK
+		------------------------------------------------
+		C++14 needs a namespace-scope definition of a static constexpr member that is odr-used (std::min() takes it by reference).
+	*/
+	constexpr size_t compress_integer_bitpack_128::integers_per_block;
+
+	/*
+		COMPRESS_INTEGER_BITPACK_128::PACK_128()
+		----------------------------------------
+	*/
+	template <uint32_t BITS>
+	void compress_integer_bitpack_128::pack_128(uint8_t *encoded, const integer *source)
+		{
+		__m128i *into = reinterpret_cast<__m128i *>(encoded);
+		const __m128i *from = reinterpret_cast<const __m128i *>(source);
+		__m128i word = _mm_setzero_si128();
+		uint32_t filled = 0;
+
+		/*
+			Each lane holds 32 integers, once a lane's 32 bits are full the word is written and the overflow starts the next word.
+		*/
+		for (uint32_t which = 0; which < 32; which++)
+			{
+			__m128i value = _mm_loadu_si128(from + which);
+			word = _mm_or_si128(word, _mm_slli_epi32(value, filled));
+			filled += BITS;
+			if (filled >= 32)
+				{
+				_mm_storeu_si128(into++, word);
+				filled -= 32;
+				word = filled == 0 ? _mm_setzero_si128() : _mm_srli_epi32(value, BITS - filled);
+				}
+			}
+		}
+
+	/*
+		COMPRESS_INTEGER_BITPACK_128::UNPACK_128()
+		------------------------------------------
+	*/
+	template <uint32_t BITS>
+	void compress_integer_bitpack_128::unpack_128(integer *decoded, const uint8_t *source)
+		{
+		__m128i *into = reinterpret_cast<__m128i *>(decoded);
+		const __m128i *from = reinterpret_cast<const __m128i *>(source);
+
+		if (BITS == 0)
+			{
+			for (uint32_t which = 0; which < 32; which++)
+				_mm_storeu_si128(into + which, _mm_setzero_si128());
+			return;
+			}
+
+		const __m128i mask = _mm_set1_epi32(BITS == 32 ? 0xFFFFFFFF : (1U << (BITS % 32)) - 1);
+		__m128i word = _mm_loadu_si128(from++);
+		uint32_t used = 0;
+
+		/*
+			Shift each integer down to the bottom of its lane, taking the high bits from the next word if it straddles two.
+		*/
+		for (uint32_t which = 0; which < 32; which++)
+			{
+			__m128i value = _mm_srli_epi32(word, used);
+			used += BITS;
+			if (used >= 32 && which != 31)
+				{
+				used -= 32;
+				word = _mm_loadu_si128(from++);
+				if (used != 0)
+					value = _mm_or_si128(value, _mm_slli_epi32(word, BITS - used));
+				}
+			_mm_storeu_si128(into + which, _mm_and_si128(value, mask));
+			}
+		}
+
+	/*
+		COMPRESS_INTEGER_BITPACK_128::BITS_NEEDED()
+		-------------------------------------------
+	*/
+	uint32_t compress_integer_bitpack_128::bits_needed(const integer *source, size_t integers)
+		{
+		integer all = 0;
+		for (const integer *end = source + integers; source < end; source++)
+			all |= *source;
+
+		return width(all);
+		}
+
+	/*
+		COMPRESS_INTEGER_BITPACK_128::PACK()
+		------------------------------------
+	*/
+	size_t compress_integer_bitpack_128::pack(uint8_t *encoded, const integer *source, size_t integers, uint32_t bits)
+		{
+		static void (* const packer[])(uint8_t *, const integer *) =
+			{
+			pack_128<0>, pack_128<1>, pack_128<2>, pack_128<3>, pack_128<4>, pack_128<5>, pack_128<6>, pack_128<7>,
+			pack_128<8>, pack_128<9>, pack_128<10>, pack_128<11>, pack_128<12>, pack_128<13>, pack_128<14>, pack_128<15>,
+			pack_128<16>, pack_128<17>, pack_128<18>, pack_128<19>, pack_128<20>, pack_128<21>, pack_128<22>, pack_128<23>,
+			pack_128<24>, pack_128<25>, pack_128<26>, pack_128<27>, pack_128<28>, pack_128<29>, pack_128<30>, pack_128<31>,
+			pack_128<32>
+			};
+
+		if (integers == integers_per_block)
+			{
+			packer[bits](encoded, source);
+			return packed_size(integers, bits);
+			}
+
+		/*
+			A partial block is packed one integer after the other, low bits first.
+		*/
+		uint8_t *into = encoded;
+		uint64_t buffer = 0;
+		uint32_t filled = 0;
+		for (const integer *end = source + integers; source < end; source++)
+			{
+			buffer |= static_cast<uint64_t>(*source) << filled;
+			filled += bits;
+			while (filled >= 8)
+				{
+				*into++ = static_cast<uint8_t>(buffer);
+				buffer >>= 8;
+				filled -= 8;
+				}
+			}
+		if (filled != 0)
+			*into++ = static_cast<uint8_t>(buffer);
+
+		return into - encoded;
+		}
+
+	/*
+		COMPRESS_INTEGER_BITPACK_128::UNPACK()
+		--------------------------------------
+	*/
+	size_t compress_integer_bitpack_128::unpack(integer *decoded, const uint8_t *source, size_t integers, uint32_t bits)
+		{
+		static void (* const unpacker[])(integer *, const uint8_t *) =
+			{
+			unpack_128<0>, unpack_128<1>, unpack_128<2>, unpack_128<3>, unpack_128<4>, unpack_128<5>, unpack_128<6>, unpack_128<7>,
+			unpack_128<8>, unpack_128<9>, unpack_128<10>, unpack_128<11>, unpack_128<12>, unpack_128<13>, unpack_128<14>, unpack_128<15>,
+			unpack_128<16>, unpack_128<17>, unpack_128<18>, unpack_128<19>, unpack_128<20>, unpack_128<21>, unpack_128<22>, unpack_128<23>,
+			unpack_128<24>, unpack_128<25>, unpack_128<26>, unpack_128<27>, unpack_128<28>, unpack_128<29>, unpack_128<30>, unpack_128<31>,
+			unpack_128<32>
+			};
+
+		if (integers == integers_per_block)
+			{
+			unpacker[bits](decoded, source);
+			return packed_size(integers, bits);
+			}
+
+		const uint8_t *from = source;
+		uint64_t mask = (static_cast<uint64_t>(1) << bits) - 1;
+		uint64_t buffer = 0;
+		uint32_t filled = 0;
+		for (integer *end = decoded + integers; decoded < end; decoded++)
+			{
+			while (filled < bits)
+				{
+				buffer |= static_cast<uint64_t>(*from++) << filled;
+				filled += 8;
+				}
+			*decoded = static_cast<integer>(buffer & mask);
+			buffer >>= bits;
+			filled -= bits;
+			}
+
+		return packed_size(integers, bits);
+		}
+
+	/*
+		COMPRESS_INTEGER_BITPACK_128::ENCODE()
+		--------------------------------------
+	*/
+	size_t compress_integer_bitpack_128::encode(void *encoded, size_t encoded_buffer_length, const integer *source, size_t source_integers)
+		{
+		size_t blocks = (source_integers + integers_per_block - 1) / integers_per_block;
+		if (blocks > encoded_buffer_length)
+			return 0;
+
+		uint8_t *widths = static_cast<uint8_t *>(encoded);
+		uint8_t *data = widths + blocks;
+		const uint8_t *end = widths + encoded_buffer_length;
+
+		for (size_t block = 0; block < blocks; block++)
+			{
+			const integer *from = source + block * integers_per_block;
+			size_t integers = (std::min)(integers_per_block, source_integers - block * integers_per_block);
+			uint32_t bits = bits_needed(from, integers);
+
+			if (data + packed_size(integers, bits) > end)
+				return 0;
+
+			widths[block] = static_cast<uint8_t>(bits);
+			data += pack(data, from, integers, bits);
+			}
+
+		return data - widths;
+		}
+
+	/*
+		COMPRESS_INTEGER_BITPACK_128::DECODE()
+		--------------------------------------
+	*/
+	void compress_integer_bitpack_128::decode(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length)
+		{
+		size_t blocks = (integers_to_decode + integers_per_block - 1) / integers_per_block;
+		const uint8_t *widths = static_cast<const uint8_t *>(source);
+		const uint8_t *data = widths + blocks;
+
+		for (size_t block = 0; block < blocks; block++)
+			{
+			size_t integers = (std::min)(integers_per_block, integers_to_decode - block * integers_per_block);
+			data += unpack(decoded + block * integers_per_block, data, integers, widths[block]);
+			}
+		}
+
+	/*
+		COMPRESS_INTEGER_BITPACK_128::DECODE_START()
+		--------------------------------------------
+	*/
+	void compress_integer_bitpack_128::decode_start(cursor &at, size_t integers, const void *source, size_t source_length) const
+		{
+		at.selectors = static_cast<const uint8_t *>(source);
+		at.data = at.selectors + (integers + integers_per_block - 1) / integers_per_block;
+		at.end = at.selectors + source_length;
+		at.decoded = 0;
+		at.integers = integers;
+		at.codex = nullptr;
+		}
+
+	/*
+		COMPRESS_INTEGER_BITPACK_128::DECODE_BLOCK()
+		--------------------------------------------
+	*/
+	size_t compress_integer_bitpack_128::decode_block(cursor &at, integer *decoded, size_t integers_to_decode) const
+		{
+		size_t got = 0;
+
+		while (at.decoded < at.integers)
+			{
+			size_t integers = (std::min)(integers_per_block, at.integers - at.decoded);
+			if (got + integers > integers_to_decode)
+				break;
+
+			at.data += unpack(decoded + got, at.data, integers, *at.selectors++);
+			at.decoded += integers;
+			got += integers;
+			}
+
+		return got;
+		}
+
+	/*
+		COMPRESS_INTEGER_BITPACK_128::UNITTEST()
+		----------------------------------------
+	*/
+	void compress_integer_bitpack_128::unittest(void)
+		{
+		compress_integer_bitpack_128 codex;
+		std::mt19937 random(1);
+		std::vector<integer> sequence;
+		std::vector<integer> decoded;
+		std::vector<uint8_t> encoded;
+
+		/*
+			Every width, as both a full block (vertical) and a partial block (horizontal).
+		*/
+		for (uint32_t bits = 0; bits <= 32; bits++)
+			for (size_t length : {integers_per_block, integers_per_block - 1, static_cast<size_t>(1)})
+				{
+				sequence.resize(length);
+				for (auto &value : sequence)
+					value = bits == 0 ? 0 : static_cast<integer>(random()) >> (32 - bits);
+				sequence[0] = bits == 0 ? 0 : static_cast<integer>(0xFFFFFFFFULL >> (32 - bits));			// make sure the width is bits
+
+				encoded.assign(packed_size(length, bits) + 1, 0);
+				JASS_assert(bits_needed(sequence.data(), length) == bits);
+				JASS_assert(pack(encoded.data(), sequence.data(), length, bits) == packed_size(length, bits));
+
+				decoded.assign(length + 1, 0xDEADBEEF);
+				JASS_assert(unpack(decoded.data(), encoded.data(), length, bits) == packed_size(length, bits));
+				JASS_assert(std::equal(sequence.begin(), sequence.end(), decoded.begin()));
+				JASS_assert(decoded[length] == 0xDEADBEEF);
+				}
+
+		/*
+			Whole sequences of mixed widths, and a block at a time.
+		*/
+		for (size_t length : {1, 127, 128, 129, 256, 1000, 5000})
+			{
+			sequence.resize(length);
+			for (size_t which = 0; which < length; which++)
+				sequence[which] = static_cast<integer>(random()) >> (random() % 32 + (which / integers_per_block) % 2);
+
+			encoded.assign(length * sizeof(integer) + length, 0);
+			size_t size = codex.encode(encoded.data(), encoded.size(), sequence.data(), sequence.size());
+			JASS_assert(size != 0);
+
+			decoded.assign(length, 0);
+			codex.decode(decoded.data(), length, encoded.data(), size);
+			JASS_assert(decoded == sequence);
+
+			JASS_assert(compress_integer::unittest_decode_blocks(codex, sequence));
+			}
+
+		/*
+			Small integers take few bytes.
+		*/
+		sequence.assign(1024, 1);
+		JASS_assert(codex.encode(encoded.data(), encoded.size(), sequence.data(), sequence.size()) == 1024 / 128 * 17);
+
+		/*
+			Overflow.
+		*/
+		JASS_assert(codex.encode(encoded.data(), 10, sequence.data(), sequence.size()) == 0);
+
+		puts("compress_integer_bitpack_128::PASSED");
+		}
+	}
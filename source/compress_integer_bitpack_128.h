@@ -0,0 +1,248 @@
+/*
+	COMPRESS_INTEGER_BITPACK_128.H
+	------------------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief SIMD-BP128 bit packing of integer sequences.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+#include "compress_integer.h"
+
+namespace JASS
+	{
+	/*
+		CLASS COMPRESS_INTEGER_BITPACK_128
+		----------------------------------
+	*/
+	/*!
+		@brief SIMD-BP128 bit packing of integer sequences.
+		@details The sequence is broken into blocks of 128 integers and each block is packed using the number of bits
+		needed to store the largest integer in it.  A block is packed "vertically" across the 4 lanes of an SSE register
+		(integer i goes into lane i % 4) so that 4 integers are unpacked with each shift and mask, and each block takes
+		exactly 16 * width bytes.  The last block (if it holds fewer than 128 integers) is packed "horizontally" one
+		integer after the other, so short postings lists are not padded out to 128 integers.
+
+		The encoding is: the width (in bits) of each block (1 byte per block), followed by the packed blocks.
+		See:
+			D. Lemire, L. Boytsov (2015), Decoding billions of integers per second through vectorization, Software: Practice and Experience 45(1):1-29
+	*/
+	class compress_integer_bitpack_128 : public compress_integer
+		{
+		public:
+			static constexpr size_t integers_per_block = 128;			///< The number of integers in each block.
+
+		private:
+			/*
+				COMPRESS_INTEGER_BITPACK_128::PACK_128()
+				----------------------------------------
+			*/
+			/*!
+				@brief Pack a block of 128 integers, each of which fits in BITS bits, vertically into 16 * BITS bytes.
+				@param encoded [out] The packed integers.
+				@param source [in] The 128 integers to pack.
+			*/
+			template <uint32_t BITS>
+			static void pack_128(uint8_t *encoded, const integer *source);
+
+			/*
+				COMPRESS_INTEGER_BITPACK_128::UNPACK_128()
+				------------------------------------------
+			*/
+			/*!
+				@brief Unpack a block of 128 integers packed by pack_128().
+				@param decoded [out] The 128 unpacked integers.
+				@param source [in] The packed integers.
+			*/
+			template <uint32_t BITS>
+			static void unpack_128(integer *decoded, const uint8_t *source);
+
+		public:
+			/*
+				COMPRESS_INTEGER_BITPACK_128::WIDTH()
+				-------------------------------------
+			*/
+			/*!
+				@brief Return the number of bits needed to store the given integer.
+				@param value [in] The integer.
+				@return The width, in bits (0 if value is 0).
+			*/
+			static inline uint32_t width(integer value)
+				{
+				if (value == 0)
+					return 0;
+				#ifdef _MSC_VER
+					unsigned long position;
+					_BitScanReverse(&position, value);
+					return static_cast<uint32_t>(position) + 1;
+				#else
+					return 32 - static_cast<uint32_t>(__builtin_clz(value));
+				#endif
+				}
+
+			/*
+				COMPRESS_INTEGER_BITPACK_128::BITS_NEEDED()
+				-------------------------------------------
+			*/
+			/*!
+				@brief Return the number of bits needed to store the largest of the given integers.
+				@param source [in] The integers.
+				@param integers [in] The number of integers.
+				@return The width, in bits (0 if all the integers are 0).
+			*/
+			static uint32_t bits_needed(const integer *source, size_t integers);
+
+			/*
+				COMPRESS_INTEGER_BITPACK_128::PACKED_SIZE()
+				-------------------------------------------
+			*/
+			/*!
+				@brief Return the number of bytes pack() uses to pack the given number of integers at the given width.
+				@param integers [in] The number of integers (no more than integers_per_block).
+				@param bits [in] The width (in bits) of each integer.
+				@return The size (in bytes) of the packed integers.
+			*/
+			static size_t packed_size(size_t integers, uint32_t bits)
+				{
+				return integers == integers_per_block ? 16 * bits : (integers * bits + 7) / 8;
+				}
+
+			/*
+				COMPRESS_INTEGER_BITPACK_128::PACK()
+				------------------------------------
+			*/
+			/*!
+				@brief Pack up to integers_per_block integers (each of which must fit in bits bits) into packed_size(integers, bits) bytes.
+				@details A full block is packed vertically (with SIMD instructions), a partial block is packed horizontally.
+				@param encoded [out] The packed integers.
+				@param source [in] The integers to pack.
+				@param integers [in] The number of integers (no more than integers_per_block).
+				@param bits [in] The width (in bits) of each integer.
+				@return The number of bytes written to encoded.
+			*/
+			static size_t pack(uint8_t *encoded, const integer *source, size_t integers, uint32_t bits);
+
+			/*
+				COMPRESS_INTEGER_BITPACK_128::UNPACK()
+				--------------------------------------
+			*/
+			/*!
+				@brief Unpack integers packed by pack(), writing exactly integers integers to decoded.
+				@param decoded [out] The unpacked integers.
+				@param source [in] The packed integers.
+				@param integers [in] The number of integers (no more than integers_per_block).
+				@param bits [in] The width (in bits) of each integer.
+				@return The number of bytes read from source.
+			*/
+			static size_t unpack(integer *decoded, const uint8_t *source, size_t integers, uint32_t bits);
+
+		public:
+			/*
+				COMPRESS_INTEGER_BITPACK_128::COMPRESS_INTEGER_BITPACK_128()
+				------------------------------------------------------------
+			*/
+			/*!
+				@brief Constructor.
+			*/
+			compress_integer_bitpack_128()
+				{
+				/* Nothing */
+				}
+
+			/*
+				COMPRESS_INTEGER_BITPACK_128::~COMPRESS_INTEGER_BITPACK_128()
+				-------------------------------------------------------------
+			*/
+			/*!
+				@brief Destructor.
+			*/
+			virtual ~compress_integer_bitpack_128()
+				{
+				/* Nothing */
+				}
+
+			/*
+				COMPRESS_INTEGER_BITPACK_128::ENCODE()
+				--------------------------------------
+			*/
+			/*!
+				@brief Encode a sequence of integers returning the number of bytes used for the encoding, or 0 if the encoded sequence doesn't fit in the buffer.
+				@param encoded [out] The sequence of bytes that is the encoded sequence.
+				@param encoded_buffer_length [in] The length (in bytes) of the output buffer, encoded.
+				@param source [in] The sequence of integers to encode.
+				@param source_integers [in] The length (in integers) of the source buffer.
+				@return The number of bytes used to encode the integer sequence, or 0 on error (i.e. overflow).
+			*/
+			virtual size_t encode(void *encoded, size_t encoded_buffer_length, const integer *source, size_t source_integers);
+
+			/*
+				COMPRESS_INTEGER_BITPACK_128::DECODE()
+				--------------------------------------
+			*/
+			/*!
+				@brief Decode a sequence of integers encoded with this codex.
+				@param decoded [out] The sequence of decoded integers.
+				@param integers_to_decode [in] The minimum number of integers to decode (it may decode more).
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			virtual void decode(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length);
+
+			/*
+				COMPRESS_INTEGER_BITPACK_128::SUPPORTS_BLOCKS()
+				-----------------------------------------------
+			*/
+			/*!
+				@brief Does this codex support decoding a block of integers at a time (using decode_start() and decode_block())?
+				@return true.
+			*/
+			virtual bool supports_blocks(void) const
+				{
+				return true;
+				}
+
+			/*
+				COMPRESS_INTEGER_BITPACK_128::DECODE_START()
+				--------------------------------------------
+			*/
+			/*!
+				@brief Set up a cursor ready to decode the encoded sequence a block at a time.
+				@param at [out] The cursor.
+				@param integers [in] The number of integers in the encoded sequence.
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			virtual void decode_start(cursor &at, size_t integers, const void *source, size_t source_length) const;
+
+			/*
+				COMPRESS_INTEGER_BITPACK_128::DECODE_BLOCK()
+				--------------------------------------------
+			*/
+			/*!
+				@brief Decode the next (up to) integers_to_decode integers from the sequence and advance the cursor.
+				@param at [in, out] The cursor (from decode_start()).
+				@param decoded [out] The decoded integers.
+				@param integers_to_decode [in] The maximum number of integers to decode (a multiple of integers_per_block).
+				@return The number of integers decoded, 0 at the end of the sequence.
+			*/
+			virtual size_t decode_block(cursor &at, integer *decoded, size_t integers_to_decode) const;
+
+			/*
+				COMPRESS_INTEGER_BITPACK_128::UNITTEST()
+				----------------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
@@ -0,0 +1,486 @@
+/*
+	COMPRESS_INTEGER_ELIAS_FANO.CPP
+	-------------------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <string.h>
+#include <stdio.h>
+
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include "maths.h"
+#include "asserts.h"
+#include "compress_integer_elias_fano.h"
+
+namespace JASS
+	{
+	/*
+		READ_64()
+		---------
+	*/
+	/*!
+		@brief Read 64 bits from a (possibly unaligned) address.
+		@param from [in] The address.
+		@return The 64-bit word.
+	*/
+	static inline uint64_t read_64(const uint8_t *from)
+		{
+		uint64_t word;
+		memcpy(&word, from, sizeof(word));		// assumes little endian
+		return word;
+		}
+
+	/*
+		GET_LOW()
+		---------
+	*/
+	/*!
+		@brief Extract the low bits of the given integer from the packed low bits.
+		@details As low_bits is at most 56, a single (unaligned) 64-bit read always holds all the bits.
+		@param low [in] The packed low bits.
+		@param low_bits [in] The width of each low part.
+		@param which [in] The integer to get.
+		@return The low bits of that integer.
+	*/
+	static inline uint64_t get_low(const uint8_t *low, uint32_t low_bits, size_t which)
+		{
+		if (low_bits == 0)
+			return 0;
+
+		size_t bit = which * low_bits;
+		return (read_64(low + bit / 8) >> (bit % 8)) & ((static_cast<uint64_t>(1) << low_bits) - 1);
+		}
+
+	/*
+		SELECT_IN_WORD()
+		----------------
+	*/
+	/*!
+		@brief Return the position of the given set bit in the word.
+		@param word [in] The word.
+		@param which [in] Which set bit (counting from 0), there must be more than this many set bits in word.
+		@return The bit position.
+	*/
+	static inline uint32_t select_in_word(uint64_t word, size_t which)
+		{
+		while (which-- > 0)
+			word &= word - 1;
+
+		return compress_integer_elias_fano::trailing_zeros(word);
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO::LOW_BITS_WIDTH()
+		---------------------------------------------
+	*/
+	uint32_t compress_integer_elias_fano::low_bits_width(size_t integers, uint64_t largest)
+		{
+		if (integers == 0 || largest / integers == 0)
+			return 0;
+
+		return static_cast<uint32_t>(maths::floor_log2(largest / integers));
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO::ENCODED_SIZE()
+		-------------------------------------------
+	*/
+	size_t compress_integer_elias_fano::encoded_size(size_t integers, uint64_t largest)
+		{
+		uint32_t low_bits = low_bits_width(integers, largest);
+		size_t low_words = (integers * low_bits + 63) / 64;
+		size_t high_words = (integers + (largest >> low_bits) + 1 + 63) / 64;
+
+		return 1 + (low_words + high_words) * sizeof(uint64_t);
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO::ENCODE_SEQUENCE()
+		----------------------------------------------
+	*/
+	template <typename NEXT_VALUE>
+	size_t compress_integer_elias_fano::encode_sequence(void *encoded, size_t encoded_buffer_length, size_t integers, uint64_t largest, NEXT_VALUE next_value)
+		{
+		if (integers == 0)
+			return 0;
+
+		/*
+			Integers so sparse that more than 56 low bits are needed can't be read with a single 64-bit read (see get_low()).
+		*/
+		size_t size = encoded_size(integers, largest);
+		if (size > encoded_buffer_length || low_bits_width(integers, largest) > 56)
+			return 0;
+
+		uint8_t *destination = static_cast<uint8_t *>(encoded);
+		memset(destination, 0, size);
+
+		uint32_t low_bits = low_bits_width(integers, largest);
+		uint8_t *low = destination + 1;
+		uint8_t *high = low + (integers * low_bits + 63) / 64 * sizeof(uint64_t);
+		uint64_t low_mask = (static_cast<uint64_t>(1) << low_bits) - 1;
+
+		*destination = static_cast<uint8_t>(low_bits);
+		for (size_t which = 0; which < integers; which++)
+			{
+			uint64_t value = next_value();
+
+			/*
+				The low bits are packed (which might straddle a word boundary, but the high bits follow so there's always 8 bytes to write into).
+			*/
+			if (low_bits != 0)
+				{
+				size_t bit = which * low_bits;
+				uint64_t word = read_64(low + bit / 8) | ((value & low_mask) << (bit % 8));
+				memcpy(low + bit / 8, &word, sizeof(word));
+				}
+
+			/*
+				The high bits are unary, the which-th integer sets bit (high bits + which).
+			*/
+			size_t bit = (value >> low_bits) + which;
+			high[bit / 8] |= 1 << (bit % 8);
+			}
+
+		return size;
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO::DECODE_SEQUENCE()
+		----------------------------------------------
+	*/
+	template <typename EMIT>
+	void compress_integer_elias_fano::decode_sequence(size_t integers, const void *source, EMIT emit)
+		{
+		const uint8_t *low = static_cast<const uint8_t *>(source) + 1;
+		uint32_t low_bits = *static_cast<const uint8_t *>(source);
+		const uint8_t *high = low + (integers * low_bits + 63) / 64 * sizeof(uint64_t);
+
+		/*
+			Walk the set bits in the high part, each is the next integer.
+		*/
+		size_t which = 0;
+		for (size_t word_number = 0; which < integers; word_number++)
+			{
+			uint64_t word = read_64(high + word_number * sizeof(uint64_t));
+			while (word != 0 && which < integers)
+				{
+				uint64_t high_part = word_number * 64 + trailing_zeros(word) - which;
+				word &= word - 1;
+				emit((high_part << low_bits) | get_low(low, low_bits, which));
+				which++;
+				}
+			}
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO::ENCODE_VALUES()
+		--------------------------------------------
+	*/
+	size_t compress_integer_elias_fano::encode_values(void *encoded, size_t encoded_buffer_length, const uint64_t *source, size_t source_integers)
+		{
+		if (source_integers == 0)
+			return 0;
+
+		return encode_sequence(encoded, encoded_buffer_length, source_integers, source[source_integers - 1], [&source]() { return *source++; });
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO::ENCODE()
+		-------------------------------------
+	*/
+	size_t compress_integer_elias_fano::encode(void *encoded, size_t encoded_buffer_length, const integer *source, size_t source_integers)
+		{
+		/*
+			Elias-Fano needs to know the largest integer in the sequence before it can start, that's the sum of the d-gaps.
+		*/
+		uint64_t largest = 0;
+		for (const integer *current = source; current < source + source_integers; current++)
+			largest += *current;
+
+		uint64_t sum = 0;
+		return encode_sequence(encoded, encoded_buffer_length, source_integers, largest, [&source, &sum]() { return sum += *source++; });
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO::DECODE_GAPS()
+		------------------------------------------
+	*/
+	void compress_integer_elias_fano::decode_gaps(integer *decoded, size_t integers, const void *source)
+		{
+		uint64_t previous = 0;
+		decode_sequence(integers, source, [&decoded, &previous](uint64_t value) { *decoded++ = static_cast<integer>(value - previous); previous = value; });
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO::DECODE_VALUES()
+		--------------------------------------------
+	*/
+	void compress_integer_elias_fano::decode_values(integer *decoded, size_t integers, const void *source, integer base)
+		{
+		decode_sequence(integers, source, [&decoded, base](uint64_t value) { *decoded++ = static_cast<integer>(value + base); });
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO::DECODE()
+		-------------------------------------
+	*/
+	void compress_integer_elias_fano::decode(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length)
+		{
+		if (integers_to_decode != 0)
+			decode_gaps(decoded, integers_to_decode, source);
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO::DECODE_D1()
+		----------------------------------------
+	*/
+	void compress_integer_elias_fano::decode_d1(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length)
+		{
+		if (integers_to_decode != 0)
+			decode_values(decoded, integers_to_decode, source);
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO::RANDOM_ACCESS::RANDOM_ACCESS()
+		-----------------------------------------------------------
+	*/
+	compress_integer_elias_fano::random_access::random_access(const void *encoded, size_t encoded_length, size_t integers) :
+		integers(integers),
+		low_bits(0),
+		low(nullptr),
+		high(nullptr),
+		high_words(0)
+		{
+		if (integers == 0 || encoded_length == 0)
+			{
+			this->integers = 0;
+			return;
+			}
+
+		low_bits = *static_cast<const uint8_t *>(encoded);
+		low = static_cast<const uint8_t *>(encoded) + 1;
+		size_t low_bytes = (integers * low_bits + 63) / 64 * sizeof(uint64_t);
+		high = reinterpret_cast<const uint64_t *>(low + low_bytes);
+		high_words = (encoded_length - 1 - low_bytes) / sizeof(uint64_t);
+
+		if (integers <= select_sample)
+			return;
+
+		/*
+			Build the select pointers.  The high bits hold integers ones and about as many zeros, so there are about 2n / select_sample samples.
+		*/
+		size_t ones_before = 0;
+		size_t zeros_before = 0;
+		for (size_t word_number = 0; word_number < high_words; word_number++)
+			{
+			size_t ones_in_word = _mm_popcnt_u64(high_word(word_number));
+			size_t zeros_in_word = 64 - ones_in_word;
+
+			while (ones.size() * select_sample < ones_before + ones_in_word)
+				ones.push_back({word_number, ones_before});
+			while (zeros.size() * select_sample < zeros_before + zeros_in_word)
+				zeros.push_back({word_number, zeros_before});
+
+			ones_before += ones_in_word;
+			zeros_before += zeros_in_word;
+			}
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO::RANDOM_ACCESS::ACCESS()
+		----------------------------------------------------
+	*/
+	uint64_t compress_integer_elias_fano::random_access::access(size_t position) const
+		{
+		/*
+			Find the word holding the position-th set bit (select 1), starting from the nearest sample.
+		*/
+		size_t word_number = 0;
+		size_t remaining = position;
+		if (!ones.empty())
+			{
+			const sample &from = ones[position / select_sample];
+			word_number = from.word;
+			remaining = position - from.before;
+			}
+
+		for (; word_number < high_words; word_number++)
+			{
+			uint64_t word = high_word(word_number);
+			size_t ones = _mm_popcnt_u64(word);
+			if (remaining < ones)
+				{
+				uint64_t high_part = word_number * 64 + select_in_word(word, remaining) - position;
+				return (high_part << low_bits) | get_low(low, low_bits, position);
+				}
+			remaining -= ones;
+			}
+
+		return 0;		// LCOV_EXCL_LINE	// position is past the end
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO::RANDOM_ACCESS::NEXT_GEQ()
+		------------------------------------------------------
+	*/
+	size_t compress_integer_elias_fano::random_access::next_geq(uint64_t value, uint64_t &found) const
+		{
+		/*
+			The integers with high part h are the set bits between the h-th and (h+1)-th unset bits, so find the
+			h-th unset bit (select 0), that's where we start looking.  Start the search from the nearest sample.
+		*/
+		uint64_t wanted_high = value >> low_bits;
+		size_t word_number = 0;
+		size_t bit = 0;
+		if (wanted_high != 0)
+			{
+			uint64_t remaining = wanted_high - 1;
+			if (!zeros.empty())
+				{
+				if (remaining / select_sample >= zeros.size())
+					return integers;
+
+				const sample &from = zeros[remaining / select_sample];
+				word_number = from.word;
+				remaining -= from.before;
+				}
+
+			for (; word_number < high_words; word_number++)
+				{
+				uint64_t word = ~high_word(word_number);
+				size_t zeros = _mm_popcnt_u64(word);
+				if (remaining < zeros)
+					{
+					bit = select_in_word(word, remaining) + 1;
+					break;
+					}
+				remaining -= zeros;
+				}
+			if (word_number == high_words)
+				return integers;
+			}
+
+		/*
+			There are (bit position - wanted_high) set bits before this point, so that's the first integer to check.
+		*/
+		size_t which = word_number * 64 + bit - wanted_high;
+		uint64_t word = bit == 64 ? 0 : high_word(word_number) & (~static_cast<uint64_t>(0) << bit);
+		while (which < integers)
+			{
+			while (word == 0)
+				{
+				if (++word_number >= high_words)
+					return integers;		// LCOV_EXCL_LINE	// can't happen as there are integers bits set
+				word = high_word(word_number);
+				}
+
+			uint64_t high_part = word_number * 64 + trailing_zeros(word) - which;
+			word &= word - 1;
+			uint64_t candidate = (high_part << low_bits) | get_low(low, low_bits, which);
+			if (candidate >= value)
+				{
+				found = candidate;
+				return which;
+				}
+			which++;
+			}
+
+		return integers;
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO::UNITTEST()
+		---------------------------------------
+	*/
+	void compress_integer_elias_fano::unittest(void)
+		{
+		compress_integer_elias_fano codex;
+		std::mt19937 random(1);
+		std::vector<integer> sequence;
+		std::vector<integer> decoded;
+		std::vector<uint8_t> encoded;
+
+		/*
+			Sparse, dense, runs of the same value (d-gaps of 0), and single integer sequences.  Those longer than
+			random_access::select_sample use the select pointers.
+		*/
+		for (uint32_t largest_gap : {1, 2, 3, 100, 100000})
+			for (size_t length : {1, 2, 7, 63, 64, 65, 256, 257, 1000, 5000})
+				{
+				sequence.resize(length);
+				for (auto &gap : sequence)
+					gap = random() % (largest_gap + 1);
+
+				encoded.assign(encoded_size(length, 100000 * static_cast<uint64_t>(length)), 0);
+				size_t size = codex.encode(encoded.data(), encoded.size(), sequence.data(), sequence.size());
+				JASS_assert(size != 0);
+
+				/*
+					Decode as d-gaps.
+				*/
+				decoded.assign(length, 0);
+				codex.decode(decoded.data(), length, encoded.data(), size);
+				JASS_assert(decoded == sequence);
+
+				/*
+					Decode as the original sequence.
+				*/
+				std::vector<uint64_t> expected;
+				uint64_t sum = 0;
+				for (auto gap : sequence)
+					expected.push_back(sum += gap);
+
+				codex.decode_d1(decoded.data(), length, encoded.data(), size);
+				for (size_t which = 0; which < length; which++)
+					JASS_assert(decoded[which] == expected[which]);
+
+				/*
+					Random access by position, and by value.
+				*/
+				random_access reader(encoded.data(), size, length);
+				JASS_assert(reader.size() == length);
+				for (size_t which = 0; which < length; which++)
+					JASS_assert(reader.access(which) == expected[which]);
+
+				for (uint64_t value = 0; value <= sum + 1; value += 1 + value / 2)
+					{
+					uint64_t found = 0;
+					size_t position = reader.next_geq(value, found);
+					size_t expected_position = std::lower_bound(expected.begin(), expected.end(), value) - expected.begin();
+					JASS_assert(position == expected_position);
+					if (position < length)
+						JASS_assert(found == expected[position]);
+					}
+
+				/*
+					Look up values either side of the integers in the sequence, so every select pointer gets used.
+				*/
+				for (size_t which = 0; which < length; which += 1 + which % 7)
+					for (uint64_t value : {expected[which], expected[which] + 1})
+						{
+						uint64_t found = 0;
+						size_t position = reader.next_geq(value, found);
+						JASS_assert(position == static_cast<size_t>(std::lower_bound(expected.begin(), expected.end(), value) - expected.begin()));
+						if (position < length)
+							JASS_assert(found == expected[position]);
+						}
+				}
+
+		/*
+			Encode values directly, check what happens on overflow and on empty sequences.
+		*/
+		uint64_t values[] = {3, 3, 7, 1000, 1ULL << 40};
+		size_t size = encode_values(encoded.data(), encoded.size(), values, 5);
+		random_access reader(encoded.data(), size, 5);
+		for (size_t which = 0; which < 5; which++)
+			JASS_assert(reader.access(which) == values[which]);
+
+		JASS_assert(encode_values(encoded.data(), 1, values, 5) == 0);
+		JASS_assert(codex.encode(encoded.data(), encoded.size(), sequence.data(), 0) == 0);
+
+		puts("compress_integer_elias_fano::PASSED");
+		}
+	}
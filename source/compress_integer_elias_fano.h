@@ -0,0 +1,346 @@
+/*
+	COMPRESS_INTEGER_ELIAS_FANO.H
+	-----------------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Elias-Fano encoding of integer sequences, with random access.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <string.h>
+#include <immintrin.h>
+
+#include <vector>
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+#include "compress_integer.h"
+
+namespace JASS
+	{
+	/*
+		CLASS COMPRESS_INTEGER_ELIAS_FANO
+		---------------------------------
+	*/
+	/*!
+		@brief Elias-Fano encoding of integer sequences.
+		@details Elias-Fano encodes a monotone sequence of n integers no larger than u in at most 2 + ceil(log2(u/n)) bits per
+		integer.  The low l = floor(log2(u/n)) bits of each integer are stored verbatim (packed), the remaining high bits are
+		stored in unary as a bitvector in which the i-th integer sets bit (high + i).  Because of this the i-th integer
+		can be found without decoding those before it, and so can the first integer no smaller than a given value.
+
+		Like all the other codexes this one encodes d-gaps (it computes the cumulative sum before encoding and the differences
+		after decoding), so it can be used wherever they can.  decode_d1() is faster than decode() as the original sequence
+		is what is stored.  The random_access class gives access to the original (not d-gap) sequence.
+
+		The encoding is: 1 byte holding l, the low bits packed into 64-bit words, then the high bits packed into 64-bit words.
+		See:
+			S. Vigna (2013), Quasi-succinct indices, Proceedings of WSDM 2013, pp 83-92
+	*/
+	class compress_integer_elias_fano : public compress_integer
+		{
+		public:
+			/*
+				CLASS COMPRESS_INTEGER_ELIAS_FANO::RANDOM_ACCESS
+				------------------------------------------------
+			*/
+			/*!
+				@brief Random access into an Elias-Fano encoded sequence (without decoding it).
+				@details Positions and values are of the original (cumulative sum, not d-gap) sequence.  access() is select 1 on the
+				high bits and next_geq() is select 0.  The constructor samples the word holding every select_sample-th one and every
+				select_sample-th zero, so each call starts its popcount scan at most select_sample ones (or zeros) from the answer.
+				Short sequences (no more than select_sample integers) aren't sampled, so constructing a reader for them doesn't allocate.
+			*/
+			class random_access
+				{
+				public:
+					static constexpr size_t select_sample = 256;			///< Sample the position of every select_sample-th one (and zero) in the high bits.
+
+				private:
+					/*
+						CLASS COMPRESS_INTEGER_ELIAS_FANO::RANDOM_ACCESS::SAMPLE
+						--------------------------------------------------------
+					*/
+					/*!
+						@brief A select pointer into the high bits.
+					*/
+					class sample
+						{
+						public:
+							size_t word;				///< The word holding the sampled bit.
+							size_t before;				///< The number of bits of the same kind (ones or zeros) in the words before word.
+						};
+
+				private:
+					size_t integers;					///< The number of integers in the sequence.
+					uint32_t low_bits;				///< The width (in bits) of the low part of each integer.
+					const uint8_t *low;				///< The packed low bits.
+					const uint64_t *high;			///< The high bits (unary) as a bitvector (which may not be aligned).
+					size_t high_words;				///< The length of high (in 64-bit words).
+					std::vector<sample> ones;		///< The word holding the (k * select_sample)-th one, for each k.
+					std::vector<sample> zeros;		///< The word holding the (k * select_sample)-th zero, for each k.
+
+				private:
+					/*
+						COMPRESS_INTEGER_ELIAS_FANO::RANDOM_ACCESS::HIGH_WORD()
+						-------------------------------------------------------
+					*/
+					/*!
+						@brief Return the given 64-bit word from the high bits.
+						@param which [in] The word.
+						@return The word.
+					*/
+					uint64_t high_word(size_t which) const
+						{
+						uint64_t word;
+						memcpy(&word, high + which, sizeof(word));
+						return word;
+						}
+
+				public:
+					/*
+						COMPRESS_INTEGER_ELIAS_FANO::RANDOM_ACCESS::RANDOM_ACCESS()
+						-----------------------------------------------------------
+					*/
+					/*!
+						@brief Constructor.
+						@param encoded [in] The Elias-Fano encoded sequence (as produced by encode()).
+						@param encoded_length [in] The length (in bytes) of encoded.
+						@param integers [in] The number of integers in the sequence.
+					*/
+					random_access(const void *encoded, size_t encoded_length, size_t integers);
+
+					/*
+						COMPRESS_INTEGER_ELIAS_FANO::RANDOM_ACCESS::SIZE()
+						--------------------------------------------------
+					*/
+					/*!
+						@brief Return the number of integers in the sequence.
+						@return The number of integers.
+					*/
+					size_t size(void) const
+						{
+						return integers;
+						}
+
+					/*
+						COMPRESS_INTEGER_ELIAS_FANO::RANDOM_ACCESS::ACCESS()
+						----------------------------------------------------
+					*/
+					/*!
+						@brief Return the integer at the given position in the sequence.
+						@param position [in] The position (which must be less than size()).
+						@return The integer.
+					*/
+					uint64_t access(size_t position) const;
+
+					/*
+						COMPRESS_INTEGER_ELIAS_FANO::RANDOM_ACCESS::NEXT_GEQ()
+						------------------------------------------------------
+					*/
+					/*!
+						@brief Find the first integer in the sequence that is greater than or equal to value.
+						@param value [in] The value to look for.
+						@param found [out] The integer that was found (unchanged if there isn't one).
+						@return The position of that integer, or size() if all the integers are smaller than value.
+					*/
+					size_t next_geq(uint64_t value, uint64_t &found) const;
+				};
+
+		private:
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO::ENCODE_SEQUENCE()
+				----------------------------------------------
+			*/
+			/*!
+				@brief Elias-Fano encode a monotone sequence of integers.
+				@param encoded [out] The sequence of bytes that is the encoded sequence.
+				@param encoded_buffer_length [in] The length (in bytes) of the output buffer, encoded.
+				@param integers [in] The number of integers in the sequence.
+				@param largest [in] The largest (last) integer in the sequence.
+				@param next_value [in] A function that returns the integers of the sequence in order, one per call.
+				@return The number of bytes used to encode the integer sequence, or 0 on error (i.e. overflow).
+			*/
+			template <typename NEXT_VALUE>
+			static size_t encode_sequence(void *encoded, size_t encoded_buffer_length, size_t integers, uint64_t largest, NEXT_VALUE next_value);
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO::DECODE_SEQUENCE()
+				----------------------------------------------
+			*/
+			/*!
+				@brief Decode an Elias-Fano encoded sequence passing each integer (in order) to a function.
+				@param integers [in] The number of integers in the sequence.
+				@param source [in] The encoded integers.
+				@param emit [in] The function to call with each integer.
+			*/
+			template <typename EMIT>
+			static void decode_sequence(size_t integers, const void *source, EMIT emit);
+
+		public:
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO::TRAILING_ZEROS()
+				---------------------------------------------
+			*/
+			/*!
+				@brief Return the number of trailing zeros in a (non-zero) word - which is the position of the lowest set bit.
+				@param word [in] The word (which must not be 0).
+				@return The number of trailing zeros.
+			*/
+			static inline uint32_t trailing_zeros(uint64_t word)
+				{
+				#ifdef _MSC_VER
+					unsigned long position;
+					_BitScanForward64(&position, word);
+					return static_cast<uint32_t>(position);
+				#else
+					return static_cast<uint32_t>(__builtin_ctzll(word));
+				#endif
+				}
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO::LOW_BITS_WIDTH()
+				---------------------------------------------
+			*/
+			/*!
+				@brief Return the number of low bits Elias-Fano uses to encode integers integers no larger than largest.
+				@param integers [in] The number of integers in the sequence.
+				@param largest [in] The largest (last) integer in the sequence.
+				@return The width (in bits) of the low part of each integer.
+			*/
+			static uint32_t low_bits_width(size_t integers, uint64_t largest);
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO::ENCODED_SIZE()
+				-------------------------------------------
+			*/
+			/*!
+				@brief Return the number of bytes Elias-Fano uses to encode integers integers no larger than largest.
+				@param integers [in] The number of integers in the sequence.
+				@param largest [in] The largest (last) integer in the sequence.
+				@return The size (in bytes) of the encoding.
+			*/
+			static size_t encoded_size(size_t integers, uint64_t largest);
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO::ENCODE_VALUES()
+				--------------------------------------------
+			*/
+			/*!
+				@brief Elias-Fano encode a monotone (non-decreasing) sequence of integers (not d-gaps).
+				@param encoded [out] The sequence of bytes that is the encoded sequence.
+				@param encoded_buffer_length [in] The length (in bytes) of the output buffer, encoded.
+				@param source [in] The sequence of integers to encode.
+				@param source_integers [in] The length (in integers) of the source buffer.
+				@return The number of bytes used to encode the integer sequence, or 0 on error (i.e. overflow).
+			*/
+			static size_t encode_values(void *encoded, size_t encoded_buffer_length, const uint64_t *source, size_t source_integers);
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO::DECODE_GAPS()
+				------------------------------------------
+			*/
+			/*!
+				@brief Decode an Elias-Fano encoded sequence into d-gaps (the differences between consecutive integers).
+				@param decoded [out] The sequence of decoded d-gaps.
+				@param integers [in] The number of integers to decode.
+				@param source [in] The encoded integers.
+			*/
+			static void decode_gaps(integer *decoded, size_t integers, const void *source);
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO::DECODE_VALUES()
+				--------------------------------------------
+			*/
+			/*!
+				@brief Decode an Elias-Fano encoded sequence into the original (monotone) sequence.
+				@param decoded [out] The sequence of decoded integers.
+				@param integers [in] The number of integers to decode.
+				@param source [in] The encoded integers.
+				@param base [in] This is added to each integer (default = 0).
+			*/
+			static void decode_values(integer *decoded, size_t integers, const void *source, integer base = 0);
+
+		public:
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO::COMPRESS_INTEGER_ELIAS_FANO()
+				----------------------------------------------------------
+			*/
+			/*!
+				@brief Constructor.
+			*/
+			compress_integer_elias_fano()
+				{
+				/* Nothing */
+				}
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO::~COMPRESS_INTEGER_ELIAS_FANO()
+				-----------------------------------------------------------
+			*/
+			/*!
+				@brief Destructor.
+			*/
+			virtual ~compress_integer_elias_fano()
+				{
+				/* Nothing */
+				}
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO::ENCODE()
+				-------------------------------------
+			*/
+			/*!
+				@brief Encode a sequence of integers (d-gaps) returning the number of bytes used for the encoding, or 0 if the encoded sequence doesn't fit in the buffer.
+				@param encoded [out] The sequence of bytes that is the encoded sequence.
+				@param encoded_buffer_length [in] The length (in bytes) of the output buffer, encoded.
+				@param source [in] The sequence of integers to encode.
+				@param source_integers [in] The length (in integers) of the source buffer.
+				@return The number of bytes used to encode the integer sequence, or 0 on error (i.e. overflow).
+			*/
+			virtual size_t encode(void *encoded, size_t encoded_buffer_length, const integer *source, size_t source_integers);
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO::DECODE()
+				-------------------------------------
+			*/
+			/*!
+				@brief Decode a sequence of integers (d-gaps) encoded with this codex.
+				@param decoded [out] The sequence of decoded integers.
+				@param integers_to_decode [in] The minimum number of integers to decode (it may decode more).
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			virtual void decode(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length);
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO::DECODE_D1()
+				----------------------------------------
+			*/
+			/*!
+				@brief Decode a sequence of D1 encoded integers (d-gaps) and reconstruct the original sequence (the cumulative sum).
+				@details Elias-Fano stores the original sequence, so this is cheaper than decode().
+				@param decoded [out] The sequence of decoded integers.
+				@param integers_to_decode [in] The number of integers to decode.
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			virtual void decode_d1(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length);
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO::UNITTEST()
+				---------------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
@@ -0,0 +1,345 @@
+/*
+	COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED.CPP
+	-------------------------------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <string.h>
+#include <stdio.h>
+
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include "asserts.h"
+#include "compress_integer_elias_fano_partitioned.h"
+
+namespace JASS
+	{
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::PARTITION_SIZE
+		-------------------------------------------------------
+		C++14 needs a namespace-scope definition of a static constexpr member that is odr-used (std::min() takes it by reference).
+	*/
+	constexpr size_t compress_integer_elias_fano_partitioned::partition_size;
+
+	/*
+		Reading a partition builds a compress_integer_elias_fano::random_access, which must not allocate select pointers.
+	*/
+	static_assert(compress_integer_elias_fano_partitioned::partition_size <= compress_integer_elias_fano::random_access::select_sample, "Partitions must be short enough to read without select pointers");
+
+	/*
+		READ_32()
+		---------
+	*/
+	/*!
+		@brief Read 32 bits from a (possibly unaligned) address.
+		@param from [in] The address.
+		@return The 32-bit word.
+	*/
+	static inline uint32_t read_32(const void *from)
+		{
+		uint32_t word;
+		memcpy(&word, from, sizeof(word));
+		return word;
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::ENCODE()
+		-------------------------------------------------
+	*/
+	size_t compress_integer_elias_fano_partitioned::encode(void *encoded, size_t encoded_buffer_length, const integer *source, size_t source_integers)
+		{
+		/*
+			Short sequences are a single partition, which is plain Elias-Fano.
+		*/
+		if (source_integers <= partition_size)
+			return elias_fano.encode(encoded, encoded_buffer_length, source, source_integers);
+
+		/*
+			Encode the last integer in each partition.
+		*/
+		size_t partitions = (source_integers + partition_size - 1) / partition_size;
+		std::vector<uint64_t> endpoints(partitions);
+		uint64_t sum = 0;
+		for (size_t which = 0; which < source_integers; which++)
+			{
+			sum += source[which];
+			endpoints[which / partition_size] = sum;
+			}
+
+		uint8_t *destination = static_cast<uint8_t *>(encoded);
+		if (encoded_buffer_length < sizeof(uint32_t))
+			return 0;
+		size_t endpoints_size = compress_integer_elias_fano::encode_values(destination + sizeof(uint32_t), encoded_buffer_length - sizeof(uint32_t), endpoints.data(), partitions);
+		if (endpoints_size == 0)
+			return 0;
+		uint32_t endpoints_size_32 = static_cast<uint32_t>(endpoints_size);
+		memcpy(destination, &endpoints_size_32, sizeof(endpoints_size_32));
+
+		uint8_t *offsets = destination + sizeof(uint32_t) + endpoints_size;
+		uint8_t *data = offsets + partitions * sizeof(uint32_t);
+		if (data > destination + encoded_buffer_length)
+			return 0;
+		size_t data_length = destination + encoded_buffer_length - data;
+
+		/*
+			Encode each partition (relative to the end of the previous one), a run of consecutive integers takes no space.
+		*/
+		uint32_t offset = 0;
+		for (size_t which = 0; which < partitions; which++)
+			{
+			const integer *partition = source + which * partition_size;
+			size_t integers = (std::min)(partition_size, source_integers - which * partition_size);
+
+			if (std::any_of(partition, partition + integers, [](integer gap) { return gap != 1; }))
+				{
+				size_t size = elias_fano.encode(data + offset, data_length - offset, partition, integers);
+				if (size == 0)
+					return 0;
+				offset += static_cast<uint32_t>(size);
+				}
+
+			memcpy(offsets + which * sizeof(uint32_t), &offset, sizeof(offset));
+			}
+
+		return data + offset - destination;
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::DECODE()
+		-------------------------------------------------
+	*/
+	void compress_integer_elias_fano_partitioned::decode(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length)
+		{
+		if (integers_to_decode <= partition_size)
+			{
+			elias_fano.decode(decoded, integers_to_decode, source, source_length);
+			return;
+			}
+
+		size_t partitions = (integers_to_decode + partition_size - 1) / partition_size;
+		const uint8_t *offsets = static_cast<const uint8_t *>(source) + sizeof(uint32_t) + read_32(source);
+		const uint8_t *data = offsets + partitions * sizeof(uint32_t);
+
+		uint32_t start = 0;
+		for (size_t which = 0; which < partitions; which++)
+			{
+			size_t integers = (std::min)(partition_size, integers_to_decode - which * partition_size);
+			uint32_t end = read_32(offsets + which * sizeof(uint32_t));
+
+			if (end == start)
+				std::fill(decoded, decoded + integers, 1);
+			else
+				compress_integer_elias_fano::decode_gaps(decoded, integers, data + start);
+
+			decoded += integers;
+			start = end;
+			}
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::DECODE_D1()
+		----------------------------------------------------
+	*/
+	void compress_integer_elias_fano_partitioned::decode_d1(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length)
+		{
+		if (integers_to_decode <= partition_size)
+			{
+			elias_fano.decode_d1(decoded, integers_to_decode, source, source_length);
+			return;
+			}
+
+		size_t partitions = (integers_to_decode + partition_size - 1) / partition_size;
+		const uint8_t *offsets = static_cast<const uint8_t *>(source) + sizeof(uint32_t) + read_32(source);
+		const uint8_t *data = offsets + partitions * sizeof(uint32_t);
+
+		uint32_t start = 0;
+		integer base = 0;
+		for (size_t which = 0; which < partitions; which++)
+			{
+			size_t integers = (std::min)(partition_size, integers_to_decode - which * partition_size);
+			uint32_t end = read_32(offsets + which * sizeof(uint32_t));
+
+			if (end == start)
+				for (size_t current = 0; current < integers; current++)
+					decoded[current] = base + static_cast<integer>(current) + 1;
+			else
+				compress_integer_elias_fano::decode_values(decoded, integers, data + start, base);
+
+			decoded += integers;
+			base = decoded[-1];
+			start = end;
+			}
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::RANDOM_ACCESS::RANDOM_ACCESS()
+		-----------------------------------------------------------------------
+	*/
+	compress_integer_elias_fano_partitioned::random_access::random_access(const void *encoded, size_t encoded_length, size_t integers) :
+		integers(integers),
+		partitions((integers + partition_size - 1) / partition_size),
+		endpoints(integers > partition_size ? static_cast<const uint8_t *>(encoded) + sizeof(uint32_t) : nullptr, integers > partition_size ? read_32(encoded) : 0, partitions),
+		offsets(nullptr),
+		data(static_cast<const uint8_t *>(encoded)),
+		end(static_cast<const uint8_t *>(encoded) + encoded_length)
+		{
+		if (integers > partition_size)
+			{
+			offsets = static_cast<const uint8_t *>(encoded) + sizeof(uint32_t) + read_32(encoded);
+			data = offsets + partitions * sizeof(uint32_t);
+			}
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::RANDOM_ACCESS::PARTITION()
+		-------------------------------------------------------------------
+	*/
+	size_t compress_integer_elias_fano_partitioned::random_access::partition(size_t which, uint64_t &base, const uint8_t *&start, size_t &length) const
+		{
+		if (offsets == nullptr)
+			{
+			base = 0;
+			start = data;
+			length = end - data;
+			return integers;
+			}
+
+		uint32_t from = which == 0 ? 0 : read_32(offsets + (which - 1) * sizeof(uint32_t));
+		base = which == 0 ? 0 : endpoints.access(which - 1);
+		start = data + from;
+		length = read_32(offsets + which * sizeof(uint32_t)) - from;
+
+		return (std::min)(partition_size, integers - which * partition_size);
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::RANDOM_ACCESS::ACCESS()
+		----------------------------------------------------------------
+	*/
+	uint64_t compress_integer_elias_fano_partitioned::random_access::access(size_t position) const
+		{
+		uint64_t base;
+		const uint8_t *start;
+		size_t length;
+		size_t integers_in_partition = partition(position / partition_size, base, start, length);
+
+		if (length == 0)
+			return base + position % partition_size + 1;
+
+		return base + compress_integer_elias_fano::random_access(start, length, integers_in_partition).access(position % partition_size);
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::RANDOM_ACCESS::NEXT_GEQ()
+		------------------------------------------------------------------
+	*/
+	size_t compress_integer_elias_fano_partitioned::random_access::next_geq(uint64_t value, uint64_t &found) const
+		{
+		/*
+			Find the first partition that ends at or after value, the answer is in there.
+		*/
+		size_t which = 0;
+		if (offsets != nullptr)
+			{
+			uint64_t last;
+			which = endpoints.next_geq(value, last);
+			if (which == partitions)
+				return integers;
+			}
+
+		uint64_t base;
+		const uint8_t *start;
+		size_t length;
+		size_t integers_in_partition = partition(which, base, start, length);
+
+		if (length == 0)
+			{
+			/*
+				A run of base + 1, base + 2, ...
+			*/
+			uint64_t position = value <= base + 1 ? 0 : value - base - 1;
+			found = base + position + 1;
+			return which * partition_size + position;
+			}
+
+		uint64_t found_in_partition;
+		size_t position = compress_integer_elias_fano::random_access(start, length, integers_in_partition).next_geq(value > base ? value - base : 0, found_in_partition);
+		if (position == integers_in_partition)
+			return integers;
+
+		found = base + found_in_partition;
+		return which * partition_size + position;
+		}
+
+	/*
+		COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::UNITTEST()
+		---------------------------------------------------
+	*/
+	void compress_integer_elias_fano_partitioned::unittest(void)
+		{
+		compress_integer_elias_fano_partitioned codex;
+		std::mt19937 random(1);
+		std::vector<integer> sequence;
+		std::vector<integer> decoded;
+		std::vector<uint8_t> encoded;
+
+		/*
+			Single partitions, partial last partitions, and a mix of sparse partitions and runs.
+		*/
+		for (uint32_t largest_gap : {1, 3, 100000})
+			for (size_t length : {1, 127, 128, 129, 1000, 5000})
+				{
+				sequence.resize(length);
+				for (size_t which = 0; which < length; which++)
+					sequence[which] = (which / partition_size) % 3 == 1 ? 1 : random() % (largest_gap + 1);
+
+				encoded.assign(compress_integer_elias_fano::encoded_size(length, 100000 * static_cast<uint64_t>(length)) + length, 0);
+				size_t size = codex.encode(encoded.data(), encoded.size(), sequence.data(), sequence.size());
+				JASS_assert(size != 0);
+
+				decoded.assign(length, 0);
+				codex.decode(decoded.data(), length, encoded.data(), size);
+				JASS_assert(decoded == sequence);
+
+				std::vector<uint64_t> expected;
+				uint64_t sum = 0;
+				for (auto gap : sequence)
+					expected.push_back(sum += gap);
+
+				codex.decode_d1(decoded.data(), length, encoded.data(), size);
+				for (size_t which = 0; which < length; which++)
+					JASS_assert(decoded[which] == expected[which]);
+
+				random_access reader(encoded.data(), size, length);
+				JASS_assert(reader.size() == length);
+				for (size_t which = 0; which < length; which++)
+					JASS_assert(reader.access(which) == expected[which]);
+
+				for (uint64_t value = 0; value <= sum + 1; value += 1 + value / 8)
+					{
+					uint64_t found = 0;
+					size_t position = reader.next_geq(value, found);
+					size_t expected_position = std::lower_bound(expected.begin(), expected.end(), value) - expected.begin();
+					JASS_assert(position == expected_position);
+					if (position < length)
+						JASS_assert(found == expected[position]);
+					}
+				}
+
+		/*
+			A dense list (all runs) is just the endpoints and offsets.
+		*/
+		sequence.assign(1024, 1);
+		size_t size = codex.encode(encoded.data(), encoded.size(), sequence.data(), sequence.size());
+		JASS_assert(size < 64);
+
+		/*
+			Overflow.
+		*/
+		JASS_assert(codex.encode(encoded.data(), 10, sequence.data(), sequence.size()) == 0);
+
+		puts("compress_integer_elias_fano_partitioned::PASSED");
+		}
+	}
@@ -0,0 +1,206 @@
+/*
+	COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED.H
+	-----------------------------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Partitioned Elias-Fano encoding of integer sequences, with random access.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include "compress_integer_elias_fano.h"
+
+namespace JASS
+	{
+	/*
+		CLASS COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED
+		---------------------------------------------
+	*/
+	/*!
+		@brief Partitioned Elias-Fano encoding of integer sequences.
+		@details Elias-Fano chooses the number of low bits from the average gap over the whole sequence, so it cannot take
+		advantage of clustering.  Partitioned Elias-Fano splits the sequence into partitions of partition_size integers,
+		each Elias-Fano encoded relative to the last integer of the previous partition.  A partition that is a run of
+		consecutive integers (d-gaps of 1, common in dense impact segments) takes no space at all.  The last integer of each
+		partition is itself Elias-Fano encoded so that random_access can jump straight to the right partition.
+
+		Sequences of no more than partition_size integers are stored as plain Elias-Fano (there's only one partition).  Otherwise
+		the encoding is: the size of the endpoints (uint32_t), the Elias-Fano encoded endpoints, the end offset of each partition
+		(uint32_t), then the partitions.
+
+		This uses fixed-size partitions rather than the optimal (dynamic programming) partitioning in the paper.  See:
+			G. Ottaviano, R. Venturini (2014), Partitioned Elias-Fano Indexes, Proceedings of SIGIR 2014, pp 273-282
+	*/
+	class compress_integer_elias_fano_partitioned : public compress_integer
+		{
+		public:
+			static constexpr size_t partition_size = 128;			///< The number of integers in each partition (except the last).
+
+		public:
+			/*
+				CLASS COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::RANDOM_ACCESS
+				------------------------------------------------------------
+			*/
+			/*!
+				@brief Random access into a partitioned Elias-Fano encoded sequence (without decoding it).
+				@details Positions and values are of the original (cumulative sum, not d-gap) sequence.  The endpoints reader has
+				select pointers so finding the partition doesn't scan from the start, and a partition is short enough that reading
+				it needs neither select pointers nor an allocation.
+			*/
+			class random_access
+				{
+				private:
+					size_t integers;													///< The number of integers in the sequence.
+					size_t partitions;												///< The number of partitions.
+					compress_integer_elias_fano::random_access endpoints;		///< The last integer in each partition.
+					const uint8_t *offsets;											///< The (unaligned uint32_t) end offset of each partition.
+					const uint8_t *data;												///< The partitions.
+					const uint8_t *end;												///< The end of the encoded sequence.
+
+				private:
+					/*
+						COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::RANDOM_ACCESS::PARTITION()
+						-------------------------------------------------------------------
+					*/
+					/*!
+						@brief Get the details of a partition.
+						@param which [in] The partition.
+						@param base [out] The integer before the first integer in the partition (0 for the first partition).
+						@param start [out] The start of the partition's encoding.
+						@param length [out] The length (in bytes) of the partition's encoding, 0 for a run.
+						@return The number of integers in the partition.
+					*/
+					size_t partition(size_t which, uint64_t &base, const uint8_t *&start, size_t &length) const;
+
+				public:
+					/*
+						COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::RANDOM_ACCESS::RANDOM_ACCESS()
+						-----------------------------------------------------------------------
+					*/
+					/*!
+						@brief Constructor.
+						@param encoded [in] The partitioned Elias-Fano encoded sequence (as produced by encode()).
+						@param encoded_length [in] The length (in bytes) of encoded.
+						@param integers [in] The number of integers in the sequence.
+					*/
+					random_access(const void *encoded, size_t encoded_length, size_t integers);
+
+					/*
+						COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::RANDOM_ACCESS::SIZE()
+						--------------------------------------------------------------
+					*/
+					/*!
+						@brief Return the number of integers in the sequence.
+						@return The number of integers.
+					*/
+					size_t size(void) const
+						{
+						return integers;
+						}
+
+					/*
+						COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::RANDOM_ACCESS::ACCESS()
+						----------------------------------------------------------------
+					*/
+					/*!
+						@brief Return the integer at the given position in the sequence.
+						@param position [in] The position (which must be less than size()).
+						@return The integer.
+					*/
+					uint64_t access(size_t position) const;
+
+					/*
+						COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::RANDOM_ACCESS::NEXT_GEQ()
+						------------------------------------------------------------------
+					*/
+					/*!
+						@brief Find the first integer in the sequence that is greater than or equal to value.
+						@param value [in] The value to look for.
+						@param found [out] The integer that was found (unchanged if there isn't one).
+						@return The position of that integer, or size() if all the integers are smaller than value.
+					*/
+					size_t next_geq(uint64_t value, uint64_t &found) const;
+				};
+
+		private:
+			compress_integer_elias_fano elias_fano;			///< Each partition is Elias-Fano encoded.
+
+		public:
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED()
+				----------------------------------------------------------------------------------
+			*/
+			/*!
+				@brief Constructor.
+			*/
+			compress_integer_elias_fano_partitioned()
+				{
+				/* Nothing */
+				}
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::~COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED()
+				-----------------------------------------------------------------------------------
+			*/
+			/*!
+				@brief Destructor.
+			*/
+			virtual ~compress_integer_elias_fano_partitioned()
+				{
+				/* Nothing */
+				}
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::ENCODE()
+				-------------------------------------------------
+			*/
+			/*!
+				@brief Encode a sequence of integers (d-gaps) returning the number of bytes used for the encoding, or 0 if the encoded sequence doesn't fit in the buffer.
+				@param encoded [out] The sequence of bytes that is the encoded sequence.
+				@param encoded_buffer_length [in] The length (in bytes) of the output buffer, encoded.
+				@param source [in] The sequence of integers to encode.
+				@param source_integers [in] The length (in integers) of the source buffer.
+				@return The number of bytes used to encode the integer sequence, or 0 on error (i.e. overflow).
+			*/
+			virtual size_t encode(void *encoded, size_t encoded_buffer_length, const integer *source, size_t source_integers);
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::DECODE()
+				-------------------------------------------------
+			*/
+			/*!
+				@brief Decode a sequence of integers (d-gaps) encoded with this codex.
+				@param decoded [out] The sequence of decoded integers.
+				@param integers_to_decode [in] The minimum number of integers to decode (it may decode more).
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			virtual void decode(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length);
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::DECODE_D1()
+				----------------------------------------------------
+			*/
+			/*!
+				@brief Decode a sequence of D1 encoded integers (d-gaps) and reconstruct the original sequence (the cumulative sum).
+				@param decoded [out] The sequence of decoded integers.
+				@param integers_to_decode [in] The number of integers to decode.
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			virtual void decode_d1(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length);
+
+			/*
+				COMPRESS_INTEGER_ELIAS_FANO_PARTITIONED::UNITTEST()
+				---------------------------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
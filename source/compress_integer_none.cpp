@@ -9,6 +9,7 @@
 
 #include <array>
 #include <random>
+#include <algorithm>
 
 #include "asserts.h"
 #include "compress_integer_none.h"
@@ -39,6 +40,21 @@ namespace JASS
 		::memcpy(decoded, source, source_length);
 		}
 
+	/*
+		COMPRESS_INTEGER_NONE::DECODE_BLOCK()
+		-------------------------------------
+	*/
+	size_t compress_integer_none::decode_block(cursor &at, integer *decoded, size_t integers_to_decode) const
+		{
+		size_t integers = (std::min)(integers_to_decode, at.integers - at.decoded);
+
+		::memcpy(decoded, at.data, integers * sizeof(*decoded));
+		at.data += integers * sizeof(*decoded);
+		at.decoded += integers;
+
+		return integers;
+		}
+
 	/*
 		COMPRESS_INTEGER_NONE::UNITTEST()
 		---------------------------------
@@ -65,6 +81,12 @@ namespace JASS
 		codex.decode(&decoded_buffer[0], raw_buffer.size(), &encoded_buffer[0], bytes_used);
 		JASS_assert(memcmp(&decoded_buffer[0], &raw_buffer[0], raw_buffer.size() * sizeof(raw_buffer[0])) == 0);
 
+		/*
+			Check decoding a block at a time.
+		*/
+		JASS_assert(compress_integer::unittest_decode_blocks(codex, std::vector<integer>(raw_buffer.begin(), raw_buffer.end())));
+		JASS_assert(compress_integer::unittest_decode_blocks(codex, std::vector<integer>(1000, 7)));
+
 		/*
 			Check the overflow case
 		*/
@@ -0,0 +1,186 @@
+/*
+	COMPRESS_INTEGER_PER_SEGMENT.CPP
+	--------------------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <stdio.h>
+#include <string.h>
+
+#include <limits>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "compress_integer_all.h"
+#include "compress_integer_per_segment.h"
+
+namespace JASS
+	{
+	constexpr const char *compress_integer_per_segment::all_codexes;
+
+	/*
+		The codexes that can be chosen (all of which can decode a block at a time).  The decode costs are rough estimates
+		of the relative speed of the codexes (not measurements), only their ratios matter.
+	*/
+	const compress_integer_per_segment::candidate compress_integer_per_segment::candidates[] =
+		{
+		{'s', "None", 0.25},
+		{'c', "Variable Byte", 1.4},
+		{'V', "Stream VByte", 0.9},
+		{'b', "SIMD-BP128", 0.5},
+		{'f', "PForDelta", 0.7},
+		{'F', "OptPFor", 0.7},
+		{0, nullptr, 0}
+		};
+
+	/*
+		COMPRESS_INTEGER_PER_SEGMENT::COMPRESS_INTEGER_PER_SEGMENT()
+		------------------------------------------------------------
+	*/
+	compress_integer_per_segment::compress_integer_per_segment(const std::string &codexes, criterion choose) :
+		choose(choose),
+		codex{}
+		{
+		for (size_t which = 0; candidates[which].tag != 0; which++)
+			{
+			codex[candidates[which].tag] = &compress_integer_all::get_by_name(candidates[which].name);
+			if (codexes.find(static_cast<char>(candidates[which].tag)) != std::string::npos)
+				allowed.push_back(which);
+			}
+		}
+
+	/*
+		COMPRESS_INTEGER_PER_SEGMENT::ESTIMATED_DECODE_COST()
+		-----------------------------------------------------
+	*/
+	double compress_integer_per_segment::estimated_decode_cost(uint8_t tag, size_t integers, size_t bytes)
+		{
+		for (size_t which = 0; candidates[which].tag != 0; which++)
+			if (candidates[which].tag == tag)
+				return candidates[which].nanoseconds_per_integer * integers + nanoseconds_per_byte * bytes;
+
+		return (std::numeric_limits<double>::max)();
+		}
+
+	/*
+		COMPRESS_INTEGER_PER_SEGMENT::ENCODE()
+		--------------------------------------
+	*/
+	size_t compress_integer_per_segment::encode(void *encoded, size_t encoded_buffer_length, const integer *source, size_t source_integers)
+		{
+		if (encoded_buffer_length < 1)
+			return 0;
+
+		/*
+			Each encoding is tried in whichever of encoded and spare doesn't hold the best so far, so the best never needs
+			to be encoded twice.  The serialiser shares this object between threads, so each thread has its own spare.
+		*/
+		static thread_local std::vector<uint8_t> spare;
+		if (spare.size() < encoded_buffer_length - 1)
+			spare.resize(encoded_buffer_length - 1);
+
+		uint8_t *destination = static_cast<uint8_t *>(encoded);
+		uint8_t *try_at = destination + 1;
+		uint8_t *best_at = nullptr;
+		uint8_t best = 0;
+		size_t best_size = 0;
+		double best_cost = (std::numeric_limits<double>::max)();
+
+		/*
+			Try each allowed codex.
+		*/
+		for (size_t which : allowed)
+			{
+			uint8_t tag = candidates[which].tag;
+			size_t size = codex[tag]->encode(try_at, encoded_buffer_length - 1, source, source_integers);
+			if (size == 0)
+				continue;
+
+			double cost = choose == SMALLEST ? size : estimated_decode_cost(tag, source_integers, size);
+			if (cost < best_cost)
+				{
+				best = tag;
+				best_at = try_at;
+				best_size = size;
+				best_cost = cost;
+				try_at = try_at == destination + 1 ? spare.data() : destination + 1;
+				}
+			}
+
+		if (best == 0)
+			return 0;
+
+		if (best_at != destination + 1)
+			memcpy(destination + 1, best_at, best_size);
+		*destination = best;
+
+		return best_size + 1;
+		}
+
+	/*
+		COMPRESS_INTEGER_PER_SEGMENT::UNITTEST()
+		----------------------------------------
+	*/
+	void compress_integer_per_segment::unittest(void)
+		{
+		compress_integer_per_segment smallest;
+		compress_integer_per_segment fastest(all_codexes, FASTEST);
+		compress_integer_per_segment variable_byte_only("c");
+		std::mt19937 random(1);
+		std::vector<integer> sequence;
+		std::vector<integer> decoded;
+		std::vector<uint8_t> encoded(1024 * 1024);
+
+		/*
+			Dense, sparse, and mixed sequences of different lengths.
+		*/
+		for (size_t length : {1, 3, 100, 128, 1000, 5000})
+			for (uint32_t largest_gap : {1U, 100U, 0xFFFFFFFFU})
+				{
+				sequence.resize(length);
+				for (auto &value : sequence)
+					value = largest_gap == 1 ? 1 : static_cast<integer>(random() % largest_gap);
+
+				for (compress_integer_per_segment *codex : {&smallest, &fastest, &variable_byte_only})
+					{
+					size_t size = codex->encode(encoded.data(), encoded.size(), sequence.data(), sequence.size());
+					JASS_assert(size != 0);
+
+					decoded.assign(length + 256, 0);
+					codex->decode(decoded.data(), length, encoded.data(), size);
+					JASS_assert(std::equal(sequence.begin(), sequence.end(), decoded.begin()));
+
+					codex->decode_d1(decoded.data(), length, encoded.data(), size);
+					integer sum = 0;
+					for (size_t which = 0; which < length; which++)
+						JASS_assert(decoded[which] == (sum += sequence[which]));
+
+					JASS_assert(compress_integer::unittest_decode_blocks(*codex, sequence));
+					}
+				}
+
+		/*
+			Make sure the right codex is chosen.  A long run of 1s is best bit packed, large random integers are best not compressed.
+		*/
+		sequence.assign(1024, 1);
+		smallest.encode(encoded.data(), encoded.size(), sequence.data(), sequence.size());
+		JASS_assert(encoded[0] == 'b');
+		variable_byte_only.encode(encoded.data(), encoded.size(), sequence.data(), sequence.size());
+		JASS_assert(encoded[0] == 'c');
+
+		for (auto &value : sequence)
+			value = static_cast<integer>(random()) | 0x80000000;
+		smallest.encode(encoded.data(), encoded.size(), sequence.data(), sequence.size());
+		JASS_assert(encoded[0] == 's');
+
+		JASS_assert(estimated_decode_cost('s', 100, 400) < estimated_decode_cost('c', 100, 100));
+
+		/*
+			Overflow.
+		*/
+		JASS_assert(smallest.encode(encoded.data(), 10, sequence.data(), sequence.size()) == 0);
+
+		puts("compress_integer_per_segment::PASSED");
+		}
+	}
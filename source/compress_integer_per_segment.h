@@ -0,0 +1,237 @@
+/*
+	COMPRESS_INTEGER_PER_SEGMENT.H
+	------------------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Choose, for each sequence (impact segment), the best of several codexes.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <string>
+
+#include "asserts.h"
+#include "compress_integer.h"
+
+namespace JASS
+	{
+	/*
+		CLASS COMPRESS_INTEGER_PER_SEGMENT
+		----------------------------------
+	*/
+	/*!
+		@brief Choose, for each sequence (impact segment), the best of several codexes.
+		@details Impact segments differ greatly: the segments of high impact scores are short and sparse, those of low
+		impact scores are long and dense.  No one codex is best for all of them, so this codex encodes each sequence with
+		each of the allowed codexes and keeps the best, either the smallest or the one estimated to be fastest to decode.
+		The encoding is a 1-byte tag saying which codex was chosen followed by that codex's encoding.  The tags are the
+		same characters JASS v1 uses for the codex of an index (see serialise_jass_v1).
+
+		All the candidate codexes can decode a block at a time, so this codex can too.  The codexes are found (in
+		compress_integer_all) when this object is constructed, so the instruction set (see cpu) they use is fixed then.
+	*/
+	class compress_integer_per_segment : public compress_integer
+		{
+		public:
+			/*!
+				@enum criterion
+				@brief How to choose between the codexes.
+			*/
+			enum criterion
+				{
+				SMALLEST,			///< Choose the codex that produces the smallest encoding.
+				FASTEST				///< Choose the codex that is estimated to be the fastest to decode (see estimated_decode_cost()).
+				};
+
+		private:
+			/*
+				CLASS COMPRESS_INTEGER_PER_SEGMENT::CANDIDATE
+				---------------------------------------------
+			*/
+			/*!
+				@brief A codex that can be chosen, its tag, and the (rough) cost of decoding with it.
+			*/
+			class candidate
+				{
+				public:
+					uint8_t tag;								///< The tag stored before the encoding.
+					const char *name;							///< The name of the codex in compress_integer_all.
+					double nanoseconds_per_integer;		///< Estimated decode (D1) time per integer.
+				};
+
+		public:
+			static constexpr double nanoseconds_per_byte = 0.1;		///< Estimated time to read a byte of the encoding from memory.
+			static constexpr const char *all_codexes = "scVbfF";		///< The tags of all the codexes that can be chosen.
+
+		private:
+			static const candidate candidates[];			///< The codexes that can be chosen (terminated with a tag of 0).
+
+		private:
+			std::vector<size_t> allowed;						///< Those (indexes into candidates) that encode() is allowed to choose from.
+			criterion choose;										///< How encode() chooses.
+			compress_integer *codex[256];						///< The codex for each tag (nullptr for unknown tags).
+
+		private:
+			/*
+				COMPRESS_INTEGER_PER_SEGMENT::CODEX_FOR()
+				-----------------------------------------
+			*/
+			/*!
+				@brief Return the codex used to encode a sequence encoded by this codex.
+				@param source [in] The encoded sequence (which starts with the tag).
+				@return The codex.
+			*/
+			compress_integer &codex_for(const void *source) const
+				{
+				compress_integer *which = codex[*static_cast<const uint8_t *>(source)];
+				JASS_assert(which != nullptr);
+				return *which;
+				}
+
+		public:
+			/*
+				COMPRESS_INTEGER_PER_SEGMENT::COMPRESS_INTEGER_PER_SEGMENT()
+				------------------------------------------------------------
+			*/
+			/*!
+				@brief Constructor.
+				@param codexes [in] The tags of the codexes encode() may choose between (default = all_codexes), unknown tags are ignored.
+				@param choose [in] How to choose between them (default = SMALLEST).
+			*/
+			explicit compress_integer_per_segment(const std::string &codexes = all_codexes, criterion choose = SMALLEST);
+
+			/*
+				COMPRESS_INTEGER_PER_SEGMENT::~COMPRESS_INTEGER_PER_SEGMENT()
+				-------------------------------------------------------------
+			*/
+			/*!
+				@brief Destructor.
+			*/
+			virtual ~compress_integer_per_segment()
+				{
+				/* Nothing */
+				}
+
+			/*
+				COMPRESS_INTEGER_PER_SEGMENT::ESTIMATED_DECODE_COST()
+				-----------------------------------------------------
+			*/
+			/*!
+				@brief Estimate the time it takes to decode a sequence.
+				@details The estimate is linear in the number of integers (the codex's per-integer cost, a rough estimate rather
+				than a measurement) and in the size of the encoding (the cost of getting it from memory).  It is only used to rank
+				codexes against each other.
+				@param tag [in] The codex's tag.
+				@param integers [in] The number of integers in the sequence.
+				@param bytes [in] The size of the encoding, in bytes.
+				@return The estimated time, in nanoseconds.
+			*/
+			static double estimated_decode_cost(uint8_t tag, size_t integers, size_t bytes);
+
+			/*
+				COMPRESS_INTEGER_PER_SEGMENT::ENCODE()
+				--------------------------------------
+			*/
+			/*!
+				@brief Encode a sequence of integers returning the number of bytes used for the encoding, or 0 if the encoded sequence doesn't fit in the buffer.
+				@param encoded [out] The sequence of bytes that is the encoded sequence.
+				@param encoded_buffer_length [in] The length (in bytes) of the output buffer, encoded.
+				@param source [in] The sequence of integers to encode.
+				@param source_integers [in] The length (in integers) of the source buffer.
+				@return The number of bytes used to encode the integer sequence, or 0 on error (i.e. overflow).
+			*/
+			virtual size_t encode(void *encoded, size_t encoded_buffer_length, const integer *source, size_t source_integers);
+
+			/*
+				COMPRESS_INTEGER_PER_SEGMENT::DECODE()
+				--------------------------------------
+			*/
+			/*!
+				@brief Decode a sequence of integers encoded with this codex.
+				@param decoded [out] The sequence of decoded integers.
+				@param integers_to_decode [in] The minimum number of integers to decode (it may decode more).
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			virtual void decode(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length)
+				{
+				codex_for(source).decode(decoded, integers_to_decode, static_cast<const uint8_t *>(source) + 1, source_length - 1);
+				}
+
+			/*
+				COMPRESS_INTEGER_PER_SEGMENT::DECODE_D1()
+				-----------------------------------------
+			*/
+			/*!
+				@brief Decode a sequence of D1 encoded integers (d-gaps) and reconstruct the original sequence (the cumulative sum).
+				@param decoded [out] The sequence of decoded integers.
+				@param integers_to_decode [in] The number of integers to decode.
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			virtual void decode_d1(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length)
+				{
+				codex_for(source).decode_d1(decoded, integers_to_decode, static_cast<const uint8_t *>(source) + 1, source_length - 1);
+				}
+
+			/*
+				COMPRESS_INTEGER_PER_SEGMENT::SUPPORTS_BLOCKS()
+				-----------------------------------------------
+			*/
+			/*!
+				@brief Does this codex support decoding a block of integers at a time (using decode_start() and decode_block())?
+				@return true.
+			*/
+			virtual bool supports_blocks(void) const
+				{
+				return true;
+				}
+
+			/*
+				COMPRESS_INTEGER_PER_SEGMENT::DECODE_START()
+				--------------------------------------------
+			*/
+			/*!
+				@brief Set up a cursor ready to decode the encoded sequence a block at a time.
+				@param at [out] The cursor.
+				@param integers [in] The number of integers in the encoded sequence.
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			virtual void decode_start(cursor &at, size_t integers, const void *source, size_t source_length) const
+				{
+				const compress_integer &chosen = codex_for(source);
+				chosen.decode_start(at, integers, static_cast<const uint8_t *>(source) + 1, source_length - 1);
+				at.codex = &chosen;
+				}
+
+			/*
+				COMPRESS_INTEGER_PER_SEGMENT::DECODE_BLOCK()
+				--------------------------------------------
+			*/
+			/*!
+				@brief Decode the next (up to) integers_to_decode integers from the sequence and advance the cursor.
+				@param at [in, out] The cursor (from decode_start()).
+				@param decoded [out] The decoded integers.
+				@param integers_to_decode [in] The maximum number of integers to decode (a multiple of 128).
+				@return The number of integers decoded, 0 at the end of the sequence.
+			*/
+			virtual size_t decode_block(cursor &at, integer *decoded, size_t integers_to_decode) const
+				{
+				return at.codex->decode_block(at, decoded, integers_to_decode);
+				}
+
+			/*
+				COMPRESS_INTEGER_PER_SEGMENT::UNITTEST()
+				----------------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
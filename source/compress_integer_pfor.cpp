@@ -0,0 +1,264 @@
+/*
+	COMPRESS_INTEGER_PFOR.CPP
+	-------------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <stdio.h>
+
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include "asserts.h"
+#include "compress_integer_pfor.h"
+
+namespace JASS
+	{
+	/*
+		COMPRESS_INTEGER_PFOR::INTEGERS_PER_BLOCK
+		-----------------------------------------
+		C++14 needs a namespace-scope definition of a static constexpr member that is odr-used (std::min() takes it by reference).
+	*/
+	constexpr size_t compress_integer_pfor::integers_per_block;
+
+	/*
+		COMPRESS_INTEGER_PFOR::ENCODED_BLOCK_SIZE()
+		-------------------------------------------
+	*/
+	size_t compress_integer_pfor::encoded_block_size(size_t integers, uint32_t bits, const size_t *widths)
+		{
+		size_t exceptions = 0;
+		uint32_t high_bits = 0;
+		for (uint32_t width = bits + 1; width <= 32; width++)
+			if (widths[width] != 0)
+				{
+				exceptions += widths[width];
+				high_bits = width - bits;
+				}
+
+		size_t size = 2 + compress_integer_bitpack_128::packed_size(integers, bits);
+		if (exceptions != 0)
+			size += 1 + exceptions + compress_integer_bitpack_128::packed_size(exceptions, high_bits);
+
+		return size;
+		}
+
+	/*
+		COMPRESS_INTEGER_PFOR::CHOOSE_WIDTH()
+		-------------------------------------
+	*/
+	uint32_t compress_integer_pfor::choose_width(const integer *source, size_t integers) const
+		{
+		size_t widths[33] = {};
+		for (size_t which = 0; which < integers; which++)
+			widths[compress_integer_bitpack_128::width(source[which])]++;
+
+		uint32_t largest = 32;
+		while (largest > 0 && widths[largest] == 0)
+			largest--;
+
+		if (optimal)
+			{
+			/*
+				OptPFor: the width that results in the smallest block.
+			*/
+			uint32_t best = largest;
+			size_t best_size = encoded_block_size(integers, largest, widths);
+			for (uint32_t bits = 0; bits < largest; bits++)
+				{
+				size_t size = encoded_block_size(integers, bits, widths);
+				if (size < best_size)
+					{
+					best = bits;
+					best_size = size;
+					}
+				}
+			return best;
+			}
+
+		/*
+			PForDelta: the smallest width that leaves no more than 10% of the integers as exceptions.
+		*/
+		size_t exceptions = 0;
+		uint32_t bits = largest;
+		while (bits > 0 && exceptions + widths[bits] <= integers / 10)
+			exceptions += widths[bits--];
+
+		return bits;
+		}
+
+	/*
+		COMPRESS_INTEGER_PFOR::ENCODE()
+		-------------------------------
+	*/
+	size_t compress_integer_pfor::encode(void *encoded, size_t encoded_buffer_length, const integer *source, size_t source_integers)
+		{
+		uint8_t *destination = static_cast<uint8_t *>(encoded);
+		const uint8_t *end = destination + encoded_buffer_length;
+		integer low[integers_per_block];
+		integer high[integers_per_block];
+		uint8_t position[integers_per_block];
+
+		for (size_t start = 0; start < source_integers; start += integers_per_block)
+			{
+			const integer *from = source + start;
+			size_t integers = (std::min)(integers_per_block, source_integers - start);
+			uint32_t bits = choose_width(from, integers);
+
+			/*
+				Split the integers that don't fit into their low and high bits.
+			*/
+			uint64_t mask = (static_cast<uint64_t>(1) << bits) - 1;
+			size_t exceptions = 0;
+			for (size_t which = 0; which < integers; which++)
+				{
+				low[which] = static_cast<integer>(from[which] & mask);
+				if (low[which] != from[which])
+					{
+					position[exceptions] = static_cast<uint8_t>(which);
+					high[exceptions] = static_cast<integer>(from[which] >> bits);
+					exceptions++;
+					}
+				}
+			uint32_t high_bits = compress_integer_bitpack_128::bits_needed(high, exceptions);
+
+			size_t size = 2 + compress_integer_bitpack_128::packed_size(integers, bits);
+			if (exceptions != 0)
+				size += 1 + exceptions + compress_integer_bitpack_128::packed_size(exceptions, high_bits);
+			if (destination + size > end)
+				return 0;
+
+			/*
+				Write the block.
+			*/
+			*destination++ = static_cast<uint8_t>(bits);
+			*destination++ = static_cast<uint8_t>(exceptions);
+			if (exceptions != 0)
+				{
+				*destination++ = static_cast<uint8_t>(high_bits);
+				std::copy(position, position + exceptions, destination);
+				destination += exceptions;
+				destination += compress_integer_bitpack_128::pack(destination, high, exceptions, high_bits);
+				}
+			destination += compress_integer_bitpack_128::pack(destination, low, integers, bits);
+			}
+
+		return destination - static_cast<uint8_t *>(encoded);
+		}
+
+	/*
+		COMPRESS_INTEGER_PFOR::DECODE_ONE_BLOCK()
+		-----------------------------------------
+	*/
+	const uint8_t *compress_integer_pfor::decode_one_block(integer *decoded, size_t integers, const uint8_t *source)
+		{
+		uint32_t bits = *source++;
+		size_t exceptions = *source++;
+
+		if (exceptions == 0)
+			return source + compress_integer_bitpack_128::unpack(decoded, source, integers, bits);
+
+		/*
+			Unpack the low bits then patch in the high bits of the exceptions.
+		*/
+		integer high[integers_per_block];
+		uint32_t high_bits = *source++;
+		const uint8_t *position = source;
+		source += exceptions;
+		source += compress_integer_bitpack_128::unpack(high, source, exceptions, high_bits);
+		source += compress_integer_bitpack_128::unpack(decoded, source, integers, bits);
+
+		for (size_t which = 0; which < exceptions; which++)
+			decoded[position[which]] |= high[which] << bits;
+
+		return source;
+		}
+
+	/*
+		COMPRESS_INTEGER_PFOR::DECODE()
+		-------------------------------
+	*/
+	void compress_integer_pfor::decode(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length)
+		{
+		const uint8_t *from = static_cast<const uint8_t *>(source);
+
+		for (size_t start = 0; start < integers_to_decode; start += integers_per_block)
+			from = decode_one_block(decoded + start, (std::min)(integers_per_block, integers_to_decode - start), from);
+		}
+
+	/*
+		COMPRESS_INTEGER_PFOR::DECODE_BLOCK()
+		-------------------------------------
+	*/
+	size_t compress_integer_pfor::decode_block(cursor &at, integer *decoded, size_t integers_to_decode) const
+		{
+		size_t got = 0;
+
+		while (at.decoded < at.integers)
+			{
+			size_t integers = (std::min)(integers_per_block, at.integers - at.decoded);
+			if (got + integers > integers_to_decode)
+				break;
+
+			at.data = decode_one_block(decoded + got, integers, at.data);
+			at.decoded += integers;
+			got += integers;
+			}
+
+		return got;
+		}
+
+	/*
+		COMPRESS_INTEGER_PFOR::UNITTEST()
+		---------------------------------
+	*/
+	void compress_integer_pfor::unittest(void)
+		{
+		compress_integer_pfor pfor_delta(false);
+		compress_integer_pfor opt_pfor(true);
+		std::mt19937 random(1);
+		std::vector<integer> sequence;
+		std::vector<integer> decoded;
+		std::vector<uint8_t> encoded;
+
+		/*
+			Small integers with the occasional large one (the exceptions), full and partial blocks.
+		*/
+		for (size_t length : {1, 10, 127, 128, 129, 256, 1000, 5000})
+			{
+			sequence.resize(length);
+			for (size_t which = 0; which < length; which++)
+				sequence[which] = random() % 20 == 0 ? static_cast<integer>(random()) : random() % 16;
+			sequence[0] = 0xFFFFFFFF;
+
+			for (compress_integer_pfor *codex : {&pfor_delta, &opt_pfor})
+				{
+				encoded.assign(length * sizeof(integer) * 2 + 16, 0);
+				size_t size = codex->encode(encoded.data(), encoded.size(), sequence.data(), sequence.size());
+				JASS_assert(size != 0);
+
+				decoded.assign(length, 0);
+				codex->decode(decoded.data(), length, encoded.data(), size);
+				JASS_assert(decoded == sequence);
+
+				JASS_assert(compress_integer::unittest_decode_blocks(*codex, sequence));
+				}
+			}
+
+		/*
+			The exceptions mean a block of small integers with one large one is much smaller than bit packing at the largest width.
+		*/
+		sequence.assign(128, 3);
+		sequence[64] = 1 << 30;
+		JASS_assert(opt_pfor.encode(encoded.data(), encoded.size(), sequence.data(), sequence.size()) < 128 / 4 + 16);
+		JASS_assert(pfor_delta.encode(encoded.data(), encoded.size(), sequence.data(), sequence.size()) < 128 / 4 + 16);
+
+		/*
+			Overflow.
+		*/
+		JASS_assert(opt_pfor.encode(encoded.data(), 10, sequence.data(), sequence.size()) == 0);
+
+		puts("compress_integer_pfor::PASSED");
+		}
+	}
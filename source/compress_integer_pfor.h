@@ -0,0 +1,174 @@
+/*
+	COMPRESS_INTEGER_PFOR.H
+	-----------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief PForDelta and OptPFor (patched frame of reference) encoding of integer sequences.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include "compress_integer_bitpack_128.h"
+
+namespace JASS
+	{
+	/*
+		CLASS COMPRESS_INTEGER_PFOR
+		---------------------------
+	*/
+	/*!
+		@brief PForDelta and OptPFor (patched frame of reference) encoding of integer sequences.
+		@details Like SIMD-BP128 the sequence is broken into blocks of 128 integers, each bit packed (using
+		compress_integer_bitpack_128::pack()) at a single width.  But rather than using the width of the largest integer,
+		a smaller width is chosen and those integers that do not fit (the exceptions) have their high bits stored separately
+		and patched in after unpacking.  PForDelta chooses the smallest width that leaves no more than 10% of the integers
+		as exceptions; OptPFor tries every width and chooses the one that results in the smallest block.
+
+		Each block is: the width (1 byte), the number of exceptions (1 byte), and if there are exceptions then the width of
+		their high bits (1 byte), the position of each (1 byte each), and their packed high bits.  This is followed by the
+		packed low bits of the block.
+		See:
+			M. Zukowski, S. Heman, N. Nes, P. Boncz (2006), Super-Scalar RAM-CPU Cache Compression, Proceedings of ICDE 2006, pp 59-70
+			H. Yan, S. Ding, T. Suel (2009), Inverted index compression and query processing with optimized document ordering, Proceedings of WWW 2009, pp 401-410
+	*/
+	class compress_integer_pfor : public compress_integer
+		{
+		public:
+			static constexpr size_t integers_per_block = compress_integer_bitpack_128::integers_per_block;		///< The number of integers in each block.
+
+		private:
+			bool optimal;							///< true for OptPFor, false for PForDelta.
+
+		private:
+			/*
+				COMPRESS_INTEGER_PFOR::ENCODED_BLOCK_SIZE()
+				-------------------------------------------
+			*/
+			/*!
+				@brief Return the number of bytes used to encode a block if its low bits are the given width.
+				@param integers [in] The number of integers in the block.
+				@param bits [in] The width of the low bits.
+				@param widths [in] widths[b] is the number of integers in the block that need exactly b bits (b = 0..32).
+				@return The size of the block, in bytes.
+			*/
+			static size_t encoded_block_size(size_t integers, uint32_t bits, const size_t *widths);
+
+			/*
+				COMPRESS_INTEGER_PFOR::CHOOSE_WIDTH()
+				-------------------------------------
+			*/
+			/*!
+				@brief Choose the width of the low bits of a block.
+				@param source [in] The integers in the block.
+				@param integers [in] The number of integers in the block.
+				@return The width, in bits.
+			*/
+			uint32_t choose_width(const integer *source, size_t integers) const;
+
+			/*
+				COMPRESS_INTEGER_PFOR::DECODE_ONE_BLOCK()
+				-----------------------------------------
+			*/
+			/*!
+				@brief Decode a single block.
+				@param decoded [out] The decoded integers.
+				@param integers [in] The number of integers in the block.
+				@param source [in] The encoded block.
+				@return A pointer to the byte after the end of the block.
+			*/
+			static const uint8_t *decode_one_block(integer *decoded, size_t integers, const uint8_t *source);
+
+		public:
+			/*
+				COMPRESS_INTEGER_PFOR::COMPRESS_INTEGER_PFOR()
+				----------------------------------------------
+			*/
+			/*!
+				@brief Constructor.
+				@param optimal [in] true for OptPFor, false for PForDelta (the encoding is the same, only the choice of width differs).
+			*/
+			explicit compress_integer_pfor(bool optimal = true) :
+				optimal(optimal)
+				{
+				/* Nothing */
+				}
+
+			/*
+				COMPRESS_INTEGER_PFOR::~COMPRESS_INTEGER_PFOR()
+				-----------------------------------------------
+			*/
+			/*!
+				@brief Destructor.
+			*/
+			virtual ~compress_integer_pfor()
+				{
+				/* Nothing */
+				}
+
+			/*
+				COMPRESS_INTEGER_PFOR::ENCODE()
+				-------------------------------
+			*/
+			/*!
+				@brief Encode a sequence of integers returning the number of bytes used for the encoding, or 0 if the encoded sequence doesn't fit in the buffer.
+				@param encoded [out] The sequence of bytes that is the encoded sequence.
+				@param encoded_buffer_length [in] The length (in bytes) of the output buffer, encoded.
+				@param source [in] The sequence of integers to encode.
+				@param source_integers [in] The length (in integers) of the source buffer.
+				@return The number of bytes used to encode the integer sequence, or 0 on error (i.e. overflow).
+			*/
+			virtual size_t encode(void *encoded, size_t encoded_buffer_length, const integer *source, size_t source_integers);
+
+			/*
+				COMPRESS_INTEGER_PFOR::DECODE()
+				-------------------------------
+			*/
+			/*!
+				@brief Decode a sequence of integers encoded with this codex.
+				@param decoded [out] The sequence of decoded integers.
+				@param integers_to_decode [in] The minimum number of integers to decode (it may decode more).
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			virtual void decode(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length);
+
+			/*
+				COMPRESS_INTEGER_PFOR::SUPPORTS_BLOCKS()
+				----------------------------------------
+			*/
+			/*!
+				@brief Does this codex support decoding a block of integers at a time (using decode_start() and decode_block())?
+				@return true.
+			*/
+			virtual bool supports_blocks(void) const
+				{
+				return true;
+				}
+
+			/*
+				COMPRESS_INTEGER_PFOR::DECODE_BLOCK()
+				-------------------------------------
+			*/
+			/*!
+				@brief Decode the next (up to) integers_to_decode integers from the sequence and advance the cursor.
+				@param at [in, out] The cursor (from decode_start()).
+				@param decoded [out] The decoded integers.
+				@param integers_to_decode [in] The maximum number of integers to decode (a multiple of integers_per_block).
+				@return The number of integers decoded, 0 at the end of the sequence.
+			*/
+			virtual size_t decode_block(cursor &at, integer *decoded, size_t integers_to_decode) const;
+
+			/*
+				COMPRESS_INTEGER_PFOR::UNITTEST()
+				---------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
@@ -8,6 +8,7 @@
 #include <stdio.h>
 
 #include <random>
+#include <algorithm>
 
 #include "asserts.h"
 #include "compress_integer_stream_vbyte.h"
@@ -30,6 +31,15 @@ namespace JASS
 	*/
 	size_t compress_integer_stream_vbyte::encode(void *encoded_as_void, size_t encoded_buffer_length, const integer *source, size_t source_integers)
 		{
+		/*
+			Stream VByte doesn't check for overflow so work out how large the encoding will be before encoding.
+		*/
+		size_t needed = (source_integers + 3) / 4;
+		for (const integer *current = source; current < source + source_integers; current++)
+			needed += *current < (1U << 8) ? 1 : *current < (1U << 16) ? 2 : *current < (1U << 24) ? 3 : 4;
+		if (needed > encoded_buffer_length)
+			return 0;
+
 		return streamvbyte::streamvbyte_encode(const_cast<integer *>(source), static_cast<uint32_t>(source_integers), static_cast<uint8_t *>(encoded_as_void));
 		}
 
@@ -42,6 +52,184 @@ namespace JASS
 		streamvbyte::streamvbyte_decode(reinterpret_cast<uint8_t *>(const_cast<void *>(source_as_void)), decoded, static_cast<uint32_t>(integers_to_decode));
 		}
 
+	/*
+		COMPRESS_INTEGER_STREAM_VBYTE::DECODE_START()
+		---------------------------------------------
+	*/
+	void compress_integer_stream_vbyte::decode_start(cursor &at, size_t integers, const void *source, size_t source_length) const
+		{
+		at.selectors = static_cast<const uint8_t *>(source);
+		at.data = at.selectors + (integers + 3) / 4;			// the data starts after the 2-bit keys
+		at.end = at.selectors + source_length;
+		at.decoded = 0;
+		at.integers = integers;
+		at.codex = nullptr;
+		}
+
+	/*
+		COMPRESS_INTEGER_STREAM_VBYTE::DECODE_BLOCK()
+		---------------------------------------------
+	*/
+	size_t compress_integer_stream_vbyte::decode_block(cursor &at, integer *decoded, size_t integers_to_decode) const
+		{
+		size_t integers = (std::min)(integers_to_decode, at.integers - at.decoded);
+		size_t which = at.decoded;
+		size_t finish = which + integers;
+		const uint8_t *data = at.data;
+
+		/*
+			Decode whole groups of 4 integers with a shuffle - as long as we can safely read 16 bytes.
+		*/
+		for (; which + 4 <= finish && data + sizeof(__m128i) <= at.end; which += 4)
+			{
+			uint8_t key = at.selectors[which / 4];
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(decoded), _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(streamvbyte::shuffleTable[key]))));
+			data += streamvbyte::lengthTable[key];
+			decoded += 4;
+			}
+
+		/*
+			Decode the remainder one at a time.
+		*/
+		for (; which < finish; which++)
+			{
+			uint32_t bytes = ((at.selectors[which / 4] >> ((which % 4) * 2)) & 0x03) + 1;
+			integer value = 0;
+			memcpy(&value, data, bytes);				// assumes little endian
+			data += bytes;
+			*decoded++ = value;
+			}
+
+		at.data = data;
+		at.decoded = finish;
+
+		return integers;
+		}
+
+	/*
+		COMPRESS_INTEGER_STREAM_VBYTE::DECODE_D1_AVX2()
+		-----------------------------------------------
+	*/
+	void compress_integer_stream_vbyte::decode_d1_avx2(integer *&decoded, const uint8_t *keys, const uint8_t *&data, const uint8_t *end, size_t groups, size_t &group, uint32_t &previous)
+		{
+		__m256i carry = _mm256_set1_epi32(previous);
+		const __m256i last = _mm256_set1_epi32(7);
+
+		/*
+			Decode 2 groups with 2 shuffles, then sum all 8 integers at once (as long as we can safely read 16 bytes from the second group).
+		*/
+		for (; group + 2 <= groups; group += 2)
+			{
+			uint8_t key_0 = keys[group];
+			uint8_t key_1 = keys[group + 1];
+			const uint8_t *data_1 = data + streamvbyte::lengthTable[key_0];
+			if (data_1 + sizeof(__m128i) > end)
+				break;
+
+			__m128i low = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(streamvbyte::shuffleTable[key_0])));
+			__m128i high = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data_1)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(streamvbyte::shuffleTable[key_1])));
+			data = data_1 + streamvbyte::lengthTable[key_1];
+
+			__m256i elements = _mm256_add_epi32(simd::cumulative_sum(_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1)), carry);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(decoded), elements);
+			carry = _mm256_permutevar8x32_epi32(elements, last);
+			decoded += 8;
+			}
+
+		previous = static_cast<uint32_t>(_mm256_extract_epi32(carry, 0));
+		}
+
+	/*
+		COMPRESS_INTEGER_STREAM_VBYTE::DECODE_D1_AVX512()
+		-------------------------------------------------
+	*/
+	void compress_integer_stream_vbyte::decode_d1_avx512(integer *&decoded, const uint8_t *keys, const uint8_t *&data, const uint8_t *end, size_t groups, size_t &group, uint32_t &previous)
+		{
+		const integer *start = decoded;
+		__m512i carry = _mm512_set1_epi32(previous);
+		const __m512i last = _mm512_set1_epi32(15);
+
+		/*
+			Decode 4 groups with 4 shuffles, then sum all 16 integers at once (as long as we can safely read 16 bytes from the fourth group).
+		*/
+		for (; group + 4 <= groups; group += 4)
+			{
+			const uint8_t *key = keys + group;
+			const uint8_t *data_1 = data + streamvbyte::lengthTable[key[0]];
+			const uint8_t *data_2 = data_1 + streamvbyte::lengthTable[key[1]];
+			const uint8_t *data_3 = data_2 + streamvbyte::lengthTable[key[2]];
+			if (data_3 + sizeof(__m128i) > end)
+				break;
+
+			__m512i elements = _mm512_castsi128_si512(_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(streamvbyte::shuffleTable[key[0]]))));
+			elements = _mm512_inserti32x4(elements, _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data_1)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(streamvbyte::shuffleTable[key[1]]))), 1);
+			elements = _mm512_inserti32x4(elements, _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data_2)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(streamvbyte::shuffleTable[key[2]]))), 2);
+			elements = _mm512_inserti32x4(elements, _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data_3)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(streamvbyte::shuffleTable[key[3]]))), 3);
+			data = data_3 + streamvbyte::lengthTable[key[3]];
+
+			elements = _mm512_add_epi32(simd::cumulative_sum(elements), carry);
+			_mm512_storeu_si512(decoded, elements);
+			carry = _mm512_maskz_permutexvar_epi32(0xFFFF, last, elements);
+			decoded += 16;
+			}
+
+		if (decoded != start)
+			previous = decoded[-1];
+		}
+
+	/*
+		COMPRESS_INTEGER_STREAM_VBYTE::DECODE_D1()
+		------------------------------------------
+	*/
+	void compress_integer_stream_vbyte::decode_d1(integer *decoded, size_t integers_to_decode, const void *source_as_void, size_t source_length)
+		{
+		const uint8_t *keys = static_cast<const uint8_t *>(source_as_void);
+		const uint8_t *data = keys + (integers_to_decode + 3) / 4;			// the data starts after the 2-bit keys
+		const uint8_t *end = keys + source_length;
+		size_t groups = integers_to_decode / 4;
+		size_t group = 0;
+		uint32_t previous = 0;
+
+		/*
+			Use the wider instructions for as much of the sequence as possible then fall through to SSE for the remainder.
+		*/
+		cpu::isa use = (std::min)(instruction_set, cpu::best());
+		if (use == cpu::AVX512)
+			decode_d1_avx512(decoded, keys, data, end, groups, group, previous);
+		else if (use == cpu::AVX2)
+			decode_d1_avx2(decoded, keys, data, end, groups, group, previous);
+
+		/*
+			Each key byte describes 4 integers, decode them with a shuffle then sum and store - as long as we can safely read 16 bytes.
+		*/
+		__m128i carry = _mm_set1_epi32(previous);
+		for (; group < groups && data + sizeof(__m128i) <= end; group++)
+			{
+			uint8_t key = keys[group];
+			__m128i elements = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(streamvbyte::shuffleTable[key])));
+			data += streamvbyte::lengthTable[key];
+
+			elements = _mm_add_epi32(simd::cumulative_sum(elements), carry);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(decoded), elements);
+			carry = _mm_shuffle_epi32(elements, 0xFF);
+			decoded += 4;
+			}
+
+		/*
+			Decode the remainder one at a time (each key is 2 bits, 0 to 3, being the number of bytes minus 1).
+		*/
+		previous = static_cast<uint32_t>(_mm_cvtsi128_si32(carry));
+		for (size_t which = group * 4; which < integers_to_decode; which++)
+			{
+			uint32_t bytes = ((keys[which / 4] >> ((which % 4) * 2)) & 0x03) + 1;
+			uint32_t value = 0;
+			memcpy(&value, data, bytes);				// assumes little endian
+			data += bytes;
+			previous += value;
+			*decoded++ = previous;
+			}
+		}
+
 	/*
 		COMPRESS_INTEGER_STREAM_VBYTE::UNITTEST()
 		-----------------------------------------
@@ -77,6 +265,11 @@ namespace JASS
 		decompressed.resize(sequence.size());
 		JASS_assert(decompressed == sequence);
 
+		/*
+			Overflow.
+		*/
+		JASS_assert(compressor.encode(&compressed[0], size_once_compressed - 1, &sequence[0], sequence.size()) == 0);
+
 		auto will_take = streamvbyte::streamvbyte_max_compressedbytes(128);
 		JASS_assert(will_take == 544);
 
@@ -90,6 +283,47 @@ namespace JASS
 		*/
 		compressor.decode(&decompressed[0], 0, &compressed[0], size_once_compressed);
 
+		/*
+			Check the fused decode and cumulative sum against decode() followed by a (scalar) cumulative sum.
+		*/
+		std::mt19937 random(1);
+		for (size_t length : {1, 3, 4, 5, 17, 64, 67, 1000, 1001})
+			{
+			sequence.resize(length);
+			for (auto &gap : sequence)
+				gap = random() >> (random() % 32);
+
+			size_once_compressed = compressor.encode(&compressed[0], compressed.size() * sizeof(compressed[0]), &sequence[0], sequence.size());
+
+			uint32_t sum = 0;
+			std::vector<uint32_t> expected;
+			for (auto gap : sequence)
+				expected.push_back(sum += gap);
+
+			/*
+				Every instruction set this CPU supports must give the same answer.
+			*/
+			for (cpu::isa instruction_set = cpu::SSE4_2; instruction_set <= cpu::best(); instruction_set = static_cast<cpu::isa>(instruction_set + 1))
+				{
+				compress_integer_stream_vbyte variant(instruction_set);
+				decompressed.assign(length + 256, 0);
+				variant.decode_d1(&decompressed[0], length, &compressed[0], size_once_compressed);
+				decompressed.resize(length);
+				JASS_assert(decompressed == expected);
+				}
+			}
+
+		/*
+			Check decoding a block at a time, including sequences that end part way through a group of 4.
+		*/
+		for (size_t length : {1, 3, 4, 5, 255, 256, 257, 1000, 1027})
+			{
+			sequence.resize(length);
+			for (auto &value : sequence)
+				value = random() >> (random() % 32);
+			JASS_assert(compress_integer::unittest_decode_blocks(compressor, sequence));
+			}
+
 		/*
 			The tests have passed
 		*/
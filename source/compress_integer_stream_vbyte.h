@@ -27,15 +27,55 @@ namespace JASS
 	*/
 	class compress_integer_stream_vbyte : public compress_integer
 		{
+		private:
+			cpu::isa instruction_set;			///< The instruction set decode_d1() uses.
+
+		private:
+			/*
+				COMPRESS_INTEGER_STREAM_VBYTE::DECODE_D1_AVX2()
+				-----------------------------------------------
+			*/
+			/*!
+				@brief Decode and sum pairs of groups of 4 integers (8 integers at a time) using AVX2, as long as it is safe to do so.
+				@param decoded [in, out] Where to write the decoded integers, advanced past them on return.
+				@param keys [in] The Stream VByte keys (one byte per group of 4 integers).
+				@param data [in, out] The encoded data for group, advanced past what was decoded on return.
+				@param end [in] The end of the encoded sequence.
+				@param groups [in] The number of whole groups of 4 integers in the sequence.
+				@param group [in, out] The next group to decode, advanced past what was decoded on return.
+				@param previous [in, out] The last integer decoded (the value that is added to the next group).
+			*/
+			JASS_TARGET_AVX2 static void decode_d1_avx2(integer *&decoded, const uint8_t *keys, const uint8_t *&data, const uint8_t *end, size_t groups, size_t &group, uint32_t &previous);
+
+			/*
+				COMPRESS_INTEGER_STREAM_VBYTE::DECODE_D1_AVX512()
+				-------------------------------------------------
+			*/
+			/*!
+				@brief Decode and sum 4 groups of 4 integers (16 integers at a time) using AVX-512, as long as it is safe to do so.
+				@param decoded [in, out] Where to write the decoded integers, advanced past them on return.
+				@param keys [in] The Stream VByte keys (one byte per group of 4 integers).
+				@param data [in, out] The encoded data for group, advanced past what was decoded on return.
+				@param end [in] The end of the encoded sequence.
+				@param groups [in] The number of whole groups of 4 integers in the sequence.
+				@param group [in, out] The next group to decode, advanced past what was decoded on return.
+				@param previous [in, out] The last integer decoded (the value that is added to the next group).
+			*/
+			JASS_TARGET_AVX512 static void decode_d1_avx512(integer *&decoded, const uint8_t *keys, const uint8_t *&data, const uint8_t *end, size_t groups, size_t &group, uint32_t &previous);
+
 		public:
 			/*
-				COMPRESS_INTEGER_STREAM_VBYTE::COMPRESS_INTEGER_VARIABLE_BYTE()
-				---------------------------------------------------------------
+				COMPRESS_INTEGER_STREAM_VBYTE::COMPRESS_INTEGER_STREAM_VBYTE()
+				--------------------------------------------------------------
 			*/
 			/*!
 				@brief Constructor.
+				@details The encoding is the same whatever the instruction set, only the speed of decode_d1() differs.  Asking for an
+				instruction set that the CPU does not support is not an error, the best one that is supported is used instead.
+				@param instruction_set [in] The best instruction set decode_d1() may use (default = cpu::AVX512, which is the best available).
 			*/
-			compress_integer_stream_vbyte()
+			explicit compress_integer_stream_vbyte(cpu::isa instruction_set = cpu::AVX512) :
+				instruction_set(instruction_set)
 				{
 				/* Nothing */
 				}
@@ -79,6 +119,59 @@ namespace JASS
 			*/
 			virtual void decode(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length);
 
+			/*
+				COMPRESS_INTEGER_STREAM_VBYTE::SUPPORTS_BLOCKS()
+				------------------------------------------------
+			*/
+			/*!
+				@brief Does this codex support decoding a block of integers at a time (using decode_start() and decode_block())?
+				@return true.
+			*/
+			virtual bool supports_blocks(void) const
+				{
+				return true;
+				}
+
+			/*
+				COMPRESS_INTEGER_STREAM_VBYTE::DECODE_START()
+				---------------------------------------------
+			*/
+			/*!
+				@brief Set up a cursor ready to decode the encoded sequence a block at a time.
+				@param at [out] The cursor.
+				@param integers [in] The number of integers in the encoded sequence.
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			virtual void decode_start(cursor &at, size_t integers, const void *source, size_t source_length) const;
+
+			/*
+				COMPRESS_INTEGER_STREAM_VBYTE::DECODE_BLOCK()
+				---------------------------------------------
+			*/
+			/*!
+				@brief Decode the next (up to) integers_to_decode integers from the sequence and advance the cursor.
+				@param at [in, out] The cursor (from decode_start()).
+				@param decoded [out] The decoded integers.
+				@param integers_to_decode [in] The maximum number of integers to decode (a multiple of 4 except for the last block).
+				@return The number of integers decoded, 0 at the end of the sequence.
+			*/
+			virtual size_t decode_block(cursor &at, integer *decoded, size_t integers_to_decode) const;
+
+			/*
+				COMPRESS_INTEGER_STREAM_VBYTE::DECODE_D1()
+				------------------------------------------
+			*/
+			/*!
+				@brief Decode a sequence of D1 encoded integers (d-gaps) and reconstruct the original sequence (the cumulative sum).
+				@details Each group of 4 integers is decoded with a shuffle and summed while still in a register.  If the CPU supports
+				them (and the constructor allowed it) then 2 or 4 groups are summed at once using AVX2 or AVX-512.
+				@param decoded [out] The sequence of decoded integers.
+				@param integers_to_decode [in] The number of integers to decode.
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			virtual void decode_d1(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length);
 
 			/*
 				COMPRESS_INTEGER_STREAM_VBYTE::UNITTEST()
@@ -8,6 +8,7 @@
 #include <stdio.h>
 
 #include <random>
+#include <algorithm>
 
 #include "asserts.h"
 #include "compress_integer_variable_byte.h"
@@ -133,6 +134,32 @@ namespace JASS
 			}
 		}
 
+	/*
+		COMPRESS_INTEGER_VARIABLE_BYTE::DECODE_BLOCK()
+		----------------------------------------------
+	*/
+	size_t compress_integer_variable_byte::decode_block(cursor &at, integer *decoded, size_t integers_to_decode) const
+		{
+		size_t integers = (std::min)(integers_to_decode, at.integers - at.decoded);
+		const uint8_t *source = at.data;
+
+		for (integer *end = decoded + integers; decoded < end; decoded++)
+			{
+			/*
+				Each byte without the high bit set is a 7-bit chunk of the integer, the one with the high bit set is the last chunk.
+			*/
+			integer value = 0;
+			while ((*source & 0x80) == 0)
+				value = (value << 7) | *source++;
+			*decoded = (value << 7) | (*source++ & 0x7F);
+			}
+
+		at.data = source;
+		at.decoded += integers;
+
+		return integers;
+		}
+
 	/*
 		COMPRESS_INTEGER_VARIABLE_BYTE::UNITTEST()
 		------------------------------------------
@@ -248,6 +275,19 @@ namespace JASS
 		JASS_assert(memcmp(decoded_buffer, ten_byte, sizeof(five_byte)) == 0);
 #endif
 		
+		/*
+			Check decoding a block at a time.
+		*/
+		std::mt19937 random(1);
+		std::vector<integer> sequence;
+		for (size_t length : {1, 255, 256, 257, 1000})
+			{
+			sequence.resize(length);
+			for (auto &value : sequence)
+				value = random() >> (random() % 32);
+			JASS_assert(compress_integer::unittest_decode_blocks(codex, sequence));
+			}
+
 		/*
 			The tests have passed
 		*/
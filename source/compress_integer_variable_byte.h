@@ -89,6 +89,32 @@ namespace JASS
 			*/
 			virtual void decode(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length);
 
+			/*
+				COMPRESS_INTEGER_VARIABLE_BYTE::SUPPORTS_BLOCKS()
+				-------------------------------------------------
+			*/
+			/*!
+				@brief Does this codex support decoding a block of integers at a time (using decode_start() and decode_block())?
+				@return true.
+			*/
+			virtual bool supports_blocks(void) const
+				{
+				return true;
+				}
+
+			/*
+				COMPRESS_INTEGER_VARIABLE_BYTE::DECODE_BLOCK()
+				----------------------------------------------
+			*/
+			/*!
+				@brief Decode the next (up to) integers_to_decode integers from the sequence and advance the cursor.
+				@param at [in, out] The cursor (from decode_start()).
+				@param decoded [out] The decoded integers.
+				@param integers_to_decode [in] The maximum number of integers to decode.
+				@return The number of integers decoded, 0 at the end of the sequence.
+			*/
+			virtual size_t decode_block(cursor &at, integer *decoded, size_t integers_to_decode) const;
+
 			/*
 				COMPRESS_INTEGER_VARIABLE_BYTE::BYTES_NEEDED_FOR()
 				--------------------------------------------------
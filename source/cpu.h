@@ -0,0 +1,259 @@
+/*
+	CPU.H
+	-----
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Run-time detection of the instruction sets supported by the CPU.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <string>
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#else
+	#include <cpuid.h>
+#endif
+
+#include "asserts.h"
+
+/*!
+	@def JASS_TARGET_AVX2
+	@brief Mark a function as being compiled for AVX2 (so that it can be called only if cpu::supports(cpu::AVX2) is true).
+*/
+/*!
+	@def JASS_TARGET_AVX512
+	@brief Mark a function as being compiled for AVX-512 (so that it can be called only if cpu::supports(cpu::AVX512) is true).
+*/
+#if defined(__GNUC__) || defined(__clang__)
+	#define JASS_TARGET_AVX2 __attribute__((target("avx2")))
+	#define JASS_TARGET_AVX512 __attribute__((target("avx2,avx512f")))
+#else
+	#define JASS_TARGET_AVX2
+	#define JASS_TARGET_AVX512
+#endif
+
+namespace JASS
+	{
+	/*
+		CLASS CPU
+		---------
+	*/
+	/*!
+		@brief Run-time detection of the instruction sets supported by the CPU.
+		@details JASS is compiled for SSE4.2 so that a single binary runs on all the machines we use.  Code paths that
+		use wider instruction sets are compiled with JASS_TARGET_AVX2 or JASS_TARGET_AVX512 and are only called if best()
+		says so.  The best instruction set is found (using cpuid) the first time it is asked for.
+	*/
+	class cpu
+		{
+		public:
+			/*!
+				@enum isa
+				@brief The instruction sets that JASS has code paths for (in order, each is a superset of those before it).
+			*/
+			enum isa
+				{
+				SSE4_2 = 0,				///< SSE4.2 (the minimum JASS will run on).
+				AVX2,						///< AVX2.
+				AVX512,					///< AVX-512 Foundation.
+				ISA_COUNT				///< The number of instruction sets in this enum.
+				};
+
+		private:
+			/*
+				CPU::CPUID()
+				------------
+			*/
+			/*!
+				@brief Call the cpuid instruction.
+				@param leaf [in] The cpuid function (eax).
+				@param subleaf [in] The cpuid sub-function (ecx).
+				@param registers [out] eax, ebx, ecx, and edx (in that order).
+			*/
+			static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t registers[4])
+				{
+				#ifdef _MSC_VER
+					int answer[4];
+					__cpuidex(answer, leaf, subleaf);
+					for (size_t which = 0; which < 4; which++)
+						registers[which] = static_cast<uint32_t>(answer[which]);
+				#else
+					__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+				#endif
+				}
+
+			/*
+				CPU::XGETBV()
+				-------------
+			*/
+			/*!
+				@brief Get the extended control register (XCR0) that says which registers the operating system saves on a context switch.
+				@return XCR0.
+			*/
+			static uint64_t xgetbv(void)
+				{
+				#ifdef _MSC_VER
+					return _xgetbv(0);
+				#else
+					uint32_t eax, edx;
+					__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+					return (static_cast<uint64_t>(edx) << 32) | eax;
+				#endif
+				}
+
+			/*
+				CPU::DETECT()
+				-------------
+			*/
+			/*!
+				@brief Ask the CPU (and the operating system) which is the best instruction set we can use.
+				@details AVX registers can only be used if the operating system saves them on a context switch, so as well as
+				the CPU supporting the instructions the OS must have turned them on (which is reported by XCR0).
+				@return The best instruction set.
+			*/
+			static isa detect(void)
+				{
+				uint32_t registers[4];
+
+				cpuid(0, 0, registers);
+				uint32_t max_leaf = registers[0];
+				if (max_leaf < 7)
+					return SSE4_2;
+
+				cpuid(1, 0, registers);
+				bool osxsave = (registers[2] & (1 << 27)) != 0;
+				if (!osxsave)
+					return SSE4_2;
+
+				uint64_t xcr0 = xgetbv();
+				cpuid(7, 0, registers);
+				bool avx2 = (registers[1] & (1 << 5)) != 0 && (xcr0 & 0x06) == 0x06;				// XMM and YMM state
+				bool avx512 = (registers[1] & (1 << 16)) != 0 && (xcr0 & 0xE6) == 0xE6;			// XMM, YMM, opmask, and ZMM state
+
+				return avx2 && avx512 ? AVX512 : avx2 ? AVX2 : SSE4_2;
+				}
+
+			/*
+				CPU::SELECTED()
+				---------------
+			*/
+			/*!
+				@brief Return a reference to the instruction set that has been selected (which is detect() unless limit() has been called).
+				@return The selected instruction set.
+			*/
+			static isa &selected(void)
+				{
+				static isa chosen = detect();
+				return chosen;
+				}
+
+		public:
+			/*
+				CPU::BEST()
+				-----------
+			*/
+			/*!
+				@brief Return the best instruction set that this CPU supports (and that JASS has code for).
+				@return The instruction set.
+			*/
+			static isa best(void)
+				{
+				return selected();
+				}
+
+			/*
+				CPU::SUPPORTS()
+				---------------
+			*/
+			/*!
+				@brief Can code compiled for the given instruction set be run on this CPU?
+				@param instruction_set [in] The instruction set.
+				@return true if it can, else false.
+			*/
+			static bool supports(isa instruction_set)
+				{
+				return instruction_set <= best();
+				}
+
+			/*
+				CPU::LIMIT()
+				------------
+			*/
+			/*!
+				@brief Stop JASS from using instruction sets better than the given one (for example, to compare code paths on one machine).
+				@details This cannot be used to turn on an instruction set the CPU does not support.
+				@param instruction_set [in] The best instruction set to use.
+			*/
+			static void limit(isa instruction_set)
+				{
+				if (instruction_set < detect())
+					selected() = instruction_set;
+				else
+					selected() = detect();
+				}
+
+			/*
+				CPU::NAME()
+				-----------
+			*/
+			/*!
+				@brief Return the name of the instruction set.
+				@param instruction_set [in] The instruction set.
+				@return The name as a C string.
+			*/
+			static const char *name(isa instruction_set)
+				{
+				switch (instruction_set)
+					{
+					case SSE4_2:
+						return "SSE4.2";
+					case AVX2:
+						return "AVX2";
+					case AVX512:
+						return "AVX-512";
+					default:
+						return "Unknown";		// LCOV_EXCL_LINE
+					}
+				}
+
+			/*
+				CPU::UNITTEST()
+				---------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				isa original = best();
+
+				/*
+					We're running so we must have SSE4.2, and if we have something better then we must have everything before it.
+				*/
+				JASS_assert(supports(SSE4_2));
+				for (isa instruction_set = SSE4_2; instruction_set < ISA_COUNT; instruction_set = static_cast<isa>(instruction_set + 1))
+					JASS_assert(supports(instruction_set) == (instruction_set <= original));
+
+				/*
+					We can turn instruction sets off, but we can't turn them on if they're not there.
+				*/
+				limit(SSE4_2);
+				JASS_assert(best() == SSE4_2);
+				limit(AVX512);
+				JASS_assert(best() == original);
+
+				JASS_assert(std::string(name(AVX2)) == "AVX2");
+
+				puts("cpu::PASSED");
+				}
+		};
+	}
@@ -119,10 +119,72 @@ namespace JASS
 			template <typename QUERY_T>
 			void process(uint16_t impact, QUERY_T &accumulators) const
 				{
-				for (auto document : *this)
-					accumulators.add_rsv(document, impact);
+				accumulators.add_rsv_block(begin(), integers, impact);
 				}
 				
+			/*
+				DECODER_D0::DECODE_AND_PROCESS()
+				--------------------------------
+			*/
+			/*!
+				@brief Decode and process the compressed sequence a block at a time (rather than decoding it all then processing it all).
+				@details The sequence is decoded into a small buffer that stays in L1 cache and the document ids in that buffer are
+				added to the accumulators before the next block is decoded.  This avoids writing the whole segment to memory and then
+				reading it back.  Codexes that cannot decode a block at a time are decoded with decode() then process().  The
+				sequence is D0.
+				@param impact [in] The impact score to add for each document id in the list.
+				@param accumulators [in] The accumulators to add to.
+				@param decoder [in] The codex to use to decompress the sequence.
+				@param integers [in] The number of integers that are compressed.
+				@param compressed [in] The compressed sequence.
+				@param compressed_size [in] The length of the compressed sequence.
+			*/
+			template <typename QUERY_T>
+			void decode_and_process(uint16_t impact, QUERY_T &accumulators, compress_integer &decoder, size_t integers, const void *compressed, size_t compressed_size)
+				{
+				QUERY_T *only = &accumulators;
+				decode_and_process(impact, &only, 1, decoder, integers, compressed, compressed_size);
+				}
+
+			/*
+				DECODER_D0::DECODE_AND_PROCESS()
+				--------------------------------
+			*/
+			/*!
+				@brief Decode the compressed sequence once and add it to the accumulators of several queries.
+				@details As with the single query version the sequence is decoded a block at a time, and each block is added to every
+				query's accumulators while it is still in L1 cache.  The sequence is D0.
+				@param impact [in] The impact score to add for each document id in the list.
+				@param accumulators [in] The accumulators (queries) to add to.
+				@param queries [in] The number of queries in accumulators.
+				@param decoder [in] The codex to use to decompress the sequence.
+				@param integers [in] The number of integers that are compressed.
+				@param compressed [in] The compressed sequence.
+				@param compressed_size [in] The length of the compressed sequence.
+			*/
+			template <typename QUERY_T>
+			void decode_and_process(uint16_t impact, QUERY_T *const *accumulators, size_t queries, compress_integer &decoder, size_t integers, const void *compressed, size_t compressed_size)
+				{
+				if (!decoder.supports_blocks())
+					{
+					decode(decoder, integers, compressed, compressed_size);
+					for (size_t which = 0; which < queries; which++)
+						process(impact, *accumulators[which]);
+					return;
+					}
+
+				compress_integer::cursor at;
+				compress_integer::integer block[compress_integer::block_size];
+				size_t got;
+
+				decoder.decode_start(at, integers, compressed, compressed_size);
+				while ((got = decoder.decode_block(at, block, compress_integer::block_size)) != 0)
+					{
+					for (size_t which = 0; which < queries; which++)
+						accumulators[which]->add_rsv_block(block, got, impact);
+					}
+				}
+
 			/*
 				DECODER_D0::UNITTEST()
 				----------------------
@@ -145,6 +207,35 @@ namespace JASS
 					result << answer.document_id << " ";
 
 				JASS_assert(result.str() == "19 17 13 11 7 ");
+
+				/*
+					Decoding and processing a block at a time must give the same answer.
+				*/
+				query<uint16_t, 100, 100> blocked_query(primary_keys, 20, 5);
+				std::ostringstream blocked_result;
+
+				decoder.decode_and_process(1, blocked_query, identity, integer_sequence.size(), integer_sequence.data(), sizeof(integer_sequence[0]) * integer_sequence.size());
+				for (const auto &answer : blocked_query)
+					blocked_result << answer.document_id << " ";
+
+				JASS_assert(blocked_result.str() == result.str());
+
+				/*
+					Decoding once for several queries must give each the same answer.
+				*/
+				query<uint16_t, 100, 100> first_query(primary_keys, 20, 5);
+				query<uint16_t, 100, 100> second_query(primary_keys, 20, 5);
+				query<uint16_t, 100, 100> *both[] = {&first_query, &second_query};
+
+				decoder.decode_and_process(1, both, 2, identity, integer_sequence.size(), integer_sequence.data(), sizeof(integer_sequence[0]) * integer_sequence.size());
+				for (auto current : both)
+					{
+					std::ostringstream batched_result;
+					for (const auto &answer : *current)
+						batched_result << answer.document_id << " ";
+					JASS_assert(batched_result.str() == result.str());
+					}
+
 				puts("decoder_d0::PASSED");
 				}
 		};
@@ -25,7 +25,8 @@ namespace JASS
 		@brief Decode for D1 encoded integer sequences
 		@details Many of the integer encoders compute differences (d-gaps, or deltas) between consequtive
 		integers before encoding (so-called D1).  This makes the integers smaller and thus easier to encode.
-		This class decodes and adds to the accumulators D1 delta encoded sequences.
+		This class decodes and adds to the accumulators D1 delta encoded sequences.  The cumulative sum is computed
+		when the sequence is decoded rather than as each integer is processed.
 	*/
 	class decoder_d1
 		{
@@ -33,90 +34,18 @@ namespace JASS
 			size_t integers;													///< The number of integers in the decompress buffer.
 			std::vector<uint32_t> decompress_buffer;					///< The delta-encoded decopressed integer sequence.
 
-		private:
-			/*
-				CLASS DECODER_D1::ITERATOR
-				--------------------------
-			*/
-			/*!
-				@brief Iterator over D1 encoded integer sequences reconstituting the original sequence (i.e. doing the cumulative add)
-			*/
-			class iterator
-				{
-				private:
-					uint32_t cumulative;					///< The cumulative sum so far
-					const uint32_t *current;			///< Pointer to the current D1 encoded integer
-
-				public:
-					/*
-						DECODER_D1::ITERATOR::ITERATOR()
-						--------------------------------
-					*/
-					/*!
-						@brief Constructor
-						@param array [in] The vector to use in the iterator
-						@param offset [in] The offset within the vector to use in the iterator
-					*/
-					iterator(const std::vector<uint32_t> &array, size_t offset) :
-						cumulative(0),
-						current(array.data() + offset)
-						{
-						/* Nothing */
-						}
-
-					/*
-						DECODER_D1::ITERATOR::OPERATOR*()
-						---------------------------------
-					*/
-					/*!
-						@brief Return a reference to the element pointed to by this iterator.
-					*/
-					uint32_t operator*(void)
-						{
-						cumulative += *current;
-						return cumulative;
-						}
-
-					/*
-						DECODER_D1::ITERATOR::OPERATOR!=()
-						----------------------------------
-					*/
-					/*!
-						@brief Compare two iterator objects for non-equality.
-						@param another [in] The iterator object to compare to.
-						@return true if they differ, else false.
-					*/
-					bool operator!=(iterator &another)
-						{
-						return current != another.current;
-						}
-
-					/*
-						DECODER_D1::ITERATOR::OPERATOR++()
-						----------------------------------
-					*/
-					/*!
-						@brief Increment this iterator.
-					*/
-					iterator &operator++(void)
-						{
-						current++;
-						return *this;
-						}
-				};
-
 		private:
 			/*
 				DECODER_D1::BEGIN()
 				-------------------
 			*/
 			/*!
-				@brief Return an iterator pointing to the start of the sequence (using this iterator will D1 decode each integer in sequence).
+				@brief Return an iterator pointing to the start of the (already D1 decoded) sequence.
 				@return Iterator pointing to start of sequence.
 			*/
-			iterator begin() const
+			auto begin() const
 				{
-				return iterator(decompress_buffer, 0);
+				return decompress_buffer.data();
 				}
 
 			/*
@@ -124,12 +53,12 @@ namespace JASS
 				-----------------
 			*/
 			/*!
-				@brief Return an iterator pointing to the end of the sequence (using this iterator will D1 decode each integer in sequence).
+				@brief Return an iterator pointing to the end of the (already D1 decoded) sequence.
 				@return Iterator pointing to end of sequence.
 			*/
-			iterator end() const
+			auto end() const
 				{
-				return iterator(decompress_buffer, integers);
+				return decompress_buffer.data() + integers;
 				}
 
 		public:
@@ -163,6 +92,8 @@ namespace JASS
 			*/
 			/*!
 				@brief Given the integer decoder, the number of integes to decode, and the compressed sequence, decompress (but do not process).
+				@details The D1 sequence is turned back into document ids here (using SIMD instructions, or as part of the
+				decoder for those that can) so that process() reads document ids directly.
 				@param decoder [in] The codex to use to decompress into the D1 sequence.
 				@param integers [in] The number of integers that are compressed.
 				@param compressed [in] The compressed sequence.
@@ -170,7 +101,7 @@ namespace JASS
 			*/
 			void decode(JASS::compress_integer &decoder, size_t integers, const void *compressed, size_t compressed_size)
 				{
-				decoder.decode(decompress_buffer.data(), integers, compressed, compressed_size);
+				decoder.decode_d1(decompress_buffer.data(), integers, compressed, compressed_size);
 				this->integers = integers;
 				}
 
@@ -187,8 +118,73 @@ namespace JASS
 			template <typename QUERY_T>
 			void process(uint16_t impact, QUERY_T &accumulators) const
 				{
-				for (auto document : *this)
-					accumulators.add_rsv(document, impact);
+				accumulators.add_rsv_block(begin(), integers, impact);
+				}
+
+			/*
+				DECODER_D1::DECODE_AND_PROCESS()
+				--------------------------------
+			*/
+			/*!
+				@brief Decode and process the compressed sequence a block at a time (rather than decoding it all then processing it all).
+				@details The sequence is decoded into a small buffer that stays in L1 cache and the document ids in that buffer are
+				added to the accumulators before the next block is decoded.  This avoids writing the whole segment to memory and then
+				reading it back.  Codexes that cannot decode a block at a time are decoded with decode() then process().  The
+				sequence is D1 (the cumulative sum is carried from block to block).
+				@param impact [in] The impact score to add for each document id in the list.
+				@param accumulators [in] The accumulators to add to.
+				@param decoder [in] The codex to use to decompress the sequence.
+				@param integers [in] The number of integers that are compressed.
+				@param compressed [in] The compressed sequence.
+				@param compressed_size [in] The length of the compressed sequence.
+			*/
+			template <typename QUERY_T>
+			void decode_and_process(uint16_t impact, QUERY_T &accumulators, compress_integer &decoder, size_t integers, const void *compressed, size_t compressed_size)
+				{
+				QUERY_T *only = &accumulators;
+				decode_and_process(impact, &only, 1, decoder, integers, compressed, compressed_size);
+				}
+
+			/*
+				DECODER_D1::DECODE_AND_PROCESS()
+				--------------------------------
+			*/
+			/*!
+				@brief Decode the compressed sequence once and add it to the accumulators of several queries.
+				@details As with the single query version the sequence is decoded a block at a time, and each block is added to every
+				query's accumulators while it is still in L1 cache.  The sequence is D1 (the cumulative sum is carried from block to block).
+				@param impact [in] The impact score to add for each document id in the list.
+				@param accumulators [in] The accumulators (queries) to add to.
+				@param queries [in] The number of queries in accumulators.
+				@param decoder [in] The codex to use to decompress the sequence.
+				@param integers [in] The number of integers that are compressed.
+				@param compressed [in] The compressed sequence.
+				@param compressed_size [in] The length of the compressed sequence.
+			*/
+			template <typename QUERY_T>
+			void decode_and_process(uint16_t impact, QUERY_T *const *accumulators, size_t queries, compress_integer &decoder, size_t integers, const void *compressed, size_t compressed_size)
+				{
+				if (!decoder.supports_blocks())
+					{
+					decode(decoder, integers, compressed, compressed_size);
+					for (size_t which = 0; which < queries; which++)
+						process(impact, *accumulators[which]);
+					return;
+					}
+
+				compress_integer::cursor at;
+				compress_integer::integer block[compress_integer::block_size];
+				size_t got;
+				uint32_t previous = 0;
+
+				decoder.decode_start(at, integers, compressed, compressed_size);
+				while ((got = decoder.decode_block(at, block, compress_integer::block_size)) != 0)
+					{
+					simd::cumulative_sum(block, got, previous);
+					previous = block[got - 1];
+					for (size_t which = 0; which < queries; which++)
+						accumulators[which]->add_rsv_block(block, got, impact);
+					}
 				}
 
 			/*
@@ -213,6 +209,35 @@ namespace JASS
 					result << answer.document_id << " ";
 
 				JASS_assert(result.str() == "19 17 13 11 7 ");
+
+				/*
+					Decoding and processing a block at a time must give the same answer.
+				*/
+				JASS::query<uint16_t, 100, 100> blocked_query(primary_keys, 20, 5);
+				std::ostringstream blocked_result;
+
+				decoder.decode_and_process(1, blocked_query, identity, integer_sequence.size(), integer_sequence.data(), sizeof(integer_sequence[0]) * integer_sequence.size());
+				for (const auto &answer : blocked_query)
+					blocked_result << answer.document_id << " ";
+
+				JASS_assert(blocked_result.str() == result.str());
+
+				/*
+					Decoding once for several queries must give each the same answer.
+				*/
+				JASS::query<uint16_t, 100, 100> first_query(primary_keys, 20, 5);
+				JASS::query<uint16_t, 100, 100> second_query(primary_keys, 20, 5);
+				JASS::query<uint16_t, 100, 100> *both[] = {&first_query, &second_query};
+
+				decoder.decode_and_process(1, both, 2, identity, integer_sequence.size(), integer_sequence.data(), sizeof(integer_sequence[0]) * integer_sequence.size());
+				for (auto current : both)
+					{
+					std::ostringstream batched_result;
+					for (const auto &answer : *current)
+						batched_result << answer.document_id << " ";
+					JASS_assert(batched_result.str() == result.str());
+					}
+
 				puts("decoder_d1::PASSED");
 				}
 		};
@@ -195,6 +195,30 @@ namespace JASS
 				case 'q':
 					name = "QMX JASS v1";
 					return compress_integer_all::get_by_name("QMX JASS v1");
+				case 'c':
+					name = "Variable Byte";
+					return compress_integer_all::get_by_name("Variable Byte");
+				case 'V':
+					name = "Stream VByte";
+					return compress_integer_all::get_by_name("Stream VByte");
+				case 'e':
+					name = "Elias-Fano";
+					return compress_integer_all::get_by_name("Elias-Fano");
+				case 'E':
+					name = "Partitioned Elias-Fano";
+					return compress_integer_all::get_by_name("Partitioned Elias-Fano");
+				case 'b':
+					name = "SIMD-BP128";
+					return compress_integer_all::get_by_name("SIMD-BP128");
+				case 'f':
+					name = "PForDelta";
+					return compress_integer_all::get_by_name("PForDelta");
+				case 'F':
+					name = "OptPFor";
+					return compress_integer_all::get_by_name("OptPFor");
+				case 'a':
+					name = "Per-Segment Best";
+					return compress_integer_all::get_by_name("Per-Segment Best");
 				default:
 					exit(printf("Unknown index format\n"));
 					/*
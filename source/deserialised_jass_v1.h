@@ -16,6 +16,7 @@
 
 #include <string>
 #include <vector>
+#include <algorithm>
 
 #include "slice.h"
 #include "query_term.h"
@@ -233,6 +234,19 @@ namespace JASS
 				return reinterpret_cast<const uint8_t *>(&postings_memory[0]);
 				}
 
+			/*
+				DESERIALISED_JASS_V1::POSTINGS_SIZE()
+				-------------------------------------
+			*/
+			/*!
+				@brief Return the size (in bytes) of the postings "file"
+				@return The size of the postings "file"
+			*/
+			size_t postings_size(void) const
+				{
+				return postings_memory.size();
+				}
+
 			/*
 				DESERIALISED_JASS_V1::DOCUMENT_COUNT()
 				--------------------------------------
@@ -267,5 +281,25 @@ namespace JASS
 
 				return false;
 				}
+
+			/*
+				DESERIALISED_JASS_V1::MAXIMUM_IMPACT()
+				--------------------------------------
+			*/
+			/*!
+				@brief Return the largest impact score of any of the segments of a term
+				@details The JASS v1 index does not store this directly, but each segment header holds its impact so it is the largest of those.
+				@param metadata [in] The term (as returned by postings_details())
+				@return The largest impact score the term can contribute to a document
+			*/
+			uint16_t maximum_impact(const metadata &metadata) const
+				{
+				uint16_t largest = 0;
+				const uint64_t *segment = reinterpret_cast<const uint64_t *>(metadata.offset);
+				for (uint64_t which = 0; which < metadata.impacts; which++)
+					largest = (std::max)(largest, reinterpret_cast<const segment_header *>(postings() + segment[which])->impact);
+
+				return largest;
+				}
 		};
 	}
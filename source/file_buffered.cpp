@@ -0,0 +1,256 @@
+/*
+	FILE_BUFFERED.CPP
+	-----------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef WIN32
+	#include <io.h>
+	#include <malloc.h>
+#else
+	#include <unistd.h>
+#endif
+
+#include <new>
+#include <stdexcept>
+
+#include "file.h"
+#include "timer.h"
+#include "asserts.h"
+#include "file_buffered.h"
+
+namespace JASS
+	{
+	std::atomic<uint64_t> file_buffered::total_bytes(0);
+	std::atomic<uint64_t> file_buffered::total_nanoseconds(0);
+
+	/*
+		FILE_BUFFERED::FILE_BUFFERED()
+		------------------------------
+	*/
+	file_buffered::file_buffered(const std::string &filename, size_t buffer_size, bool asynchronous, bool direct) :
+		descriptor(-1),
+		direct(false),
+		asynchronous(asynchronous),
+		buffer_size((buffer_size + alignment - 1) / alignment * alignment),
+		buffer{nullptr, nullptr},
+		current(0),
+		used(0),
+		flushed(0)
+		{
+		if (this->buffer_size == 0)
+			this->buffer_size = alignment;
+
+		/*
+			Open the file, if we're asked for direct I/O and can't have it then fall back to normal I/O.
+		*/
+		#ifdef WIN32
+			descriptor = ::_open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+		#else
+			#ifdef O_DIRECT
+				if (direct)
+					{
+					descriptor = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+					this->direct = descriptor >= 0;
+					}
+			#endif
+			if (descriptor < 0)
+				descriptor = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		#endif
+
+		/*
+			Allocate the buffers aligned so that they can be used for direct I/O.
+		*/
+		for (size_t which = 0; which < (asynchronous ? 2 : 1); which++)
+			{
+			#ifdef WIN32
+				buffer[which] = static_cast<uint8_t *>(::_aligned_malloc(this->buffer_size, alignment));
+			#else
+				void *memory;
+				buffer[which] = ::posix_memalign(&memory, alignment, this->buffer_size) == 0 ? static_cast<uint8_t *>(memory) : nullptr;
+			#endif
+			if (buffer[which] == nullptr)
+				throw std::bad_alloc();			// LCOV_EXCL_LINE	// out of memory
+			}
+		}
+
+	/*
+		FILE_BUFFERED::~FILE_BUFFERED()
+		-------------------------------
+	*/
+	file_buffered::~file_buffered()
+		{
+		/*
+			A destructor cannot throw so a failure to write here is lost (just as it is with fclose()).
+		*/
+		try
+			{
+			flush();
+			}
+		catch (...)
+			{
+			/* Nothing */		// LCOV_EXCL_LINE
+			}
+
+		if (descriptor >= 0)
+			{
+			#ifdef WIN32
+				::_close(descriptor);
+			#else
+				::close(descriptor);
+			#endif
+			}
+
+		for (auto memory : buffer)
+			{
+			#ifdef WIN32
+				::_aligned_free(memory);
+			#else
+				::free(memory);
+			#endif
+			}
+		}
+
+	/*
+		FILE_BUFFERED::WRITE_TO_DISK()
+		------------------------------
+	*/
+	bool file_buffered::write_to_disk(int descriptor, const uint8_t *buffer, size_t bytes)
+		{
+		auto clock = timer::start();
+		size_t total = bytes;
+
+		while (bytes > 0)
+			{
+			/*
+				The OS might not write the whole buffer in one go (and on Windows the length is only 32 bits) so loop until done.
+			*/
+			#ifdef WIN32
+				auto wrote = ::_write(descriptor, buffer, static_cast<unsigned int>((std::min)(bytes, static_cast<size_t>(1) << 30)));
+			#else
+				auto wrote = ::write(descriptor, buffer, bytes);
+			#endif
+			if (wrote <= 0)
+				return false;
+			buffer += wrote;
+			bytes -= wrote;
+			}
+
+		total_bytes += total;
+		total_nanoseconds += timer::stop(clock).nanoseconds();
+		return true;
+		}
+
+	/*
+		FILE_BUFFERED::WAIT()
+		---------------------
+	*/
+	void file_buffered::wait(void)
+		{
+		if (in_flight.valid() && !in_flight.get())
+			throw std::runtime_error("file_buffered::write() failure");
+		}
+
+	/*
+		FILE_BUFFERED::FLUSH_BUFFER()
+		-----------------------------
+	*/
+	void file_buffered::flush_buffer(void)
+		{
+		if (descriptor < 0)
+			throw std::runtime_error("file_buffered::write() to a file that is not open");
+
+		if (asynchronous)
+			{
+			/*
+				Wait for the previous write to finish (so that its buffer is free), then start writing this one and swap buffers.
+			*/
+			wait();
+			in_flight = std::async(std::launch::async, write_to_disk, descriptor, buffer[current], used);
+			current = 1 - current;
+			}
+		else if (!write_to_disk(descriptor, buffer[current], used))
+			throw std::runtime_error("file_buffered::write() failure");
+
+		flushed += used;
+		used = 0;
+		}
+
+	/*
+		FILE_BUFFERED::FLUSH()
+		----------------------
+	*/
+	void file_buffered::flush(void)
+		{
+		if (descriptor < 0)
+			return;
+
+		/*
+			Direct I/O can only write whole blocks, so if we're not at a block boundary then turn it off for the tail of the file.
+		*/
+		#if defined(O_DIRECT) && !defined(WIN32)
+			if (direct && used % alignment != 0)
+				{
+				wait();
+				::fcntl(descriptor, F_SETFL, ::fcntl(descriptor, F_GETFL) & ~O_DIRECT);
+				direct = false;
+				}
+		#endif
+
+		if (used != 0)
+			flush_buffer();
+		wait();
+		}
+
+	/*
+		FILE_BUFFERED::UNITTEST()
+		-------------------------
+	*/
+	void file_buffered::unittest(void)
+		{
+		/*
+			A sequence that crosses buffer boundaries in all sorts of places, and includes writes larger than the buffer.
+		*/
+		std::string expected;
+		for (size_t length = 0; length < 10000; length += 37)
+			expected += std::string(length, static_cast<char>('a' + length % 26));
+
+		auto filename = file::mkstemp("jass");
+
+		for (int asynchronous = 0; asynchronous < 2; asynchronous++)
+			for (int direct = 0; direct < 2; direct++)
+				{
+				uint64_t bytes_before = bytes_written();
+
+					{
+					file_buffered out(filename, alignment, asynchronous != 0, direct != 0);
+					JASS_assert(out.is_open());
+
+					for (size_t from = 0, length = 0; from < expected.size(); from += length, length += 37)
+						{
+						std::string piece = expected.substr(from, length);
+						out.write(piece);
+						JASS_assert(out.tell() == from + piece.size());
+						}
+					}
+
+				/*
+					Check that what was written is what we get back, and that it was counted.
+				*/
+				std::string reread;
+				file::read_entire_file(filename, reread);
+				JASS_assert(reread == expected);
+				JASS_assert(bytes_written() - bytes_before == expected.size());
+				}
+
+		(void)remove(filename.c_str());
+
+		puts("file_buffered::PASSED");
+		}
+	}
@@ -0,0 +1,299 @@
+/*
+	FILE_BUFFERED.H
+	---------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Write-only file that batches writes into large aligned buffers.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <atomic>
+#include <string>
+#include <future>
+#include <algorithm>
+
+namespace JASS
+	{
+	/*
+		CLASS FILE_BUFFERED
+		-------------------
+	*/
+	/*!
+		@brief Write-only file that batches many small writes into a few large ones.
+		@details The serialisers write a few bytes at a time (an impact header field, a document id, a line of C++) and
+		going through a FILE * for each of those is dominated by libc overhead.  This class copies writes into a large
+		aligned buffer and only talks to the operating system when that buffer is full.
+
+		If asynchronous writes are asked for then there are two buffers; one is written to disk (by another thread) while
+		the other is being filled.  If direct I/O is asked for (and the platform supports O_DIRECT) then the operating
+		system's page cache is bypassed, the tail of the file (which is not a whole number of blocks) is written without it.
+
+		Like JASS::file, the file is opened on construction and closed (and flushed) on destruction.  The total number of
+		bytes written (and the time taken) by all objects of this class is kept so that the write rate can be reported.
+	*/
+	class file_buffered
+		{
+		public:
+			static constexpr size_t alignment = 4096;								///< Buffers are aligned to (and flushed in multiples of) this many bytes, as required by O_DIRECT.
+			static constexpr size_t default_buffer_size = 4 * 1024 * 1024;		///< The default size of a buffer.
+
+		private:
+			static std::atomic<uint64_t> total_bytes;			///< The number of bytes written to disk by all file_buffered objects.
+			static std::atomic<uint64_t> total_nanoseconds;	///< The time spent writing to disk by all file_buffered objects.
+
+		private:
+			int descriptor;							///< The operating system's handle to the file.
+			bool direct;								///< True if the file was opened for direct (O_DIRECT) I/O.
+			bool asynchronous;						///< True if a full buffer is written by another thread while the other buffer is filled.
+			size_t buffer_size;						///< The size of each buffer (in bytes).
+			uint8_t *buffer[2];						///< The buffers (the second is only used for asynchronous writes).
+			size_t current;							///< The buffer currently being filled.
+			size_t used;								///< The number of bytes used in the current buffer.
+			uint64_t flushed;							///< The number of bytes already handed to the operating system.
+			std::future<bool> in_flight;			///< The asynchronous write currently in progress (if any).
+
+		private:
+			/*
+				FILE_BUFFERED::WRITE_TO_DISK()
+				------------------------------
+			*/
+			/*!
+				@brief Write the whole of the buffer to the file, keeping track of how long it took.
+				@param descriptor [in] The file to write to.
+				@param buffer [in] The data to write.
+				@param bytes [in] The number of bytes to write.
+				@return true on success, false on failure.
+			*/
+			static bool write_to_disk(int descriptor, const uint8_t *buffer, size_t bytes);
+
+			/*
+				FILE_BUFFERED::WAIT()
+				---------------------
+			*/
+			/*!
+				@brief Wait for the asynchronous write (if any) to complete.
+				@details Throws std::runtime_error if that write failed.
+			*/
+			void wait(void);
+
+			/*
+				FILE_BUFFERED::FLUSH_BUFFER()
+				-----------------------------
+			*/
+			/*!
+				@brief Hand the (full) current buffer to the operating system and start filling the other.
+				@details Throws std::runtime_error on failure.
+			*/
+			void flush_buffer(void);
+
+		public:
+			/*
+				FILE_BUFFERED::FILE_BUFFERED()
+				------------------------------
+			*/
+			/*!
+				@brief Constructor.  Create (or truncate) the given file and open it for writing.
+				@param filename [in] The name of the file.
+				@param buffer_size [in] The size of the buffer, rounded up to a multiple of alignment (default = default_buffer_size).
+				@param asynchronous [in] If true then full buffers are written to disk by another thread (default = false).
+				@param direct [in] If true then use O_DIRECT (if supported) to bypass the page cache (default = false).
+			*/
+			explicit file_buffered(const std::string &filename, size_t buffer_size = default_buffer_size, bool asynchronous = false, bool direct = false);
+
+			/*
+				FILE_BUFFERED::~FILE_BUFFERED()
+				-------------------------------
+			*/
+			/*!
+				@brief Destructor.  Flush and close the file.
+			*/
+			~file_buffered();
+
+			/*
+				FILE_BUFFERED::FILE_BUFFERED()
+				------------------------------
+			*/
+			/*!
+				@brief Copy constructor (deleted as the object owns the file and its buffers).
+			*/
+			file_buffered(const file_buffered &) = delete;
+
+			/*
+				FILE_BUFFERED::OPERATOR=()
+				--------------------------
+			*/
+			/*!
+				@brief Assignment operator (deleted as the object owns the file and its buffers).
+			*/
+			file_buffered &operator=(const file_buffered &) = delete;
+
+			/*
+				FILE_BUFFERED::WRITE()
+				----------------------
+			*/
+			/*!
+				@brief Write bytes number of bytes to the end of the file.
+				@details Throws std::runtime_error if the operating system fails to write the file.
+				@param data [in] the byte sequence to write.
+				@param bytes [in] The number of bytes of data to write.
+				@return The number of bytes of data that were written to the file.
+			*/
+			size_t write(const void *data, size_t bytes)
+				{
+				/*
+					The common case is that it fits in the buffer.
+				*/
+				if (used + bytes <= buffer_size)
+					{
+					memcpy(buffer[current] + used, data, bytes);
+					used += bytes;
+					return bytes;
+					}
+
+				/*
+					It doesn't fit so fill the buffer, flush, and repeat.
+				*/
+				const uint8_t *from = static_cast<const uint8_t *>(data);
+				size_t remaining = bytes;
+				while (remaining > 0)
+					{
+					size_t chunk = (std::min)(remaining, buffer_size - used);
+					memcpy(buffer[current] + used, from, chunk);
+					used += chunk;
+					from += chunk;
+					remaining -= chunk;
+					if (used == buffer_size)
+						flush_buffer();
+					}
+
+				return bytes;
+				}
+
+			/*
+				FILE_BUFFERED::WRITE()
+				----------------------
+			*/
+			/*!
+				@brief Write the string to the end of the file.
+				@param data [in] the string to write.
+				@return The number of bytes of data that were written to the file.
+			*/
+			size_t write(const std::string &data)
+				{
+				return write(data.c_str(), data.size());
+				}
+
+			/*
+				FILE_BUFFERED::TELL()
+				---------------------
+			*/
+			/*!
+				@brief Return the byte offset of the end of the file (including data still in the buffer).
+				@return byte offset.
+			*/
+			size_t tell(void) const
+				{
+				return flushed + used;
+				}
+
+			/*
+				FILE_BUFFERED::IS_OPEN()
+				------------------------
+			*/
+			/*!
+				@brief Check whether or not the file was successfully opened.
+				@return true if the file is open, else false.
+			*/
+			bool is_open(void) const
+				{
+				return descriptor >= 0;
+				}
+
+			/*
+				FILE_BUFFERED::IS_DIRECT()
+				--------------------------
+			*/
+			/*!
+				@brief Check whether or not the file was opened for direct (O_DIRECT) I/O.
+				@details Direct I/O might not be available even when asked for, either because the platform does not support
+				it or because the file system does not.
+				@return true if the page cache is being bypassed, else false.
+			*/
+			bool is_direct(void) const
+				{
+				return direct;
+				}
+
+			/*
+				FILE_BUFFERED::FLUSH()
+				----------------------
+			*/
+			/*!
+				@brief Write everything in the buffers to disk.
+				@details If the file was opened for direct I/O and the file is not a whole number of blocks long then direct I/O
+				is turned off for this file, so call this method once all writing is done (the destructor does so).  Throws
+				std::runtime_error on failure.
+			*/
+			void flush(void);
+
+			/*
+				FILE_BUFFERED::BYTES_WRITTEN()
+				------------------------------
+			*/
+			/*!
+				@brief Return the number of bytes written to disk by all file_buffered objects.
+				@return The number of bytes.
+			*/
+			static uint64_t bytes_written(void)
+				{
+				return total_bytes;
+				}
+
+			/*
+				FILE_BUFFERED::NANOSECONDS_WRITING()
+				------------------------------------
+			*/
+			/*!
+				@brief Return the time spent writing to disk by all file_buffered objects.
+				@details When several files are written at once (or asynchronously) these times overlap, so this is the
+				sum of the time spent in each write and not the wall-clock time.
+				@return The time in nanoseconds.
+			*/
+			static uint64_t nanoseconds_writing(void)
+				{
+				return total_nanoseconds;
+				}
+
+			/*
+				FILE_BUFFERED::BYTES_PER_SECOND()
+				---------------------------------
+			*/
+			/*!
+				@brief Return the write rate of all file_buffered objects (bytes_written() / nanoseconds_writing()).
+				@return The number of bytes written per second spent writing.
+			*/
+			static double bytes_per_second(void)
+				{
+				uint64_t nanoseconds = total_nanoseconds;
+				return nanoseconds == 0 ? 0 : static_cast<double>(total_bytes) * 1'000'000'000.0 / nanoseconds;
+				}
+
+			/*
+				FILE_BUFFERED::UNITTEST()
+				-------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
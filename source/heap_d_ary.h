@@ -0,0 +1,400 @@
+/*
+	HEAP_D_ARY.H
+	------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief An iterative d-ary min-heap with a position index, a drop-in replacement for heap.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <functional>
+
+#include "asserts.h"
+#include "forceinline.h"
+
+namespace JASS
+	{
+	/*
+		CLASS HEAP_D_ARY
+		----------------
+	*/
+	/*!
+		@brief A min-heap over an array passed by the caller, with the same interface as heap.
+		@details Each node has ARITY children rather than two, so the heap is shallower and the children of a node are next to each other
+		in memory (4 pointers is half a cache line).  Sifting is iterative and the smallest child is chosen with conditional selects rather than branches.
+		promote() finds the element through a position index (an open-addressed hash table from element to position) rather than searching the heap.
+		The index is only built the first time promote() is called after make_heap(), so callers that only use make_heap() and push_back()
+		never pay to maintain it.  The elements in the heap must be distinct.
+		@tparam TYPE The type to build the heap over (normally a pointer type).
+		@tparam COMPARE Function returning -ve on smaller, 0 on same, or +ve on larger.
+		@tparam ARITY The number of children of each node (default 4).
+	*/
+	template <typename TYPE, typename COMPARE, size_t ARITY = 4>
+	class heap_d_ary
+		{
+		static_assert(ARITY >= 2, "A heap must have at least two children per node");
+
+		private:
+			/*
+				CLASS HEAP_D_ARY::SLOT
+				----------------------
+			*/
+			/*!
+				@brief An entry in the position index.
+			*/
+			class slot
+				{
+				public:
+					TYPE key;						///< The element
+					uint32_t position;			///< Where it is in the heap (or EMPTY)
+				};
+
+			static constexpr uint32_t EMPTY = (std::numeric_limits<uint32_t>::max)();			///< Marker for an unused slot in the position index
+
+		private:
+			TYPE *array;						///< The array to build the heap over
+			size_t size;						///< The maximum size of of the heap
+			COMPARE compare;					///< The comparison functor
+
+			std::vector<slot> index;		///< The position index (a hash table from element to position in the heap)
+			size_t index_shift;				///< The hash is the top (64 - index_shift) bits of the product of the key and a constant
+			size_t index_mask;				///< index.size() - 1
+			bool index_valid;					///< Is the position index correct?
+
+		private:
+			/*
+				HEAP_D_ARY::HASH()
+				------------------
+			*/
+			/*!
+				@brief Return the slot in the position index to start looking for key.
+				@param key [in] The element to look for.
+				@return The slot.
+			*/
+			forceinline size_t hash(TYPE key) const
+				{
+				return (static_cast<uint64_t>(std::hash<TYPE>()(key)) * 0x9E3779B97F4A7C15ULL) >> index_shift;
+				}
+
+			/*
+				HEAP_D_ARY::FIND()
+				------------------
+			*/
+			/*!
+				@brief Return the slot in the position index holding key, which must be there.
+				@param key [in] The element to look for.
+				@return The slot.
+			*/
+			forceinline slot &find(TYPE key)
+				{
+				size_t where = hash(key);
+				while (index[where].position == EMPTY || index[where].key != key)
+					where = (where + 1) & index_mask;
+
+				return index[where];
+				}
+
+			/*
+				HEAP_D_ARY::INSERT()
+				--------------------
+			*/
+			/*!
+				@brief Add key to the position index.
+				@param key [in] The element.
+				@param position [in] Where it is in the heap.
+			*/
+			forceinline void insert(TYPE key, size_t position)
+				{
+				size_t where = hash(key);
+				while (index[where].position != EMPTY)
+					where = (where + 1) & index_mask;
+
+				index[where].key = key;
+				index[where].position = static_cast<uint32_t>(position);
+				}
+
+			/*
+				HEAP_D_ARY::ERASE()
+				-------------------
+			*/
+			/*!
+				@brief Remove key (which must be there) from the position index.
+				@details This uses backward-shift deletion so that no tombstones are needed.
+				@param key [in] The element.
+			*/
+			void erase(TYPE key)
+				{
+				size_t hole = &find(key) - &index[0];
+				size_t where = hole;
+				while (1)
+					{
+					where = (where + 1) & index_mask;
+					if (index[where].position == EMPTY)
+						break;
+
+					/*
+						An entry can move back into the hole only if its home slot is not in the (cyclic) range (hole, where]
+					*/
+					size_t home = hash(index[where].key);
+					if (((where - home) & index_mask) >= ((where - hole) & index_mask))
+						{
+						index[hole] = index[where];
+						hole = where;
+						}
+					}
+				index[hole].position = EMPTY;
+				}
+
+			/*
+				HEAP_D_ARY::BUILD_INDEX()
+				-------------------------
+			*/
+			/*!
+				@brief Build the position index from the heap.
+			*/
+			void build_index(void)
+				{
+				for (auto &entry : index)
+					entry.position = EMPTY;
+				for (size_t position = 0; position < size; position++)
+					insert(array[position], position);
+				index_valid = true;
+				}
+
+			/*
+				HEAP_D_ARY::SMALLEST_CHILD()
+				----------------------------
+			*/
+			/*!
+				@brief Return the position of the smallest child of the node at position (which must have at least one child).
+				@param first [in] The position of the first child.
+				@return The position of the smallest child.
+			*/
+			forceinline size_t smallest_child(size_t first) const
+				{
+				size_t smallest = first;
+				if (first + ARITY <= size)
+					{
+					/*
+						The usual case is a full set of children, so the loop has a fixed trip count and is unrolled into a set of selects.
+					*/
+					for (size_t child = first + 1; child < first + ARITY; child++)
+						smallest = compare(array[child], array[smallest]) < 0 ? child : smallest;
+					}
+				else
+					for (size_t child = first + 1; child < size; child++)
+						smallest = compare(array[child], array[smallest]) < 0 ? child : smallest;
+
+				return smallest;
+				}
+
+			/*
+				HEAP_D_ARY::SIFT_DOWN()
+				-----------------------
+			*/
+			/*!
+				@brief Place key at position then move it towards the leaves until the heap property holds.
+				@param key [in] The element to place.
+				@param position [in] Where to start.
+				@param maintain_index [in] Keep the position index up to date.
+				@return The final position of the key.
+			*/
+			forceinline size_t sift_down(TYPE key, size_t position, bool maintain_index)
+				{
+				size_t first;
+				while ((first = position * ARITY + 1) < size)
+					{
+					size_t smallest = smallest_child(first);
+					if (compare(array[smallest], key) >= 0)
+						break;
+
+					array[position] = array[smallest];
+					if (maintain_index)
+						find(array[position]).position = static_cast<uint32_t>(position);
+					position = smallest;
+					}
+
+				array[position] = key;
+				return position;
+				}
+
+		public:
+			/*
+				HEAP_D_ARY::HEAP_D_ARY()
+				------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param array [in] The array to maintain the heap over
+				@param size [in] The maximum number of elements in te array (the size of the heap)
+				@param compare [in] The comparison functor
+			*/
+			heap_d_ary(TYPE &array, size_t size, const COMPARE &compare = COMPARE()) :
+				array(&array),
+				size(size),
+				compare(compare),
+				index_valid(false)
+				{
+				/*
+					The position index is a power of 2 at least twice the size of the heap so that the probe sequences are short.
+				*/
+				size_t bits = 1;
+				while (((size_t)1 << bits) < size * 2)
+					bits++;
+				index.resize((size_t)1 << bits);
+				index_shift = 64 - bits;
+				index_mask = index.size() - 1;
+				}
+
+			/*
+				HEAP_D_ARY::MAKE_HEAP()
+				-----------------------
+			*/
+			/*!
+				@brief build the heap
+			*/
+			forceinline void make_heap(void)
+				{
+				if (size > 1)
+					for (size_t position = (size - 2) / ARITY + 1; position-- > 0;)
+						sift_down(array[position], position, false);
+
+				index_valid = false;
+				}
+
+			/*
+				HEAP_D_ARY::PUSH_BACK()
+				-----------------------
+			*/
+			/*!
+				@brief Add and element to the heap (replacing the smallest).
+				@param key [in] The element to add to the heap
+				@details This method does not check to see if the element is already in the heap or that
+				the element should be in the heap (i.e. > smallest).
+			*/
+			forceinline void push_back(TYPE key)
+				{
+				if (index_valid)
+					{
+					erase(array[0]);
+					insert(key, sift_down(key, 0, true));
+					}
+				else
+					sift_down(key, 0, false);
+				}
+
+			/*
+				HEAP_D_ARY::PROMOTE()
+				---------------------
+			*/
+			/*!
+				@brief Key has changed its value (it got larger) so move it to its new place in the heap.
+				@param key [in] The element that has changed
+			*/
+			forceinline void promote(TYPE key)
+				{
+				if (!index_valid)
+					build_index();
+
+				slot &entry = find(key);
+				size_t from = entry.position;
+				entry.position = static_cast<uint32_t>(sift_down(key, from, true));
+				}
+
+			/*
+				HEAP_D_ARY::UNITTEST()
+				----------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				/*
+					A heap of pointers to integers (as the query uses), compared on value then on address
+				*/
+				class compare_pointers
+					{
+					public:
+						int operator()(int *a, int *b) const
+							{
+							return *a < *b ? -1 : *a > *b ? 1 : a < b ? -1 : a == b ? 0 : 1;
+							}
+					};
+
+				std::mt19937 random(1);
+				for (size_t k : {1, 2, 3, 4, 5, 16, 17, 100})
+					{
+					std::vector<int> values(k * 4);
+					std::vector<int *> array(k);
+
+					/*
+						Fill the top-k with the first k, then add or promote at random, checking against a sort every time.
+					*/
+					for (size_t which = 0; which < k; which++)
+						{
+						values[which] = 1 + random() % 8;
+						array[which] = &values[which];
+						}
+
+					heap_d_ary<int *, compare_pointers> heap(array[0], k);
+					heap.make_heap();
+
+					std::vector<bool> in_heap(values.size(), false);
+					for (size_t which = 0; which < k; which++)
+						in_heap[which] = true;
+
+					for (size_t step = 0; step < 2000; step++)
+						{
+						size_t which = random() % values.size();
+						int *pointer = &values[which];
+						values[which] += 1 + random() % 3;
+						if (in_heap[which])
+							heap.promote(pointer);
+						else if (compare_pointers()(pointer, array[0]) > 0)
+							{
+							in_heap[array[0] - &values[0]] = false;
+							in_heap[which] = true;
+							heap.push_back(pointer);
+							}
+						else if (step % 100 == 0)
+							heap.make_heap();				// make sure push_back() and promote() work after a rebuild
+
+						/*
+							The front must be the smallest and every node must be no larger than its children
+						*/
+						for (size_t node = 1; node < k; node++)
+							JASS_assert(compare_pointers()(array[(node - 1) / 4], array[node]) <= 0);
+
+						/*
+							The heap must be the k largest
+						*/
+						std::vector<int *> all;
+						for (auto &value : values)
+							all.push_back(&value);
+						std::sort(all.begin(), all.end(), [](int *a, int *b){ return compare_pointers()(a, b) > 0; });
+						std::vector<int *> expected(all.begin(), all.begin() + k);
+						std::vector<int *> got(array);
+						std::sort(expected.begin(), expected.end());
+						std::sort(got.begin(), got.end());
+						JASS_assert(expected == got);
+						}
+					}
+
+				puts("heap_d_ary::PASSED");
+				}
+		};
+	}
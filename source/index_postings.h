@@ -16,6 +16,7 @@
 #include <tuple>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 
 #include "dynamic_array.h"
 #include "allocator_pool.h"
@@ -428,12 +429,15 @@ namespace JASS
 				an impact ordered postings list ordered \<i\>\<d\>...\<d\>\<0\>\<i\>\<d\>...\<d\>\<0\> with \<i\> being in decreasing order and \<d\>
 				begin in increasing order for each chunk.  It also generates a set of headers that poing to each \<d\>..\<d\> range,
 				excluding \<i\> and excluding \<0\>.
+				The frequency table (256KB) is taken from the arena rather than the stack so that this method is safe to call from
+				threads with small stacks (as happens when serialising in parallel).
 				@param memory [in] All allocation to do with this process, including the result, is allocated in this arena.
 				@result A reference to the impact ordered posting list allocated in the arena passed as paramter memory.
 			*/
 			index_postings_impact &impact_order(allocator &memory) const
 				{
-				std::array<uint32_t, 0x10000> frequencies = {};
+				uint32_t *frequencies = static_cast<uint32_t *>(memory.malloc(0x10000 * sizeof(*frequencies)));
+				std::fill(frequencies, frequencies + 0x10000, 0);
 				size_t number_of_postings = 0;
 				size_t highest_impact = 0;
 				size_t lowest_impact = std::numeric_limits<size_t>::max();
@@ -0,0 +1,346 @@
+/*
+	NUMA.H
+	------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Discover the NUMA topology of the machine, pin threads to CPUs, and place memory on a NUMA node.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+#ifdef __linux__
+	#include <sched.h>
+	#include <pthread.h>
+#endif
+
+#include "asserts.h"
+
+namespace JASS
+	{
+	/*
+		CLASS NUMA
+		----------
+	*/
+	/*!
+		@brief Discover the NUMA topology of the machine, pin threads to CPUs, and place memory on a NUMA node.
+		@details On Linux the topology is read from /sys/devices/system/node, restricted to the CPUs in the process's affinity mask (so that
+		taskset and container cpusets are honoured), and threads are pinned with pthread_setaffinity_np().  Memory
+		is placed using the operating system's first-touch policy (a page is allocated on the node of the CPU that first writes to it), so
+		there is no dependency on libnuma.  On other operating systems (or if /sys is not available) the machine is treated as a single
+		node holding every CPU, and pinning does nothing.
+	*/
+	class numa
+		{
+		private:
+			/*
+				NUMA::READ_LINE()
+				-----------------
+			*/
+			/*!
+				@brief Return the first line of a (small) file.
+				@details The files in /sys report a size of 4096 bytes regardless of their content so they're read as a stream, not with file::read_entire_file().
+				@param filename [in] The name of the file.
+				@return The first line, or an empty string if the file cannot be read.
+			*/
+			static std::string read_line(const std::string &filename)
+				{
+				std::string line;
+				std::ifstream file(filename);
+				if (file)
+					std::getline(file, line);
+				return line;
+				}
+
+			/*
+				NUMA::DETECT()
+				--------------
+			*/
+			/*!
+				@brief Ask the operating system which CPUs are on which NUMA node.
+				@return A list, one per node, of the CPUs on that node (never empty).
+			*/
+			static std::vector<std::vector<size_t>> detect(void)
+				{
+				std::vector<std::vector<size_t>> topology;
+
+				#ifdef __linux__
+					/*
+						Only the CPUs the process may run on (as restricted by taskset or a cgroup cpuset) can be pinned to.
+					*/
+					std::vector<size_t> allowed = allowed_cpus();
+					for (size_t node : parse_list(read_line("/sys/devices/system/node/online")))
+						{
+						std::vector<size_t> cpus;
+						for (size_t cpu : parse_list(read_line("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist")))
+							if (allowed.size() == 0 || std::find(allowed.begin(), allowed.end(), cpu) != allowed.end())
+								cpus.push_back(cpu);
+						if (cpus.size() != 0)
+							topology.push_back(cpus);				// nodes without (allowed) CPUs can't run threads so are ignored
+						}
+
+					if (topology.size() == 0 && allowed.size() != 0)
+						topology.push_back(allowed);
+				#endif
+
+				if (topology.size() == 0)
+					{
+					topology.resize(1);
+					size_t cpus = (std::max)(std::thread::hardware_concurrency(), 1U);
+					for (size_t cpu = 0; cpu < cpus; cpu++)
+						topology[0].push_back(cpu);
+					}
+
+				return topology;
+				}
+
+			/*
+				NUMA::TOPOLOGY()
+				----------------
+			*/
+			/*!
+				@brief Return the NUMA topology (which is found the first time it is asked for).
+				@return A list, one per node, of the CPUs on that node.
+			*/
+			static const std::vector<std::vector<size_t>> &topology(void)
+				{
+				static const std::vector<std::vector<size_t>> nodes = detect();
+				return nodes;
+				}
+
+		public:
+			/*
+				NUMA::ALLOWED_CPUS()
+				--------------------
+			*/
+			/*!
+				@brief Return the CPUs this process is allowed to run on (its affinity mask, which taskset and cgroup cpusets restrict).
+				@return The CPUs in increasing order, or an empty list if they cannot be found.
+			*/
+			static std::vector<size_t> allowed_cpus(void)
+				{
+				std::vector<size_t> answer;
+
+				#ifdef __linux__
+					cpu_set_t set;
+					CPU_ZERO(&set);
+					if (sched_getaffinity(0, sizeof(set), &set) == 0)
+						for (size_t cpu = 0; cpu < CPU_SETSIZE; cpu++)
+							if (CPU_ISSET(cpu, &set))
+								answer.push_back(cpu);
+				#endif
+
+				return answer;
+				}
+
+			/*
+				NUMA::PARSE_LIST()
+				------------------
+			*/
+			/*!
+				@brief Turn a Linux CPU or node list (such as "0-3,8,10-11") into a list of numbers.
+				@param list [in] The list.
+				@return The numbers in the list (in the order they are listed).
+			*/
+			static std::vector<size_t> parse_list(const std::string &list)
+				{
+				std::vector<size_t> answer;
+				const char *current = list.c_str();
+
+				while (*current != '\0')
+					{
+					char *end;
+					size_t from = strtoul(current, &end, 10);
+					if (end == current)
+						break;
+					size_t to = from;
+					current = end;
+					if (*current == '-')
+						{
+						to = strtoul(current + 1, &end, 10);
+						current = end;
+						}
+					for (size_t which = from; which <= to; which++)
+						answer.push_back(which);
+
+					if (*current == ',')
+						current++;
+					}
+
+				return answer;
+				}
+
+			/*
+				NUMA::NODES()
+				-------------
+			*/
+			/*!
+				@brief Return the number of NUMA nodes (that have CPUs).
+				@return The number of nodes (at least 1).
+			*/
+			static size_t nodes(void)
+				{
+				return topology().size();
+				}
+
+			/*
+				NUMA::NODE_FOR_THREAD()
+				-----------------------
+			*/
+			/*!
+				@brief Return the node that a worker thread should run on.
+				@details Threads are dealt across the nodes in turn so that at any thread count the load (and the memory traffic) is spread evenly.
+				@param thread [in] The worker thread number (from 0).
+				@return The node (from 0 to nodes() - 1).
+			*/
+			static size_t node_for_thread(size_t thread)
+				{
+				return thread % nodes();
+				}
+
+			/*
+				NUMA::CPU_FOR_THREAD()
+				----------------------
+			*/
+			/*!
+				@brief Return the CPU that a worker thread should be pinned to.
+				@details This is on node_for_thread(thread).  If there are more threads than CPUs on a node then CPUs are shared.
+				@param thread [in] The worker thread number (from 0).
+				@return The CPU number (as the operating system numbers them).
+			*/
+			static size_t cpu_for_thread(size_t thread)
+				{
+				const auto &cpus = topology()[node_for_thread(thread)];
+				return cpus[(thread / nodes()) % cpus.size()];
+				}
+
+			/*
+				NUMA::PIN()
+				-----------
+			*/
+			/*!
+				@brief Pin the calling thread to the given CPU.
+				@details Memory the thread touches for the first time after this is then allocated on the CPU's node.
+				@param cpu [in] The CPU to run on.
+				@return true on success, false if the thread could not be pinned (or pinning is not supported).
+			*/
+			static bool pin(size_t cpu)
+				{
+				#ifdef __linux__
+					cpu_set_t set;
+					CPU_ZERO(&set);
+					CPU_SET(cpu, &set);
+					return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+				#else
+					return false;
+				#endif
+				}
+
+			/*
+				NUMA::REPLICATE()
+				-----------------
+			*/
+			/*!
+				@brief Make a copy of a block of memory on the given node.
+				@details The copy is allocated and written by a thread pinned to a CPU on the node, so (with first-touch placement) the pages are local to it.
+				If the thread can't be pinned then no copy is made, as it would be on whatever node the thread happened to run on.
+				@param source [in] The memory to copy.
+				@param bytes [in] The number of bytes to copy.
+				@param node [in] The node to put the copy on.
+				@return The copy, or nullptr if it could not be put on the node (in which case the caller should use the source).
+			*/
+			static std::unique_ptr<uint8_t[]> replicate(const void *source, size_t bytes, size_t node)
+				{
+				std::unique_ptr<uint8_t[]> copy;
+
+				std::thread worker([&copy, source, bytes, node]()
+					{
+					if (!pin(topology()[node][0]))
+						return;
+					copy.reset(new uint8_t[bytes]);
+					::memcpy(copy.get(), source, bytes);
+					});
+				worker.join();
+
+				return copy;
+				}
+
+			/*
+				NUMA::UNITTEST()
+				----------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				/*
+					Check the parser on the formats Linux uses
+				*/
+				JASS_assert(parse_list("") == std::vector<size_t>());
+				JASS_assert(parse_list("0") == std::vector<size_t>({0}));
+				JASS_assert(parse_list("0-3") == std::vector<size_t>({0, 1, 2, 3}));
+				JASS_assert(parse_list("0-1,8,10-11\n") == std::vector<size_t>({0, 1, 8, 10, 11}));
+
+				/*
+					There's always at least one node with at least one CPU, and threads are dealt across the nodes
+				*/
+				JASS_assert(nodes() >= 1);
+				for (size_t thread = 0; thread < nodes() * 3; thread++)
+					{
+					JASS_assert(node_for_thread(thread) == thread % nodes());
+					const auto &cpus = topology()[node_for_thread(thread)];
+					JASS_assert(std::find(cpus.begin(), cpus.end(), cpu_for_thread(thread)) != cpus.end());
+					}
+
+				/*
+					Every CPU a thread is given is one the process is allowed to run on
+				*/
+				auto allowed = allowed_cpus();
+				if (allowed.size() != 0)
+					for (const auto &cpus : topology())
+						for (size_t cpu : cpus)
+							JASS_assert(std::find(allowed.begin(), allowed.end(), cpu) != allowed.end());
+
+				/*
+					A replica is a copy (if one can be made, which on Linux it can as the node's CPUs are all allowed)
+				*/
+				const char message[] = "replicate me";
+				auto copy = replicate(message, sizeof(message), nodes() - 1);
+				#ifdef __linux__
+					JASS_assert(copy != nullptr);
+				#endif
+				JASS_assert(copy == nullptr || ::memcmp(copy.get(), message, sizeof(message)) == 0);
+
+				/*
+					On Linux we can pin a thread to a CPU it is allowed to run on (and it's then running there)
+				*/
+				#ifdef __linux__
+					std::thread worker([]()
+						{
+						size_t cpu = sched_getcpu();
+						JASS_assert(pin(cpu));
+						JASS_assert(static_cast<size_t>(sched_getcpu()) == cpu);
+						});
+					worker.join();
+				#endif
+
+				puts("numa::PASSED");
+				}
+		};
+	}
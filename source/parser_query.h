@@ -101,13 +101,28 @@ namespace JASS
 			template <typename STRING_TYPE>
 			void parse(query_term_list &parsed_query, const STRING_TYPE &query)
 				{
-				current = (uint8_t *)(const_cast<char *>(query.c_str()));							// get a pointer to the start of the query string
-				end_of_query = current + query.size();			// get a pointer to the end of the query string
+				parse(parsed_query, query.c_str(), query.size());
+				}
+
+			/*
+				PARSER_QUERY::PARSE()
+				---------------------
+			*/
+			/*!
+				@brief parse and return the list of query tokens.
+				@param parsed_query [out] The parsed query once parsed.
+				@param query [in] The query to be parsed.
+				@param length [in] The length of the query (in bytes).
+			*/
+			void parse(query_term_list &parsed_query, const char *query, size_t length)
+				{
+				current = (uint8_t *)(const_cast<char *>(query));							// get a pointer to the start of the query string
+				end_of_query = current + length;			// get a pointer to the end of the query string
 
 				/*
 					Allocate space for the normalised query terms
 				*/
-				size_t worse_case_normalised_query_length = unicode::max_casefold_expansion_factor * unicode::max_utf8_bytes * query.size();		// might be as much as (18 * 4) times the size iof the input string (worst case0
+				size_t worse_case_normalised_query_length = unicode::max_casefold_expansion_factor * unicode::max_utf8_bytes * length;		// might be as much as (18 * 4) times the size iof the input string (worst case0
 				buffer_pos = (uint8_t *)memory.malloc(worse_case_normalised_query_length);
 				if (buffer_pos == nullptr)
 					return;				// LCOV_EXCL_LINE			// At time of writing this can't happen because either malloc will assert or delatyed allocation will not return nullptr!
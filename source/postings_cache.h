@@ -0,0 +1,296 @@
+/*
+	POSTINGS_CACHE.H
+	----------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief A bounded cache of decoded impact segments (document id lists) shared by all the search threads.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include "asserts.h"
+#include "forceinline.h"
+
+namespace JASS
+	{
+	/*
+		CLASS POSTINGS_CACHE
+		--------------------
+	*/
+	/*!
+		@brief A bounded cache of decoded (and D1 reconstructed) impact segments, keyed on where the segment is in the postings.
+		@details Frequent terms recur in many queries and each time their segments would be decoded again.  The cache holds the
+		document ids of the hottest segments so that they can be passed straight to query::add_rsv_block().  It is filled (by a single thread)
+		before the search starts and is then only read, so the threads share it without locks.  Segments are found through an open-addressed
+		hash table from segment offset (which is never 0) to the document ids, all of which are stored in one array.  The size limit includes
+		the hash table, and is on the memory allocated (the capacity of the array of document ids, not just the part of it in use).
+	*/
+	class postings_cache
+		{
+		private:
+			/*
+				CLASS POSTINGS_CACHE::SLOT
+				--------------------------
+			*/
+			/*!
+				@brief An entry in the hash table.
+			*/
+			class slot
+				{
+				public:
+					uint64_t segment;					///< The offset of the segment in the postings (or 0 if the slot is empty)
+					uint32_t start;					///< Where in store the document ids start
+					uint32_t documents;				///< The number of document ids
+				};
+
+		private:
+			size_t maximum_bytes;					///< The most memory the cache can use
+			std::vector<uint32_t> store;			///< The document ids of all the cached segments
+			std::vector<slot> table;				///< The hash table
+			size_t table_shift;						///< The hash is the top (64 - table_shift) bits of the product of the key and a constant
+			size_t table_mask;						///< table.size() - 1
+			size_t entries;							///< The number of segments in the cache
+
+		private:
+			/*
+				POSTINGS_CACHE::HASH()
+				----------------------
+			*/
+			/*!
+				@brief Return the slot in the hash table to start looking for segment.
+				@param segment [in] The segment offset.
+				@return The slot.
+			*/
+			forceinline size_t hash(uint64_t segment) const
+				{
+				return (segment * 0x9E3779B97F4A7C15ULL) >> table_shift;
+				}
+
+			/*
+				POSTINGS_CACHE::RESIZE()
+				------------------------
+			*/
+			/*!
+				@brief Set the hash table to the given power of 2 number of slots and re-insert every segment.
+				@param bits [in] log2 of the number of slots.
+			*/
+			void resize(size_t bits)
+				{
+				std::vector<slot> old(size_t(1) << bits, slot{0, 0, 0});
+				old.swap(table);
+				table_shift = 64 - bits;
+				table_mask = table.size() - 1;
+
+				for (const auto &entry : old)
+					if (entry.segment != 0)
+						{
+						size_t where = hash(entry.segment);
+						while (table[where].segment != 0)
+							where = (where + 1) & table_mask;
+						table[where] = entry;
+						}
+				}
+
+			/*
+				POSTINGS_CACHE::SET_CAPACITY()
+				------------------------------
+			*/
+			/*!
+				@brief Move the document ids into an array of exactly the given capacity.
+				@details std::vector grows geometrically, which could take the capacity of store well past maximum_bytes, so store is only ever grown (or shrunk) with this.
+				@param capacity [in] The capacity (which must be at least store.size()).
+			*/
+			void set_capacity(size_t capacity)
+				{
+				std::vector<uint32_t> replacement;
+				replacement.reserve(capacity);
+				replacement.insert(replacement.end(), store.begin(), store.end());
+				replacement.swap(store);
+				}
+
+		public:
+			/*
+				POSTINGS_CACHE::POSTINGS_CACHE()
+				--------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param maximum_bytes [in] The most memory the cache can use (document ids and hash table).
+			*/
+			explicit postings_cache(size_t maximum_bytes) :
+				maximum_bytes(maximum_bytes),
+				entries(0)
+				{
+				resize(4);
+				}
+
+			/*
+				POSTINGS_CACHE::SIZE()
+				----------------------
+			*/
+			/*!
+				@brief Return the number of segments in the cache.
+				@return The number of segments.
+			*/
+			size_t size(void) const
+				{
+				return entries;
+				}
+
+			/*
+				POSTINGS_CACHE::BYTES()
+				-----------------------
+			*/
+			/*!
+				@brief Return the amount of memory the cache is using.
+				@return The number of bytes allocated for the document ids and the hash table.
+			*/
+			size_t bytes(void) const
+				{
+				return store.capacity() * sizeof(store[0]) + table.size() * sizeof(table[0]);
+				}
+
+			/*
+				POSTINGS_CACHE::INSERT()
+				------------------------
+			*/
+			/*!
+				@brief Add a decoded segment to the cache.
+				@details The hash table is kept at most half full.  Adding the same segment twice does nothing.  This must not be called while
+				other threads are calling find().
+				@param segment [in] The offset of the segment in the postings (not 0).
+				@param document_ids [in] The decoded document ids.
+				@param documents [in] The number of document ids.
+				@return true if the segment is in the cache, false if it did not fit.
+			*/
+			bool insert(uint64_t segment, const uint32_t *document_ids, size_t documents)
+				{
+				if (find(segment) != nullptr)
+					return true;
+
+				size_t bits = 64 - table_shift;
+				bool grow = (entries + 1) * 2 > table.size();
+				size_t table_bytes = (table.size() << (grow ? 1 : 0)) * sizeof(slot);
+				if ((store.size() + documents) * sizeof(store[0]) + table_bytes > maximum_bytes || store.size() + documents > (std::numeric_limits<uint32_t>::max)())
+					return false;
+
+				if (grow)
+					resize(bits + 1);
+
+				/*
+					Double the capacity of the document ids (as std::vector would) but never past what the limit leaves after the hash table.  If the
+					hash table just grew the capacity might need to shrink.
+				*/
+				size_t needed = store.size() + documents;
+				size_t limit = (maximum_bytes - table_bytes) / sizeof(store[0]);
+				if (needed > store.capacity() || store.capacity() > limit)
+					set_capacity((std::min)((std::max)(needed, store.capacity() * 2), limit));
+
+				size_t where = hash(segment);
+				while (table[where].segment != 0)
+					where = (where + 1) & table_mask;
+				table[where] = slot{segment, static_cast<uint32_t>(store.size()), static_cast<uint32_t>(documents)};
+				store.insert(store.end(), document_ids, document_ids + documents);
+				entries++;
+
+				return true;
+				}
+
+			/*
+				POSTINGS_CACHE::FIND()
+				----------------------
+			*/
+			/*!
+				@brief Return the decoded document ids of a segment.
+				@param segment [in] The offset of the segment in the postings.
+				@return The document ids (there are as many as the segment frequency), or nullptr if the segment is not in the cache.
+			*/
+			forceinline const uint32_t *find(uint64_t segment) const
+				{
+				size_t where = hash(segment);
+				while (table[where].segment != 0)
+					{
+					if (table[where].segment == segment)
+						return store.data() + table[where].start;
+					where = (where + 1) & table_mask;
+					}
+
+				return nullptr;
+				}
+
+			/*
+				POSTINGS_CACHE::UNITTEST()
+				--------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				std::vector<uint32_t> ids(100);
+				for (size_t which = 0; which < ids.size(); which++)
+					ids[which] = static_cast<uint32_t>(which * 3);
+
+				/*
+					Segments that fit are found with their document ids, those that aren't there aren't found
+				*/
+				postings_cache cache(1024 * 1024);
+				for (uint64_t segment = 1; segment <= 100; segment++)
+					JASS_assert(cache.insert(segment * 8, ids.data(), segment));
+				JASS_assert(cache.size() == 100);
+				for (uint64_t segment = 1; segment <= 100; segment++)
+					{
+					const uint32_t *got = cache.find(segment * 8);
+					JASS_assert(got != nullptr);
+					JASS_assert(std::equal(got, got + segment, ids.begin()));
+					JASS_assert(cache.find(segment * 8 + 1) == nullptr);
+					}
+
+				/*
+					Adding a segment again does nothing
+				*/
+				JASS_assert(cache.insert(8, ids.data() + 1, 1));
+				JASS_assert(*cache.find(8) == 0);
+				JASS_assert(cache.size() == 100);
+
+				/*
+					The cache never grows beyond its limit, and a segment that does not fit does not stop a smaller one being added
+				*/
+				postings_cache small(sizeof(slot) * 16 + sizeof(uint32_t) * 50);
+				JASS_assert(small.insert(8, ids.data(), 40));
+				JASS_assert(!small.insert(16, ids.data(), 20));
+				JASS_assert(small.insert(24, ids.data(), 10));
+				JASS_assert(small.bytes() <= sizeof(slot) * 16 + sizeof(uint32_t) * 50);
+				JASS_assert(small.find(16) == nullptr);
+				JASS_assert(small.find(24) != nullptr);
+
+				/*
+					The limit is on the memory allocated, not just that in use, even as the hash table grows
+				*/
+				const size_t limit = sizeof(slot) * 64 + sizeof(uint32_t) * 1000;
+				postings_cache tight(limit);
+				for (uint64_t segment = 1; segment <= 100; segment++)
+					{
+					tight.insert(segment * 8, ids.data(), segment % 30 + 1);
+					JASS_assert(tight.bytes() <= limit);
+					}
+				JASS_assert(tight.size() > 16);
+				for (uint64_t segment = 1; segment <= 100; segment++)
+					if (tight.find(segment * 8) != nullptr)
+						JASS_assert(std::equal(ids.begin(), ids.begin() + segment % 30 + 1, tight.find(segment * 8)));
+
+				puts("postings_cache::PASSED");
+				}
+		};
+	}
@@ -12,35 +12,67 @@
 */
 #pragma once
 
-#include "heap.h"
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+
+#include "heap_d_ary.h"
 #include "top_k_qsort.h"
 #include "parser_query.h"
 #include "accumulator_2d.h"
+#include "accumulator_simple.h"
+#include "accumulator_epoch.h"
+#include "accumulator_hash.h"
+#include "accumulator_bitmap.h"
 #include "query_term_list.h"
 #include "allocator_memory.h"
 
 namespace JASS
 	{
+	/*!
+		@enum query_top_k
+		@brief How a query tracks the top-k while the accumulators are being updated.
+	*/
+	enum query_top_k
+		{
+		TOP_K_HEAP,					///< A min-heap of pointers to the top-k accumulators, updated as each accumulator changes.
+		TOP_K_HISTOGRAM			///< A histogram of the accumulator values and a threshold, the top-k are collected at the end of the search (bounded integer accumulators only).
+		};
+
 	/*
 		CLASS QUERY
 		-----------
 	*/
 	/*!
 		@brief Everything necessary to process a query is encapsulated in an object of this type
-		@tparam ACCUMULATOR_TYPE The value-type for an accumulator (normally uint16_t or double).
+		@tparam ACCUMULATOR_TYPE The value-type for an accumulator (normally uint16_t or double).  8-bit integer accumulators saturate rather than wrap (see add()).
 		@tparam MAX_DOCUMENTS The maximum number of documents that are ever going to exist in this collection
 		@tparam MAX_TOP_K The maximum top-k documents that are going to be asked for
+		@tparam ACCUMULATORS The accumulator management policy (accumulator_2d, accumulator_bitmap, accumulator_simple, accumulator_epoch, or accumulator_hash).
+		A policy is constructed with the number of accumulators and must provide operator[](document_id) (which returns a zeroed accumulator on first
+		touch after rewind()), get_index(pointer) (the inverse of &operator[]()), order(pointer) (the key that ties are broken on, which must be in
+		document order), rewind(postings) (postings is the most the next search will add), and size().  A pointer to an accumulator must stay
+		valid until the next rewind() because the top-k holds pointers.
+		@tparam TOP_K_METHOD How the top-k is tracked (see query_top_k).  The histogram keeps no per-posting heap, instead it counts how many
+		accumulators have each value and keeps a threshold, then collects the top-k with one pass over the touched accumulators (see for_each_touched()).
+		Both give the same results.
 	*/
-	template <typename ACCUMULATOR_TYPE, size_t MAX_DOCUMENTS, size_t MAX_TOP_K>
+	template <typename ACCUMULATOR_TYPE, size_t MAX_DOCUMENTS, size_t MAX_TOP_K, typename ACCUMULATORS = accumulator_2d<ACCUMULATOR_TYPE, MAX_DOCUMENTS>, query_top_k TOP_K_METHOD = TOP_K_HEAP>
 	class query
 		{
+		/*
+			The histogram has one bucket per possible accumulator value so it can only be used with small integer accumulators.
+		*/
+		static constexpr size_t histogram_size = std::is_integral<ACCUMULATOR_TYPE>::value && sizeof(ACCUMULATOR_TYPE) <= 2 ? (size_t)1 << (8 * sizeof(ACCUMULATOR_TYPE)) : 1;
+		static_assert(TOP_K_METHOD != TOP_K_HISTOGRAM || histogram_size > 1, "TOP_K_HISTOGRAM needs an 8-bit or 16-bit integer ACCUMULATOR_TYPE");
+
 		public:
 			/*
 				CLASS QUERY::ADD_RSV_COMPARE
 				----------------------------
 			*/
 			/*!
-				@brief Functor that does the comparison (looking for a < b, if a == b then pointer compare).
+				@brief Functor that does the comparison (looking for a < b, if a == b then compare on ACCUMULATORS::order()).
 			*/
 			class add_rsv_compare
 				{
@@ -60,7 +92,7 @@ namespace JASS
 						/*
 							The most likely case is that the value at a is less than the value at b so do that check first.
 						*/
-						return *a < *b ? -1 : *a > *b ? 1 : a < b ? -1 : a == b ? 0 : 1;
+						return *a < *b ? -1 : *a > *b ? 1 : ACCUMULATORS::order(a) < ACCUMULATORS::order(b) ? -1 : a == b ? 0 : 1;
 						}
 				};
 			/*
@@ -68,7 +100,7 @@ namespace JASS
 				-----------------------------
 			*/
 			/*!
-				@brief Functor that does the comparison (looking for a > b, if a == b then pointer compare).
+				@brief Functor that does the comparison (looking for a > b, if a == b then compare on ACCUMULATORS::order()).
 			*/
 			class sort_rsv_compare
 				{
@@ -88,7 +120,7 @@ namespace JASS
 						/*
 							The most likely case is that the value at a is less than the value at b so do that check first.
 						*/
-						return *a < *b ? 1 : *a > *b ? -1 : a < b ? 1 : a == b ? 0 : -1;
+						return *a < *b ? 1 : *a > *b ? -1 : ACCUMULATORS::order(a) < ACCUMULATORS::order(b) ? 1 : a == b ? 0 : -1;
 						}
 				};
 
@@ -137,7 +169,7 @@ namespace JASS
 					};
 
 				public:
-					query<ACCUMULATOR_TYPE, MAX_DOCUMENTS, MAX_TOP_K> &parent;			///< The query object that this is iterating over
+					query<ACCUMULATOR_TYPE, MAX_DOCUMENTS, MAX_TOP_K, ACCUMULATORS, TOP_K_METHOD> &parent;			///< The query object that this is iterating over
 					size_t where;																				///< Where in the results list we are
 
 				public:
@@ -150,7 +182,7 @@ namespace JASS
 						@param parent [in] The object we are iterating over
 						@param where [in] Where in the results list this iterator starts
 					*/
-					iterator(query<ACCUMULATOR_TYPE, MAX_DOCUMENTS, MAX_TOP_K> &parent, size_t where) :
+					iterator(query<ACCUMULATOR_TYPE, MAX_DOCUMENTS, MAX_TOP_K, ACCUMULATORS, TOP_K_METHOD> &parent, size_t where) :
 						parent(parent),
 						where(where)
 						{
@@ -196,24 +228,34 @@ namespace JASS
 					*/
 					docid_rsv_pair operator*()
 						{
-						size_t id = parent.accumulator_pointers[where] - &parent.accumulators[0];
+						size_t id = parent.accumulators.get_index(parent.accumulator_pointers[where]);
 						return docid_rsv_pair(id, parent.primary_keys[id], parent.accumulators[id]);
 						}
 					};
 
 		private:
-			ACCUMULATOR_TYPE zero;														///< Constant zero used for pointer dereferenced comparisons
+			static constexpr size_t add_rsv_block_size = 256;						///< add_rsv_block() updates this many accumulators before it looks at the top-k
+
+		private:
 			allocator_pool memory;														///< All memory allocation happens in this "arena"
 			ACCUMULATOR_TYPE *accumulator_pointers[MAX_TOP_K];					///< Array of pointers to the top k accumulators
-			accumulator_2d<ACCUMULATOR_TYPE, MAX_DOCUMENTS> accumulators;	///< The accumulators, one per document in the collection
+			ACCUMULATORS accumulators;													///< The accumulators, one per document in the collection
 			size_t needed_for_top_k;													///< The number of results we still need in order to fill the top-k
-			heap<ACCUMULATOR_TYPE *, add_rsv_compare> top_results;			///< Heap containing the top-k results
+			heap_d_ary<ACCUMULATOR_TYPE *, add_rsv_compare> top_results;	///< Heap containing the top-k results
 
 			parser_query parser;															///< Parser responsible for converting text into a parsed query
 			query_term_list *parsed_query;											///< The parsed query
 			const std::vector<std::string> &primary_keys;						///< A vector of strings, each the primary key for the document with an id equal to the vector index
 			size_t top_k;																	///< The number of results to track.
 
+			ACCUMULATOR_TYPE *candidates[add_rsv_block_size];					///< The accumulators add_rsv_block() found are at least the bottom of the top-k
+			ACCUMULATOR_TYPE candidate_previous[add_rsv_block_size];			///< The value of each of the candidates before add_rsv_block() added to it
+
+			uint32_t histogram[TOP_K_METHOD == TOP_K_HISTOGRAM ? histogram_size : 1];	///< The number of accumulators with each value (only those at or above histogram_threshold are correct)
+			ACCUMULATOR_TYPE histogram_threshold;									///< The top-k are all at or above this value
+			ACCUMULATOR_TYPE histogram_highest;										///< The highest accumulator value seen (so rewind() need only clear that much of the histogram)
+			size_t histogram_above;														///< The number of accumulators at or above histogram_threshold
+
 			add_rsv_compare cmp;															///< Comparison during addition (used to order low to high a min heap)
 			sort_rsv_compare final_sort_cmp;											///< Comparison after search (used to order high to low)
 
@@ -229,15 +271,16 @@ namespace JASS
 				@param top_k [in]	The top-k documents to return from the query once executed.
 			*/
 			query(const std::vector<std::string> &primary_keys, size_t documents = 1024, size_t top_k = 10) :
-				zero(0),
 				accumulators(documents),
 				top_results(*accumulator_pointers, top_k),
 				parser(memory),
-				parsed_query(nullptr),
+				parsed_query(new (memory.malloc(sizeof(query_term_list))) query_term_list(memory)),
 				primary_keys(primary_keys),
-				top_k(top_k)
+				top_k(top_k),
+				histogram_highest(0)
 				{
-				rewind();
+				std::fill(histogram, histogram + sizeof(histogram) / sizeof(*histogram), 0);
+				rewind(0);
 				}
 
 			/*
@@ -249,7 +292,7 @@ namespace JASS
 			*/
 			~query()
 				{
-				delete parsed_query;
+				/* Nothing (the parsed query is in memory) */
 				}
 
 			/*
@@ -262,6 +305,8 @@ namespace JASS
 			*/
 			auto begin(void)
 				{
+				if (TOP_K_METHOD == TOP_K_HISTOGRAM)
+					collect();
 				sort();
 				return iterator(*this, needed_for_top_k);
 				}
@@ -291,9 +336,33 @@ namespace JASS
 			template <typename STRING_TYPE>
 			void parse(const STRING_TYPE &query)
 				{
+				/*
+					Throw away the previous query but keep the memory it used so that, once warmed up, parsing doesn't allocate
+				*/
+				memory.recycle();
+				parsed_query = new (memory.malloc(sizeof(query_term_list))) query_term_list(memory);
+
 				parser.parse(*parsed_query, query);
 				}
 
+			/*
+				QUERY::PARSE()
+				--------------
+			*/
+			/*!
+				@brief Take the given query and parse it.
+				@details This is the same as parse(STRING_TYPE) but the query need not be in a string object (so the caller needn't build one).
+				@param query [in] The query to parse.
+				@param length [in] The length of the query (in bytes).
+			*/
+			void parse(const char *query, size_t length)
+				{
+				memory.recycle();
+				parsed_query = new (memory.malloc(sizeof(query_term_list))) query_term_list(memory);
+
+				parser.parse(*parsed_query, query, length);
+				}
+
 			/*
 				QUERY::TERMS()
 				--------------
@@ -312,15 +381,24 @@ namespace JASS
 				---------------
 			*/
 			/*!
-				@brief Clear this object after use and ready for re-use
+				@brief Clear the accumulators and the top-k after use and ready for re-use
+				@details The parsed query is not touched (so it can be used after the search), it is thrown away by the next call to parse().
+				Accumulator policies that are sized for each search (accumulator_hash) are sized from postings.  The constructor rewinds with
+				0 postings, so with such a policy rewind() must be called before the first search.
+				@param postings [in] The largest number of postings the next search will add (default is as many as there can be).
 			*/
-			void rewind(void)
+			void rewind(size_t postings = (std::numeric_limits<size_t>::max)())
 				{
-				accumulator_pointers[0] = &zero;
-				accumulators.rewind();
+				accumulators.rewind(postings);
 				needed_for_top_k = top_k;
-				delete parsed_query;
-				parsed_query = new query_term_list(memory);
+
+				if (TOP_K_METHOD == TOP_K_HISTOGRAM)
+					{
+					std::fill(histogram, histogram + (size_t)histogram_highest + 1, 0);
+					histogram_threshold = 1;
+					histogram_highest = 0;
+					histogram_above = 0;
+					}
 				}
 
 			/*
@@ -335,6 +413,29 @@ namespace JASS
 				top_k_qsort::sort(accumulator_pointers + needed_for_top_k, top_k - needed_for_top_k, top_k, final_sort_cmp);
 				}
 
+			/*
+				QUERY::ADD()
+				------------
+			*/
+			/*!
+				@brief Add score to an accumulator, saturating (rather than wrapping) if the accumulator is an 8-bit integer.
+				@details 8-bit accumulators are only used when the largest possible score fits (so saturation should never happen).  If it does then the
+				saturated documents tie and are ordered on address, which is better than the wrapped documents falling out of the top-k.
+				@param accumulator [in] The value of the accumulator.
+				@param score [in] The amount to add.
+				@return The new value of the accumulator.
+			*/
+			static forceinline ACCUMULATOR_TYPE add(ACCUMULATOR_TYPE accumulator, ACCUMULATOR_TYPE score)
+				{
+				if (std::is_integral<ACCUMULATOR_TYPE>::value && sizeof(ACCUMULATOR_TYPE) == 1)
+					{
+					unsigned int sum = static_cast<unsigned int>(accumulator) + static_cast<unsigned int>(score);
+					return static_cast<ACCUMULATOR_TYPE>((std::min)(sum, static_cast<unsigned int>((std::numeric_limits<ACCUMULATOR_TYPE>::max)())));
+					}
+				else
+					return accumulator + score;
+				}
+
 			/*
 				QUERY::ADD_RSV()
 				----------------
@@ -346,13 +447,22 @@ namespace JASS
 			*/
 			forceinline void add_rsv(size_t document_id, ACCUMULATOR_TYPE score)
 				{
+				if (TOP_K_METHOD == TOP_K_HISTOGRAM)
+					{
+					add_rsv_histogram(document_id, score);
+					return;
+					}
+
 				ACCUMULATOR_TYPE *which = &accumulators[document_id];			// This will create the accumulator if it doesn't already exist.
 
 				/*
-					By doing the add first its possible to reduce the "usual" path through the code to a single comparison.  The JASS v1 "usual" path took three comparisons.
+					By doing the add first its possible to reduce the "usual" path through the code to a single comparison (and a well predicted test that the top-k is full).
+					The JASS v1 "usual" path took three comparisons.  Until the top-k is full the bottom of it is not compared to (there isn't one).
 				*/
-				*which += score;
-				if (cmp(which, accumulator_pointers[0]) >= 0)			// ==0 is the case where we're the current bottom of heap so might need to be promoted
+				ACCUMULATOR_TYPE previous = *which;
+				ACCUMULATOR_TYPE now = add(previous, score);
+				*which = now;
+				if (needed_for_top_k > 0 || cmp(which, accumulator_pointers[0]) >= 0)			// ==0 is the case where we're the current bottom of heap so might need to be promoted
 					{
 					/*
 						We end up in the top-k, now to work out why.  As this is a rare occurence, we've got a little bit of time on our hands
@@ -362,7 +472,7 @@ namespace JASS
 						/*
 							the heap isn't full yet - so change only happens if we're a new addition (i.e. the old value was a 0)
 						*/
-						if (*which == score)
+						if (previous == 0)
 							{
 							accumulator_pointers[--needed_for_top_k] = which;
 							if (needed_for_top_k == 0)
@@ -371,9 +481,9 @@ namespace JASS
 						}
 					else
 						{
-						*which -= score;
+						*which = previous;
 						int prior_compare = cmp(which, accumulator_pointers[0]);
-						*which += score;
+						*which = now;
 
 						if (prior_compare < 0)
 							top_results.push_back(which);				// we're not in the heap so add this accumulator to the heap
@@ -383,6 +493,159 @@ namespace JASS
 					}
 				}
 
+			/*
+				QUERY::ADD_RSV_BLOCK()
+				----------------------
+			*/
+			/*!
+				@brief Add weight to the rsv of each document in a list of documents (such as an impact segment).
+				@details The result is the same as calling add_rsv() on each document, but the accumulators are updated in a tight,
+				branch-free loop that also notes which accumulators are now at least the bottom of the top-k.  Only those are then
+				checked against the top-k, first re-building the heap if any were already in it, and then adding those that have just got in.
+				This is exact because the top-k is always the k largest accumulators (ties broken on address), whatever the order they
+				were added in.  Each document must occur at most once in the list.
+				@param document_id [in] The list of documents.
+				@param documents [in] The number of documents in the list.
+				@param score [in] The amount of weight to add to each.
+			*/
+			void add_rsv_block(const uint32_t *document_id, size_t documents, ACCUMULATOR_TYPE score)
+				{
+				const uint32_t *end = document_id + documents;
+
+				if (TOP_K_METHOD == TOP_K_HISTOGRAM)
+					{
+					while (document_id < end)
+						add_rsv_histogram(*document_id++, score);
+					raise_threshold();
+					return;
+					}
+
+				/*
+					Until the top-k is full every accumulator that is touched gets into it, so there's nothing to gain from batching.
+				*/
+				while (needed_for_top_k > 0 && document_id < end)
+					add_rsv(*document_id++, score);
+
+				while (document_id < end)
+					{
+					const uint32_t *block_end = document_id + (std::min)(static_cast<size_t>(end - document_id), add_rsv_block_size);
+					ACCUMULATOR_TYPE *bottom = accumulator_pointers[0];
+					ACCUMULATOR_TYPE threshold = *bottom;
+
+					/*
+						Add to the accumulators, keeping those that reach the bottom of the top-k.
+					*/
+					size_t found = 0;
+					for (; document_id < block_end; document_id++)
+						{
+						ACCUMULATOR_TYPE *which = &accumulators[*document_id];
+						ACCUMULATOR_TYPE previous = *which;
+						ACCUMULATOR_TYPE now = add(previous, score);
+						*which = now;
+						candidates[found] = which;
+						candidate_previous[found] = previous;
+						found += now >= threshold;
+						}
+
+					/*
+						If any were already in the top-k (the previous value compares at least equal to the previous bottom) then the heap
+						must be rebuilt.  Several keys have changed so promoting them one at a time would not give a heap.
+					*/
+					size_t outside = 0;
+					for (size_t current = 0; current < found; current++)
+						{
+						ACCUMULATOR_TYPE *which = candidates[current];
+						ACCUMULATOR_TYPE previous = candidate_previous[current];
+						candidates[outside] = which;
+						outside += previous < threshold || (previous == threshold && ACCUMULATORS::order(which) < ACCUMULATORS::order(bottom));
+						}
+					if (outside != found)
+						top_results.make_heap();
+
+					/*
+						Now the heap is correct again, add those that have got into the top-k.
+					*/
+					for (size_t current = 0; current < outside; current++)
+						if (cmp(candidates[current], accumulator_pointers[0]) > 0)
+							top_results.push_back(candidates[current]);
+					}
+				}
+
+			/*
+				QUERY::ADD_RSV_HISTOGRAM()
+				--------------------------
+			*/
+			/*!
+				@brief Add weight to the rsv for document docuument_id and keep the histogram up to date.
+				@details The histogram is only maintained at or above the threshold (which never goes down during a search), so an accumulator
+				is counted when it reaches the threshold and un-counted from its old value if that was at or above the threshold.  There are no branches.
+				@param document_id [in] which document to increment
+				@param score [in] the amount of weight to add
+			*/
+			forceinline void add_rsv_histogram(size_t document_id, ACCUMULATOR_TYPE score)
+				{
+				ACCUMULATOR_TYPE *which = &accumulators[document_id];
+				ACCUMULATOR_TYPE previous = *which;
+				ACCUMULATOR_TYPE now = add(previous, score);
+				*which = now;
+
+				size_t was_above = previous >= histogram_threshold;
+				size_t is_above = now >= histogram_threshold;
+				histogram[static_cast<size_t>(previous)] -= was_above;
+				histogram[static_cast<size_t>(now)] += is_above;
+				histogram_above += is_above - was_above;
+				histogram_highest = (std::max)(histogram_highest, now);
+				}
+
+			/*
+				QUERY::RAISE_THRESHOLD()
+				------------------------
+			*/
+			/*!
+				@brief Move the histogram threshold up as far as possible while keeping at least top-k accumulators at or above it.
+			*/
+			void raise_threshold(void)
+				{
+				while (histogram_above - histogram[static_cast<size_t>(histogram_threshold)] >= top_k)
+					{
+					histogram_above -= histogram[static_cast<size_t>(histogram_threshold)];
+					histogram_threshold++;
+					}
+				}
+
+			/*
+				QUERY::COLLECT()
+				----------------
+			*/
+			/*!
+				@brief Collect the top-k from the accumulators using the histogram (the results are left for sort() in accumulator_pointers).
+				@details Everything above the threshold is in the top-k, as are as many of those at the threshold as needed to fill it.  Ties
+				are broken on address just like the heap, so the first of those at the threshold (in document order) are the ones left out.
+			*/
+			void collect(void)
+				{
+				raise_threshold();
+
+				size_t wanted = (std::min)(histogram_above, top_k);
+				size_t skip = histogram_above - wanted;
+				ACCUMULATOR_TYPE threshold = histogram_threshold;
+
+				needed_for_top_k = top_k - wanted;
+				ACCUMULATOR_TYPE **into = accumulator_pointers + needed_for_top_k;
+				accumulators.for_each_touched([&into, &skip, threshold](ACCUMULATOR_TYPE &value)
+					{
+					if (value > threshold)
+						*into++ = &value;
+					else if (value == threshold)
+						{
+						if (skip == 0)
+							*into++ = &value;
+						else
+							skip--;
+						}
+					});
+				}
+
 			/*
 				QUERY::UNITTEST()
 				-----------------
@@ -424,8 +687,145 @@ namespace JASS
 					else if (times == 3)
 						JASS_assert(term.token() == "three");
 					}
+				JASS_assert(times == 3);
+
+				/*
+					Parsing again replaces the previous query (re-using its memory)
+				*/
+				times = 0;
+				query_object.parse(std::string("four"));
+				for (const auto &term : query_object.terms())
+					{
+					times++;
+					JASS_assert(term.token() == "four");
+					}
+				JASS_assert(times == 1);
+
+				/*
+					add_rsv_block() must give the same top-k as add_rsv(), including ties, with the top-k full or not.  Small
+					collections with documents in random order make many ties and lots of changes to the heap.  The other
+					accumulator policies must give the same answer too.
+				*/
+				std::vector<std::string> many_keys(1024, "key");
+				uint32_t seed = 1;
+				auto random = [&seed](){ seed = seed * 1103515245 + 12345; return seed >> 16; };
+				for (size_t trial = 0; trial < 200; trial++)
+					{
+					size_t k = 1 + random() % 10;
+					size_t collection_size = 5 + random() % 60;
+					query<uint16_t, 1024, 10> one_at_a_time(many_keys, 1024, k);
+					query<uint16_t, 1024, 10> blocked(many_keys, 1024, k);
+					query<uint16_t, 1024, 10, accumulator_simple<uint16_t, 1024>> simple(many_keys, 1024, k);
+					query<uint16_t, 1024, 10, accumulator_epoch<uint16_t, 1024>> epoch(many_keys, 1024, k);
+					query<uint16_t, 1024, 10, accumulator_bitmap<uint16_t, 1024>> bitmap(many_keys, 1024, k);
+					query<uint16_t, 1024, 10, accumulator_hash<uint16_t, 1024>> hash(many_keys, 1024, k);
+					query<uint16_t, 1024, 10, accumulator_2d<uint16_t, 1024>, TOP_K_HISTOGRAM> histogram(many_keys, 1024, k);
+					query<uint16_t, 1024, 10, accumulator_epoch<uint16_t, 1024>, TOP_K_HISTOGRAM> histogram_epoch(many_keys, 1024, k);
+					query<uint16_t, 1024, 10, accumulator_hash<uint16_t, 1024>, TOP_K_HISTOGRAM> histogram_hash(many_keys, 1024, k);
+					hash.rewind(8 * collection_size);
+					histogram_hash.rewind(8 * collection_size);
+					for (size_t term = 0; term < 8; term++)
+						{
+						std::vector<uint32_t> segment;
+						for (uint32_t document = 0; document < collection_size; document++)
+							if (random() % 3 == 0)
+								segment.push_back(document);
+						for (size_t from = segment.size(); from > 1; from--)
+							std::swap(segment[from - 1], segment[random() % from]);
+
+						uint16_t impact = 1 + random() % 5;
+						for (const auto document : segment)
+							one_at_a_time.add_rsv(document, impact);
+						blocked.add_rsv_block(segment.data(), segment.size(), impact);
+						simple.add_rsv_block(segment.data(), segment.size(), impact);
+						epoch.add_rsv_block(segment.data(), segment.size(), impact);
+						bitmap.add_rsv_block(segment.data(), segment.size(), impact);
+						hash.add_rsv_block(segment.data(), segment.size(), impact);
+						histogram_hash.add_rsv_block(segment.data(), segment.size(), impact);
+						histogram.add_rsv_block(segment.data(), segment.size(), impact);
+						for (const auto document : segment)
+							histogram_epoch.add_rsv(document, impact);
+						}
+
+					std::ostringstream expected;
+					std::ostringstream got;
+					for (const auto &rsv : one_at_a_time)
+						expected << "<" << rsv.document_id << "," << rsv.rsv << ">";
+					for (const auto &rsv : blocked)
+						got << "<" << rsv.document_id << "," << rsv.rsv << ">";
+					JASS_assert(expected.str() == got.str());
+
+					std::ostringstream got_simple;
+					std::ostringstream got_epoch;
+					std::ostringstream got_bitmap;
+					std::ostringstream got_hash;
+					for (const auto &rsv : simple)
+						got_simple << "<" << rsv.document_id << "," << rsv.rsv << ">";
+					for (const auto &rsv : epoch)
+						got_epoch << "<" << rsv.document_id << "," << rsv.rsv << ">";
+					for (const auto &rsv : bitmap)
+						got_bitmap << "<" << rsv.document_id << "," << rsv.rsv << ">";
+					for (const auto &rsv : hash)
+						got_hash << "<" << rsv.document_id << "," << rsv.rsv << ">";
+					JASS_assert(expected.str() == got_simple.str());
+					JASS_assert(expected.str() == got_epoch.str());
+					JASS_assert(expected.str() == got_bitmap.str());
+					JASS_assert(expected.str() == got_hash.str());
+
+					/*
+						The histogram must give the same answer whether or not the threshold has been raised during the search, and again after a rewind().
+					*/
+					for (size_t pass = 0; pass < 2; pass++)
+						{
+						std::ostringstream got_histogram;
+						std::ostringstream got_histogram_epoch;
+						std::ostringstream got_histogram_hash;
+						for (const auto &rsv : histogram)
+							got_histogram << "<" << rsv.document_id << "," << rsv.rsv << ">";
+						for (const auto &rsv : histogram_epoch)
+							got_histogram_epoch << "<" << rsv.document_id << "," << rsv.rsv << ">";
+						for (const auto &rsv : histogram_hash)
+							got_histogram_hash << "<" << rsv.document_id << "," << rsv.rsv << ">";
+						JASS_assert(expected.str() == got_histogram.str());
+						JASS_assert(expected.str() == got_histogram_epoch.str());
+						JASS_assert(expected.str() == got_histogram_hash.str());
+
+						histogram.rewind();
+						histogram_epoch.rewind();
+						histogram_hash.rewind(k);
+						for (const auto &rsv : one_at_a_time)
+							{
+							uint32_t document = rsv.document_id;
+							histogram.add_rsv_block(&document, 1, rsv.rsv);
+							histogram_epoch.add_rsv(document, rsv.rsv);
+							histogram_hash.add_rsv(document, rsv.rsv);
+							}
+						}
+					}
+
+				/*
+					8-bit accumulators saturate rather than wrap, through both add_rsv() and add_rsv_block()
+				*/
+				query<uint8_t, 1024, 10> narrow(many_keys, 1024, 2);
+				narrow.add_rsv(1, 200);
+				narrow.add_rsv(2, 100);
+				narrow.add_rsv(1, 100);
+				uint32_t saturate[] = {1, 2, 3};
+				narrow.add_rsv_block(saturate, 3, 200);
+				std::ostringstream got_narrow;
+				for (const auto &rsv : narrow)
+					got_narrow << "<" << rsv.document_id << "," << +rsv.rsv << ">";
+				JASS_assert(got_narrow.str() == "<2,255><1,255>");
 
 				puts("query::PASSED");
 				}
 		};
+
+	/*
+		QUERY::ADD_RSV_BLOCK_SIZE
+		-------------------------
+		C++14 needs a namespace-scope definition of a static constexpr member that is odr-used (std::min() takes it by reference).
+	*/
+	template <typename ACCUMULATOR_TYPE, size_t MAX_DOCUMENTS, size_t MAX_TOP_K, typename ACCUMULATORS, query_top_k TOP_K_METHOD>
+	constexpr size_t query<ACCUMULATOR_TYPE, MAX_DOCUMENTS, MAX_TOP_K, ACCUMULATORS, TOP_K_METHOD>::add_rsv_block_size;
 	}
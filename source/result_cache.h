@@ -0,0 +1,558 @@
+/*
+	RESULT_CACHE.H
+	--------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief A bounded, sharded, thread-safe cache of query results with CLOCK eviction.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+#include "asserts.h"
+#include "hash_pearson.h"
+
+namespace JASS
+	{
+	/*
+		CLASS RESULT_CACHE
+		------------------
+	*/
+	/*!
+		@brief A bounded, thread-safe cache of query results (the top-k <document_id, rsv> list) keyed on a byte string.
+		@details All the memory the cache will ever use is allocated by the constructor, so neither find() nor insert() allocates.  The
+		cache is split into shards (on the hash of the key), each with its own lock, so that threads searching at the same time rarely wait
+		for each other.  Within a shard the entries are in a hash table (chained through the entries), and when the shard is full the
+		victim is chosen with the CLOCK algorithm (an approximation of least recently used where a hit sets a reference bit, and the clock
+		hand clears reference bits until it finds an entry without one).  The key is up to the caller, but it must include everything
+		that changes the results (for a search engine: the normalised query terms, top-k, and any early termination budget).
+	*/
+	class result_cache
+		{
+		public:
+			/*
+				CLASS RESULT_CACHE::RESULT
+				--------------------------
+			*/
+			/*!
+				@brief A single result (a <document_id, rsv> pair).
+			*/
+			class result
+				{
+				public:
+					uint32_t document_id;				///< The document identifier
+					uint32_t rsv;							///< The rsv (Retrieval Status Value) relevance score
+				};
+
+			/*
+				CLASS RESULT_CACHE::ANSWER
+				--------------------------
+			*/
+			/*!
+				@brief A list of results that can be passed to insert(), filled by find(), and iterated over like a query (so that run_export can write it).
+			*/
+			class answer
+				{
+				public:
+					/*
+						CLASS RESULT_CACHE::ANSWER::DOCID_RSV_PAIR
+						------------------------------------------
+					*/
+					/*!
+						@brief Literally a <document_id, rsv> ordered pair (as returned by query::iterator).
+					*/
+					class docid_rsv_pair
+						{
+						public:
+							size_t document_id;							///< The document identifier
+							const std::string &primary_key;			///< The external identifier of the document (the primary key)
+							uint32_t rsv;									///< The rsv (Retrieval Status Value) relevance score
+
+						public:
+							/*
+								RESULT_CACHE::ANSWER::DOCID_RSV_PAIR::DOCID_RSV_PAIR()
+								------------------------------------------------------
+							*/
+							/*!
+								@brief Constructor.
+								@param document_id [in] The document Identifier.
+								@param key [in] The external identifier of the document (the primary key).
+								@param rsv [in] The rsv (Retrieval Status Value) relevance score.
+							*/
+							docid_rsv_pair(size_t document_id, const std::string &key, uint32_t rsv) :
+								document_id(document_id),
+								primary_key(key),
+								rsv(rsv)
+								{
+								/* Nothing */
+								}
+						};
+
+					/*
+						CLASS RESULT_CACHE::ANSWER::ITERATOR
+						------------------------------------
+					*/
+					/*!
+						@brief Iterate over the results
+					*/
+					class iterator
+						{
+						public:
+							const answer &parent;			///< The answer being iterated over
+							size_t where;						///< Where in the results list we are
+
+						public:
+							/*
+								RESULT_CACHE::ANSWER::ITERATOR::ITERATOR()
+								------------------------------------------
+							*/
+							/*!
+								@brief Constructor
+								@param parent [in] The object we are iterating over
+								@param where [in] Where in the results list this iterator starts
+							*/
+							iterator(const answer &parent, size_t where) :
+								parent(parent),
+								where(where)
+								{
+								/* Nothing */
+								}
+
+							/*
+								RESULT_CACHE::ANSWER::ITERATOR::OPERATOR!=()
+								--------------------------------------------
+							*/
+							/*!
+								@brief Compare two iterator objects for non-equality.
+								@param with [in] The iterator object to compare to.
+								@return true if they differ, else false.
+							*/
+							bool operator!=(const iterator &with) const
+								{
+								return with.where != where;
+								}
+
+							/*
+								RESULT_CACHE::ANSWER::ITERATOR::OPERATOR++()
+								--------------------------------------------
+							*/
+							/*!
+								@brief Increment this iterator.
+							*/
+							iterator &operator++(void)
+								{
+								where++;
+								return *this;
+								}
+
+							/*
+								RESULT_CACHE::ANSWER::ITERATOR::OPERATOR*()
+								-------------------------------------------
+							*/
+							/*!
+								@brief Return the <document_id,rsv> pair at the current location.
+								@return The current object.
+							*/
+							docid_rsv_pair operator*() const
+								{
+								const result &current = parent.results[where];
+								return docid_rsv_pair(current.document_id, parent.primary_keys[current.document_id], current.rsv);
+								}
+						};
+
+				public:
+					const std::vector<std::string> &primary_keys;		///< The primary keys of the documents (for the iterator)
+					std::vector<result> results;							///< The results (allocated once, to the largest size)
+					size_t size;													///< The number of results that are in use
+
+				public:
+					/*
+						RESULT_CACHE::ANSWER::ANSWER()
+						------------------------------
+					*/
+					/*!
+						@brief Constructor
+						@param primary_keys [in] The primary keys of the documents.
+						@param maximum_results [in] The largest number of results this object will hold.
+					*/
+					answer(const std::vector<std::string> &primary_keys, size_t maximum_results) :
+						primary_keys(primary_keys),
+						results(maximum_results),
+						size(0)
+						{
+						/* Nothing */
+						}
+
+					/*
+						RESULT_CACHE::ANSWER::PUSH_BACK()
+						---------------------------------
+					*/
+					/*!
+						@brief Add a result to the end of the list (if there's room).
+						@param document_id [in] The document identifier.
+						@param rsv [in] The rsv (Retrieval Status Value) relevance score.
+					*/
+					void push_back(size_t document_id, uint32_t rsv)
+						{
+						if (size < results.size())
+							{
+							results[size].document_id = static_cast<uint32_t>(document_id);
+							results[size].rsv = rsv;
+							size++;
+							}
+						}
+
+					/*
+						RESULT_CACHE::ANSWER::BEGIN()
+						-----------------------------
+					*/
+					/*!
+						@brief Return an iterator pointing to the first result.
+						@return Iterator pointing to the first result.
+					*/
+					iterator begin(void) const
+						{
+						return iterator(*this, 0);
+						}
+
+					/*
+						RESULT_CACHE::ANSWER::END()
+						---------------------------
+					*/
+					/*!
+						@brief Return an iterator pointing past the last result.
+						@return Iterator pointing past the last result.
+					*/
+					iterator end(void) const
+						{
+						return iterator(*this, size);
+						}
+				};
+
+		private:
+			static constexpr int32_t NONE = -1;						///< The end of a hash chain
+
+			/*
+				CLASS RESULT_CACHE::ENTRY
+				-------------------------
+			*/
+			/*!
+				@brief The details of a cached answer (the key and the results are kept in the shard, at the same index as the entry).
+			*/
+			class entry
+				{
+				public:
+					uint32_t hash;							///< The hash of the key
+					uint32_t key_length;					///< The length of the key (in bytes)
+					uint32_t results;						///< The number of results
+					int32_t next;							///< The next entry in the hash chain (or NONE)
+					bool used;								///< Does this entry hold an answer
+					bool referenced;						///< The CLOCK reference bit (set on a hit)
+				};
+
+			/*
+				CLASS RESULT_CACHE::SHARD
+				-------------------------
+			*/
+			/*!
+				@brief An independently locked part of the cache.
+			*/
+			class shard
+				{
+				public:
+					std::mutex lock;						///< Only one thread can look in a shard at a time
+					std::vector<entry> entries;		///< The entries
+					std::vector<int32_t> bucket;		///< The hash table (the first entry in each chain)
+					std::vector<char> keys;				///< The keys (maximum_key_length bytes per entry)
+					std::vector<result> results;		///< The results (maximum_results per entry)
+					size_t hand;							///< The CLOCK hand
+				};
+
+		private:
+			size_t maximum_key_length;						///< The longest key that can be cached
+			size_t maximum_results;							///< The longest answer that can be cached
+			std::vector<std::unique_ptr<shard>> shards;	///< The shards
+			std::atomic<uint64_t> hits;					///< The number of calls to find() that found the key
+			std::atomic<uint64_t> misses;					///< The number of calls to find() that did not find the key
+
+		private:
+			/*
+				RESULT_CACHE::LOCATE()
+				----------------------
+			*/
+			/*!
+				@brief Find a key in a shard (which must be locked by the caller).
+				@param where [in] The shard.
+				@param hash [in] The hash of the key.
+				@param key [in] The key.
+				@param key_length [in] The length of the key.
+				@return The entry, or NONE if the key is not in the shard.
+			*/
+			int32_t locate(shard &where, uint32_t hash, const char *key, size_t key_length) const
+				{
+				int32_t current = where.bucket[(hash / shards.size()) & (where.bucket.size() - 1)];
+				while (current != NONE)
+					{
+					const entry &candidate = where.entries[current];
+					if (candidate.hash == hash && candidate.key_length == key_length && ::memcmp(&where.keys[current * maximum_key_length], key, key_length) == 0)
+						return current;
+					current = candidate.next;
+					}
+
+				return NONE;
+				}
+
+			/*
+				RESULT_CACHE::UNLINK()
+				----------------------
+			*/
+			/*!
+				@brief Remove an entry from its hash chain (the shard must be locked by the caller).
+				@param where [in] The shard.
+				@param which [in] The entry.
+			*/
+			void unlink(shard &where, int32_t which)
+				{
+				int32_t *previous = &where.bucket[(where.entries[which].hash / shards.size()) & (where.bucket.size() - 1)];
+				while (*previous != which)
+					previous = &where.entries[*previous].next;
+				*previous = where.entries[which].next;
+				where.entries[which].used = false;
+				}
+
+		public:
+			/*
+				RESULT_CACHE::RESULT_CACHE()
+				----------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param bytes [in] The (approximate) amount of memory to use.
+				@param maximum_results [in] The longest answer that can be cached (normally top-k).
+				@param maximum_key_length [in] The longest key that can be cached (default = 256 bytes).
+				@param number_of_shards [in] The number of independently locked shards (default = 16).
+			*/
+			result_cache(size_t bytes, size_t maximum_results, size_t maximum_key_length = 256, size_t number_of_shards = 16) :
+				maximum_key_length(maximum_key_length),
+				maximum_results(maximum_results),
+				hits(0),
+				misses(0)
+				{
+				size_t entry_size = sizeof(entry) + sizeof(int32_t) + maximum_key_length + maximum_results * sizeof(result);
+				size_t entries_per_shard = (std::max)(bytes / entry_size / number_of_shards, static_cast<size_t>(1));
+
+				size_t buckets = 1;
+				while (buckets < entries_per_shard)
+					buckets *= 2;
+
+				for (size_t which = 0; which < number_of_shards; which++)
+					{
+					shards.push_back(std::unique_ptr<shard>(new shard));
+					shard &current = *shards.back();
+					current.entries.resize(entries_per_shard, entry{0, 0, 0, NONE, false, false});
+					current.bucket.resize(buckets, static_cast<int32_t>(NONE));				// resize() takes a reference, so pass a copy of NONE
+					current.keys.resize(entries_per_shard * maximum_key_length);
+					current.results.resize(entries_per_shard * maximum_results);
+					current.hand = 0;
+					}
+				}
+
+			/*
+				RESULT_CACHE::FIND()
+				--------------------
+			*/
+			/*!
+				@brief Look up a key and, if it is found, copy the results into into.
+				@param key [in] The key.
+				@param key_length [in] The length of the key (in bytes).
+				@param into [out] The answer (unchanged if the key is not found).
+				@return true if the key was found, else false.
+			*/
+			bool find(const char *key, size_t key_length, answer &into)
+				{
+				if (key_length <= maximum_key_length)
+					{
+					uint32_t hash = static_cast<uint32_t>(hash_pearson::hash_32(key, key_length));
+					shard &where = *shards[hash % shards.size()];
+					std::lock_guard<std::mutex> guard(where.lock);
+
+					int32_t found = locate(where, hash, key, key_length);
+					if (found != NONE)
+						{
+						entry &current = where.entries[found];
+						current.referenced = true;
+						into.size = (std::min)(static_cast<size_t>(current.results), into.results.size());
+						std::copy(&where.results[found * maximum_results], &where.results[found * maximum_results] + into.size, into.results.begin());
+						hits++;
+						return true;
+						}
+					}
+
+				misses++;
+				return false;
+				}
+
+			/*
+				RESULT_CACHE::INSERT()
+				----------------------
+			*/
+			/*!
+				@brief Add an answer to the cache (evicting another if necessary).
+				@details Keys that are too long, and answers that are too long, are not cached.  If the key is already in the cache then nothing happens.
+				@param key [in] The key.
+				@param key_length [in] The length of the key (in bytes).
+				@param from [in] The answer.
+			*/
+			void insert(const char *key, size_t key_length, const answer &from)
+				{
+				if (key_length > maximum_key_length || from.size > maximum_results)
+					return;
+
+				uint32_t hash = static_cast<uint32_t>(hash_pearson::hash_32(key, key_length));
+				shard &where = *shards[hash % shards.size()];
+				std::lock_guard<std::mutex> guard(where.lock);
+
+				if (locate(where, hash, key, key_length) != NONE)
+					return;						// another thread got here first
+
+				/*
+					Choose the victim with the CLOCK algorithm
+				*/
+				while (where.entries[where.hand].used && where.entries[where.hand].referenced)
+					{
+					where.entries[where.hand].referenced = false;
+					where.hand = (where.hand + 1) % where.entries.size();
+					}
+				int32_t victim = static_cast<int32_t>(where.hand);
+				where.hand = (where.hand + 1) % where.entries.size();
+
+				if (where.entries[victim].used)
+					unlink(where, victim);
+
+				/*
+					Put the answer into the victim's place and add it to the hash chain
+				*/
+				entry &current = where.entries[victim];
+				current.hash = hash;
+				current.key_length = static_cast<uint32_t>(key_length);
+				current.results = static_cast<uint32_t>(from.size);
+				current.used = true;
+				current.referenced = false;
+				::memcpy(&where.keys[victim * maximum_key_length], key, key_length);
+				std::copy(from.results.begin(), from.results.begin() + from.size, &where.results[victim * maximum_results]);
+
+				int32_t &head = where.bucket[(hash / shards.size()) & (where.bucket.size() - 1)];
+				current.next = head;
+				head = victim;
+				}
+
+			/*
+				RESULT_CACHE::HIT_COUNT()
+				-------------------------
+			*/
+			/*!
+				@brief Return the number of calls to find() that found the key.
+				@return The number of hits.
+			*/
+			uint64_t hit_count(void) const
+				{
+				return hits;
+				}
+
+			/*
+				RESULT_CACHE::MISS_COUNT()
+				--------------------------
+			*/
+			/*!
+				@brief Return the number of calls to find() that did not find the key.
+				@return The number of misses.
+			*/
+			uint64_t miss_count(void) const
+				{
+				return misses;
+				}
+
+			/*
+				RESULT_CACHE::KEY_LENGTH_LIMIT()
+				--------------------------------
+			*/
+			/*!
+				@brief Return the length of the longest key that can be cached.
+				@return The maximum key length (in bytes).
+			*/
+			size_t key_length_limit(void) const
+				{
+				return maximum_key_length;
+				}
+
+			/*
+				RESULT_CACHE::UNITTEST()
+				------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				std::vector<std::string> keys = {"zero", "one", "two", "three"};
+				result_cache::answer answer(keys, 3);
+				result_cache::answer got(keys, 3);
+
+				/*
+					One shard with room for 2 answers (so that eviction can be checked)
+				*/
+				result_cache cache((sizeof(entry) + sizeof(int32_t) + 16 + 3 * sizeof(result)) * 2, 3, 16, 1);
+
+				answer.push_back(3, 30);
+				answer.push_back(1, 10);
+				cache.insert("a b", 3, answer);
+				JASS_assert(!cache.find("a c", 3, got));
+				JASS_assert(cache.find("a b", 3, got));
+				JASS_assert(got.size == 2);
+
+				std::ostringstream string;
+				for (const auto &result : got)
+					string << "<" << result.primary_key << "," << result.rsv << ">";
+				JASS_assert(string.str() == "<three,30><one,10>");
+
+				/*
+					"a b" has been used since it was added, so once the cache is full it is "c" (which has not been used) that is evicted.
+				*/
+				answer.size = 0;
+				answer.push_back(2, 20);
+				cache.insert("c", 1, answer);
+				cache.insert("d", 1, answer);
+				JASS_assert(cache.find("a b", 3, got));
+				JASS_assert(!cache.find("c", 1, got));
+				JASS_assert(cache.find("d", 1, got));
+				JASS_assert(got.size == 1 && got.results[0].document_id == 2);
+
+				/*
+					Keys that are too long are never cached.
+				*/
+				std::string long_key(17, 'x');
+				cache.insert(long_key.c_str(), long_key.size(), answer);
+				JASS_assert(!cache.find(long_key.c_str(), long_key.size(), got));
+
+				JASS_assert(cache.hit_count() == 3);
+				JASS_assert(cache.miss_count() == 3);
+
+				puts("result_cache::PASSED");
+				}
+		};
+	}
@@ -52,7 +52,10 @@ namespace JASS
 				for (const auto &document : result)
 					{
 					current++;
-					stream << topic_id << " Q0 "<< document.primary_key << ' ' << current << ' ' << document.rsv << ' ' << run_name;
+					/*
+						The unary + promotes 8-bit accumulators so that the rsv is written as a number rather than as a character.
+					*/
+					stream << topic_id << " Q0 "<< document.primary_key << ' ' << current << ' ' << +document.rsv << ' ' << run_name;
 
 					/*
 						Optionally include the internal document id for debugging purposes.
@@ -4,9 +4,13 @@
 	Copyright (c) 2017 Andrew Trotman
 	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
 */
+#include <string>
 #include <ostream>
+#include <algorithm>
 
+#include "file.h"
 #include "slice.h"
+#include "reverse.h"
 #include "version.h"
 #include "checksum.h"
 #include "serialise_ci.h"
@@ -19,13 +23,32 @@ namespace JASS
 		SERIALISE_CI::SERIALISE_CI()
 		----------------------------
 	*/
-	serialise_ci::serialise_ci() :
-		postings_file("JASS_postings.cpp", "w+b"),
-		postings_header_file("JASS_postings.h", "w+b"),
-		vocab_file("JASS_vocabulary.cpp", "w+b"),
-		primary_key_file("JASS_primary_keys.cpp", "w+b"),
-		terms(0)
+	serialise_ci::serialise_ci(generator kind, size_t top_k, size_t shards) :
+		postings_header_file("JASS_postings.h"),
+		vocab_file("JASS_vocabulary.cpp"),
+		primary_key_file("JASS_primary_keys.cpp"),
+		query_header_file("JASS_query.h"),
+		terms(0),
+		documents(0),
+		top_k(top_k),
+		kind(kind),
+		memory(1024 * 1024)
 		{
+		/*
+			Open the postings shards, the first is JASS_postings.cpp and the remainder are JASS_postings_<n>.cpp.  The shards are
+			listed in JASS_postings.cmake, which the build includes, so that shards left over from an earlier (larger) index
+			aren't compiled in and a change in the number of shards causes cmake to re-run.
+		*/
+		std::string manifest = "# Generated by " + version::build() + "\nset(COMPILED_INDEX_POSTINGS_FILES";
+		for (size_t shard = 0; shard < (std::max)(shards, static_cast<size_t>(1)); shard++)
+			{
+			std::string filename = shard == 0 ? "JASS_postings.cpp" : "JASS_postings_" + std::to_string(shard) + ".cpp";
+			postings_file.push_back(std::make_unique<file_buffered>(filename, 16 * 1024 * 1024, true));			// the postings are most of the index so write them asynchronously
+			manifest += "\n\t" + filename;
+			}
+		manifest += ")\n";
+		file::write_entire_file("JASS_postings.cmake", manifest);
+
 		/*
 			Write out the headers of each file
 		*/
@@ -35,14 +58,19 @@ namespace JASS
 		vocab_file.write("#include\"JASS_vocabulary.h\"\n");
 		vocab_file.write("JASS_ci_vocab dictionary[] = {\n");
 
-		postings_file.write("/* Generated by " + version::build() + " */\n");
-		postings_file.write("#include <stddef.h>\n");
-		postings_file.write("#include <stdint.h>\n");
-		postings_file.write("#include\"query.h\"\n\n");
-		postings_file.write("using namespace JASS;\n");
+		for (auto &shard : postings_file)
+			{
+			shard->write("/* Generated by " + version::build() + " */\n");
+			shard->write("#include <stddef.h>\n");
+			shard->write("#include <stdint.h>\n");
+			shard->write("#include\"JASS_query.h\"\n");
+			if (kind != ADD_RSV)
+				shard->write("#include\"JASS_segment.h\"\n");
+			shard->write("\nusing namespace JASS;\n");
+			}
 
 		postings_header_file.write("/* Generated by " + version::build() + " */\n");
-		postings_header_file.write("#include\"query.h\"\n\n");
+		postings_header_file.write("#include\"JASS_query.h\"\n\n");
 		postings_header_file.write("using namespace JASS;\n");
 
 		primary_key_file.write("/* Generated by " + version::build() + " */\n");
@@ -68,21 +96,33 @@ namespace JASS
 		vocab_file.write(length.str());
 
 		primary_key_file.write("};\n");
+
+		/*
+			Now that the number of documents is known, describe the query object.  The accumulators are sized for exactly
+			this collection rather than some compile-time upper bound.
+		*/
+		std::ostringstream query_type;
+		query_type << "/* Generated by " << version::build() << " */\n";
+		query_type << "#pragma once\n";
+		query_type << "#include <stddef.h>\n";
+		query_type << "#include <stdint.h>\n";
+		query_type << "#include\"query.h\"\n\n";
+		query_type << "constexpr size_t JASS_ci_documents = " << documents << ";\n";
+		query_type << "constexpr size_t JASS_ci_max_top_k = " << top_k << ";\n";
+		query_type << "typedef JASS::query<uint16_t, JASS_ci_documents, JASS_ci_max_top_k> JASS_ci_query;\n";
+		query_type << "constexpr const char *JASS_ci_build = \"" << version::build() << "\";\n";
+		query_header_file.write(query_type.str());
 		}
 
 	/*
-		SERIALISE_CI::OPERATOR()()
-		--------------------------
+		SERIALISE_CI::WRITE_ADD_RSV()
+		-----------------------------
 	*/
-	void serialise_ci::operator()(const slice &term, const index_postings &postings)
+	void serialise_ci::write_add_rsv(std::ostream &code, const slice &term, const index_postings &postings)
 		{
-		std::ostringstream code;
 		uint64_t previous_document_id = (std::numeric_limits<uint64_t>::max)();
 
-		/*
-			Construct the method and write it out
-		*/
-		code << "void T_" << term << "(query<uint16_t, 10'000'000, 10> &q)\n";
+		code << "void T_" << term << "(JASS_ci_query &q)\n";
 		code << "{\n";
 		for (const auto &posting : postings)
 			{
@@ -93,8 +133,83 @@ namespace JASS
 				}
 			}
 		code << "}\n";
+		}
+
+	/*
+		SERIALISE_CI::WRITE_SEGMENTS()
+		------------------------------
+	*/
+	template <typename HEADERS>
+	void serialise_ci::write_segments(std::ostream &code, const slice &term, const HEADERS &headers)
+		{
+		/*
+			The document ids, grouped by impact.
+		*/
+		size_t written = 0;
+		code << "static const uint32_t T_" << term << "_documents[] =\n{";
+		for (const auto &header : headers)
+			for (const auto &document_id : header)
+				code << (written++ % integers_per_line == 0 ? "\n" : "") << document_id << ',';
+		code << "\n};\n";
+
+		/*
+			The segments, each of which is the impact and the range of the document ids array with that impact.
+		*/
+		size_t start = 0;
+		code << "static const JASS_ci_segment T_" << term << "_segments[] =\n{\n";
+		for (const auto &header : headers)
+			{
+			code << '{' << header.impact_score << ',' << start << ',' << start + header.size() << "},\n";
+			start += header.size();
+			}
+		code << "};\n";
+		}
+
+	/*
+		SERIALISE_CI::WRITE_PACKED()
+		----------------------------
+	*/
+	void serialise_ci::write_packed(std::ostream &code, const slice &term, const index_postings &postings, bool impact_ordered)
+		{
+		const auto &headers = postings.impact_order(memory);
+
+		if (impact_ordered)
+			write_segments(code, term, reverse(headers));
+		else
+			write_segments(code, term, headers);
+
+		/*
+			The method to process the postings list.
+		*/
+		code << "void T_" << term << "(JASS_ci_query &q)\n";
+		code << "{\n";
+		code << "JASS_ci_add_segments(q, T_" << term << "_segments, T_" << term << "_segments + " << headers.impact_size() << ", T_" << term << "_documents);\n";
+		code << "}\n";
+
+		memory.rewind();
+		}
 
-		postings_file.write(code.str());
+	/*
+		SERIALISE_CI::OPERATOR()()
+		--------------------------
+	*/
+	void serialise_ci::operator()(const slice &term, const index_postings &postings)
+		{
+		std::ostringstream code;
+
+		/*
+			Construct the method and write it out
+		*/
+		if (kind == ADD_RSV)
+			write_add_rsv(code, term, postings);
+		else
+			write_packed(code, term, postings, kind == PACKED_IMPACT_ORDERED);
+
+		/*
+			Write it to the shard with the least code in it so that the shards take about the same time to compile
+		*/
+		auto shard = std::min_element(postings_file.begin(), postings_file.end(), [](const auto &first, const auto &second){ return first->tell() < second->tell(); });
+		(*shard)->write(code.str());
 
 		/*
 			Add this term to the vocabulary
@@ -110,7 +225,7 @@ namespace JASS
 		*/
 		postings_header_file.write("void T_");
 		postings_header_file.write(term.address(), term.size());
-		postings_header_file.write("(<uint16_t, 10'000'000, 10> &q);\n");
+		postings_header_file.write("(JASS_ci_query &q);\n");
 
 		terms++;
 		}
@@ -124,6 +239,8 @@ namespace JASS
 		primary_key_file.write("\"");
 		primary_key_file.write(primary_key.address(), primary_key.size());
 		primary_key_file.write("\",\n");
+
+		documents++;
 		}
 
 	/*
@@ -152,11 +269,11 @@ namespace JASS
 //		std::cout << "=====\n";
 		auto checksum = checksum::fletcher_16_file("JASS_postings.cpp");
 //		std::cout << "JASS_postings.c:" << checksum << '\n';
-		JASS_assert(checksum == 3754 || checksum == 53180);
+		JASS_assert(checksum == 49633 || checksum == 29939);
 
 		checksum = checksum::fletcher_16_file("JASS_postings.h");
 //		std::cout << "JASS_postings.h:" << checksum << '\n';
-		JASS_assert(checksum == 31941 || checksum == 61399);
+		JASS_assert(checksum == 12385 || checksum == 41843);
 
 		checksum = checksum::fletcher_16_file("JASS_vocabulary.cpp");
 //		std::cout << "JASS_vocabulary.cpp:" << checksum << '\n';
@@ -167,6 +284,52 @@ namespace JASS
 		JASS_assert(checksum == 18729 || checksum == 28987);
 
 //		std::cout << "=====\n";
+
+		/*
+			Packed postings, in both orders.  In three_documents_asymetric "two" has a term frequency of 1 in document 1 and 2 in documents 2 and 3.
+		*/
+		index_manager_sequential asymetric;
+		index_manager_sequential::unittest_build_index(asymetric, unittest_data::three_documents_asymetric);
+
+		std::string generated;
+		{
+		serialise_ci serialiser(PACKED);
+		asymetric.iterate(serialiser);
+		}
+		file::read_entire_file("JASS_postings.cpp", generated);
+		JASS_assert(generated.find("#include\"JASS_segment.h\"\n") != std::string::npos);
+		JASS_assert(generated.find("static const uint32_t T_two_documents[] =\n{\n1,2,3,\n};\nstatic const JASS_ci_segment T_two_segments[] =\n{\n{1,0,1},\n{2,1,3},\n};\n") != std::string::npos);
+		JASS_assert(generated.find("void T_two(JASS_ci_query &q)\n{\nJASS_ci_add_segments(q, T_two_segments, T_two_segments + 2, T_two_documents);\n}\n") != std::string::npos);
+
+		{
+		serialise_ci serialiser(PACKED_IMPACT_ORDERED);
+		asymetric.iterate(serialiser);
+		}
+		file::read_entire_file("JASS_postings.cpp", generated);
+		JASS_assert(generated.find("static const uint32_t T_two_documents[] =\n{\n2,3,1,\n};\nstatic const JASS_ci_segment T_two_segments[] =\n{\n{2,0,2},\n{1,2,3},\n};\n") != std::string::npos);
+
+		/*
+			The query type is sized for the collection (three documents plus document 0) and the given top-k, and the postings
+			are split over the shards.
+		*/
+		{
+		serialise_ci serialiser(PACKED, 5, 2);
+		asymetric.iterate(serialiser);
+		}
+		file::read_entire_file("JASS_query.h", generated);
+		JASS_assert(generated.find("constexpr size_t JASS_ci_documents = 4;\nconstexpr size_t JASS_ci_max_top_k = 5;\ntypedef JASS::query<uint16_t, JASS_ci_documents, JASS_ci_max_top_k> JASS_ci_query;\n") != std::string::npos);
+
+		std::string shard;
+		file::read_entire_file("JASS_postings.cpp", generated);
+		file::read_entire_file("JASS_postings_1.cpp", shard);
+		generated += shard;
+		for (const auto &term : {"one", "two"})
+			JASS_assert(generated.find("void T_" + std::string(term) + "(JASS_ci_query &q)\n") != std::string::npos);
+		JASS_assert(shard.find("(JASS_ci_query &q)\n") != std::string::npos);
+
+		file::read_entire_file("JASS_postings.cmake", generated);
+		JASS_assert(generated.find("set(COMPILED_INDEX_POSTINGS_FILES\n\tJASS_postings.cpp\n\tJASS_postings_1.cpp)\n") != std::string::npos);
+
 		puts("serialise_ci::PASSED");
 		}
 	}
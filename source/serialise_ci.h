@@ -12,8 +12,13 @@
  */
 #pragma once
 
-#include "file.h"
+#include <memory>
+#include <vector>
+#include <ostream>
+
+#include "file_buffered.h"
 #include "index_manager.h"
+#include "allocator_pool.h"
 
 namespace JASS
 	{
@@ -26,15 +31,91 @@ namespace JASS
 		@details  Andrew Trotman (University of Otago) and Jimmy Lin (University of Waterloo) proposed serialising the index into
 		source code and then the index and the search engine are all the same single file.  This is an implementaiton of this, indexing
 		into a postings file (and header), a vocabulary file.
+
+		The original generator writes one add_rsv() call per posting, which is fine for toy collections but produces more source
+		code than a compiler can cope with for anything larger.  The packed generators instead write each postings list as a
+		static const array of document ids grouped by impact (term frequency) and a table of segments (impact, start, end)
+		into that array, and each term's method is a single call to the loop in JASS_segment.h.  The segments are either in
+		increasing impact order (as index_postings::impact_order() generates them), or in decreasing impact order so that the
+		most important postings are processed first.
+
+		The type of the query object is not fixed by the generator, it is the typedef JASS_ci_query written to JASS_query.h once
+		the number of documents in the collection is known.  The accumulators are sized for exactly that many documents and the
+		top-k can be chosen at index time.  The postings can also be sharded into several source files (JASS_postings.cpp,
+		JASS_postings_1.cpp, ...) so that large compiled indexes can be compiled in parallel, the shards are listed in
+		JASS_postings.cmake (which compiled_index/CMakeLists.txt includes).
+
+		The generated files can either be linked into JASS_compiled_index or, together with JASS_plugin.cpp, built into a shared
+		object that describes itself (version, documents, top-k, vocabulary, postings, and primary keys) and is loaded at run
+		time by JASS_compiled_index_loader.
 	*/
 	class serialise_ci : public index_manager::delegate
 		{
+		public:
+			/*!
+				@enum generator
+				@brief The kind of code to generate for each postings list.
+			*/
+			enum generator
+				{
+				ADD_RSV,							///< One add_rsv() statement per posting.
+				PACKED,							///< Static arrays of document ids grouped by impact (low to high) processed by a templated loop.
+				PACKED_IMPACT_ORDERED		///< As PACKED, but with the highest impact segment first.
+				};
+
 		private:
-			file postings_file;						///< The postings file
-			file postings_header_file;				///< The header file for the postings file (so that the vocab can point to the methods)
-			file vocab_file;						///< The vocabulary file (also know as the dictionary file)
-			file primary_key_file;					///< The list of primary keys.
+			static constexpr size_t integers_per_line = 16;	///< The number of document ids written on each line of a packed array.
+
+		private:
+			std::vector<std::unique_ptr<file_buffered>> postings_file;	///< The postings files (one per shard)
+			file_buffered postings_header_file;		///< The header file for the postings file (so that the vocab can point to the methods)
+			file_buffered vocab_file;				///< The vocabulary file (also know as the dictionary file)
+			file_buffered primary_key_file;			///< The list of primary keys.
+			file_buffered query_header_file;		///< The header file describing the type of the query object (JASS_ci_query)
 			uint64_t terms;							///< The number of terms in the vocabulary file.
+			uint64_t documents;						///< The number of documents (primary keys) in the collection, including document 0.
+			size_t top_k;								///< The largest top-k the compiled index can be asked for.
+			generator kind;							///< The kind of code to generate for each postings list.
+			allocator_pool memory;					///< Memory used to impact order each postings list (when generating packed code).
+
+		private:
+			/*
+				SERIALISE_CI::WRITE_ADD_RSV()
+				-----------------------------
+			*/
+			/*!
+				@brief Write the method for a term as one add_rsv() statement per posting.
+				@param code [out] The generated code is appended to this.
+				@param term [in] The term name.
+				@param postings [in] The postings list.
+			*/
+			static void write_add_rsv(std::ostream &code, const slice &term, const index_postings &postings);
+
+			/*
+				SERIALISE_CI::WRITE_SEGMENTS()
+				------------------------------
+			*/
+			/*!
+				@brief Write the document ids array and the segments array for a term, with the segments in the order given.
+				@param code [out] The generated code is appended to this.
+				@param term [in] The term name.
+				@param headers [in] The impact headers (of an impact ordered postings list) in the order they are to be written.
+			*/
+			template <typename HEADERS>
+			static void write_segments(std::ostream &code, const slice &term, const HEADERS &headers);
+
+			/*
+				SERIALISE_CI::WRITE_PACKED()
+				----------------------------
+			*/
+			/*!
+				@brief Write the postings list for a term as static arrays of document ids and segments, and a method that processes them.
+				@param code [out] The generated code is appended to this.
+				@param term [in] The term name.
+				@param postings [in] The postings list.
+				@param impact_ordered [in] Write the segments highest impact first (rather than lowest impact first).
+			*/
+			void write_packed(std::ostream &code, const slice &term, const index_postings &postings, bool impact_ordered);
 
 		public:
 			/*
@@ -42,9 +123,12 @@ namespace JASS
 				----------------------------
 			*/
 			/*!
-				Constructor
+				@brief Constructor
+				@param kind [in] The kind of code to generate for each postings list (default = ADD_RSV).
+				@param top_k [in] The largest top-k the compiled index can be asked for (default = 10).
+				@param shards [in] The number of source files to spread the postings over (default = 1).
 			*/
-			serialise_ci();
+			explicit serialise_ci(generator kind = ADD_RSV, size_t top_k = 10, size_t shards = 1);
 
 			/*
 				SERIALISE_CI::~SERIALISE_CI()
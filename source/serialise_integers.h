@@ -12,7 +12,7 @@
  */
 #pragma once
 
-#include "file.h"
+#include "file_buffered.h"
 #include "index_manager.h"
 
 namespace JASS
@@ -35,7 +35,7 @@ namespace JASS
 	class serialise_integers : public index_manager::delegate
 		{
 		private:
-			file postings_file;						///< The postings file
+			file_buffered postings_file;				///< The postings file
 			allocator_pool memory;					///< Memory used to store the impact-ordered postings list.
 
 		public:
@@ -47,7 +47,7 @@ namespace JASS
 				Constructor
 			*/
 			serialise_integers() :
-				postings_file("postings.bin", "w+b")
+				postings_file("postings.bin", 16 * 1024 * 1024, true)
 				{
 				/* Nothing. */
 				}
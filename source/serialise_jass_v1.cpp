@@ -4,12 +4,21 @@
 	Copyright (c) 2016 Andrew Trotman
 	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
 */
+#include <string.h>
+
+#include <mutex>
+#include <thread>
 #include <algorithm>
+#include <condition_variable>
 
+#include "file.h"
 #include "reverse.h"
+#include "asserts.h"
 #include "checksum.h"
 #include "serialise_jass_v1.h"
+#include "compress_integer_all.h"
 #include "index_manager_sequential.h"
+#include "compress_integer_per_segment.h"
 
 namespace JASS
 	{
@@ -19,6 +28,12 @@ namespace JASS
 	*/
 	serialise_jass_v1::~serialise_jass_v1()
 		{
+		/*
+			If there were no primary keys then the deferred postings lists have not yet been serialised.
+		*/
+		if (!deferred.empty())
+			serialise_deferred();
+
 		/*
 			Sort then serialise the contents of the CIvocab.bin file.
 		*/
@@ -44,41 +59,94 @@ namespace JASS
 		}
 
 	/*
-		SERIALISE_JASS_V1::WRITE_POSTINGS()
-		-----------------------------------
+		List of the JASS compressors that can be used in a JASS v1 index (those that are safe to share between threads).
 	*/
-	size_t serialise_jass_v1::write_postings(const index_postings &postings_list, size_t &number_of_impacts)
+	static const std::pair<serialise_jass_v1::jass_v1_codex, const char *> jass_v1_compressors[] =
 		{
-		/*
-			Keep a track of where the postings are stored on disk.
-		*/
-		size_t postings_location = postings.tell();
+		{serialise_jass_v1::jass_v1_codex::uncompressed, "None"},
+		{serialise_jass_v1::jass_v1_codex::variable_byte, "Variable Byte"},
+		{serialise_jass_v1::jass_v1_codex::stream_vbyte, "Stream VByte"},
+		{serialise_jass_v1::jass_v1_codex::elias_fano, "Elias-Fano"},
+		{serialise_jass_v1::jass_v1_codex::elias_fano_partitioned, "Partitioned Elias-Fano"},
+		{serialise_jass_v1::jass_v1_codex::simd_bp128, "SIMD-BP128"},
+		{serialise_jass_v1::jass_v1_codex::pfor_delta, "PForDelta"},
+		{serialise_jass_v1::jass_v1_codex::opt_pfor, "OptPFor"},
+		{serialise_jass_v1::jass_v1_codex::per_segment, "Per-Segment Best"},
+		};
+
+	/*
+		SERIALISE_JASS_V1::GET_CODEX()
+		------------------------------
+	*/
+	bool serialise_jass_v1::get_codex(const std::string &name, jass_v1_codex &codex)
+		{
+		for (const auto &known : jass_v1_compressors)
+			if (name == known.second)
+				{
+				codex = known.first;
+				return true;
+				}
+
+		return false;
+		}
 
+	/*
+		SERIALISE_JASS_V1::COMPRESSOR()
+		-------------------------------
+	*/
+	compress_integer &serialise_jass_v1::compressor(jass_v1_codex codex)
+		{
+		for (const auto &known : jass_v1_compressors)
+			if (codex == known.first)
+				return compress_integer_all::get_by_name(known.second);
+
+		return compress_integer_all::get_by_name("None");
+		}
+
+	/*
+		SERIALISE_JASS_V1::SERIALISE_POSTINGS()
+		---------------------------------------
+	*/
+	size_t serialise_jass_v1::serialise_postings(std::vector<uint8_t> &buffer, const index_postings &postings_list, allocator &memory) const
+		{
 		/*
 			Impact order the postings list.
 		*/
 		const auto &impact_ordered = postings_list.impact_order(memory);
 
 		/*
-			Compute the number of impact headers we're going to see.
+			Compute the number of impact headers we're going to see and (an upper bound on) how large the serialised postings list will be.
+			The bound allows each segment one byte per posting (and a little) more than the uncompressed size.
 		*/
-		number_of_impacts = impact_ordered.impact_size();
+		size_t number_of_impacts = impact_ordered.impact_size();
+		size_t number_of_postings = 0;
+		size_t longest_segment = 0;
+		for (const auto &header : impact_ordered)
+			{
+			number_of_postings += header.size();
+			longest_segment = (std::max)(longest_segment, header.size());
+			}
+
+		size_t start_of_data = number_of_impacts * sizeof(uint64_t) + (number_of_impacts + 1) * impact_header_size;
+		buffer.resize(start_of_data + number_of_postings * (sizeof(uint32_t) + 1) + number_of_impacts * 64);
+		uint8_t *into = buffer.data();
+		uint32_t *segment = static_cast<uint32_t *>(memory.malloc(longest_segment * sizeof(uint32_t) + 1));
 
 		/*
-			Write out each pointer to an impact header.
+			Write out each pointer to an impact header (relative to the start of the buffer).
 		*/
-		uint64_t offset = postings_location + number_of_impacts * sizeof(offset);
-		uint64_t impact_header_size = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint64_t) + sizeof(uint32_t);
+		uint64_t offset = number_of_impacts * sizeof(offset);
 		for (size_t which = 0; which < number_of_impacts; which++)
 			{
-			postings.write(&offset, sizeof(offset));
+			memcpy(into, &offset, sizeof(offset));
+			into += sizeof(offset);
 			offset += impact_header_size;
 			}
 
 		/*
-			Write out each impact header.
+			Write out each impact header and (after all the headers) its compressed segment.
 		*/
-		size_t start_of_postings = offset + impact_header_size;			// +1 because there's a 0 terminator at the end
+		uint64_t start_of_postings = offset + impact_header_size;			// +1 because there's a 0 terminator at the end
 
 		for (const auto &header : reverse(impact_ordered))
 			{
@@ -86,71 +154,104 @@ namespace JASS
 				impact score (uint16_t).
 			*/
 			uint16_t score = static_cast<uint16_t>(header.impact_score);
-			postings.write(&score, sizeof(score));
+			memcpy(into, &score, sizeof(score));
+			into += sizeof(score);
 
 			/*
 				start loction on disk (uint64_t).
 			*/
-			uint64_t start_location = start_of_postings;
-			postings.write(&start_location, sizeof(start_location));
+			memcpy(into, &start_of_postings, sizeof(start_of_postings));
+			into += sizeof(start_of_postings);
 
 			/*
-				This is where compression happens - but since we're not initially compressing no work is necessary.
+				JASS v1 counts document ids from 0 (but the indexer counts from 1 so we subtract 1).  Uncompressed postings are
+				stored as document ids, compressed postings as d-gaps.
 			*/
+			uint32_t previous = 0;
+			uint32_t *document_id = segment;
+			for (const auto &posting : header)
+				{
+				*document_id = static_cast<uint32_t>(posting - 1) - previous;
+				if (codex != jass_v1_codex::uncompressed)
+					previous = static_cast<uint32_t>(posting - 1);
+				document_id++;
+				}
+
+			size_t compressed_size = encoder->encode(buffer.data() + start_of_postings, buffer.size() - start_of_postings, segment, header.size());
+			JASS_assert(compressed_size != 0 || header.size() == 0);
 
 			/*
 				end location on disk (uint64_t).
 			*/
-			uint64_t finish_location = start_of_postings + header.size() * sizeof(uint32_t);
-			postings.write(&finish_location, sizeof(finish_location));
+			uint64_t finish_location = start_of_postings + compressed_size;
+			memcpy(into, &finish_location, sizeof(finish_location));
+			into += sizeof(finish_location);
 
 			/*
 				the number of document ids with this impact score (length of the impact segment measured in doc_ids).
 			*/
 			uint32_t frequency = static_cast<uint32_t>(header.size());
-			postings.write(&frequency, sizeof(frequency));
+			memcpy(into, &frequency, sizeof(frequency));
+			into += sizeof(frequency);
+
 			start_of_postings = finish_location;
 			}
 
 		/*
 			write out a "blank" impact header
 		*/
-		uint8_t zero[] = {0, 0,  0, 0, 0, 0, 0, 0, 0, 0,   0, 0, 0, 0, 0, 0, 0, 0,   0, 0, 0, 0};
-		postings.write(&zero, sizeof(zero));
+		memset(into, 0, impact_header_size);
 
-		/*
-			write out each postings list segment.
-		*/
-		for (const auto &header : reverse(impact_ordered))
-			for (const auto &posting : header)
-				{
-				/*
-					uncompressed is an array of uint32_t integers counting from 0 (but the indexer counts from 1 so we subtract 1).
-				*/
-				uint32_t document_id = static_cast<uint32_t>(posting - 1);
-				postings.write(&document_id, sizeof(document_id));
-				}
+		buffer.resize(start_of_postings);
 
-		/*
-			return the location of the postings list on disk
-		*/
-		return postings_location;
+		return number_of_impacts;
 		}
 
 	/*
-		SERIALISE_JASS_V1::OPERATOR()()
-		-------------------------------
+		SERIALISE_JASS_V1::RELOCATE()
+		-----------------------------
 	*/
-	void serialise_jass_v1::operator()(const slice &term, const index_postings &postings)
+	void serialise_jass_v1::relocate(std::vector<uint8_t> &buffer, size_t number_of_impacts, uint64_t base)
+		{
+		uint8_t *pointers = buffer.data();
+		uint8_t *headers = pointers + number_of_impacts * sizeof(uint64_t);
+		uint64_t location;
+
+		for (size_t which = 0; which < number_of_impacts; which++)
+			{
+			/*
+				The pointer to the impact header.
+			*/
+			memcpy(&location, pointers + which * sizeof(location), sizeof(location));
+			location += base;
+			memcpy(pointers + which * sizeof(location), &location, sizeof(location));
+
+			/*
+				The start and end locations in the impact header (which come after the uint16_t impact score).
+			*/
+			uint8_t *header = headers + which * impact_header_size + sizeof(uint16_t);
+			memcpy(&location, header, sizeof(location));
+			location += base;
+			memcpy(header, &location, sizeof(location));
+
+			memcpy(&location, header + sizeof(location), sizeof(location));
+			location += base;
+			memcpy(header + sizeof(location), &location, sizeof(location));
+			}
+		}
+
+	/*
+		SERIALISE_JASS_V1::WRITE_POSTINGS()
+		-----------------------------------
+	*/
+	void serialise_jass_v1::write_postings(const slice &term, std::vector<uint8_t> &buffer, size_t number_of_impacts)
 		{
 		/*
-			write the postings list to disk and keep a track of where it is.
+			Keep a track of where the postings are stored on disk, then write them there.
 		*/
-		memory.rewind();
-		size_t number_of_impact_scores;
-
-		size_t postings_location;
-		postings_location = write_postings(postings, number_of_impact_scores);
+		uint64_t postings_location = postings.tell();
+		relocate(buffer, number_of_impacts, postings_location);
+		postings.write(buffer.data(), buffer.size());
 
 		/*
 			Find out where we are in the vocabulary strings file - which will be the start of the term before we write it.
@@ -162,11 +263,121 @@ namespace JASS
 		*/
 		vocabulary_strings.write(term.address(), term.size());
 		vocabulary_strings.write("\0", 1);
-		
+
 		/*
 			Keep a copy of the term and the detals of the postings list for later sorting and writeing to CIvocab.bin
 		*/
-		index_key.push_back(vocab_tripple(term, term_offset, postings_location, number_of_impact_scores));
+		index_key.push_back(vocab_tripple(term, term_offset, postings_location, number_of_impacts));
+		}
+
+	/*
+		SERIALISE_JASS_V1::SERIALISE_DEFERRED()
+		---------------------------------------
+	*/
+	void serialise_jass_v1::serialise_deferred(void)
+		{
+		/*
+			Each slot holds a serialised postings list that has not yet been written to disk.  Postings list number n goes into
+			slot n % slots, and the workers can only get a fixed number of postings lists ahead of the writer.
+		*/
+		class slot
+			{
+			public:
+				std::vector<uint8_t> buffer;
+				size_t number_of_impacts = 0;
+				bool ready = false;
+			};
+
+		size_t total = deferred.size();
+		size_t slots = threads * 4;
+		std::vector<slot> in_flight(slots);
+		std::mutex lock;
+		std::condition_variable changed;
+		size_t next_to_serialise = 0;
+		size_t next_to_write = 0;
+
+		/*
+			A worker claims the next postings list, serialises it into its slot, and tells the writer it is ready.
+		*/
+		auto worker = [&]()
+			{
+			allocator_pool arena(1024 * 1024);
+
+			while (1)
+				{
+				size_t which;
+					{
+					std::unique_lock<std::mutex> critical_section(lock);
+					changed.wait(critical_section, [&](){ return next_to_serialise >= total || next_to_serialise < next_to_write + slots; });
+					if (next_to_serialise >= total)
+						return;
+					which = next_to_serialise++;
+					}
+
+				slot &into = in_flight[which % slots];
+				arena.rewind();
+				into.number_of_impacts = serialise_postings(into.buffer, *deferred[which].second, arena);
+
+					{
+					std::lock_guard<std::mutex> critical_section(lock);
+					into.ready = true;
+					}
+				changed.notify_all();
+				}
+			};
+
+		std::vector<std::thread> workers;
+		for (size_t thread = 0; thread < threads; thread++)
+			workers.push_back(std::thread(worker));
+
+		/*
+			The writer writes the postings lists in order, as they become ready.
+		*/
+		for (next_to_write = 0; next_to_write < total; )
+			{
+			slot &from = in_flight[next_to_write % slots];
+				{
+				std::unique_lock<std::mutex> critical_section(lock);
+				changed.wait(critical_section, [&](){ return from.ready; });
+				}
+
+			write_postings(deferred[next_to_write].first, from.buffer, from.number_of_impacts);
+
+				{
+				std::lock_guard<std::mutex> critical_section(lock);
+				from.ready = false;
+				next_to_write++;
+				}
+			changed.notify_all();
+			}
+
+		for (auto &thread : workers)
+			thread.join();
+
+		deferred.clear();
+		}
+
+	/*
+		SERIALISE_JASS_V1::OPERATOR()()
+		-------------------------------
+	*/
+	void serialise_jass_v1::operator()(const slice &term, const index_postings &postings)
+		{
+		/*
+			If we're serialising in parallel then wait until we have all the postings lists.
+		*/
+		if (threads > 1)
+			{
+			deferred.push_back(std::make_pair(term, &postings));
+			return;
+			}
+
+		/*
+			write the postings list to disk and keep a track of where it is.
+		*/
+		memory.rewind();
+		size_t number_of_impact_scores = serialise_postings(serialised, postings, memory);
+		write_postings(term, serialised, number_of_impact_scores);
 		}
 
 	/*
@@ -175,6 +386,12 @@ namespace JASS
 	*/
 	void serialise_jass_v1::operator()(size_t document_id, const slice &primary_key)
 		{
+		/*
+			The postings lists have all been seen, so serialise any we've been holding back.
+		*/
+		if (!deferred.empty())
+			serialise_deferred();
+
 		primary_key_offsets.push_back(primary_keys.tell());
 		primary_keys.write(primary_key.address(), primary_key.size());
 		primary_keys.write("\0", 1);
@@ -195,25 +412,104 @@ namespace JASS
 		/*
 			Serialise the index.
 		*/
+		for (size_t threads = 1; threads <= 4; threads += 3)
+			{
+			{
+			serialise_jass_v1 serialiser(threads);
+			index.iterate(serialiser);
+			}
+
+			/*
+				Checksum the index to make sure its correct (and the same regardless of the number of threads).
+			*/
+			auto checksum = checksum::fletcher_16_file("CIvocab.bin");
+			JASS_assert(checksum == 10977);
+
+			checksum = checksum::fletcher_16_file("CIvocab_terms.bin");
+			JASS_assert(checksum == 25057);
+
+			checksum = checksum::fletcher_16_file("CIpostings.bin");
+			JASS_assert(checksum == 9785);
+
+			checksum = checksum::fletcher_16_file("CIdoclist.bin");
+			JASS_assert(checksum == 3045);
+			}
+
+		/*
+			Decode every segment of every postings list into (impact, document id) pairs.
+		*/
+		auto decode_index = []()
+			{
+			std::string vocab;
+			std::string postings_file;
+			file::read_entire_file("CIvocab.bin", vocab);
+			file::read_entire_file("CIpostings.bin", postings_file);
+			const uint8_t *postings = reinterpret_cast<const uint8_t *>(postings_file.data());
+			compress_integer &decoder = compressor(static_cast<jass_v1_codex>(postings[0]));
+
+			std::vector<uint32_t> everything;
+			std::vector<compress_integer::integer> decoded;
+			for (size_t tripple = 0; tripple < vocab.size(); tripple += 3 * sizeof(uint64_t))
+				{
+				uint64_t offset, impacts;
+				memcpy(&offset, vocab.data() + tripple + sizeof(uint64_t), sizeof(offset));
+				memcpy(&impacts, vocab.data() + tripple + 2 * sizeof(uint64_t), sizeof(impacts));
+				for (uint64_t which = 0; which < impacts; which++)
+					{
+					uint64_t header, start, end;
+					uint16_t impact;
+					uint32_t frequency;
+					memcpy(&header, postings + offset + which * sizeof(header), sizeof(header));
+					memcpy(&impact, postings + header, sizeof(impact));
+					memcpy(&start, postings + header + sizeof(impact), sizeof(start));
+					memcpy(&end, postings + header + sizeof(impact) + sizeof(start), sizeof(end));
+					memcpy(&frequency, postings + header + sizeof(impact) + sizeof(start) + sizeof(end), sizeof(frequency));
+
+					decoded.assign(frequency + 256, 0);
+					if (postings[0] == static_cast<uint8_t>(jass_v1_codex::uncompressed))
+						decoder.decode(decoded.data(), frequency, postings + start, end - start);
+					else
+						decoder.decode_d1(decoded.data(), frequency, postings + start, end - start);
+
+					everything.push_back(impact);
+					everything.insert(everything.end(), decoded.begin(), decoded.begin() + frequency);
+					}
+				}
+			return everything;
+			};
+
+		/*
+			Every codex must give the same postings as the uncompressed index.
+		*/
 		{
 		serialise_jass_v1 serialiser;
 		index.iterate(serialiser);
 		}
+		auto uncompressed = decode_index();
+		for (const auto &codex : jass_v1_compressors)
+			{
+			{
+			serialise_jass_v1 serialiser(2, codex.first);
+			index.iterate(serialiser);
+			}
+			JASS_assert(decode_index() == uncompressed);
+
+			jass_v1_codex found;
+			JASS_assert(get_codex(codex.second, found) && found == codex.first);
+			}
 
 		/*
-			Checksum the index to make sure its correct.
+			A configured per-segment compressor.
 		*/
-		auto checksum = checksum::fletcher_16_file("CIvocab.bin");
-		JASS_assert(checksum == 10977);
-
-		checksum = checksum::fletcher_16_file("CIvocab_terms.bin");
-		JASS_assert(checksum == 25057);
-
-		checksum = checksum::fletcher_16_file("CIpostings.bin");
-		JASS_assert(checksum == 9785);
+		{
+		compress_integer_per_segment fastest("scb", compress_integer_per_segment::FASTEST);
+		serialise_jass_v1 serialiser(2, jass_v1_codex::per_segment, &fastest);
+		index.iterate(serialiser);
+		}
+		JASS_assert(decode_index() == uncompressed);
 
-		checksum = checksum::fletcher_16_file("CIdoclist.bin");
-		JASS_assert(checksum == 3045);
+		jass_v1_codex found;
+		JASS_assert(!get_codex("QMX Improved", found));
 
 		puts("serialise_jass_v1::PASSED");
 		}
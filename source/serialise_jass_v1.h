@@ -12,10 +12,14 @@
 */
 #pragma once
 
-#include "file.h"
+#include <vector>
+#include <utility>
+
 #include "slice.h"
+#include "file_buffered.h"
 #include "index_postings.h"
 #include "index_manager.h"
+#include "compress_integer.h"
 
 namespace JASS
 	{
@@ -55,7 +59,8 @@ namespace JASS
 
 		CIpostings.bin: This file contains all the postings lists compressed using the same codex. This is different from 
 		ATIRE which allows each postings list to be encoded using a different codex. The first byte of this file specifies 
-		the codex where s=uncompressed, c=VarByte, 8=Simple8, q=QMX, Q=QMX4D, R=QMX0D. This is followed by the postings lists.
+		the codex where s=uncompressed, c=VarByte, 8=Simple8, q=QMX, Q=QMX4D, R=QMX0D (and JASS v2 adds V=Stream VByte, e=Elias-Fano,
+		E=Partitioned Elias-Fano, b=SIMD-BP128, f=PForDelta, F=OptPFor, a=per-segment). This is followed by the postings lists.
 		A postings list is: a list of 64-bit pointer to headers. Each header is (uint16_t impact_score, uint64_t start,
 		uint64_t end, uint32_t impact_frequency) where impact_score is the impact value, start and end are pointers to the
 		compressed docids, and impact_frequency is the number of dociment_ids in the list. The header is terminated with a 
@@ -66,13 +71,15 @@ namespace JASS
 	*/
 	class serialise_jass_v1 : public index_manager::delegate
 		{
-		private:
+		public:
 			/*
 				ENUM CLASS JASS_V1_CODEX
 				------------------------
 			*/
 			/*!
 				@brief The compression scheme that is active
+				@details JASS v1 only knew the first few of these, the rest are the JASS v2 codexes that can be used in a JASS v1 index.
+				Except for uncompressed, the postings are D1 encoded (and the first d-gap is from 0).
 			*/
 			enum class jass_v1_codex
 				{
@@ -81,9 +88,17 @@ namespace JASS
 				simple_8 = '8',					///< Postings are compressed using ATIRE's simple-8 encoding.
 				qmx = 'q',							///< Postings are compressed using QMX (with difference encoding).
 				qmx_d4 = 'Q',						///< Postings are compressed using QMX with Lemire's D4 delta encoding.
-				qmx_d0 = 'R'						///< Postings are compressed using QMX without delta encoding.
+				qmx_d0 = 'R',						///< Postings are compressed using QMX without delta encoding.
+				stream_vbyte = 'V',				///< Postings are compressed using Stream VByte.
+				elias_fano = 'e',					///< Postings are compressed using Elias-Fano.
+				elias_fano_partitioned = 'E',	///< Postings are compressed using Partitioned Elias-Fano.
+				simd_bp128 = 'b',					///< Postings are compressed using SIMD-BP128.
+				pfor_delta = 'f',					///< Postings are compressed using PForDelta.
+				opt_pfor = 'F',					///< Postings are compressed using OptPFor.
+				per_segment = 'a'					///< Each segment is compressed using whichever codex is best for it (see compress_integer_per_segment).
 				};
 
+		private:
 			/*
 				CLASS SERIALISE_JASS_V1::VOCAB_TRIPPLE
 				--------------------------------------
@@ -136,26 +151,75 @@ namespace JASS
 				};
 			
 		private:
-			file vocabulary_strings;						///< The concatination of UTS-8 encoded unique tokens in the collection.
-			file vocabulary;									///< Details about the term (including a pointer to the term, a pointer to the postings, and the quantum count.
-			file postings;										///< The postings lists.
-			file primary_keys;								///< The list of external identifiers (document primary keys).
+			static constexpr size_t impact_header_size = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint64_t) + sizeof(uint32_t);	///< Size of a (packed) impact header on disk.
+
+		private:
+			file_buffered vocabulary_strings;				///< The concatination of UTS-8 encoded unique tokens in the collection.
+			file_buffered vocabulary;							///< Details about the term (including a pointer to the term, a pointer to the postings, and the quantum count.
+			file_buffered postings;								///< The postings lists.
+			file_buffered primary_keys;						///< The list of external identifiers (document primary keys).
 			std::vector<vocab_tripple> index_key;		///< The entry point into the JASS v1 index is CIvocab.bin, the index key.
 			std::vector<uint64_t> primary_key_offsets;///< A list of locations (on disk) of each primary key.
 			allocator_pool memory;							///< Memory used to store the impact-ordered postings list.
+			std::vector<uint8_t> serialised;				///< The serialised postings list (before it is written to disk).
+			size_t threads;									///< The number of threads to use to serialise the postings lists.
+			std::vector<std::pair<slice, const index_postings *>> deferred;		///< When serialising in parallel, the postings lists waiting to be serialised.
+			jass_v1_codex codex;								///< The codex used to compress the postings.
+			compress_integer *encoder;						///< The compressor for that codex (which must be safe to use from many threads at once).
 
 		private:
+			/*
+				SERIALISE_JASS_V1::SERIALISE_POSTINGS()
+				---------------------------------------
+			*/
+			/*!
+				@brief Convert the postings list to the JASS v1 format and serialise it into a memory buffer.
+				@details All the offsets in the serialised postings list are relative to the start of the buffer, relocate() must
+				be called to turn them into locations within CIpostings.bin.  This method does not change the object's state and so
+				is safe to call from many threads at once (each with their own buffer and memory).  Each segment is compressed
+				with the codex given to the constructor.
+				@param buffer [out] The serialised postings list.
+				@param postings [in] The postings list to serialise.
+				@param memory [in] The arena used for the impact-ordered postings list.
+				@return The number of distinct impact scores seen in the postings list.
+			*/
+			size_t serialise_postings(std::vector<uint8_t> &buffer, const index_postings &postings, allocator &memory) const;
+
+			/*
+				SERIALISE_JASS_V1::RELOCATE()
+				-----------------------------
+			*/
+			/*!
+				@brief Turn the buffer-relative offsets of a serialised postings list into file offsets.
+				@param buffer [in, out] The serialised postings list (as generated by serialise_postings()).
+				@param number_of_impacts [in] The number of impact headers in the postings list.
+				@param base [in] The location (in CIpostings.bin) at which the buffer will be written.
+			*/
+			static void relocate(std::vector<uint8_t> &buffer, size_t number_of_impacts, uint64_t base);
+
 			/*
 				SERIALISE_JASS_V1::WRITE_POSTINGS()
 				-----------------------------------
 			*/
 			/*!
-				@brief Convert the postings list to the JASS v1 format and serialise it to disk.
-				@param postings [in] The postings list to serialise.
-				@param number_of_impacts [out] The number of distinct impact scores seen in the postings list.
-				@return The location (in CIpostings.bin) of the start of the serialised postings list.
+				@brief Write a serialised postings list and its term to disk, and remember the term's details for the vocabulary.
+				@param term [in] The term.
+				@param buffer [in, out] The serialised postings list (as generated by serialise_postings()), which is relocated in place.
+				@param number_of_impacts [in] The number of distinct impact scores in the postings list.
 			*/
-			size_t write_postings(const index_postings &postings, size_t &number_of_impacts);
+			void write_postings(const slice &term, std::vector<uint8_t> &buffer, size_t number_of_impacts);
+
+			/*
+				SERIALISE_JASS_V1::SERIALISE_DEFERRED()
+				---------------------------------------
+			*/
+			/*!
+				@brief Serialise all the deferred postings lists in parallel.
+				@details Each worker thread claims the next postings list, impact orders and serialises it into its own buffer.
+				The calling thread is the only writer, it writes each buffer in the order the terms were given to this object
+				so the index is identical to that produced by a single thread.  The number of buffers in flight is bounded.
+			*/
+			void serialise_deferred(void);
 
 		public:
 			/*
@@ -164,21 +228,54 @@ namespace JASS
 			*/
 			/*!
 				@brief Constructor
+				@details If threads is greater than 1 then the postings lists are not serialised as they are given to this object,
+				they are serialised in parallel once all the postings lists have been seen (that is, on the first primary key).  So
+				the postings lists (and terms) must remain valid until then, as they do with index_manager::iterate().
+				@param threads [in] The number of threads to use to serialise the postings lists (default = 1).
+				@param codex [in] The codex to compress the postings with, which must be one get_codex() knows (default = uncompressed).
+				@param encoder [in] The compressor to use for that codex, or nullptr for the one in compress_integer_all (default = nullptr).  This is
+				how a configured compress_integer_per_segment is given to the serialiser, it must outlive this object.
 			*/
-			serialise_jass_v1() :
-				vocabulary_strings("CIvocab_terms.bin", "w+b"),
-				vocabulary("CIvocab.bin", "w+b"),
-				postings("CIpostings.bin", "w+b"),
-				primary_keys("CIdoclist.bin", "w+b"),
-				memory(1024 * 1024)								///< The allocation block size is currently 1MB, big enough for most postings lists (but it'll grow for larger ones).
+			explicit serialise_jass_v1(size_t threads = 1, jass_v1_codex codex = jass_v1_codex::uncompressed, compress_integer *encoder = nullptr) :
+				vocabulary_strings("CIvocab_terms.bin"),
+				vocabulary("CIvocab.bin"),
+				postings("CIpostings.bin", 16 * 1024 * 1024, true),			// the postings are most of the index so write them asynchronously
+				primary_keys("CIdoclist.bin"),
+				memory(1024 * 1024),								///< The allocation block size is currently 1MB, big enough for most postings lists (but it'll grow for larger ones).
+				threads(threads == 0 ? 1 : threads),
+				codex(codex),
+				encoder(encoder == nullptr ? &compressor(codex) : encoder)
 				{
 				/*
-					For the initial bring-up the postings ar not compressed.
+					The first byte of the postings file is the codex.
 				*/
-				uint8_t codex = static_cast<uint8_t>(jass_v1_codex::uncompressed);
-				postings.write(&codex, 1);
+				uint8_t codex_byte = static_cast<uint8_t>(codex);
+				postings.write(&codex_byte, 1);
 				}
 
+			/*
+				SERIALISE_JASS_V1::GET_CODEX()
+				------------------------------
+			*/
+			/*!
+				@brief Find the JASS v1 codex for the JASS compressor of the given name (see compress_integer_all).
+				@param name [in] The name of the compressor.
+				@param codex [out] The JASS v1 codex.
+				@return true if the compressor can be used in a JASS v1 index, else false.
+			*/
+			static bool get_codex(const std::string &name, jass_v1_codex &codex);
+
+			/*
+				SERIALISE_JASS_V1::COMPRESSOR()
+				-------------------------------
+			*/
+			/*!
+				@brief Return the compressor for a JASS v1 codex that get_codex() knows.
+				@param codex [in] The JASS v1 codex.
+				@return A reference to the compressor.
+			*/
+			static compress_integer &compressor(jass_v1_codex codex);
+
 			/*
 				SERIALISE_JASS_V1::~SERIALISE_JASS_V1()
 				--------------------------------------
@@ -0,0 +1,269 @@
+/*
+	SIMD.H
+	------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief SIMD helper routines.
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <immintrin.h>
+
+#include <random>
+#include <vector>
+
+#include "cpu.h"
+#include "asserts.h"
+
+namespace JASS
+	{
+	/*
+		CLASS SIMD
+		----------
+	*/
+	/*!
+		@brief SIMD helper routines.
+		@details JASS is compiled for SSE4.2 so the SSE versions of these routines are always available.  If the compiler is
+		targeting AVX2 (for example, -mavx2) then the wider versions are also used.
+	*/
+	class simd
+		{
+		public:
+			/*
+				SIMD::CUMULATIVE_SUM()
+				----------------------
+			*/
+			/*!
+				@brief Compute the cumulative sum (prefix sum) of the 4 integers in a register.
+				@param elements [in] The integers.
+				@return {elements[0], elements[0] + elements[1], elements[0] + elements[1] + elements[2], ...}.
+			*/
+			static inline __m128i cumulative_sum(__m128i elements)
+				{
+				elements = _mm_add_epi32(elements, _mm_slli_si128(elements, 4));
+				return _mm_add_epi32(elements, _mm_slli_si128(elements, 8));
+				}
+
+			/*
+				SIMD::CUMULATIVE_SUM()
+				----------------------
+			*/
+			/*!
+				@brief Compute the cumulative sum (prefix sum) of the 8 integers in a register.
+				@param elements [in] The integers.
+				@return {elements[0], elements[0] + elements[1], elements[0] + elements[1] + elements[2], ...}.
+			*/
+			JASS_TARGET_AVX2 static inline __m256i cumulative_sum(__m256i elements)
+				{
+				/*
+					Sum within each 128-bit lane then add the last element of the low lane to each element of the high lane.
+				*/
+				elements = _mm256_add_epi32(elements, _mm256_slli_si256(elements, 4));
+				elements = _mm256_add_epi32(elements, _mm256_slli_si256(elements, 8));
+				__m256i low_lane_total = _mm256_shuffle_epi32(elements, 0xFF);
+				return _mm256_add_epi32(elements, _mm256_permute2x128_si256(low_lane_total, low_lane_total, 0x08));
+				}
+
+			/*
+				SIMD::CUMULATIVE_SUM()
+				----------------------
+			*/
+			/*!
+				@brief Compute the cumulative sum (prefix sum) of the 16 integers in a register.
+				@param elements [in] The integers.
+				@return {elements[0], elements[0] + elements[1], elements[0] + elements[1] + elements[2], ...}.
+			*/
+			JASS_TARGET_AVX512 static inline __m512i cumulative_sum(__m512i elements)
+				{
+				/*
+					valignd of a register with itself rotates whole integers (across lanes), zeroing the ones that wrapped around
+					makes this the usual log(n) shift and add.
+				*/
+				elements = _mm512_add_epi32(elements, _mm512_maskz_alignr_epi32(0xFFFE, elements, elements, 15));
+				elements = _mm512_add_epi32(elements, _mm512_maskz_alignr_epi32(0xFFFC, elements, elements, 14));
+				elements = _mm512_add_epi32(elements, _mm512_maskz_alignr_epi32(0xFFF0, elements, elements, 12));
+				return _mm512_add_epi32(elements, _mm512_maskz_alignr_epi32(0xFF00, elements, elements, 8));
+				}
+
+			/*
+				SIMD::CUMULATIVE_SUM_SSE4_2()
+				-----------------------------
+			*/
+			/*!
+				@brief Compute the cumulative sum (prefix sum) of the array in place using SSE4.2 instructions.
+				@param data [in, out] The integers.
+				@param length [in] The number of integers in data.
+				@param previous [in] The value preceding data[0], this is added to every element.
+			*/
+			static inline void cumulative_sum_sse4_2(uint32_t *data, size_t length, uint32_t previous)
+				{
+				uint32_t *end = data + length;
+
+				__m128i carry = _mm_set1_epi32(previous);
+				for (; data + 4 <= end; data += 4)
+					{
+					__m128i elements = _mm_add_epi32(cumulative_sum(_mm_loadu_si128(reinterpret_cast<__m128i *>(data))), carry);
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(data), elements);
+					carry = _mm_shuffle_epi32(elements, 0xFF);
+					}
+
+				previous = static_cast<uint32_t>(_mm_cvtsi128_si32(carry));
+				for (; data < end; data++)
+					previous = *data += previous;
+				}
+
+			/*
+				SIMD::CUMULATIVE_SUM_AVX2()
+				---------------------------
+			*/
+			/*!
+				@brief Compute the cumulative sum (prefix sum) of the array in place using AVX2 instructions (8 at a time).
+				@param data [in, out] The integers.
+				@param length [in] The number of integers in data.
+				@param previous [in] The value preceding data[0], this is added to every element.
+			*/
+			JASS_TARGET_AVX2 static inline void cumulative_sum_avx2(uint32_t *data, size_t length, uint32_t previous)
+				{
+				uint32_t *end = data + length;
+
+				__m256i carry = _mm256_set1_epi32(previous);
+				const __m256i last = _mm256_set1_epi32(7);
+				for (; data + 8 <= end; data += 8)
+					{
+					__m256i elements = _mm256_add_epi32(cumulative_sum(_mm256_loadu_si256(reinterpret_cast<__m256i *>(data))), carry);
+					_mm256_storeu_si256(reinterpret_cast<__m256i *>(data), elements);
+					carry = _mm256_permutevar8x32_epi32(elements, last);
+					}
+
+				cumulative_sum_sse4_2(data, end - data, static_cast<uint32_t>(_mm256_extract_epi32(carry, 0)));
+				}
+
+			/*
+				SIMD::CUMULATIVE_SUM_AVX512()
+				-----------------------------
+			*/
+			/*!
+				@brief Compute the cumulative sum (prefix sum) of the array in place using AVX-512 instructions (16 at a time).
+				@param data [in, out] The integers.
+				@param length [in] The number of integers in data.
+				@param previous [in] The value preceding data[0], this is added to every element.
+			*/
+			JASS_TARGET_AVX512 static inline void cumulative_sum_avx512(uint32_t *data, size_t length, uint32_t previous)
+				{
+				uint32_t *end = data + length;
+
+				const uint32_t *start = data;
+				__m512i carry = _mm512_set1_epi32(previous);
+				const __m512i last = _mm512_set1_epi32(15);
+				for (; data + 16 <= end; data += 16)
+					{
+					__m512i elements = _mm512_add_epi32(cumulative_sum(_mm512_loadu_si512(data)), carry);
+					_mm512_storeu_si512(data, elements);
+					carry = _mm512_maskz_permutexvar_epi32(0xFFFF, last, elements);
+					}
+
+				cumulative_sum_avx2(data, end - data, data == start ? previous : data[-1]);
+				}
+
+			/*
+				SIMD::CUMULATIVE_SUM()
+				----------------------
+			*/
+			/*!
+				@brief Compute the cumulative sum (prefix sum) of the array in place, turning D1 encoded d-gaps back into the original integers.
+				@details This uses the widest instructions the CPU supports (see cpu::best()).
+				@param data [in, out] The integers.
+				@param length [in] The number of integers in data.
+				@param previous [in] The value preceding data[0], this is added to every element (default = 0).
+			*/
+			static inline void cumulative_sum(uint32_t *data, size_t length, uint32_t previous = 0)
+				{
+				switch (cpu::best())
+					{
+					case cpu::AVX512:
+						cumulative_sum_avx512(data, length, previous);
+						break;
+					case cpu::AVX2:
+						cumulative_sum_avx2(data, length, previous);
+						break;
+					default:
+						cumulative_sum_sse4_2(data, length, previous);
+						break;
+					}
+				}
+
+			/*
+				SIMD::PREFETCH()
+				----------------
+			*/
+			/*!
+				@brief Ask the CPU to start loading memory into cache (all levels) so that it is there when it is needed.
+				@details One prefetch is issued for each cache line the range touches.  Prefetching an address that isn't mapped does not fault.
+				@param address [in] The start of the memory.
+				@param bytes [in] The number of bytes to load (default = one byte, so one cache line).
+			*/
+			static inline void prefetch(const void *address, size_t bytes = 1)
+				{
+				const size_t cache_line = 64;
+				uintptr_t end = reinterpret_cast<uintptr_t>(address) + bytes;
+				for (uintptr_t line = reinterpret_cast<uintptr_t>(address) & ~(cache_line - 1); line < end; line += cache_line)
+					_mm_prefetch(reinterpret_cast<const char *>(line), _MM_HINT_T0);
+				}
+
+			/*
+				SIMD::UNITTEST()
+				----------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				std::mt19937 random(1);
+				std::vector<uint32_t> sequence;
+				std::vector<uint32_t> expected;
+
+				/*
+					Check all the short lengths (which exercise the tails) and a few long ones, using each instruction set this CPU supports.
+				*/
+				cpu::isa original = cpu::best();
+				for (cpu::isa instruction_set = cpu::SSE4_2; instruction_set <= original; instruction_set = static_cast<cpu::isa>(instruction_set + 1))
+					{
+					cpu::limit(instruction_set);
+					for (size_t length : {0, 1, 2, 3, 4, 5, 7, 8, 9, 11, 12, 15, 16, 17, 31, 32, 33, 47, 48, 49, 1000, 1023})
+						{
+						sequence.resize(length);
+						expected.resize(length);
+						uint32_t sum = 10;
+						for (size_t which = 0; which < length; which++)
+							{
+							sequence[which] = random() % 1000;
+							expected[which] = sum += sequence[which];
+							}
+
+						cumulative_sum(sequence.data(), sequence.size(), 10);
+						JASS_assert(sequence == expected);
+						}
+					}
+				cpu::limit(original);
+
+				/*
+					Prefetching does not change memory (and does not fault on addresses that aren't mapped)
+				*/
+				std::vector<uint32_t> before(expected);
+				prefetch(expected.data(), expected.size() * sizeof(expected[0]));
+				prefetch(nullptr, 256);
+				JASS_assert(expected == before);
+
+				puts("simd::PASSED");
+				}
+		};
+	}
@@ -30,7 +30,7 @@ namespace JASS
 	*/
 	class timer
 		{
-		private:
+		public:
 			/*
 				TYPEDEF TIMER::STOP_WATCH
 				-------------------------
@@ -41,6 +41,7 @@ namespace JASS
 			*/
 			typedef std::chrono::time_point<std::chrono::steady_clock, std::chrono::nanoseconds> stop_watch;
 
+		private:
 			/*
 				CLASS TIMER::DURATION
 				----------------------
@@ -28,6 +28,8 @@
 
 #include <string>
 
+#include "cpu.h"
+
 namespace JASS
 	{
 	/*!
@@ -65,6 +67,20 @@ namespace JASS
 				}
 
 
+			/*
+				VERSION::INSTRUCTION_SET()
+				--------------------------
+			*/
+			/*!
+				@brief Return a string saying which instruction set the SIMD code paths (see JASS::cpu) are using on this machine.
+				@details This is not part of build() because build() is written into generated files that should not depend on the machine.
+				@return A string.
+			*/
+			static std::string instruction_set(void)
+				{
+				return std::string("Using ") + cpu::name(cpu::best()) + std::string(" code paths");
+				}
+
 			/*
 				VERSION::CREDITS()
 				------------------
@@ -76,7 +92,9 @@ namespace JASS
 			static std::string credits(void)
 				{
 				return
-					build() + "\n"
+					build() + "\n" +
+					instruction_set() + "\n"
+					"\n"
 					"DESIGN & IMPLEMENTATION\n"
 					"-----------------------\n"
 					"Andrew Trotman\n"
@@ -102,6 +120,11 @@ namespace JASS
 					"Carry-8b         - Andrew Trotman\n"
 					"QMX Original     - Andrew Trotman\n"
 					"QMX Improved     - Andrew Trotman\n"
+					"Elias-Fano       - Andrew Trotman\n"
+					"SIMD-BP128       - Andrew Trotman\n"
+					"PForDelta        - Andrew Trotman\n"
+					"OptPFor          - Andrew Trotman\n"
+					"Per-Segment Best - Andrew Trotman\n"
 					"";
 				}
 		};
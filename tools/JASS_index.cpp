@@ -17,41 +17,67 @@
 #include "commandline.h"
 #include "serialise_ci.h"
 #include "instream_file.h"
+#include "file_buffered.h"
 #include "instream_memory.h"
 #include "serialise_jass_v1.h"
 #include "serialise_integers.h"
+#include "compress_integer_all.h"
 #include "instream_document_trec.h"
 #include "index_manager_sequential.h"
+#include "compress_integer_per_segment.h"
 
 /*
 	Declare the command line parameters
 */
 bool parameter_jass_v1_index = false;
 bool parameter_compiled_index = false;
+bool parameter_compiled_packed = false;
+bool parameter_compiled_impact_ordered = false;
+size_t parameter_compiled_top_k = 10;
+size_t parameter_compiled_shards = 1;
 bool parameter_uint32_index = false;
 std::string parameter_filename = "";
 bool parameter_quiet = false;
 bool parameter_help = false;
 size_t parameter_report_every_n = (std::numeric_limits<size_t>::max)();
+size_t parameter_threads = 1;
+std::array<bool, JASS::compress_integer_all::compressors_size> parameter_compressor = {};
+std::string parameter_per_segment_codexes = JASS::compress_integer_per_segment::all_codexes;
+bool parameter_per_segment_fastest = false;
 
-auto command_line_parameters = std::make_tuple
+auto command_line_parameters = std::tuple_cat
 	(
-	JASS::commandline::note("\nMISCELLANEOUS\n-------------"),
-	JASS::commandline::parameter("-q", "--nologo", "Suppress the banner.", parameter_quiet),
-	JASS::commandline::parameter("-?", "--help", "Print this help.", parameter_help),
-	JASS::commandline::parameter("-h", "--help", "Print this help.", parameter_help),
-	JASS::commandline::parameter("-H", "--help", "Print this help.", parameter_help),
-
-	JASS::commandline::note("\nREPORTING\n---------"),
-	JASS::commandline::parameter("-N", "--report-every", "<n> Report time and memory every <n> documents.", parameter_report_every_n),
-
-	JASS::commandline::note("\nFILE HANDLING\n-------------"),
-	JASS::commandline::parameter("-f", "--filename", "<filename> Filename to index.", parameter_filename),
-
-	JASS::commandline::note("\nINDEX GENERATION\n----------------"),
-	JASS::commandline::parameter("-I1", "--index_jass_v1", "Generate a JASS version 1 index.", parameter_jass_v1_index),
-	JASS::commandline::parameter("-Ic", "--index_compiled", "Generate a JASS compiled index.", parameter_compiled_index),
-	JASS::commandline::parameter("-Ib", "--index_binary", "Generate a binary dump of just the postings segments.", parameter_uint32_index)
+	std::make_tuple
+		(
+		JASS::commandline::note("\nMISCELLANEOUS\n-------------"),
+		JASS::commandline::parameter("-q", "--nologo", "Suppress the banner.", parameter_quiet),
+		JASS::commandline::parameter("-?", "--help", "Print this help.", parameter_help),
+		JASS::commandline::parameter("-h", "--help", "Print this help.", parameter_help),
+		JASS::commandline::parameter("-H", "--help", "Print this help.", parameter_help),
+
+		JASS::commandline::note("\nREPORTING\n---------"),
+		JASS::commandline::parameter("-N", "--report-every", "<n> Report time and memory every <n> documents.", parameter_report_every_n),
+
+		JASS::commandline::note("\nFILE HANDLING\n-------------"),
+		JASS::commandline::parameter("-f", "--filename", "<filename> Filename to index.", parameter_filename),
+
+		JASS::commandline::note("\nINDEX GENERATION\n----------------"),
+		JASS::commandline::parameter("-I1", "--index_jass_v1", "Generate a JASS version 1 index.", parameter_jass_v1_index),
+		JASS::commandline::parameter("-Ic", "--index_compiled", "Generate a JASS compiled index.", parameter_compiled_index),
+		JASS::commandline::parameter("-Cp", "--compiled_packed", "Generate the compiled index as packed arrays of document ids (rather than add_rsv() calls).", parameter_compiled_packed),
+		JASS::commandline::parameter("-Ci", "--compiled_impact_ordered", "Generate the compiled index as packed arrays, highest impact first.", parameter_compiled_impact_ordered),
+		JASS::commandline::parameter("-Ck", "--compiled_top_k", "<k> The largest top-k the compiled index can be asked for (default = 10).", parameter_compiled_top_k),
+		JASS::commandline::parameter("-Cs", "--compiled_shards", "<n> Spread the compiled index postings over <n> source files (default = 1).", parameter_compiled_shards),
+		JASS::commandline::parameter("-Ib", "--index_binary", "Generate a binary dump of just the postings segments.", parameter_uint32_index),
+		JASS::commandline::parameter("-t", "--threads", "<n> Use <n> threads to serialise the index (default = 1).", parameter_threads),
+
+		JASS::commandline::note("\nPER-SEGMENT COMPRESSION (-cA)\n-----------------------------"),
+		JASS::commandline::parameter("-Ps", "--per_segment_codexes", "<codexes> The JASS v1 codex letters to choose between (default = scVbfF).", parameter_per_segment_codexes),
+		JASS::commandline::parameter("-Pf", "--per_segment_fastest", "Choose the codex estimated to be fastest to decode (default = smallest).", parameter_per_segment_fastest),
+
+		JASS::commandline::note("\nJASS V1 INDEX COMPRESSION\n-------------------------")
+		),
+	JASS::compress_integer_all::parameterlist(parameter_compressor)
 	);
 
 /*
@@ -82,7 +108,7 @@ int main(int argc, const char *argv[])
 		}
 
 	if (!parameter_quiet)
-		std::cout << JASS::version::build() << "\n";
+		std::cout << JASS::version::build() << "\n" << JASS::version::instruction_set() << "\n";
 
 	if (parameter_filename == "")
 		std::cout << "filename needed";
@@ -90,6 +116,19 @@ int main(int argc, const char *argv[])
 	if (parameter_filename == "" || parameter_help)
 		exit(usage(argv[0]));
 
+	JASS::serialise_jass_v1::jass_v1_codex codex;
+	if (!JASS::serialise_jass_v1::get_codex(JASS::compress_integer_all::name(parameter_compressor), codex))
+		{
+		std::cout << JASS::compress_integer_all::name(parameter_compressor) << " cannot be used in a JASS v1 index\n";
+		exit(1);
+		}
+
+	if (parameter_per_segment_codexes.empty() || parameter_per_segment_codexes.find_first_not_of(JASS::compress_integer_per_segment::all_codexes) != std::string::npos)
+		{
+		std::cout << "-Ps must be one or more of the codex letters " << JASS::compress_integer_per_segment::all_codexes << " (not \"" << parameter_per_segment_codexes << "\")\n";
+		exit(1);
+		}
+
 	/*
 		Now call JASS
 	*/
@@ -166,7 +205,8 @@ int main(int argc, const char *argv[])
 	*/
 	if (parameter_compiled_index)
 		{
-		JASS::serialise_ci serialiser;
+		auto kind = parameter_compiled_impact_ordered ? JASS::serialise_ci::PACKED_IMPACT_ORDERED : parameter_compiled_packed ? JASS::serialise_ci::PACKED : JASS::serialise_ci::ADD_RSV;
+		JASS::serialise_ci serialiser(kind, parameter_compiled_top_k, parameter_compiled_shards);
 		index.iterate(serialiser);
 		}
 
@@ -175,7 +215,9 @@ int main(int argc, const char *argv[])
 	*/
 	if (parameter_jass_v1_index)
 		{
-		JASS::serialise_jass_v1 serialiser;
+		JASS::compress_integer_per_segment per_segment(parameter_per_segment_codexes, parameter_per_segment_fastest ? JASS::compress_integer_per_segment::FASTEST : JASS::compress_integer_per_segment::SMALLEST);
+		JASS::compress_integer *encoder = codex == JASS::serialise_jass_v1::jass_v1_codex::per_segment ? &per_segment : nullptr;
+		JASS::serialise_jass_v1 serialiser(parameter_threads, codex, encoder);
 		index.iterate(serialiser);
 		}
 
@@ -188,5 +230,11 @@ int main(int argc, const char *argv[])
 		index.iterate(serialiser);
 		}
 
+	/*
+		Report how fast the index was written to disk.
+	*/
+	if (JASS::file_buffered::bytes_written() != 0)
+		std::cout << "Bytes written:" << JASS::file_buffered::bytes_written() << " (" << JASS::file_buffered::bytes_per_second() / (1024 * 1024) << " MB/second)\n";
+
 	return 0;
 	}
@@ -0,0 +1,194 @@
+/*
+	BENCHMARK_HEAP.CPP
+	------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*
+	Compare the speed of the heaps used to keep the top-k during query processing (heap and heap_d_ary).
+
+	Each heap is driven the same way query::add_rsv() drives it: a stream of (document, impact) pairs is added to a set of
+	accumulators, an accumulator that gets into the top-k is added with push_back(), and one already in the top-k is promote()d.
+	The documents are drawn with a skewed distribution (as they are in real postings) so that there are plenty of promotions.
+	The time to process the stream, and the number of calls to each method, is reported for k = 10, 100, and 1000.
+*/
+#include <limits>
+#include <random>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+#include <stdint.h>
+
+#include "heap.h"
+#include "timer.h"
+#include "heap_d_ary.h"
+#include "commandline.h"
+
+/*
+	PARAMETERS
+	----------
+*/
+size_t parameter_documents = 1'000'000;				///< Number of accumulators
+size_t parameter_postings = 10'000'000;				///< Number of postings to process
+size_t parameter_repeats = 5;							///< Number of times to run each (the fastest is reported)
+
+std::string parameters_errors;						///< Any errors as a result of command line parsing
+auto parameters = std::make_tuple					///< The  command line parameter block
+	(
+	JASS::commandline::parameter("-d", "--documents", "Number of documents (accumulators) [default = 1000000]", parameter_documents),
+	JASS::commandline::parameter("-p", "--postings",  "Number of postings to process [default = 10000000]", parameter_postings),
+	JASS::commandline::parameter("-r", "--repeats",   "Number of times to run each benchmark (the fastest is reported) [default = 5]", parameter_repeats)
+	);
+
+/*
+	CLASS ADD_RSV_COMPARE
+	---------------------
+*/
+/*!
+	@brief The same comparison as query::add_rsv_compare.
+*/
+class add_rsv_compare
+	{
+	public:
+		forceinline int operator() (uint16_t *a, uint16_t *b) const
+			{
+			return *a < *b ? -1 : *a > *b ? 1 : a < b ? -1 : a == b ? 0 : 1;
+			}
+	};
+
+/*
+	CLASS POSTING
+	-------------
+*/
+/*!
+	@brief A document and the impact to add to its accumulator
+*/
+class posting
+	{
+	public:
+		uint32_t document_id;		///< The document
+		uint16_t impact;				///< The impact score
+	};
+
+/*
+	BENCHMARK()
+	-----------
+*/
+/*!
+	@brief Process the postings using the given heap to keep the top-k.
+	@param postings [in] The postings to process.
+	@param top_k [in] The k in top-k.
+	@param checksum [out] The sum of the top-k document ids (so the heaps can be checked against each other).
+	@param push_backs [out] The number of calls to push_back().
+	@param promotions [out] The number of calls to promote().
+	@return The time taken (in nanoseconds).
+*/
+template <typename HEAP>
+uint64_t benchmark(const std::vector<posting> &postings, size_t top_k, size_t &checksum, size_t &push_backs, size_t &promotions)
+	{
+	std::vector<uint16_t> accumulators(parameter_documents, 0);
+	std::vector<uint16_t *> accumulator_pointers(top_k);
+	HEAP top_results(accumulator_pointers[0], top_k);
+	add_rsv_compare cmp;
+	uint16_t zero = 0;
+	size_t needed_for_top_k = top_k;
+	accumulator_pointers[0] = &zero;
+	push_backs = promotions = 0;
+
+	auto timer = JASS::timer::start();
+	for (const auto &current : postings)
+		{
+		uint16_t *which = &accumulators[current.document_id];
+		*which += current.impact;
+		if (cmp(which, accumulator_pointers[0]) >= 0)
+			{
+			if (needed_for_top_k > 0)
+				{
+				if (*which == current.impact)
+					{
+					accumulator_pointers[--needed_for_top_k] = which;
+					if (needed_for_top_k == 0)
+						top_results.make_heap();
+					}
+				}
+			else
+				{
+				*which -= current.impact;
+				int prior_compare = cmp(which, accumulator_pointers[0]);
+				*which += current.impact;
+
+				if (prior_compare < 0)
+					{
+					push_backs++;
+					top_results.push_back(which);
+					}
+				else
+					{
+					promotions++;
+					top_results.promote(which);
+					}
+				}
+			}
+		}
+	uint64_t took = JASS::timer::stop(timer).nanoseconds();
+
+	checksum = 0;
+	for (const auto &pointer : accumulator_pointers)
+		checksum += pointer - &accumulators[0];
+
+	return took;
+	}
+
+/*
+	MAIN()
+	------
+*/
+int main(int argc, const char *argv[])
+	{
+	auto success = JASS::commandline::parse(argc, argv, parameters, parameters_errors);
+	if (!success)
+		{
+		std::cout << parameters_errors;
+		exit(1);
+		}
+
+	/*
+		Generate the postings with a skewed (Zipfian-like) choice of document and small impacts
+	*/
+	std::mt19937 random(1);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	std::vector<posting> postings(parameter_postings);
+	for (auto &current : postings)
+		{
+		current.document_id = static_cast<uint32_t>(parameter_documents * uniform(random) * uniform(random) * uniform(random));
+		current.impact = 1 + random() % 16;
+		}
+
+	std::cout << "k, heap(ms), heap_d_ary(ms), push_back, promote\n";
+	for (size_t top_k : {10, 100, 1000})
+		{
+		uint64_t binary = (std::numeric_limits<uint64_t>::max)();
+		uint64_t d_ary = (std::numeric_limits<uint64_t>::max)();
+		size_t binary_checksum;
+		size_t d_ary_checksum;
+		size_t push_backs;
+		size_t promotions;
+
+		for (size_t repeat = 0; repeat < parameter_repeats; repeat++)
+			{
+			binary = (std::min)(binary, benchmark<JASS::heap<uint16_t *, add_rsv_compare>>(postings, top_k, binary_checksum, push_backs, promotions));
+			d_ary = (std::min)(d_ary, benchmark<JASS::heap_d_ary<uint16_t *, add_rsv_compare>>(postings, top_k, d_ary_checksum, push_backs, promotions));
+			}
+
+		if (binary_checksum != d_ary_checksum)
+			{
+			std::cout << "The heaps disagree on the top-" << top_k << "\n";
+			exit(1);
+			}
+
+		std::cout << top_k << ", " << binary / 1'000'000.0 << ", " << d_ary / 1'000'000.0 << ", " << push_backs << ", " << promotions << "\n";
+		}
+
+	return 0;
+	}
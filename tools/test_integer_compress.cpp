@@ -13,8 +13,15 @@
 	repreated until end of file
 
 	An example file is Lemire's dump of .gov2 which can be found here: https://lemire.me/data/integercompression2014.html
+
+	In benchmark mode (-B) every compressor (or those selected) is run over the same lists and the encode and decode
+	throughput, bits per integer, and cycles per integer are reported for each list length (bucketed by powers of 2).
+	Synthetic lists with Zipfian d-gaps can be generated with -Z.
 */
+#include <cmath>
+#include <array>
 #include <limits>
+#include <random>
 #include <iostream>
 
 #include <stdio.h>
@@ -22,6 +29,12 @@
 #include <stdint.h>
 #include <string.h>
 
+#ifdef _MSC_VER
+	#include <intrin.h>
+#else
+	#include <x86intrin.h>
+#endif
+
 #include "file.h"
 #include "timer.h"
 #include "commandline.h"
@@ -40,6 +53,86 @@ std::vector<uint64_t> decompress_count;				// Buffer holding the number of posti
 std::vector<uint64_t> compressed_size;				// Buffer holding the size (in bytes) of each compressed string
 std::vector<uint64_t> compressed_count;				// Buffer holding the number of postings list of this length, should be identical to decompress_count
 
+/*
+	In benchmark mode lists are bucketed by the floor of the log2 of their length.
+*/
+#define NUMBER_OF_BUCKETS 33
+
+/*
+	To simulate a cold cache we write to a buffer larger than the cache before each decode.
+*/
+#define CACHE_FLUSH_SIZE (64 * 1024 * 1024)
+
+/*
+	CLASS BENCHMARK_STATISTICS
+	--------------------------
+	The sum of the measurements of one compressor on all the lists in one bucket.
+*/
+class benchmark_statistics
+	{
+	public:
+		uint64_t lists = 0;							// The number of lists
+		uint64_t integers = 0;						// The total number of integers in those lists
+		uint64_t bytes = 0;							// The total size of the lists once compressed
+		uint64_t encode_nanoseconds = 0;			// The time taken to encode
+		uint64_t encode_cycles = 0;				// The number of CPU cycles taken to encode
+		uint64_t decode_nanoseconds = 0;			// The time taken to decode (from a warm cache)
+		uint64_t decode_cycles = 0;				// The number of CPU cycles taken to decode (from a warm cache)
+		uint64_t cold_nanoseconds = 0;			// The time taken to decode (from a cold cache)
+		uint64_t cold_cycles = 0;					// The number of CPU cycles taken to decode (from a cold cache)
+		uint64_t failures = 0;						// The number of lists that could not be encoded or did not decode correctly
+
+	public:
+		/*
+			BENCHMARK_STATISTICS::OPERATOR+=()
+			----------------------------------
+		*/
+		benchmark_statistics &operator+=(const benchmark_statistics &with)
+			{
+			lists += with.lists;
+			integers += with.integers;
+			bytes += with.bytes;
+			encode_nanoseconds += with.encode_nanoseconds;
+			encode_cycles += with.encode_cycles;
+			decode_nanoseconds += with.decode_nanoseconds;
+			decode_cycles += with.decode_cycles;
+			cold_nanoseconds += with.cold_nanoseconds;
+			cold_cycles += with.cold_cycles;
+			failures += with.failures;
+			return *this;
+			}
+	};
+
+/*
+	CYCLES()
+	--------
+	Return the CPU's time stamp counter.
+*/
+static inline uint64_t cycles(void)
+	{
+	return __rdtsc();
+	}
+
+/*
+	PER_SECOND()
+	------------
+	Return the number of integers processed per second, or 0 if no time was taken.
+*/
+static double per_second(uint64_t integers, uint64_t nanoseconds)
+	{
+	return nanoseconds == 0 ? 0 : integers * 1'000'000'000.0 / nanoseconds;
+	}
+
+/*
+	PER_INTEGER()
+	-------------
+	Return value divided by the number of integers, or 0 if there are no integers.
+*/
+static double per_integer(uint64_t value, uint64_t integers)
+	{
+	return integers == 0 ? 0 : static_cast<double>(value) / integers;
+	}
+
 /*
 	DRAW_HISTOGRAM()
 	----------------
@@ -56,13 +149,12 @@ void draw_histogram(void)
 /*
 	GENERATE_DIFFERENCES()
 	----------------------
-	Compute the d1-gap delta's of the postings list (consequetive differences)
+	Compute the d1-gap delta's of the first length integers of the postings list (consequetive differences)
 */
-void generate_differences(std::vector<uint32_t> &postings_list)
+void generate_differences(std::vector<uint32_t> &postings_list, size_t length)
 	{
 	uint32_t previous = 0;
-	size_t length = postings_list.size();
-	
+
 	for (size_t current = 0; current < length; current++)
 		{
 		uint32_t was = postings_list[current];
@@ -89,6 +181,258 @@ void generate_example(const std::string &filename)
 		}
 	}
 
+/*
+	GENERATE_ZIPFIAN()
+	------------------
+	Generate lists whose d-gaps are drawn from a Zipfian distribution with the given skew.  The lengths of the lists are drawn
+	uniformly on a log scale (between 1 and max_length) so that each length bucket is equally well represented.  As the
+	longer lists must fit in the collection, the largest d-gap is 2 * documents / length.  The same seed is used each time
+	so that the same file is generated each time.
+*/
+void generate_zipfian(const std::string &filename, size_t lists, double skew, uint64_t max_length, uint64_t documents)
+	{
+	JASS::file output(filename, "w+b");
+	std::mt19937_64 random(1);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	std::vector<uint32_t> list;
+
+	max_length = (std::min)(max_length, documents);
+	for (size_t which = 0; which < lists; which++)
+		{
+		uint64_t length = (std::max)(static_cast<uint64_t>(1), static_cast<uint64_t>(std::exp(uniform(random) * std::log(static_cast<double>(max_length)))));
+		double largest_gap = (std::max)(2.0, 2.0 * documents / length);
+
+		list.clear();
+		uint64_t document_id = 0;
+		for (uint64_t posting = 0; posting < length; posting++)
+			{
+			/*
+				Invert the (continuous approximation of the) Zipfian CDF on [1, largest_gap].
+			*/
+			double probability = uniform(random);
+			double gap;
+			if (std::fabs(skew - 1.0) < 1e-9)
+				gap = std::pow(largest_gap, probability);
+			else
+				gap = std::pow(probability * (std::pow(largest_gap, 1.0 - skew) - 1.0) + 1.0, 1.0 / (1.0 - skew));
+
+			document_id += (std::max)(static_cast<uint64_t>(1), static_cast<uint64_t>(gap));
+			if (document_id >= documents)
+				break;
+			list.push_back(static_cast<uint32_t>(document_id));
+			}
+
+		uint32_t list_length = static_cast<uint32_t>(list.size());
+		output.write(&list_length, sizeof(list_length));
+		output.write(list.data(), list.size() * sizeof(list[0]));
+		}
+	}
+
+/*
+	FLUSH_CACHE()
+	-------------
+	Write to a buffer larger than the CPU's cache so that nothing we care about is still in the cache.
+*/
+void flush_cache(void)
+	{
+	static std::vector<uint8_t> buffer(CACHE_FLUSH_SIZE);
+	static uint8_t sum = 0;
+
+	for (size_t byte = 0; byte < buffer.size(); byte += 64)
+		sum += ++buffer[byte];
+	}
+
+/*
+	BENCHMARK()
+	-----------
+	Run each of the chosen compressors on each of the postings lists in the file and keep statistics by length bucket.
+	The warm cache decode is straight after the encode (so the compressed list is already in cache), the cold cache
+	decode (if asked for) is after flushing the cache.
+*/
+void benchmark(FILE *fp, const std::vector<size_t> &codecs, std::vector<std::array<benchmark_statistics, NUMBER_OF_BUCKETS>> &statistics, bool cold, uint64_t report_every)
+	{
+	uint32_t length;
+	uint32_t term_count = 0;
+
+	statistics.resize(codecs.size());
+
+	while (fread(&length, sizeof(length), 1, fp)  == 1)
+		{
+		term_count++;
+
+		/*
+			Make sure length is not too large, then read the list and convert into d1-gaps.
+		*/
+		if (length > postings_list.size())
+			exit(printf("fatal error: NUMBER_OF_DOCUMENTS is smaller than the length of this postings list (%lld vs %lld)", (long long)NUMBER_OF_DOCUMENTS, (long long)length));
+
+		if (fread(&postings_list[0], sizeof(postings_list[0]), length, fp) != length)
+			exit(printf("i/o error\n"));
+
+		generate_differences(postings_list, length);
+
+		size_t bucket = 0;
+		while ((static_cast<uint64_t>(2) << bucket) <= length)
+			bucket++;
+
+		for (size_t which = 0; which < codecs.size(); which++)
+			{
+			JASS::compress_integer &shrinkerator = JASS::compress_integer_all::get_by_index(codecs[which]);
+			benchmark_statistics &stats = statistics[which][bucket];
+
+			/*
+				Encode
+			*/
+			auto timer = JASS::timer::start();
+			uint64_t start = cycles();
+			uint64_t size_in_bytes_once_compressed = shrinkerator.encode(&compressed_postings_list[0], compressed_postings_list.size() * sizeof(compressed_postings_list[0]), &postings_list[0], length);
+			uint64_t encode_cycles = cycles() - start;
+			auto encode_nanoseconds = JASS::timer::stop(timer).nanoseconds();
+
+			if (size_in_bytes_once_compressed == 0 && length != 0)
+				{
+				stats.failures++;
+				continue;
+				}
+
+			/*
+				Decode from a warm cache
+			*/
+			timer = JASS::timer::start();
+			start = cycles();
+			shrinkerator.decode(&decompressed_postings_list[0], length, &compressed_postings_list[0], size_in_bytes_once_compressed);
+			uint64_t decode_cycles = cycles() - start;
+			auto decode_nanoseconds = JASS::timer::stop(timer).nanoseconds();
+
+			/*
+				Decode from a cold cache
+			*/
+			uint64_t cold_cycles = 0;
+			uint64_t cold_nanoseconds = 0;
+			if (cold)
+				{
+				flush_cache();
+				timer = JASS::timer::start();
+				start = cycles();
+				shrinkerator.decode(&decompressed_postings_list[0], length, &compressed_postings_list[0], size_in_bytes_once_compressed);
+				cold_cycles = cycles() - start;
+				cold_nanoseconds = JASS::timer::stop(timer).nanoseconds();
+				}
+
+			/*
+				Verify
+			*/
+			if (memcmp(&postings_list[0], &decompressed_postings_list[0], length * sizeof(postings_list[0])) != 0)
+				{
+				stats.failures++;
+				continue;
+				}
+
+			stats.lists++;
+			stats.integers += length;
+			stats.bytes += size_in_bytes_once_compressed;
+			stats.encode_nanoseconds += encode_nanoseconds;
+			stats.encode_cycles += encode_cycles;
+			stats.decode_nanoseconds += decode_nanoseconds;
+			stats.decode_cycles += decode_cycles;
+			stats.cold_nanoseconds += cold_nanoseconds;
+			stats.cold_cycles += cold_cycles;
+			}
+
+		if (term_count % report_every == 0)
+			std::cerr << "Terms processed:" << term_count << std::endl;
+		}
+	}
+
+/*
+	REPORT_ROW()
+	------------
+	Write out one row of the benchmark results in the given format ("text", "csv", or "json").
+*/
+void report_row(const std::string &format, const char *codec, uint64_t min_length, uint64_t max_length, const benchmark_statistics &stats, bool cold, bool first)
+	{
+	double bits_per_integer = per_integer(stats.bytes * 8, stats.integers);
+	double encode_per_second = per_second(stats.integers, stats.encode_nanoseconds);
+	double encode_cycles = per_integer(stats.encode_cycles, stats.integers);
+	double decode_per_second = per_second(stats.integers, stats.decode_nanoseconds);
+	double decode_cycles = per_integer(stats.decode_cycles, stats.integers);
+	double cold_per_second = per_second(stats.integers, stats.cold_nanoseconds);
+	double cold_cycles = per_integer(stats.cold_cycles, stats.integers);
+
+	if (format == "json")
+		{
+		std::cout << (first ? "" : ",\n") << "{\"codec\":\"" << codec << "\", \"min_length\":" << min_length << ", \"max_length\":" << max_length;
+		std::cout << ", \"lists\":" << stats.lists << ", \"integers\":" << stats.integers << ", \"bits_per_integer\":" << bits_per_integer;
+		std::cout << ", \"encode_integers_per_second\":" << encode_per_second << ", \"encode_cycles_per_integer\":" << encode_cycles;
+		std::cout << ", \"decode_integers_per_second\":" << decode_per_second << ", \"decode_cycles_per_integer\":" << decode_cycles;
+		if (cold)
+			std::cout << ", \"cold_decode_integers_per_second\":" << cold_per_second << ", \"cold_decode_cycles_per_integer\":" << cold_cycles;
+		std::cout << ", \"failures\":" << stats.failures << "}";
+		}
+	else
+		{
+		char separator = format == "csv" ? ',' : ' ';
+		if (format == "csv")
+			std::cout << '"' << codec << '"';
+		else
+			std::cout << '\'' << codec << '\'';
+		std::cout << separator << min_length << separator << max_length << separator << stats.lists << separator << stats.integers << separator << bits_per_integer;
+		std::cout << separator << encode_per_second << separator << encode_cycles << separator << decode_per_second << separator << decode_cycles;
+		if (cold)
+			std::cout << separator << cold_per_second << separator << cold_cycles;
+		std::cout << separator << stats.failures << '\n';
+		}
+	}
+
+/*
+	REPORT()
+	--------
+	Write out the benchmark results for each compressor, one row per length bucket followed by one for all lengths.
+*/
+void report(const std::string &format, const std::vector<size_t> &codecs, const std::vector<std::array<benchmark_statistics, NUMBER_OF_BUCKETS>> &statistics, bool cold)
+	{
+	if (format == "json")
+		std::cout << "[\n";
+	else
+		{
+		char separator = format == "csv" ? ',' : ' ';
+		std::cout << "Codec" << separator << "MinLength" << separator << "MaxLength" << separator << "Lists" << separator << "Integers" << separator << "BitsPerInteger";
+		std::cout << separator << "EncodeIntegersPerSecond" << separator << "EncodeCyclesPerInteger" << separator << "DecodeIntegersPerSecond" << separator << "DecodeCyclesPerInteger";
+		if (cold)
+			std::cout << separator << "ColdDecodeIntegersPerSecond" << separator << "ColdDecodeCyclesPerInteger";
+		std::cout << separator << "Failures\n";
+		}
+
+	bool first = true;
+	for (size_t which = 0; which < codecs.size(); which++)
+		{
+		const char *codec = JASS::compress_integer_all::get_name(codecs[which]);
+		benchmark_statistics all;
+		uint64_t longest = 0;
+
+		for (size_t bucket = 0; bucket < NUMBER_OF_BUCKETS; bucket++)
+			{
+			const benchmark_statistics &stats = statistics[which][bucket];
+			if (stats.lists == 0 && stats.failures == 0)
+				continue;
+
+			uint64_t min_length = bucket == 0 ? 0 : static_cast<uint64_t>(1) << bucket;
+			uint64_t max_length = (static_cast<uint64_t>(2) << bucket) - 1;
+			report_row(format, codec, min_length, max_length, stats, cold, first);
+			first = false;
+
+			all += stats;
+			longest = max_length;
+			}
+
+		report_row(format, codec, 0, longest, all, cold, first);
+		first = false;
+		}
+
+	if (format == "json")
+		std::cout << "\n]\n";
+	}
+
 /*
 	USAGE()
 	-------
@@ -112,6 +456,14 @@ int main(int argc, const char *argv[])
 	*/
 	uint64_t report_every = (std::numeric_limits<uint64_t>::max)();							// print a message every this number of postings lists
 	bool generate = false;																// should we generate a sample file (usually false)
+	bool generate_zipf = false;														// should we generate a file of Zipfian d-gaps
+	size_t zipf_lists = 1000;															// the number of lists to generate
+	std::string zipf_skew = "1.0";													// the skew of the Zipfian distribution
+	size_t zipf_max_length = 1 << 20;												// the length of the longest list to generate
+	size_t zipf_documents = NUMBER_OF_DOCUMENTS;									// the number of documents in the generated collection
+	bool benchmark_mode = false;														// should we benchmark all the compressors
+	bool benchmark_cold = false;														// should we also benchmark from a cold cache
+	std::string format = "text";														// the benchmark output format
 	std::string filename = "";															// the name of the postings list file to check with
 	std::array<bool, JASS::compress_integer_all::compressors_size> selectors = {};		// which compressor does the user select
 	auto command_line = JASS::compress_integer_all::parameterlist(selectors);			// get list of avaiable compressors
@@ -128,6 +480,15 @@ int main(int argc, const char *argv[])
 			(
 			JASS::commandline::note("\nGENERATE\n--------"),
 			JASS::commandline::parameter("-G", "--Generate", "generate a sample file for checking (you are unlikely to want to do this)", generate),
+			JASS::commandline::parameter("-Z", "--Zipfian_generate", "generate a file of lists with Zipfian d-gaps", generate_zipf),
+			JASS::commandline::parameter("-L", "--Zipfian_lists", "<n> the number of lists to generate (default = 1000)", zipf_lists),
+			JASS::commandline::parameter("-S", "--Zipfian_skew", "<s> the skew of the Zipfian distribution (default = 1.0)", zipf_skew),
+			JASS::commandline::parameter("-M", "--Zipfian_max_length", "<n> the length of the longest list (default = 1048576)", zipf_max_length),
+			JASS::commandline::parameter("-D", "--Zipfian_documents", "<n> the number of documents in the collection (default = 20971520)", zipf_documents),
+			JASS::commandline::note("\nBENCHMARK\n---------"),
+			JASS::commandline::parameter("-B", "--Benchmark", "benchmark all the compressors (or those selected) on the same lists", benchmark_mode),
+			JASS::commandline::parameter("-C", "--Cold", "also benchmark decoding from a cold cache (slow)", benchmark_cold),
+			JASS::commandline::parameter("-F", "--Format", "<format> benchmark output format: text, csv, or json (default = text)", format),
 			JASS::commandline::note("\nREPORTING\n---------"),
 			JASS::commandline::parameter("-N", "--report-every", "<n> Report time and memory every <n> documents.", report_every)
 			)
@@ -155,8 +516,17 @@ int main(int argc, const char *argv[])
 		generate_example(filename);
 		return 0;
 		}
+	if (generate_zipf)
+		{
+		std::cout << "Generate Zipfian " << filename << '\n';
+		generate_zipfian(filename, zipf_lists, strtod(zipf_skew.c_str(), nullptr), zipf_max_length, (std::min)(zipf_documents, static_cast<size_t>(NUMBER_OF_DOCUMENTS)));
+		return 0;
+		}
+	if (format != "text" && format != "csv" && format != "json")
+		usage(argv[0], all_parameters);
 	JASS::compress_integer &shrinkerator = JASS::compress_integer_all::compressor(selectors);
-	std::cout << "Check " << JASS::compress_integer_all::name(selectors) << " on file " << filename << '\n';
+	if (!benchmark_mode)
+		std::cout << "Check " << JASS::compress_integer_all::name(selectors) << " on file " << filename << '\n';
 
 	/*
 		Initialise by setting the count buffers to 0
@@ -176,6 +546,27 @@ int main(int argc, const char *argv[])
 	if (fp == nullptr)
 		exit(printf("cannot open %s\n", filename.c_str()));
 
+	/*
+		In benchmark mode run all the selected compressors (or all compressors if none are selected).
+	*/
+	if (benchmark_mode)
+		{
+		std::vector<size_t> codecs;
+		for (size_t which = 0; which < JASS::compress_integer_all::compressors_size; which++)
+			if (selectors[which])
+				codecs.push_back(which);
+		if (codecs.size() == 0)
+			for (size_t which = 0; which < JASS::compress_integer_all::compressors_size; which++)
+				codecs.push_back(which);
+
+		std::vector<std::array<benchmark_statistics, NUMBER_OF_BUCKETS>> statistics;
+		benchmark(fp, codecs, statistics, benchmark_cold, report_every);
+		fclose(fp);
+		report(format, codecs, statistics, benchmark_cold);
+
+		return 0;
+		}
+
 	/*
 		Iterate through each postings list in the file
 	*/
@@ -204,7 +595,7 @@ int main(int argc, const char *argv[])
 		/*
 			convert into d1-gaps
 		*/
-		generate_differences(postings_list);
+		generate_differences(postings_list, length);
 
 		/*
 			Compress
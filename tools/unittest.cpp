@@ -4,7 +4,10 @@
 	Copyright (c) 2016-2017 Andrew Trotman
 	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
 */
+#include "cpu.h"
 #include "file.h"
+#include "numa.h"
+#include "simd.h"
 #include "ascii.h"
 #include "maths.h"
 #include "query.h"
@@ -14,13 +17,15 @@
 #include "unicode.h"
 #include "version.h"
 #include "reverse.h"
+#include "result_cache.h"
 #include "checksum.h"
 #include "decode_d0.h"
 #include "decode_d1.h"
 #include "bitstring.h"
 #include "hash_table.h"
+#include "postings_cache.h"
 #include "run_export.h"
-#include "top_k_heap.h"
+#include "heap_d_ary.h"
 #include "top_k_qsort.h"
 #include "binary_tree.h"
 #include "commandline.h"
@@ -29,6 +34,7 @@
 #include "hash_pearson.h"
 #include "parser_query.h"
 #include "channel_file.h"
+#include "file_buffered.h"
 #include "dynamic_array.h"
 #include "allocator_cpp.h"
 #include "instream_file.h"
@@ -36,6 +42,10 @@
 #include "allocator_pool.h"
 #include "index_postings.h"
 #include "accumulator_2d.h"
+#include "accumulator_simple.h"
+#include "accumulator_epoch.h"
+#include "accumulator_hash.h"
+#include "accumulator_bitmap.h"
 #include "instream_memory.h"
 #include "run_export_trec.h"
 #include "allocator_memory.h"
@@ -44,6 +54,7 @@
 #include "instream_file_star.h"
 #include "compress_integer_all.h"
 #include "compress_integer_none.h"
+#include "compress_integer_pfor.h"
 #include "index_postings_impact.h"
 #include "compress_general_zlib.h"
 #include "instream_document_trec.h"
@@ -58,10 +69,15 @@
 #include "compress_integer_qmx_original.h"
 #include "compress_integer_qmx_improved.h"
 #include "compress_integer_carryover_12.h"
+#include "compress_integer_bitpack_128.h"
+#include "compress_integer_per_segment.h"
 #include "compress_integer_variable_byte.h"
 #include "compress_integer_simple_9_packed.h"
 #include "compress_integer_simple_8b_packed.h"
 #include "compress_integer_simple_16_packed.h"
+#include "compress_integer_elias_fano_partitioned.h"
+
+#include "../anytime/JASS_anytime_cost.h"
 
 /*
 	MAIN()
@@ -105,6 +121,9 @@ int main(void)
 
 		puts("file");
 		JASS::file::unittest();
+
+		puts("file_buffered");
+		JASS::file_buffered::unittest();
 		
 		puts("bitstring");
 		JASS::bitstring::unittest();
@@ -241,14 +260,41 @@ int main(void)
 		puts("compress_integer_carry_8b");
 		JASS::compress_integer_carry_8b::unittest();
 
+		puts("compress_integer_elias_fano");
+		JASS::compress_integer_elias_fano::unittest();
+
+		puts("compress_integer_elias_fano_partitioned");
+		JASS::compress_integer_elias_fano_partitioned::unittest();
+
+		puts("compress_integer_bitpack_128");
+		JASS::compress_integer_bitpack_128::unittest();
+
+		puts("compress_integer_pfor");
+		JASS::compress_integer_pfor::unittest();
+
+		puts("compress_integer_per_segment");
+		JASS::compress_integer_per_segment::unittest();
+
 		puts("accumulator_2d");
 		JASS::accumulator_2d<uint32_t, 1>::unittest();
 
+		puts("accumulator_bitmap");
+		JASS::accumulator_bitmap<uint32_t, 1>::unittest();
+
+		puts("accumulator_simple");
+		JASS::accumulator_simple<uint32_t, 1>::unittest();
+
+		puts("accumulator_epoch");
+		JASS::accumulator_epoch<uint32_t, 1>::unittest();
+
+		puts("accumulator_hash");
+		JASS::accumulator_hash<uint32_t, 1>::unittest();
+
 		puts("pointer_box");
 		JASS::pointer_box<int>::unittest();
 
-		puts("top_k_heap");
-		JASS::top_k_heap<int>::unittest();
+		puts("heap_d_ary");
+		JASS::heap_d_ary<int *, std::less<int *>>::unittest();
 
 		puts("query");
 		JASS::query<uint16_t, 1, 1>::unittest();
@@ -256,18 +302,36 @@ int main(void)
 		puts("decode_d0");
 		JASS::decoder_d0::unittest();
 
+		puts("cpu");
+		JASS::cpu::unittest();
+
+		puts("numa");
+		JASS::numa::unittest();
+
+		puts("simd");
+		JASS::simd::unittest();
+
 		puts("decode_d1");
 		JASS::decoder_d1::unittest();
 
 		puts("run_export_trec");
 		JASS::run_export_trec::unittest();
 
+		puts("result_cache");
+		JASS::result_cache::unittest();
+
+		puts("postings_cache");
+		JASS::postings_cache::unittest();
+
 		puts("run_export");
 		JASS::run_export::unittest();
 
 		puts("compress_general_zlib");
 		JASS::compress_general_zlib::unittest();
 
+		puts("anytime_cost");
+		anytime_cost::unittest();
+
 		puts("ALL UNIT TESTS HAVE PASSED");
 		failed = false;
 		}